@@ -71,6 +71,15 @@
 #define INIT_SIZE (100)
 //static int task_max_size;
 
+/* Whether task i waits for the earlier task j.  dag_task_dep[i] is the
+   row of dag_dep_cache for the instrument of task i, indexed by the
+   instrument of the earlier task, or NULL if task i waits for none */
+#define DAG_DEPENDS(csound, i, j)                                       \
+    ((csound)->dag_task_dep[i] != NULL &&                               \
+     (csound)->dag_task_dep[i][(csound)->dag_task_map[j]->insno] == 2)
+
+void dag_reinit(CSOUND *csound);
+
 static void dag_print_state(CSOUND *csound)
 {
     int i;
@@ -99,10 +108,9 @@ static void dag_print_state(CSOUND *csound)
         break;
       case WAITING:
         {
-          char *tt = csound->dag_task_dep[i];
           int j;
           printf("status=WAITING for tasks [");
-          for (j=0; j<i; j++) if (tt[j]) printf("%d ", j);
+          for (j=0; j<i; j++) if (DAG_DEPENDS(csound, i, j)) printf("%d ", j);
           printf("]\n");
         }
         break;
@@ -122,6 +130,7 @@ void create_dag(CSOUND *csound)
     csound->dag_task_map    = csound->Calloc(csound, sizeof(INSDS*)*max);
     csound->dag_task_dep    = (char **)csound->Calloc(csound, sizeof(char*)*max);
     csound->dag_wlmm = (watchList *)csound->Calloc(csound, sizeof(watchList)*max);
+    csound->dag_first_dep = (int *)csound->Calloc(csound, sizeof(int)*max);
 }
 
 void recreate_dag(CSOUND *csound)
@@ -140,6 +149,8 @@ void recreate_dag(CSOUND *csound)
       (char **)csound->ReAlloc(csound, csound->dag_task_dep, sizeof(char*)*max);
     csound->dag_wlmm        =
       (watchList *)csound->ReAlloc(csound, csound->dag_wlmm, sizeof(watchList)*max);
+    csound->dag_first_dep   =
+      (int *)csound->ReAlloc(csound, csound->dag_first_dep, sizeof(int)*max);
 }
 
 static INSTR_SEMANTICS *dag_get_info(CSOUND* csound, int insno)
@@ -177,92 +188,133 @@ static int dag_intersect(CSOUND *csound, struct set_t *current,
     return res;
 }
 
+/* Forget cached instrument dependencies, eg after a recompilation */
+void dag_flush_cache(CSOUND *csound)
+{
+    int i;
+    if (csound->dag_dep_cache == NULL) return;
+    for (i=0; i<csound->dag_dep_cache_size; i++)
+      if (csound->dag_dep_cache[i]) csound->Free(csound, csound->dag_dep_cache[i]);
+    csound->Free(csound, csound->dag_dep_cache);
+    csound->Free(csound, csound->dag_ins_first);
+    csound->dag_dep_cache = NULL;
+    csound->dag_ins_first = NULL;
+    csound->dag_dep_cache_size = 0;
+    csound->dag_changed++;
+}
+
+/* Whether a later instance of instrument b depends on an earlier instance
+   of instrument a.  This only depends on the pair, so the answer is kept
+   in dag_dep_cache[b][a]: 0 unknown, 1 independent, 2 dependent.  The row
+   of b is then the template of the dependencies of any instance of b */
+static int dag_depends(CSOUND *csound, int b, int a)
+{
+    char *row = csound->dag_dep_cache[b];
+    if (row == NULL)
+      row = csound->dag_dep_cache[b] =
+        (char *)csound->Calloc(csound, csound->dag_dep_cache_size);
+    if (row[a] == 0) {
+      INSTR_SEMANTICS *current_instr = dag_get_info(csound, a);
+      INSTR_SEMANTICS *later_instr = dag_get_info(csound, b);
+      int cnt = 0;
+      if (dag_intersect(csound, current_instr->write,
+                        later_instr->read, cnt++)       ||
+          dag_intersect(csound, current_instr->read_write,
+                        later_instr->read, cnt++)       ||
+          dag_intersect(csound, current_instr->read,
+                        later_instr->write, cnt++)      ||
+          dag_intersect(csound, current_instr->write,
+                        later_instr->write, cnt++)      ||
+          dag_intersect(csound, current_instr->read_write,
+                        later_instr->write, cnt++)      ||
+          dag_intersect(csound, current_instr->read,
+                        later_instr->read_write, cnt++) ||
+          dag_intersect(csound, current_instr->write,
+                        later_instr->read_write, cnt++))
+        row[a] = 2;
+      else row[a] = 1;
+    }
+    return row[a] == 2;
+}
+
+/* Bring the task list and dependencies up to date with the active chain.
+   No dependency is stored per pair of tasks: task i points at the cached
+   row of its instrument (see DAG_DEPENDS), so a note that starts or ends
+   only shifts the task list.  The first task that each task waits for,
+   which dag_reinit needs on every cycle, is the first instance of the
+   earliest instrument that its instrument depends on.  A change costs
+   O(n) for a chain of n instances plus O(k^2) lookups for the k distinct
+   instruments in it, which only run the set intersections for pairs not
+   seen before. */
 void dag_build(CSOUND *csound, INSDS *chain)
 {
-    INSDS *save = chain;
     INSDS **task_map;
-    int i;
+    int *first, *first_dep, *distinct;
+    int i, j, k = 0, size;
 
     //printf("DAG BUILD***************************************\n");
     csound->dag_num_active = 0;
-    while (chain != NULL) {
-      csound->dag_num_active++;
-      chain = chain->nxtact;
-    }
-    if (csound->dag_num_active>csound->dag_task_max_size) {
-      //printf("**************need to extend task vector\n");
-      csound->dag_task_max_size = csound->dag_num_active+INIT_SIZE;
-      recreate_dag(csound);
-    }
     if (csound->dag_task_status == NULL)
       create_dag(csound); /* Should move elsewhere */
-    else {
-      memset((void*)csound->dag_task_watch, '\0',
-             sizeof(watchList*)*csound->dag_task_max_size);
-      for (i=0; i<csound->dag_task_max_size; i++) {
-        if (csound->dag_task_dep[i]) {
-          csound->dag_task_dep[i]= NULL;
-        }
-        csound->dag_wlmm[i].id = INVALID;
+    for (; chain != NULL; chain = chain->nxtact) {
+      if (csound->dag_num_active == csound->dag_task_max_size) {
+        //printf("**************need to extend task vector\n");
+        csound->dag_task_max_size += INIT_SIZE;
+        recreate_dag(csound);
       }
+      csound->dag_task_map[csound->dag_num_active++] = chain;
     }
     task_map = csound->dag_task_map;
+    size = csound->engineState.maxinsno+1;
+    for (i=0; i<csound->dag_num_active; i++)
+      if (task_map[i]->insno >= size) size = task_map[i]->insno+1;
+    if (UNLIKELY(size > csound->dag_dep_cache_size)) {
+      dag_flush_cache(csound);
+      csound->dag_dep_cache =
+        (char **)csound->Calloc(csound, sizeof(char*)*size);
+      csound->dag_ins_first =
+        (int *)csound->Calloc(csound, sizeof(int)*2*size);
+      csound->dag_dep_cache_size = size;
+    }
+    /* dag_ins_first holds the first task of each instrument, then the
+       first task of any instrument each instrument depends on; the list
+       of distinct instruments is kept in dag_first_dep until it is set */
+    first = csound->dag_ins_first;
+    first_dep = first + csound->dag_dep_cache_size;
+    distinct = csound->dag_first_dep;
+    for (i=0; i<csound->dag_num_active; i++)
+      first[task_map[i]->insno] = -1;
     for (i=0; i<csound->dag_num_active; i++) {
-      csound->dag_task_status[i] = AVAILABLE;
-      csound->dag_wlmm[i].id=i;
+      int insno = task_map[i]->insno;
+      if (first[insno] < 0) {
+        first[insno] = i;
+        distinct[k++] = insno;
+      }
     }
-    csound->dag_changed = 0;
-    if (UNLIKELY(csound->oparms->odebug))
-      printf("dag_num_active = %d\n", csound->dag_num_active);
-    i = 0; chain = save;
-    while (chain != NULL) {     /* for each instance check against later */
-      int j = i+1;              /* count of instance */
-      if (UNLIKELY(csound->oparms->odebug))
-        printf("\nWho depends on %d (instr %d)?\n", i, chain->insno);
-      INSDS *next = chain->nxtact;
-      INSTR_SEMANTICS *current_instr = dag_get_info(csound, chain->insno);
-      //csp_set_print(csound, current_instr->read);
-      //csp_set_print(csound, current_instr->write);
-      while (next) {
-        INSTR_SEMANTICS *later_instr = dag_get_info(csound, next->insno);
-        int cnt = 0;
-        if (UNLIKELY(csound->oparms->odebug)) printf("%d ", j);
-        //csp_set_print(csound, later_instr->read);
-        //csp_set_print(csound, later_instr->write);
-        //csp_set_print(csound, later_instr->read_write);
-        if (dag_intersect(csound, current_instr->write,
-                          later_instr->read, cnt++)       ||
-            dag_intersect(csound, current_instr->read_write,
-                          later_instr->read, cnt++)       ||
-            dag_intersect(csound, current_instr->read,
-                          later_instr->write, cnt++)      ||
-            dag_intersect(csound, current_instr->write,
-                          later_instr->write, cnt++)      ||
-            dag_intersect(csound, current_instr->read_write,
-                          later_instr->write, cnt++)      ||
-            dag_intersect(csound, current_instr->read,
-                          later_instr->read_write, cnt++) ||
-            dag_intersect(csound, current_instr->write,
-                          later_instr->read_write, cnt++)) {
-          char *tt = csound->dag_task_dep[j];
-          if (tt==NULL) {
-            /* get dep vector if missing and set watch first time */
-            tt = csound->dag_task_dep[j] =
-              (char*)csound->Calloc(csound, sizeof(char)*(j+1));
-            csound->dag_task_status[j] = WAITING;
-            csound->dag_wlmm[j].next = csound->dag_task_watch[i];
-            csound->dag_wlmm[j].id = j;
-            csound->dag_task_watch[i] = &(csound->dag_wlmm[j]);
-            //printf("set watch %d to %d\n", j, i);
-          }
-          tt[i] = 1;
-          //printf("-yes ");
-        }
-        j++; next = next->nxtact;
+    for (i=0; i<k; i++) {
+      int b = distinct[i];
+      first_dep[b] = INT_MAX;
+      for (j=0; j<k; j++)
+        if (dag_depends(csound, b, distinct[j]) &&
+            first[distinct[j]] < first_dep[b])
+          first_dep[b] = first[distinct[j]];
+    }
+    for (i=0; i<csound->dag_num_active; i++) {
+      int insno = task_map[i]->insno;
+      if (first_dep[insno] < i) {
+        csound->dag_first_dep[i] = first_dep[insno];
+        csound->dag_task_dep[i] = csound->dag_dep_cache[insno];
+      }
+      else {
+        csound->dag_first_dep[i] = -1;
+        csound->dag_task_dep[i] = NULL;
       }
-      task_map[i] = chain;
-      i++; chain = chain->nxtact;
     }
+    if (UNLIKELY(csound->oparms->odebug))
+      printf("dag_num_active = %d, instruments = %d\n",
+             csound->dag_num_active, k);
+    csound->dag_changed = 0;
+    dag_reinit(csound);
     if (UNLIKELY(csound->oparms->odebug)) dag_print_state(csound);
 }
 
@@ -280,18 +332,14 @@ void dag_reinit(CSOUND *csound)
     task_status[0] = AVAILABLE;
     task_watch[0] = NULL;
     for (i=1; i<csound->dag_num_active; i++) {
-      int j;
+      int j = csound->dag_first_dep[i];
       task_status[i] = AVAILABLE;
       task_watch[i] = NULL;
-      if (csound->dag_task_dep[i]==NULL) continue;
-      for (j=0; j<i; j++)
-        if (csound->dag_task_dep[i][j]) {
-          task_status[i] = WAITING;
-          wlmm[i].id = i;
-          wlmm[i].next = task_watch[j];
-          task_watch[j] = &wlmm[i];
-          break;
-        }
+      if (j < 0) continue;
+      task_status[i] = WAITING;
+      wlmm[i].id = i;
+      wlmm[i].next = task_watch[j];
+      task_watch[j] = &wlmm[i];
     }
     //dag_print_state(csound);
 }
@@ -368,8 +416,8 @@ void dag_end_task(CSOUND *csound, taskID i)
       j = to_notify->id;
       //printf("%d notifying task %d it finished\n", i, j);
       canQueue = 1;
-      for (k=0; k<j; k++) {     /* seek next watch */
-        if (csound->dag_task_dep[j][k]==0) continue;
+      for (k=csound->dag_first_dep[j]; k<j; k++) { /* seek next watch */
+        if (!DAG_DEPENDS(csound, j, k)) continue;
         //printf("investigating task %d (%d)\n", k, csound->dag_task_status[k]);
         if (ATOMIC_READ(csound->dag_task_status[k]) != DONE) {
           //printf("found task %d to watch %d status %d\n",
@@ -396,6 +444,274 @@ void dag_end_task(CSOUND *csound, taskID i)
     return;
 }
 
+/* Work-stealing dispatch (--par-scheduler=steal)
+ *
+ * Each performance thread owns a deque of ready tasks.  The main thread
+ * seeds the deques with the tasks that have no prerequisites; a thread
+ * that finishes a task decrements the predecessor count of each of its
+ * dependents and pushes those reaching zero on its own deque.  Idle
+ * threads steal from the top of the other deques, spin for a bounded
+ * time and then park until woken by a push or the end of the cycle.
+ *
+ * Every task is pushed exactly once per k-cycle, so the deques never
+ * wrap and are simply reset at the start of each cycle.
+ */
+
+#define DAG_WS_SPIN    (2048)       /* pause loops before parking */
+#define DAG_WS_PARK_MS (1)          /* bound on a single park */
+#define CACHE_LINE     (64)
+
+typedef struct {
+    volatile int  top;              /* stolen from here */
+    char          pad1[CACHE_LINE-sizeof(int)];
+    volatile int  bottom;           /* owner pushes and pops here */
+    char          pad2[CACHE_LINE-sizeof(int)];
+    taskID        *tasks;
+    char          pad3[CACHE_LINE-sizeof(taskID*)];
+} DAG_DEQUE;
+
+typedef struct dag_ws_t {
+    int           nthreads;
+    int           size;             /* capacity of each deque/task array */
+    DAG_DEQUE     *deques;
+    int           *npred;           /* number of prerequisites of each task */
+    volatile int  *remaining;       /* prerequisites not yet done this cycle */
+    int           *succ_start;      /* dependents of task i are         */
+    taskID        *succ;            /* succ[succ_start[i]..succ_start[i+1]] */
+    int           succ_max;
+    volatile int  pending;          /* tasks not yet done this cycle */
+    volatile int  *parked;
+    void          **wakeup;         /* one thread lock per thread */
+    volatile long steals, parks;
+} DAG_WS;
+
+static inline void dag_ws_pause(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static int dag_ws_destroy(CSOUND *csound, void *userData)
+{
+    DAG_WS *ws = (DAG_WS*) userData;
+    int i;
+    if (UNLIKELY(csound->oparms->odebug))
+      csound->Message(csound, Str("work stealing: %ld steals, %ld parks\n"),
+                      ws->steals, ws->parks);
+    for (i = 0; i < ws->nthreads; i++)
+      csound->DestroyThreadLock(ws->wakeup[i]);
+    csound->dag_ws = NULL;
+    return 0;
+}
+
+static DAG_WS *dag_ws_create(CSOUND *csound)
+{
+    DAG_WS *ws = (DAG_WS*) csound->Calloc(csound, sizeof(DAG_WS));
+    int i, n = csound->oparms->numThreads;
+    ws->nthreads = n;
+    ws->deques = (DAG_DEQUE*) csound->Calloc(csound, sizeof(DAG_DEQUE)*n);
+    ws->parked = (volatile int*) csound->Calloc(csound, sizeof(int)*n);
+    ws->wakeup = (void**) csound->Calloc(csound, sizeof(void*)*n);
+    for (i = 0; i < n; i++)
+      ws->wakeup[i] = csound->CreateThreadLock();
+    csound->RegisterResetCallback(csound, (void*) ws, dag_ws_destroy);
+    return ws;
+}
+
+static void dag_ws_resize(CSOUND *csound, DAG_WS *ws, int size)
+{
+    int i;
+    for (i = 0; i < ws->nthreads; i++)
+      ws->deques[i].tasks =
+        (taskID*) csound->ReAlloc(csound, ws->deques[i].tasks,
+                                  sizeof(taskID)*size);
+    ws->npred = (int*) csound->ReAlloc(csound, ws->npred, sizeof(int)*size);
+    ws->remaining = (volatile int*)
+      csound->ReAlloc(csound, (void*) ws->remaining, sizeof(int)*size);
+    ws->succ_start =
+      (int*) csound->ReAlloc(csound, ws->succ_start, sizeof(int)*(size+1));
+    ws->size = size;
+}
+
+/* Turn the dependencies found by dag_build into predecessor counts
+   and a compact list of dependents for each task */
+static void dag_ws_edges(CSOUND *csound, DAG_WS *ws)
+{
+    int i, j, n = csound->dag_num_active, edges = 0;
+    int *fill;
+
+    memset(ws->npred, 0, sizeof(int)*n);
+    memset(ws->succ_start, 0, sizeof(int)*(n+1));
+    for (j = 0; j < n; j++) {
+      if (csound->dag_task_dep[j] == NULL) continue;
+      for (i = csound->dag_first_dep[j]; i < j; i++)
+        if (DAG_DEPENDS(csound, j, i)) {
+          ws->npred[j]++;
+          ws->succ_start[i+1]++;
+          edges++;
+        }
+    }
+    for (i = 0; i < n; i++)
+      ws->succ_start[i+1] += ws->succ_start[i];
+    if (edges > ws->succ_max) {
+      ws->succ_max = edges+INIT_SIZE;
+      ws->succ = (taskID*) csound->ReAlloc(csound, ws->succ,
+                                           sizeof(taskID)*ws->succ_max);
+    }
+    /* remaining is reset for every cycle, so borrow it as the fill cursor */
+    fill = (int*) ws->remaining;
+    memcpy(fill, ws->succ_start, sizeof(int)*n);
+    for (j = 0; j < n; j++) {
+      if (csound->dag_task_dep[j] == NULL) continue;
+      for (i = csound->dag_first_dep[j]; i < j; i++)
+        if (DAG_DEPENDS(csound, j, i)) ws->succ[fill[i]++] = j;
+    }
+}
+
+/* Called by the main thread before releasing the workers; changed is
+   non-zero if dag_build has just been run */
+void dag_ws_reinit(CSOUND *csound, int changed)
+{
+    DAG_WS *ws = csound->dag_ws;
+    int i, n = csound->dag_num_active;
+
+    if (UNLIKELY(ws == NULL)) {
+      ws = csound->dag_ws = dag_ws_create(csound);
+      changed = 1;
+    }
+    if (n > ws->size) {
+      dag_ws_resize(csound, ws, csound->dag_task_max_size > n ?
+                    csound->dag_task_max_size : n);
+      changed = 1;
+    }
+    if (changed) dag_ws_edges(csound, ws);
+    for (i = 0; i < ws->nthreads; i++)
+      ws->deques[i].top = ws->deques[i].bottom = 0;
+    for (i = 0; i < n; i++) {
+      ws->remaining[i] = ws->npred[i];
+      if (ws->npred[i] == 0) {    /* deal roots round robin */
+        DAG_DEQUE *d = &ws->deques[i % ws->nthreads];
+        d->tasks[d->bottom++] = (taskID)i;
+      }
+    }
+    ws->pending = n;
+    __sync_synchronize();
+}
+
+static inline void dag_ws_push(DAG_DEQUE *d, taskID t)
+{
+    int b = d->bottom;
+    d->tasks[b] = t;
+    __sync_synchronize();
+    d->bottom = b+1;
+}
+
+static inline taskID dag_ws_pop(DAG_DEQUE *d)
+{
+    int b = d->bottom-1, t;
+    taskID task;
+    d->bottom = b;
+    __sync_synchronize();
+    t = d->top;
+    if (t > b) {                /* empty */
+      d->bottom = b+1;
+      return INVALID;
+    }
+    task = d->tasks[b];
+    if (t == b) {               /* last one: race thieves for it */
+      if (!ATOMIC_CAS(&d->top, t, t+1)) task = INVALID;
+      d->bottom = b+1;
+    }
+    return task;
+}
+
+static inline taskID dag_ws_steal(DAG_DEQUE *d)
+{
+    int t = d->top, b;
+    taskID task;
+    __sync_synchronize();
+    b = d->bottom;
+    if (t >= b) return INVALID;
+    task = d->tasks[t];
+    if (!ATOMIC_CAS(&d->top, t, t+1)) return WAIT;   /* lost the race */
+    return task;
+}
+
+static inline int dag_ws_has_work(DAG_WS *ws)
+{
+    int i;
+    for (i = 0; i < ws->nthreads; i++)
+      if (ws->deques[i].top < ws->deques[i].bottom) return 1;
+    return 0;
+}
+
+/* Wake up to cnt parked threads */
+static void dag_ws_wake(CSOUND *csound, DAG_WS *ws, int cnt)
+{
+    int i;
+    __sync_synchronize();
+    for (i = 0; i < ws->nthreads && cnt > 0; i++)
+      if (ws->parked[i]) {
+        csound->NotifyThreadLock(ws->wakeup[i]);
+        cnt--;
+      }
+}
+
+/* Returns a task to run or INVALID when every task of this cycle is done */
+taskID dag_ws_get_task(CSOUND *csound, int index)
+{
+    DAG_WS *ws = csound->dag_ws;
+    int n = ws->nthreads;
+    int spin = 0;
+    taskID task;
+
+    while (1) {
+      int i, contended = 0;
+      if ((task = dag_ws_pop(&ws->deques[index])) != INVALID) return task;
+      for (i = 1; i < n; i++) {
+        task = dag_ws_steal(&ws->deques[(index+i)%n]);
+        if (task == WAIT) contended = 1;
+        else if (task != INVALID) {
+          ws->steals++;         /* statistic only, races do not matter */
+          return task;
+        }
+      }
+      if (ATOMIC_READ(ws->pending) == 0) return INVALID;
+      if (contended || ++spin < DAG_WS_SPIN) {
+        dag_ws_pause();
+        continue;
+      }
+      /* Park; a pusher that misses our flag is covered by the recheck */
+      ws->parked[index] = 1;
+      __sync_synchronize();
+      if (!dag_ws_has_work(ws) && ATOMIC_READ(ws->pending) != 0) {
+        ws->parks++;
+        csound->WaitThreadLock(ws->wakeup[index], DAG_WS_PARK_MS);
+      }
+      ws->parked[index] = 0;
+      spin = 0;
+    }
+}
+
+void dag_ws_end_task(CSOUND *csound, int index, taskID i)
+{
+    DAG_WS *ws = csound->dag_ws;
+    int k, pushed = 0;
+    for (k = ws->succ_start[i]; k < ws->succ_start[i+1]; k++) {
+      taskID j = ws->succ[k];
+      if (__sync_sub_and_fetch(&ws->remaining[j], 1) == 0) {
+        dag_ws_push(&ws->deques[index], j);
+        pushed++;
+      }
+    }
+    /* Keep one for ourselves; wake a sleeper only for the surplus */
+    if (__sync_sub_and_fetch(&ws->pending, 1) == 0)
+      dag_ws_wake(csound, ws, ws->nthreads);
+    else if (pushed > 1)
+      dag_ws_wake(csound, ws, pushed-1);
+}
+
 
 /* INV : Acyclic */
 /* INV : Each entry is read by a single thread,
@@ -54,6 +54,7 @@ void named_instr_assign_numbers(CSOUND *csound, ENGINE_STATE *engineState);
 int named_instr_alloc(CSOUND *csound, char *s, INSTRTXT *ip, int32 insno,
                       ENGINE_STATE *engineState, int merge);
 int check_instr_name(char *s);
+void dag_flush_cache(CSOUND *csound);
 
 extern const char* SYNTHESIZED_ARG;
 
@@ -862,6 +863,12 @@ void free_instrtxt(CSOUND *csound, INSTRTXT *instrtxt)
       csound->Free(csound, active);
       active = nxt;
     }
+    active = ip->pool_ready;    /* built by the pool, never activated */
+    while (active != NULL) {
+      INSDS   *nxt = active->nxtact;
+      csound->Free(csound, active);
+      active = nxt;
+    }
     OPTXT *t = ip->nxtop;
     while (t) {
           OPTXT *s = t->nxtop;
@@ -881,6 +888,8 @@ void free_instrtxt(CSOUND *csound, INSTRTXT *instrtxt)
 
 
 
+extern int init_pass_pending(CSOUND *);
+
 /**
  * This function has two purposes:
  * 1) check deadpool for active instances, and
@@ -901,8 +910,8 @@ void add_to_deadpool(CSOUND *csound, INSTRTXT *instrtxt)
           }
           active = active->nxtinstance;
         }
-        /* no active instances */
-        if (active == NULL) {
+        /* no active instances, and none waiting for init */
+        if (active == NULL && !init_pass_pending(csound)) {
         if (csound->oparms->odebug)
           csound->Message(csound, Str(" -- free instr def %p \n"),
                           csound->dead_instr_pool[i]);
@@ -1293,6 +1302,8 @@ int engineState_merge(CSOUND *csound, ENGINE_STATE *engineState)
       }
     }
     (&(current_state->instxtanchor))->nxtinstxt = csound->instr0;
+    /* instruments may have been redefined, so their dependencies too */
+    dag_flush_cache(csound);
     return 0;
 }
 
@@ -1550,6 +1561,8 @@ PUBLIC int csoundCompileTree(CSOUND *csound, TREE *root)
     csoundLockMutex(csound->API_lock);
     if (csound->init_pass_threadlock)
       csoundLockMutex(csound->init_pass_threadlock);
+    if (csound->instance_pool_lock)
+      csoundLockMutex(csound->instance_pool_lock);
     if (engineState != &csound->engineState) {
       OPDS *ids = csound->ids;
       /* any compilation other than the first one */
@@ -1607,6 +1620,8 @@ PUBLIC int csoundCompileTree(CSOUND *csound, TREE *root)
 
     }
 
+    if (csound->instance_pool_lock)
+      csoundUnlockMutex(csound->instance_pool_lock);
     if (csound->init_pass_threadlock)
       csoundUnlockMutex(csound->init_pass_threadlock);
     /* notify API lock  */
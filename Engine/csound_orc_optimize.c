@@ -24,6 +24,9 @@
 
 #include "csoundCore.h"
 #include "csound_orc.h"
+#include "csound_standard_types.h"
+#include "aops.h"
+#include "interlocks.h"
 
 static TREE * create_fun_token(CSOUND *csound, TREE *right, char *fname)
 {
@@ -216,10 +219,1002 @@ static TREE * verify_tree1(CSOUND *csound, TREE *root)
     return root;
 }
 
+/* UDO inlining
+
+   A call to a UDO is replaced by the statements of its body when the
+   UDO is small, calls no other UDO (those are inlined first, so chains
+   collapse from the leaves up), has no setksmps, starts with xin, ends
+   with xout, and the call does not ask for a local ksmps.  The body's
+   local variables and labels are renamed into the caller with an '@n'
+   suffix, which keeps the type prefix and cannot clash with a name in
+   the source.
+
+   i-, k- and a-rate xin variables the body never writes (opcodes
+   flagged IW write their inputs) are replaced by the caller's
+   arguments; arrays never are.  xout variables the body writes on
+   every k-cycle (perf time opcodes, no labels) and never reads are
+   replaced by the caller's outputs.
+   i- and a-rate arguments that do not qualify are copied with '=',
+   which runs at the same pass as the copy made by xin or xout; a call
+   that would need any other copy is left alone. */
+
+extern OPCODINFO *find_opcode_info(CSOUND *, char *, char *, char *);
+extern int pnum(char *);
+extern OENTRY *find_opcode_new(CSOUND *, char *, char *, char *);
+extern OENTRY *find_opcode(CSOUND *, char *);
+
+#define INLINE_PASSES   8       /* depth of nested calls inlined */
+#define INLINE_STATEMENTS 32    /* largest body inlined by --opt-level=2 */
+
+typedef struct {
+    TREE        *udo;           /* UDO_TOKEN node */
+    OPCODINFO   *info;
+    CS_VAR_POOL *pool;
+    TREE        *xin, *xout;    /* NULL if absent */
+    int         labels;
+    int         ok;             /* may be inlined */
+} INLINE_UDO;
+
+typedef struct {
+    INLINE_UDO  *def;
+    TREE        **in, **out;    /* the caller's arguments */
+    char        *subst_in, *subst_out;
+    int         serial;
+} INLINE_CALL;
+
+static int tree_count(TREE *t)
+{
+    int n = 0;
+    for ( ; t != NULL; t = t->next) n++;
+    return n;
+}
+
+static TREE *tree_nth(TREE *t, int n)
+{
+    while (t != NULL && n--) t = t->next;
+    return t;
+}
+
+static OENTRY *stmt_oentry(TREE *t)
+{
+    return t->type == LABEL_TOKEN ? NULL : (OENTRY *) t->markup;
+}
+
+static int is_global_name(const char *s)
+{
+    return s[0] == 'g' || (s[0] == '#' && s[1] == 'g');
+}
+
+/* largest body inlined: --inline-udos, or the one --opt-level asks for */
+static int inline_limit(CSOUND *csound)
+{
+    OPARMS *O = csound->oparms;
+    if (O->inlineUDOs >= 0)
+      return O->inlineUDOs;
+    return O->optLevel >= 2 ? INLINE_STATEMENTS : 0;
+}
+
+/* check a UDO body once: see the comment above for the conditions */
+static void inline_check(CSOUND *csound, INLINE_UDO *u)
+{
+    TREE    *t;
+    int     n = 0;
+
+    u->xin = u->xout = NULL;
+    u->labels = 0;
+    u->ok = u->info != NULL;
+    for (t = u->udo->right; t != NULL && u->ok; t = t->next) {
+      OENTRY *ep = stmt_oentry(t);
+      if (t->type == LABEL_TOKEN)
+        u->labels = 1;
+      else if (ep == NULL || ep->useropinfo != NULL ||
+               !strcmp(ep->opname, "setksmps"))
+        u->ok = 0;
+      else if (!strcmp(ep->opname, "xin")) {
+        if (t != u->udo->right) u->ok = 0;
+        u->xin = t;
+        continue;
+      }
+      else if (!strcmp(ep->opname, "xout")) {
+        if (t->next != NULL) u->ok = 0;
+        u->xout = t;
+        continue;
+      }
+      n++;
+    }
+    if (n > inline_limit(csound) || u->info == NULL ||
+        (u->info->outchns > 0 && u->xout == NULL) ||
+        (u->xout != NULL && tree_count(u->xout->right) != u->info->outchns) ||
+        (u->xin != NULL && tree_count(u->xin->left) != u->info->inchns))
+      u->ok = 0;
+}
+
+/* does a statement of the body write (or read) the name? */
+static int body_writes(TREE *body, const char *name, int perf_only)
+{
+    TREE *t, *a;
+    for (t = body; t != NULL; t = t->next) {
+      OENTRY *ep = stmt_oentry(t);
+      if (ep == NULL || !strcmp(ep->opname, "xin"))
+        continue;
+      for (a = t->left; a != NULL; a = a->next)
+        if (a->value != NULL && !strcmp(a->value->lexeme, name) &&
+            (!perf_only || (ep->thread & 06) != 0 || (ep->thread & 07) == 0))
+          return 1;
+      /* opcodes flagged IW write to their input arguments */
+      if (!perf_only && (ep->flags & IW))
+        for (a = t->right; a != NULL; a = a->next)
+          if (a->value != NULL && !strcmp(a->value->lexeme, name))
+            return 1;
+    }
+    return 0;
+}
+
+static int body_reads(TREE *body, const char *name)
+{
+    TREE *t, *a;
+    for (t = body; t != NULL; t = t->next) {
+      OENTRY *ep = stmt_oentry(t);
+      if (ep == NULL || !strcmp(ep->opname, "xout"))
+        continue;
+      for (a = t->right; a != NULL; a = a->next)
+        if (a->value != NULL && !strcmp(a->value->lexeme, name))
+          return 1;
+    }
+    return 0;
+}
+
+static char *inline_name(CSOUND *csound, const char *name, int serial)
+{
+    char *s = csound->Malloc(csound, strlen(name) + 16);
+    sprintf(s, "%s@%d", name, serial);
+    return s;
+}
+
+/* the caller's token that replaces 'name' in the body, if any */
+static TREE *inline_subst(INLINE_CALL *c, const char *name)
+{
+    OPCODINFO *info = c->def->info;
+    TREE *a;
+    int  i;
+    if (c->def->xin != NULL)
+      for (i = 0, a = c->def->xin->left; a != NULL; i++, a = a->next)
+        if (c->subst_in[i] && !strcmp(a->value->lexeme, name))
+          return c->in[i];
+    if (c->def->xout != NULL)
+      for (i = 0, a = c->def->xout->right; a != NULL && i < info->outchns;
+           i++, a = a->next)
+        if (c->subst_out[i] && !strcmp(a->value->lexeme, name))
+          return c->out[i];
+    return NULL;
+}
+
+static int is_body_label(TREE *body, const char *name)
+{
+    for ( ; body != NULL; body = body->next)
+      if (body->type == LABEL_TOKEN && !strcmp(body->value->lexeme, name))
+        return 1;
+    return 0;
+}
+
+static ORCTOKEN *copy_token(CSOUND *csound, ORCTOKEN *v, char *lexeme)
+{
+    ORCTOKEN *ans = (ORCTOKEN *) csound->Malloc(csound, sizeof(ORCTOKEN));
+    *ans = *v;
+    ans->next = NULL;
+    if (lexeme != NULL)
+      ans->lexeme = lexeme;
+    else if (v->lexeme != NULL)
+      ans->lexeme = cs_strdup(csound, v->lexeme);
+    return ans;
+}
+
+static TREE *copy_node(CSOUND *csound, TREE *t)
+{
+    TREE *ans = (TREE *) csound->Malloc(csound, sizeof(TREE));
+    *ans = *t;
+    ans->left = ans->right = ans->next = NULL;
+    ans->value = t->value ? copy_token(csound, t->value, NULL) : NULL;
+    return ans;
+}
+
+/* copy an argument of the body into the caller */
+static TREE *inline_arg(CSOUND *csound, INLINE_CALL *c, TREE *t);
+
+static TREE *inline_args(CSOUND *csound, INLINE_CALL *c, TREE *t)
+{
+    TREE *head = NULL, **tail = &head;
+    for ( ; t != NULL; t = t->next) {
+      *tail = inline_arg(csound, c, t);
+      tail = &(*tail)->next;
+    }
+    return head;
+}
+
+static TREE *inline_arg(CSOUND *csound, INLINE_CALL *c, TREE *t)
+{
+    TREE *ans, *sub = NULL;
+    char *name = (t->value != NULL) ? t->value->lexeme : NULL;
+    if (name != NULL && (sub = inline_subst(c, name)) != NULL) {
+      ans = copy_node(csound, sub);
+      ans->markup = t->markup;
+    }
+    else {
+      ans = copy_node(csound, t);
+      if (name != NULL &&
+          (csoundFindVariableWithName(csound, c->def->pool, name) != NULL ||
+           is_body_label(c->def->udo->right, name))) {
+        csound->Free(csound, ans->value->lexeme);
+        ans->value->lexeme = inline_name(csound, name, c->serial);
+      }
+    }
+    ans->left = inline_args(csound, c, t->left);
+    ans->right = inline_args(csound, c, t->right);
+    return ans;
+}
+
+/* '=' from src to dst, for the i- and a-rate copies */
+static TREE *inline_copy(CSOUND *csound, TREE *dst, TREE *src, OENTRY *ep)
+{
+    TREE *ans = make_leaf(csound, src->line, src->locn, '=',
+                          make_token(csound, "="));
+    ans->markup = ep;
+    ans->left = dst;
+    ans->right = src;
+    return ans;
+}
+
+/* the '=' opcode for a copy of var, NULL if it cannot be copied */
+static OENTRY *inline_copy_op(CSOUND *csound, CS_VARIABLE *var)
+{
+    char  *t;
+    if (var == NULL)
+      return NULL;
+    t = var->varType->varTypeName;
+    if (strcmp(t, "i") && strcmp(t, "a"))
+      return NULL;
+    return find_opcode_new(csound, "=", t, t);
+}
+
+/* replace the call at *link with the body of c->def; returns the next
+   statement to look at (the first inlined one) or NULL if not inlined */
+static TREE *inline_call(CSOUND *csound, TREE **link, INLINE_UDO *u,
+                         CS_VAR_POOL *pool, int serial)
+{
+    TREE        *call = *link, *a, *head = NULL, **tail = &head, *t;
+    OPCODINFO   *info = u->info;
+    INLINE_CALL c;
+    OENTRY      **copy_in, **copy_out;
+    CS_VARIABLE *var;
+    int         i, j, nin = info->inchns, nout = info->outchns, ok = 1;
+
+    if (tree_count(call->left) != nout || tree_count(call->right) < nin ||
+        tree_count(call->right) > nin + 1)
+      return NULL;
+    /* an explicit local ksmps */
+    if ((a = tree_nth(call->right, nin)) != NULL &&
+        !((a->type == INTEGER_TOKEN && a->value->value == 0) ||
+          (a->type == NUMBER_TOKEN && a->value->fvalue == 0.0)))
+      return NULL;
+
+    c.def = u;
+    c.serial = serial;
+    c.in = (TREE **) csound->Calloc(csound, (nin + nout + 1) * sizeof(TREE *));
+    c.out = c.in + nin;
+    c.subst_in = (char *) csound->Calloc(csound, nin + nout + 1);
+    c.subst_out = c.subst_in + nin;
+    copy_in = (OENTRY **) csound->Calloc(csound,
+                                         (nin + nout + 1) * sizeof(OENTRY *));
+    copy_out = copy_in + nin;
+    for (i = 0; i < nin; i++)
+      c.in[i] = tree_nth(call->right, i);
+    for (i = 0; i < nout; i++)
+      c.out[i] = tree_nth(call->left, i);
+
+    for (i = 0, a = u->xin ? u->xin->left : NULL; i < nin && ok;
+         i++, a = a ? a->next : NULL) {
+      char *name = a ? a->value->lexeme : NULL;
+      char *arg = c.in[i]->value->lexeme;
+      if (name == NULL)
+        continue;
+      var = csoundFindVariableWithName(csound, u->pool, name);
+      c.subst_in[i] = var != NULL &&
+        (var->varType == &CS_VAR_TYPE_A || var->varType == &CS_VAR_TYPE_K ||
+         var->varType == &CS_VAR_TYPE_I) &&
+        !body_writes(u->udo->right, name, 0) &&
+                      !(is_global_name(arg) &&
+                        body_writes(u->udo->right, arg, 0));
+      for (j = 0; j < nout; j++)
+        if (!strcmp(arg, c.out[j]->value->lexeme))
+          c.subst_in[i] = 0;
+      if (!c.subst_in[i] && (copy_in[i] = inline_copy_op(csound, var)) == NULL)
+        ok = 0;
+    }
+    for (i = 0, a = u->xout ? u->xout->right : NULL; i < nout && ok;
+         i++, a = a->next) {
+      char *name = a->value->lexeme;
+      char *arg = c.out[i]->value->lexeme;
+      TREE *b;
+      var = csoundFindVariableWithName(csound, u->pool, name);
+      c.subst_out[i] = var != NULL && !u->labels &&
+        !is_global_name(arg) && pnum(arg) < 0 &&
+        (var->varType == &CS_VAR_TYPE_A || var->varType == &CS_VAR_TYPE_K ||
+         var->varType == &CS_VAR_TYPE_I) &&
+        body_writes(u->udo->right, name, var->varType != &CS_VAR_TYPE_I) &&
+        !body_reads(u->udo->right, name);
+      if (u->xin != NULL)
+        for (b = u->xin->left; b != NULL; b = b->next)
+          if (!strcmp(b->value->lexeme, name))
+            c.subst_out[i] = 0;
+      for (j = 0, b = u->xout->right; j < nout; j++, b = b->next)
+        if (j != i && (!strcmp(b->value->lexeme, name) ||
+                       !strcmp(c.out[j]->value->lexeme, arg)))
+          c.subst_out[i] = 0;
+      if (!c.subst_out[i] &&
+          (copy_out[i] = inline_copy_op(csound, var != NULL ? var :
+                 csoundFindVariableWithName(csound, pool, arg))) == NULL)
+        ok = 0;
+    }
+    if (!ok) {
+      csound->Free(csound, c.in);
+      csound->Free(csound, c.subst_in);
+      csound->Free(csound, copy_in);
+      return NULL;
+    }
+
+    /* the body's variables, renamed into the caller */
+    for (var = u->pool->head; var != NULL; var = var->next) {
+      ARRAY_VAR_INIT init;
+      CS_VARIABLE *nvar;
+      char *name;
+      if (inline_subst(&c, var->varName) != NULL)
+        continue;
+      init.dimensions = var->dimensions;
+      init.type = var->subType;
+      name = inline_name(csound, var->varName, serial);
+      nvar = csoundCreateVariable(csound, csound->typePool, var->varType,
+                                  name, var->subType ? &init : NULL);
+      csoundAddVariable(csound, pool, nvar);
+      csound->Free(csound, name);
+    }
+
+    for (i = 0, a = u->xin ? u->xin->left : NULL; i < nin;
+         i++, a = a ? a->next : NULL)
+      if (a != NULL && !c.subst_in[i]) {
+        TREE *dst = copy_node(csound, a);
+        csound->Free(csound, dst->value->lexeme);
+        dst->value->lexeme = inline_name(csound, a->value->lexeme, serial);
+        TREE *src = copy_node(csound, c.in[i]);
+        src->markup = NULL;
+        *tail = inline_copy(csound, dst, src, copy_in[i]);
+        tail = &(*tail)->next;
+      }
+    for (t = u->udo->right; t != NULL; t = t->next) {
+      TREE *s;
+      if (t == u->xin || t == u->xout)
+        continue;
+      s = copy_node(csound, t);
+      if (t->type == LABEL_TOKEN) {
+        csound->Free(csound, s->value->lexeme);
+        s->value->lexeme = inline_name(csound, t->value->lexeme, serial);
+      }
+      s->left = inline_args(csound, &c, t->left);
+      s->right = inline_args(csound, &c, t->right);
+      *tail = s;
+      tail = &s->next;
+    }
+    for (i = 0, a = u->xout ? u->xout->right : NULL; i < nout;
+         i++, a = a->next)
+      if (!c.subst_out[i]) {
+        *tail = inline_copy(csound, copy_node(csound, c.out[i]),
+                            inline_arg(csound, &c, a), copy_out[i]);
+        tail = &(*tail)->next;
+      }
+
+    csound->Free(csound, c.in);
+    csound->Free(csound, c.subst_in);
+    csound->Free(csound, copy_in);
+
+    /* splice */
+    *tail = call->next;
+    *link = head != NULL ? head : call->next;
+    call->next = NULL;
+    csoundDeleteTree(csound, call);
+    return *link;
+}
+
+/* inline calls to UDOs in the statement list of 'node'; returns the
+   number of calls inlined */
+static int inline_list(CSOUND *csound, TREE *node, INLINE_UDO *udos, int n,
+                       int *serial)
+{
+    CS_VAR_POOL *pool = (CS_VAR_POOL *) node->markup;
+    TREE        **link = &node->right;
+    int         count = 0;
+
+    while (*link != NULL) {
+      OENTRY    *ep = stmt_oentry(*link);
+      int       i;
+      if (ep != NULL && ep->useropinfo != NULL)
+        for (i = 0; i < n; i++)
+          if (udos[i].ok && udos[i].info == ep->useropinfo &&
+              udos[i].udo != node) {
+            if (inline_call(csound, link, &udos[i], pool, ++(*serial))) {
+              count++;
+              break;
+            }
+          }
+      if (*link == NULL)
+        break;
+      /* after inlining, *link is the first inlined statement; it calls no
+         UDO, so moving on is safe */
+      link = &(*link)->next;
+    }
+    return count;
+}
+
+static void inline_udos(CSOUND *csound, TREE *root)
+{
+    INLINE_UDO  *udos;
+    TREE        *t;
+    int         n = 0, i, pass, serial = 0, count = 0, changed;
+
+    for (t = root; t != NULL; t = t->next)
+      if (t->type == UDO_TOKEN) n++;
+    if (n == 0)
+      return;
+    udos = (INLINE_UDO *) csound->Calloc(csound, n * sizeof(INLINE_UDO));
+    for (i = 0, t = root; t != NULL; t = t->next)
+      if (t->type == UDO_TOKEN) {
+        udos[i].udo = t;
+        udos[i].pool = (CS_VAR_POOL *) t->markup;
+        udos[i].info = find_opcode_info(csound, t->left->value->lexeme,
+                                        t->left->left->value->lexeme,
+                                        t->left->right->value->lexeme);
+        i++;
+      }
+    /* collapse UDO chains from the leaves up */
+    for (pass = 0; pass < INLINE_PASSES; pass++) {
+      for (i = 0; i < n; i++)
+        inline_check(csound, &udos[i]);
+      for (changed = 0, i = 0; i < n; i++)
+        if (udos[i].udo->right != NULL)
+          changed += inline_list(csound, udos[i].udo, udos, n, &serial);
+      count += changed;
+      if (!changed)
+        break;
+    }
+    for (i = 0; i < n; i++)
+      inline_check(csound, &udos[i]);
+    for (t = root; t != NULL; t = t->next)
+      if (t->type == INSTR_TOKEN && t->right != NULL)
+        count += inline_list(csound, t, udos, n, &serial);
+    if (count)
+      csound->Message(csound, Str("inlined %d UDO call%s\n"),
+                      count, count == 1 ? "" : "s");
+    csound->Free(csound, udos);
+}
+
+/* Statement level optimisation
+
+   Runs on the statement lists of instruments and UDOs once expressions
+   have been expanded, so that every operator or function call is one
+   statement writing a synthesized '#' variable.  Those are written once
+   and read after, so a later statement can take over their value.
+
+   --opt-level=1 folds i-rate operators and functions on constants,
+   calling the opcode itself so that the result is the one the init
+   pass would compute, and removes pure statements whose results are
+   never read, and fuses chains of a-rate + - * / into one ##fused
+   opcode (OOps/aops.c) that evaluates the expression in a single loop.
+   --opt-level=2 also merges repeated pure statements with the same
+   arguments between two labels (common subexpressions), and inlines
+   UDOs unless --inline-udos says otherwise.  The default, level 0,
+   leaves the statements as they were written. */
+
+typedef struct {
+    OENTRY      *ep;
+    int         count;
+} OPT_REMOVED;
+
+typedef struct {
+    int         folded, merged, dead, fused;
+    OPT_REMOVED *removed;
+    int         nremoved, maxremoved;
+} OPT_STATS;
+
+/* argument block shared by the AOP and EVAL opcodes that are folded */
+typedef struct {
+    OPDS        h;
+    MYFLT       *arg[3];
+} OPT_EVAL;
+
+static const char *opt_pure_funcs[] = {
+    "int", "frac", "round", "floor", "ceil", "abs", "exp", "log", "sqrt",
+    "sin", "cos", "tan", "sininv", "cosinv", "taninv", "taninv2",
+    "sinh", "cosh", "tanh", "log10", "log2", NULL
+};
+
+/* operators and functions without side effects or state */
+static int opt_pure(OENTRY *ep)
+{
+    const char *s = ep->opname, *dot = strchr(s, '.');
+    int  i;
+    if (dot == NULL || ep->useropinfo != NULL)
+      return 0;
+    if (!strncmp(s, "##add.", 6) || !strncmp(s, "##sub.", 6) ||
+        !strncmp(s, "##mul.", 6) || !strncmp(s, "##div.", 6) ||
+        !strncmp(s, "##mod.", 6))
+      return 1;
+    for (i = 0; opt_pure_funcs[i] != NULL; i++)
+      if (strlen(opt_pure_funcs[i]) == (size_t) (dot - s) &&
+          !strncmp(s, opt_pure_funcs[i], dot - s))
+        return 1;
+    return 0;
+}
+
+static int opt_assign(OENTRY *ep)
+{
+    return !strcmp(ep->opname, "=.i") || !strcmp(ep->opname, "=.k") ||
+           !strcmp(ep->opname, "=.a");
+}
+
+static char *arg_name(TREE *a)
+{
+    return (a->value != NULL) ? a->value->lexeme : NULL;
+}
+
+static int is_const_arg(TREE *a)
+{
+    return a->type == NUMBER_TOKEN || a->type == INTEGER_TOKEN;
+}
+
+/* a synthesized i-, k- or a-rate scalar */
+static int is_temp(const char *s)
+{
+    return s != NULL && s[0] == '#' && s[1] != '\0' &&
+           strchr("ika", s[1]) != NULL && strchr(s, '[') == NULL;
+}
+
+/* an i-, k- or a-rate scalar of this instrument or UDO only */
+static int is_local_scalar(const char *s)
+{
+    if (s == NULL || is_global_name(s) || strchr(s, '[') != NULL ||
+        pnum((char *) s) >= 0)
+      return 0;
+    return is_temp(s) || (s[0] != '\0' && strchr("ika", s[0]) != NULL);
+}
+
+static int arg_is(TREE *a, const char *name)
+{
+    for ( ; a != NULL; a = a->next)
+      if ((arg_name(a) != NULL && !strcmp(arg_name(a), name)) ||
+          arg_is(a->left, name) || arg_is(a->right, name))
+        return 1;
+    return 0;
+}
+
+/* does statement t write name? */
+static int stmt_writes(TREE *t, const char *name)
+{
+    OENTRY *ep = stmt_oentry(t);
+    TREE   *a;
+    if (ep == NULL)
+      return 0;
+    for (a = t->left; a != NULL; a = a->next)
+      if (arg_name(a) != NULL && !strcmp(arg_name(a), name))
+        return 1;
+    /* opcodes flagged IW write to their input arguments */
+    return (ep->flags & IW) && arg_is(t->right, name);
+}
+
+static int opt_writes(TREE *body, const char *name)
+{
+    int n = 0;
+    for ( ; body != NULL; body = body->next)
+      n += stmt_writes(body, name);
+    return n;
+}
+
+static int opt_reads(TREE *body, const char *name)
+{
+    for ( ; body != NULL; body = body->next)
+      if (stmt_oentry(body) != NULL && arg_is(body->right, name))
+        return 1;
+    return 0;
+}
+
+/* replace the reads of name in the body by another name or a constant */
+static void opt_replace(CSOUND *csound, TREE *a, const char *name,
+                        const char *with, int constant)
+{
+    for ( ; a != NULL; a = a->next) {
+      if (arg_name(a) != NULL && !strcmp(arg_name(a), name)) {
+        csound->Free(csound, a->value->lexeme);
+        a->value->lexeme = cs_strdup(csound, (char *) with);
+        if (constant) {
+          a->type = a->value->type = NUMBER_TOKEN;
+          a->value->fvalue = cs_strtod(a->value->lexeme, NULL);
+        }
+      }
+      opt_replace(csound, a->left, name, with, constant);
+      opt_replace(csound, a->right, name, with, constant);
+    }
+}
+
+static void opt_replace_reads(CSOUND *csound, TREE *body, const char *name,
+                              const char *with, int constant)
+{
+    for ( ; body != NULL; body = body->next)
+      if (stmt_oentry(body) != NULL)
+        opt_replace(csound, body->right, name, with, constant);
+}
+
+/* unlink and delete the statement at *link */
+static void opt_remove(CSOUND *csound, TREE **link, OPT_STATS *st)
+{
+    TREE   *t = *link;
+    OENTRY *ep = stmt_oentry(t);
+    int    i;
+    for (i = 0; i < st->nremoved && st->removed[i].ep != ep; i++) ;
+    if (i == st->nremoved) {
+      if (st->nremoved == st->maxremoved) {
+        st->maxremoved += 16;
+        st->removed = (OPT_REMOVED *)
+          csound->ReAlloc(csound, st->removed,
+                          st->maxremoved * sizeof(OPT_REMOVED));
+      }
+      st->removed[i].ep = ep;
+      st->removed[i].count = 0;
+      st->nremoved++;
+    }
+    st->removed[i].count++;
+    *link = t->next;
+    t->next = NULL;
+    csoundDeleteTree(csound, t);
+}
+
+/* the value of an i-rate pure statement on constants */
+static int opt_fold_value(CSOUND *csound, TREE *t, OENTRY *ep, MYFLT *val)
+{
+    OPT_EVAL p;
+    MYFLT    in[2] = { FL(0.0), FL(0.0) };
+    TREE     *a;
+    int      n = 0;
+
+    if (ep->thread != 1 || ep->iopadr == NULL || !opt_pure(ep) ||
+        tree_count(t->left) != 1 || !is_temp(arg_name(t->left)) ||
+        tree_count(t->right) != (int) strlen(ep->intypes) ||
+        tree_count(t->right) > 2)
+      return 0;
+    for (a = t->right; a != NULL; a = a->next) {
+      if (!is_const_arg(a) || a->value == NULL)
+        return 0;
+      in[n++] = (MYFLT) cs_strtod(a->value->lexeme, NULL);
+    }
+    /* leave the warning to the init pass */
+    if (!strncmp(ep->opname, "##div.", 6) && in[1] == FL(0.0))
+      return 0;
+    memset(&p, 0, sizeof(OPT_EVAL));
+    p.arg[0] = val;
+    p.arg[1] = &in[0];
+    p.arg[2] = &in[1];
+    if (ep->iopadr(csound, &p) != OK || !isfinite((double) *val))
+      return 0;
+    return 1;
+}
+
+static void opt_fold(CSOUND *csound, TREE *node, OPT_STATS *st)
+{
+    TREE **link = &node->right, *t;
+    while ((t = *link) != NULL) {
+      OENTRY *ep = stmt_oentry(t);
+      MYFLT  val;
+      if (ep != NULL && opt_fold_value(csound, t, ep, &val) &&
+          opt_writes(node->right, arg_name(t->left)) == 1) {
+        char buf[32];
+        CS_SPRINTF(buf, "%.17g", (double) val);
+        opt_replace_reads(csound, node->right, arg_name(t->left), buf, 1);
+        opt_remove(csound, link, st);
+        st->folded++;
+        continue;
+      }
+      link = &t->next;
+    }
+}
+
+/* a pure statement writing one temporary, on local arguments */
+static int opt_cse_candidate(TREE *body, TREE *t, OENTRY *ep)
+{
+    TREE *a;
+    if (!opt_pure(ep) || tree_count(t->left) != 1 ||
+        !is_temp(arg_name(t->left)) ||
+        opt_writes(body, arg_name(t->left)) != 1)
+      return 0;
+    for (a = t->right; a != NULL; a = a->next)
+      if (a->value == NULL || (!is_const_arg(a) &&
+                               !is_local_scalar(arg_name(a))))
+        return 0;
+    return 1;
+}
+
+static int opt_same(TREE *t, TREE *u)
+{
+    TREE *a, *b;
+    if (t->markup != u->markup)
+      return 0;
+    for (a = t->right, b = u->right; a != NULL && b != NULL;
+         a = a->next, b = b->next)
+      if (strcmp(arg_name(a), arg_name(b)))
+        return 0;
+    return a == NULL && b == NULL;
+}
+
+static void opt_cse(CSOUND *csound, TREE *node, OPT_STATS *st)
+{
+    TREE **link = &node->right, *t, **seen = NULL;
+    int  nseen = 0, maxseen = 0, i;
+
+    while ((t = *link) != NULL) {
+      OENTRY *ep = stmt_oentry(t);
+      int    cand;
+      if (t->type == LABEL_TOKEN) {
+        nseen = 0;              /* another way in */
+        link = &t->next;
+        continue;
+      }
+      if (ep == NULL) {
+        link = &t->next;
+        continue;
+      }
+      if ((cand = opt_cse_candidate(node->right, t, ep))) {
+        for (i = 0; i < nseen && !opt_same(seen[i], t); i++) ;
+        if (i < nseen) {
+          opt_replace_reads(csound, node->right, arg_name(t->left),
+                            arg_name(seen[i]->left), 0);
+          opt_remove(csound, link, st);
+          st->merged++;
+          continue;
+        }
+      }
+      /* forget the statements whose arguments this one changes */
+      for (i = 0; i < nseen; ) {
+        TREE *a;
+        for (a = seen[i]->right; a != NULL; a = a->next)
+          if (!is_const_arg(a) && stmt_writes(t, arg_name(a)))
+            break;
+        if (a != NULL)
+          seen[i] = seen[--nseen];
+        else
+          i++;
+      }
+      if (cand) {
+        if (nseen == maxseen) {
+          maxseen += 32;
+          seen = (TREE **) csound->ReAlloc(csound, seen,
+                                           maxseen * sizeof(TREE *));
+        }
+        seen[nseen++] = t;
+      }
+      link = &t->next;
+    }
+    if (seen != NULL)
+      csound->Free(csound, seen);
+}
+
+static int opt_is_dead(TREE *body, TREE *t, OENTRY *ep)
+{
+    char *name;
+    if (!(opt_pure(ep) || opt_assign(ep)) || tree_count(t->left) != 1)
+      return 0;
+    name = arg_name(t->left);
+    return is_local_scalar(name) && !opt_reads(body, name);
+}
+
+static void opt_dead(CSOUND *csound, TREE *node, OPT_STATS *st)
+{
+    int changed;
+    do {
+      TREE **link = &node->right, *t;
+      changed = 0;
+      while ((t = *link) != NULL) {
+        OENTRY *ep = stmt_oentry(t);
+        if (ep != NULL && opt_is_dead(node->right, t, ep)) {
+          opt_remove(csound, link, st);
+          st->dead++;
+          changed = 1;
+          continue;
+        }
+        link = &t->next;
+      }
+    } while (changed);
+}
+
+/* a-rate + - * / and the operand list of a fused chain */
+typedef struct {
+    char        code[2*FUSED_ARGS];
+    TREE        *args[FUSED_ARGS];
+    TREE        *absorbed[FUSED_ARGS];
+    int         ncode, nargs, nabsorbed;
+} OPT_FUSE;
+
+static char opt_arith_a(OENTRY *ep)
+{
+    const char *s = ep->opname;
+    if (strcmp(ep->outypes, "a"))
+      return 0;
+    if (!strncmp(s, "##add.", 6)) return '+';
+    if (!strncmp(s, "##sub.", 6)) return '-';
+    if (!strncmp(s, "##mul.", 6)) return '*';
+    if (!strncmp(s, "##div.", 6)) return '/';
+    return 0;
+}
+
+static int arg_count(TREE *a, const char *name)
+{
+    int n = 0;
+    for ( ; a != NULL; a = a->next) {
+      if (arg_name(a) != NULL && !strcmp(arg_name(a), name))
+        n++;
+      n += arg_count(a->left, name) + arg_count(a->right, name);
+    }
+    return n;
+}
+
+static int opt_read_count(TREE *body, const char *name)
+{
+    int n = 0;
+    for ( ; body != NULL; body = body->next)
+      if (stmt_oentry(body) != NULL)
+        n += arg_count(body->right, name);
+    return n;
+}
+
+/* the statement computing operand a of t, if it can move into the
+   fused root: an a-rate operator whose result only t reads, with no
+   label or change to its operands before the root */
+static TREE *opt_fuse_def(TREE *body, TREE *t, TREE *root, TREE *a)
+{
+    char *name = arg_name(a);
+    TREE *d, *u, *b;
+    OENTRY *ep;
+    if (!is_temp(name) || name[1] != 'a' || opt_writes(body, name) != 1 ||
+        opt_read_count(body, name) != 1)
+      return NULL;
+    for (d = body; d != NULL && d != t && !stmt_writes(d, name); d = d->next) ;
+    if (d == NULL || d == t || (ep = stmt_oentry(d)) == NULL ||
+        !opt_arith_a(ep))
+      return NULL;
+    for (u = d->next; u != root; u = u->next) {
+      if (u == NULL || u->type == LABEL_TOKEN)
+        return NULL;
+      for (b = d->right; b != NULL; b = b->next)
+        if (!is_const_arg(b) && stmt_writes(u, arg_name(b)))
+          return NULL;
+    }
+    return d;
+}
+
+static int opt_fuse_build(TREE *body, TREE *t, TREE *root, OPT_FUSE *f)
+{
+    TREE *a, *d;
+    for (a = t->right; a != NULL; a = a->next) {
+      if ((d = opt_fuse_def(body, t, root, a)) != NULL) {
+        int ncode = f->ncode, nargs = f->nargs, nabsorbed = f->nabsorbed;
+        if (opt_fuse_build(body, d, root, f)) {
+          f->absorbed[f->nabsorbed++] = d;
+          continue;
+        }
+        f->ncode = ncode;
+        f->nargs = nargs;
+        f->nabsorbed = nabsorbed;
+      }
+      if (f->nargs == FUSED_ARGS)
+        return 0;
+      f->args[f->nargs++] = a;
+      f->code[f->ncode++] = 'x';
+    }
+    f->code[f->ncode++] = opt_arith_a(stmt_oentry(t));
+    return 1;
+}
+
+/* is the result of t the operand of a later a-rate operator? */
+static int opt_fuse_inner(TREE *body, TREE *t)
+{
+    char *name = arg_name(t->left);
+    TREE *u;
+    if (!is_temp(name) || opt_read_count(body, name) != 1)
+      return 0;
+    for (u = t->next; u != NULL; u = u->next) {
+      OENTRY *ep = stmt_oentry(u);
+      if (ep != NULL && arg_count(u->right, name))
+        return opt_arith_a(ep) != 0;
+    }
+    return 0;
+}
+
+static void opt_fuse(CSOUND *csound, TREE *node, OPT_STATS *st,
+                     OENTRY *fused)
+{
+    TREE     *t, **link, *head, **tail;
+    OPT_FUSE f;
+    char     prog[2*FUSED_ARGS + 2];
+    int      i;
+
+    for (t = node->right; t != NULL; t = t->next) {
+      OENTRY *ep = stmt_oentry(t);
+      if (ep == NULL || !opt_arith_a(ep) || tree_count(t->left) != 1 ||
+          opt_fuse_inner(node->right, t))
+        continue;
+      memset(&f, 0, sizeof(OPT_FUSE));
+      if (!opt_fuse_build(node->right, t, t, &f) || f.nabsorbed == 0)
+        continue;
+      f.code[f.ncode] = '\0';
+      snprintf(prog, sizeof(prog), "\"%s\"", f.code);
+      head = make_leaf(csound, t->line, t->locn, STRING_TOKEN,
+                       make_token(csound, prog));
+      tail = &head->next;
+      for (i = 0; i < f.nargs; i++) {
+        *tail = copy_node(csound, f.args[i]);
+        (*tail)->markup = NULL;
+        tail = &(*tail)->next;
+      }
+      for (i = 0; i < f.nabsorbed; i++) {
+        for (link = &node->right; *link != f.absorbed[i];
+             link = &(*link)->next) ;
+        opt_remove(csound, link, st);
+        st->fused++;
+      }
+      csoundDeleteTree(csound, t->right);
+      t->right = head;
+      t->markup = fused;
+      csound->Free(csound, t->value->lexeme);
+      t->value->lexeme = cs_strdup(csound, "##fused");
+    }
+}
+
+static void optimize_statements(CSOUND *csound, TREE *root, int level)
+{
+    OPT_STATS st;
+    TREE      *t;
+    OENTRY    *fused = find_opcode(csound, "##fused");
+    int       i, n;
+
+    memset(&st, 0, sizeof(OPT_STATS));
+    for (t = root; t != NULL; t = t->next) {
+      if ((t->type != INSTR_TOKEN && t->type != UDO_TOKEN) || t->right == NULL)
+        continue;
+      opt_fold(csound, t, &st);
+      if (level >= 2)
+        opt_cse(csound, t, &st);
+      opt_dead(csound, t, &st);
+      if (fused != NULL)
+        opt_fuse(csound, t, &st, fused);
+    }
+    n = st.folded + st.merged + st.dead + st.fused;
+    if (n) {
+      csound->Message(csound, Str("optimiser removed %d opcode%s "
+                                  "(%d folded, %d merged, %d dead, "
+                                  "%d fused):"),
+                      n, n == 1 ? "" : "s", st.folded, st.merged, st.dead,
+                      st.fused);
+      for (i = 0; i < st.nremoved; i++)
+        csound->Message(csound, " %s x%d", st.removed[i].ep->opname,
+                        st.removed[i].count);
+      csound->Message(csound, "\n");
+    }
+    if (st.removed != NULL)
+      csound->Free(csound, st.removed);
+}
+
 /* Optimizes tree (expressions, etc.) */
 TREE * csound_orc_optimize(CSOUND *csound, TREE *root)
 {
     TREE *original=root, *last = NULL;
+    if (inline_limit(csound) > 0)
+      inline_udos(csound, root);
+    if (csound->oparms->optLevel > 0)
+      optimize_statements(csound, root, csound->oparms->optLevel);
     while (root) {
         TREE *xx = verify_tree1(csound, root);
         if (xx != root) {
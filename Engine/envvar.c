@@ -40,6 +40,8 @@ static const char *envVar_list[] = {
     "CSOUNDRC",
     "CSSTRNGS",
     "CS_LANG",
+    "FTGENCACHE",
+    "GEN01CACHE",
     "HOME",
     "INCDIR",
     "OPCODE6DIR",
@@ -33,6 +33,18 @@
 #include "pstream.h"
 #include "pvfileio.h"
 #include <stdlib.h>
+#include <stddef.h>
+#if defined(LINUX) || defined(__MACH__) || defined(__unix__)
+#  define GEN01_MMAP
+#  define FTGEN_CACHE
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <dirent.h>
+#  include <time.h>
+#endif
 
 extern double besseli(double);
 
@@ -92,6 +104,11 @@ typedef struct namedgen {
 static CS_NOINLINE int  fterror(const FGDATA *, const char *, ...);
 static CS_NOINLINE void ftresdisp(const FGDATA *, FUNC *);
 static CS_NOINLINE FUNC *ftalloc(const FGDATA *);
+static int gen01_mapped(CSOUND *, const FUNC *);
+static int gen01_unmap(CSOUND *, FUNC *);
+static int ftgen_pure(CSOUND *, int32, const FGDATA *);
+static int ftgen_start(FGDATA *, FUNC *, int32);
+static void ftgen_wait(CSOUND *, int);
 
 static int GENUL(FGDATA *ff, FUNC *ftp)
 {
@@ -103,7 +120,8 @@ static int GENUL(FGDATA *ff, FUNC *ftp)
  * Create ftable using evtblk data, and store pointer to new table in *ftpp.
  * If mode is zero, a zero table number is ignored, otherwise a new table
  * number is automatically assigned.
- * Returns zero on success.
+ * Returns zero on success.  With --ftgen-threads the table may still be
+ * generated after this returns, but its arguments have been checked.
  */
 
 int hfgens(CSOUND *csound, FUNC **ftpp, const EVTBLK *evtblkp, int mode)
@@ -136,11 +154,14 @@ int hfgens(CSOUND *csound, FUNC **ftpp, const EVTBLK *evtblkp, int mode)
     }
     else if (ff.fno < 0) {                      /*  fno < 0: remove         */
       ff.fno = -(ff.fno);
+      if (UNLIKELY(csound->ftgen_pending))
+        ftgen_wait(csound, ff.fno);
       if (UNLIKELY(ff.fno > csound->maxfnum ||
                    (ftp = csound->flist[ff.fno]) == NULL)) {
         return fterror(&ff, Str("ftable does not exist"));
       }
       csound->flist[ff.fno] = NULL;
+      gen01_unmap(csound, ftp);
       csound->Free(csound, (void*) ftp);
       if (UNLIKELY(msg_enabled))
         csoundMessage(csound, Str("ftable %d now deleted\n"), ff.fno);
@@ -258,13 +279,23 @@ int hfgens(CSOUND *csound, FUNC **ftpp, const EVTBLK *evtblkp, int mode)
 
     if (msg_enabled)
       csoundMessage(csound, Str("ftable %d:\n"), ff.fno);
-    if ((*csound->gensub[genum])(&ff, ftp) != 0) {
-      csound->flist[ff.fno] = NULL;
-      csound->Free(csound, ftp);
-      return -1;
+    if (ftgen_pure(csound, genum, &ff)) {
+      /* queued for the pool, or read from the cache */
+      if (UNLIKELY(ftgen_start(&ff, ftp, genum) != 0)) {
+        csound->flist[ff.fno] = NULL;
+        csound->Free(csound, ftp);
+        return -1;
+      }
+    }
+    else {
+      if ((*csound->gensub[genum])(&ff, ftp) != 0) {
+        csound->flist[ff.fno] = NULL;
+        csound->Free(csound, ftp);
+        return -1;
+      }
+      /* VL 11.01.05 for deferred GEN01, it's called in gen01raw */
+      ftresdisp(&ff, ftp);                      /* rescale and display      */
     }
-    /* VL 11.01.05 for deferred GEN01, it's called in gen01raw */
-    ftresdisp(&ff, ftp);                        /* rescale and display      */
     *ftpp = ftp;
     /* keep original arguments, from GEN number  */
     ftp->argcnt = ff.e.pcnt - 3;
@@ -303,6 +334,8 @@ int csoundFTAlloc(CSOUND *csound, int tableNum, int len)
         csound->flist[i] = NULL;            /* Clear new section            */
       csound->maxfnum = size;
     }
+    if (UNLIKELY(csound->ftgen_pending))
+      ftgen_wait(csound, tableNum);
     /* allocate space for table */
     size = (int) (len * (int) sizeof(MYFLT));
     ftp = csound->flist[tableNum];
@@ -319,6 +352,7 @@ int csoundFTAlloc(CSOUND *csound, int tableNum, int len)
                                         "may find this disturbing"), tableNum);
       }
       csound->flist[tableNum] = NULL;
+      gen01_unmap(csound, ftp);
       csound->Free(csound, ftp);
       csound->flist[tableNum] = (FUNC*) csound->Malloc(csound, (size_t) size);
     }
@@ -353,10 +387,13 @@ int csoundFTDelete(CSOUND *csound, int tableNum)
 
     if (UNLIKELY((unsigned int) (tableNum - 1) >= (unsigned int) csound->maxfnum))
       return -1;
+    if (UNLIKELY(csound->ftgen_pending))
+      ftgen_wait(csound, tableNum);
     ftp = csound->flist[tableNum];
     if (UNLIKELY(ftp == NULL))
       return -1;
     csound->flist[tableNum] = NULL;
+    gen01_unmap(csound, ftp);
     csound->Free(csound, ftp);
 
     return 0;
@@ -432,7 +469,10 @@ static int gen04(FGDATA *ff, FUNC *ftp)
     if (UNLIKELY(ff->e.pcnt < 6)) {
       return fterror(ff, Str("insufficient arguments"));
     }
-    if (UNLIKELY((srcno = (int)ff->e.p[5]) <= 0 || srcno > csound->maxfnum ||
+    srcno = (int) ff->e.p[5];
+    if (UNLIKELY(csound->ftgen_pending))
+      ftgen_wait(csound, srcno);
+    if (UNLIKELY(srcno <= 0 || srcno > csound->maxfnum ||
                  (srcftp = csound->flist[srcno]) == NULL)) {
       return fterror(ff, Str("unknown srctable number"));
     }
@@ -1405,7 +1445,10 @@ static int gen24(FGDATA *ff, FUNC *ftp)
     if (UNLIKELY(nargs < 3)) {
       return fterror(ff, Str("insufficient arguments"));
     }
-    if (UNLIKELY((srcno = (int) ff->e.p[5]) <= 0 ||
+    srcno = (int) ff->e.p[5];
+    if (UNLIKELY(csound->ftgen_pending))
+      ftgen_wait(csound, srcno);
+    if (UNLIKELY(srcno <= 0 ||
         srcno > csound->maxfnum         ||
                  (srcftp = csound->flist[srcno]) == NULL)) {
       return fterror(ff, Str("unknown srctable number"));
@@ -2120,7 +2163,10 @@ static int gen40(FGDATA *ff, FUNC *ftp)               /*gab d5*/
     int     srcno, srcpts, j, k;
     MYFLT   last_value = FL(0.0), lenratio;
 
-    if (UNLIKELY((srcno = (int) ff->e.p[5]) <= 0 ||
+    srcno = (int) ff->e.p[5];
+    if (UNLIKELY(csound->ftgen_pending))
+      ftgen_wait(csound, srcno);
+    if (UNLIKELY(srcno <= 0 ||
         srcno > csound->maxfnum         ||
                  (srcftp = csound->flist[srcno]) == NULL)) {
       return fterror(ff, Str("unknown source table number"));
@@ -2239,15 +2285,12 @@ static CS_NOINLINE int fterror(const FGDATA *ff, const char *s, ...)
     return -1;
 }
 
-/* set guardpt, rescale the function, and display it */
+/* set guardpt and rescale the function */
 
-static CS_NOINLINE void ftresdisp(const FGDATA *ff, FUNC *ftp)
+static void ftrescale(const FGDATA *ff, FUNC *ftp)
 {
-    CSOUND  *csound = ff->csound;
     MYFLT   *fp, *finp = &ftp->ftable[ff->flen];
     MYFLT   abs, maxval;
-    WINDAT  dwindow;
-    char    strmsg[64];
 
     if (!ff->guardreq)                      /* if no guardpt yet, do it */
       ftp->ftable[ff->flen] = ftp->ftable[0];
@@ -2262,6 +2305,14 @@ static CS_NOINLINE void ftresdisp(const FGDATA *ff, FUNC *ftp)
         for (fp=ftp->ftable; fp<=finp; fp++)
           *fp /= maxval;
     }
+}
+
+static void ftdisplay(const FGDATA *ff, FUNC *ftp)
+{
+    CSOUND  *csound = ff->csound;
+    WINDAT  dwindow;
+    char    strmsg[64];
+
     if (!csound->oparms->displays)
       return;
     memset(&dwindow, 0, sizeof(WINDAT));
@@ -2271,6 +2322,16 @@ static CS_NOINLINE void ftresdisp(const FGDATA *ff, FUNC *ftp)
     display(csound, &dwindow);
 }
 
+/* set guardpt, rescale the function, and display it */
+
+static CS_NOINLINE void ftresdisp(const FGDATA *ff, FUNC *ftp)
+{
+    if (gen01_mapped(ff->csound, ftp))      /* done when cache written  */
+      return;
+    ftrescale(ff, ftp);
+    ftdisplay(ff, ftp);
+}
+
 static void generate_sine_tab(CSOUND *csound)
 {                               /* Assume power of 2 length */
     int flen = csound->sinelength;
@@ -2299,18 +2360,404 @@ static void generate_sine_tab(CSOUND *csound)
     return;
 }
 
+/* Tables from the GENs below depend on nothing but their arguments.
+   With --ftgen-threads=N they are generated on a pool of N threads, so
+   that the f-statements and ftgens of an orchestra run side by side,
+   and with --ftgen-cache they are kept in FTGENCACHE (or TMPDIR) and
+   read back by later runs instead of being computed again.  A queued
+   table is finished before anything else can see it: the table finders,
+   ftalloc() and the table API all call ftgen_wait() first. */
+
+#define FTGEN_MAXTHREADS  16
+#define FTCACHE_MINLEN    4096          /* smaller tables are not cached */
+
+enum { FTGEN_QUEUED, FTGEN_BUSY, FTGEN_DONE };
+
+typedef struct ftgenjob_ {
+    FGDATA  ff;
+    FUNC    *ftp;
+    int32   genum;
+    int     err;
+    int     state;
+    struct ftgenjob_ *nxt;
+} FTGENJOB;
+
+typedef struct ftgenpool_ FTGENPOOL;
+
+typedef struct {
+    FTGENPOOL *pool;
+    void    *thread, *wakeup;
+} FTGENWORKER;
+
+struct ftgenpool_ {
+    void    *lock;                      /* over the job list */
+    FTGENWORKER worker[FTGEN_MAXTHREADS];
+    int     nthreads, quit;
+    FTGENJOB *jobs;                     /* in the order queued */
+};
+
+static int ftgen_pure(CSOUND *csound, int32 genum, const FGDATA *ff)
+{
+    const OPARMS *O = csound->oparms;
+
+    if (!O->ftgenThreads && !O->ftgenCache)
+      return 0;
+    if (ISSTRCOD(ff->e.p[4]) || ISSTRCOD(ff->e.p[5]) || ff->e.pcnt >= PMAX)
+      return 0;
+    if (csound->gensub[genum] != or_sub[genum])
+      return 0;                         /* replaced by a plugin */
+    /* the argument checks of the GENs: a table that would fail is made
+       on the calling thread, so that hfgens() reports the error */
+    switch (genum) {
+    case 9: case 10: case 12: case 19:
+      return 1;
+    case 11:
+      return ((int) ff->e.p[5] >= 1);
+    case 13: case 14:
+      return (ff->e.pcnt > 6 && ff->e.p[5] > FL(0.0) && ff->e.p[6] > FL(0.0));
+    case 20:
+      return ((int) ff->e.p[5] >= 1 && (int) ff->e.p[5] <= 9);
+    }
+    return 0;
+}
+
+#ifdef FTGEN_CACHE
+typedef struct {
+    char    magic[8];                   /* "CSFTGEN" */
+    int32   myflt, nkey;                /* sizeof(MYFLT), MYFLTs in key */
+} FTCACHEHDR;
+
+/* the key is GEN number (with sign), size, guard request, sr and args */
+
+static int ftcache_key(const FGDATA *ff, FTCACHEHDR *hdr, MYFLT *key)
+{
+    int     i, nargs = ff->e.pcnt - 4;
+
+    memset(hdr, 0, sizeof(FTCACHEHDR));
+    memcpy(hdr->magic, "CSFTGEN", 8);
+    hdr->myflt = (int32) sizeof(MYFLT);
+    hdr->nkey = 4 + nargs;
+    key[0] = ff->e.p[4];
+    key[1] = (MYFLT) ff->flen;
+    key[2] = (MYFLT) ff->guardreq;
+    key[3] = ff->csound->esr;
+    for (i = 0; i < nargs; i++)
+      key[4 + i] = ff->e.p[5 + i];
+    return hdr->nkey;
+}
+
+static void ftcache_name(const FGDATA *ff, char *name, size_t size,
+                         const FTCACHEHDR *hdr, const MYFLT *key)
+{
+    CSOUND      *csound = ff->csound;
+    const char  *dir = csound->GetEnv(csound, "FTGENCACHE");
+    const unsigned char *c;
+    uint64_t    h = 0xcbf29ce484222325ULL;      /* FNV-1a */
+    size_t      i;
+
+    for (c = (const unsigned char*) hdr, i = 0; i < sizeof(FTCACHEHDR); i++)
+      h = (h ^ c[i]) * 0x100000001b3ULL;
+    for (c = (const unsigned char*) key, i = 0;
+         i < hdr->nkey * sizeof(MYFLT); i++)
+      h = (h ^ c[i]) * 0x100000001b3ULL;
+    if (dir == NULL || *dir == '\0')
+      dir = getenv("TMPDIR");
+    if (dir == NULL || *dir == '\0')
+      dir = "/tmp";
+    snprintf(name, size, "%s/csftgen-%016llx.dat", dir, (unsigned long long) h);
+}
+
+/* fill the table from the cache; returns non-zero on a hit */
+
+static int ftcache_read(const FGDATA *ff, FUNC *ftp)
+{
+    FTCACHEHDR  hdr, fhdr;
+    MYFLT       key[PMAX + 4], fkey[PMAX + 4];
+    char        name[1024];
+    size_t      nvals = (size_t) ff->flen + 1;
+    FILE        *f;
+    int         ok = 0;
+
+    ftcache_key(ff, &hdr, key);
+    ftcache_name(ff, name, sizeof(name), &hdr, key);
+    if ((f = fopen(name, "rb")) == NULL)
+      return 0;
+    if (fread(&fhdr, sizeof(FTCACHEHDR), 1, f) == 1 &&
+        memcmp(&fhdr, &hdr, sizeof(FTCACHEHDR)) == 0 &&
+        fread(fkey, sizeof(MYFLT), hdr.nkey, f) == (size_t) hdr.nkey &&
+        memcmp(fkey, key, hdr.nkey * sizeof(MYFLT)) == 0 &&
+        fread(ftp->ftable, sizeof(MYFLT), nvals, f) == nvals &&
+        getc(f) == EOF)
+      ok = 1;
+    fclose(f);
+    return ok;
+}
+
+static void ftcache_write(const FGDATA *ff, FUNC *ftp)
+{
+    FTCACHEHDR  hdr;
+    MYFLT       key[PMAX + 4];
+    char        name[1024], tmpname[1040];
+    size_t      nvals = (size_t) ff->flen + 1;
+    FILE        *f;
+    int         fd, ok;
+
+    ftcache_key(ff, &hdr, key);
+    ftcache_name(ff, name, sizeof(name), &hdr, key);
+    snprintf(tmpname, sizeof(tmpname), "%s.XXXXXX", name);
+    if ((fd = mkstemp(tmpname)) < 0)
+      return;
+    if ((f = fdopen(fd, "wb")) == NULL) {
+      close(fd);
+      unlink(tmpname);
+      return;
+    }
+    ok = (fwrite(&hdr, sizeof(FTCACHEHDR), 1, f) == 1 &&
+          fwrite(key, sizeof(MYFLT), hdr.nkey, f) == (size_t) hdr.nkey &&
+          fwrite(ftp->ftable, sizeof(MYFLT), nvals, f) == nvals);
+    if (fclose(f) != 0 || !ok || rename(tmpname, name) != 0)
+      unlink(tmpname);
+}
+#endif
+
+/* generate one table, on a pool thread or on the calling one */
+
+static void ftgen_run(FTGENJOB *j)
+{
+    CSOUND  *csound = j->ff.csound;
+#ifdef FTGEN_CACHE
+    int     cache = (csound->oparms->ftgenCache && j->ff.flen >= FTCACHE_MINLEN);
+    if (cache && ftcache_read(&j->ff, j->ftp)) {
+      j->err = 0;
+      return;
+    }
+#endif
+    j->err = (*csound->gensub[j->genum])(&j->ff, j->ftp);
+    if (j->err != 0)
+      return;
+    ftrescale(&j->ff, j->ftp);
+#ifdef FTGEN_CACHE
+    if (cache)
+      ftcache_write(&j->ff, j->ftp);
+#endif
+}
+
+/* remove a finished job; called with the pool locked */
+
+static void ftgen_reap(CSOUND *csound, FTGENPOOL *pool, FTGENJOB *j)
+{
+    FTGENJOB **jp;
+
+    for (jp = &pool->jobs; *jp != j; jp = &(*jp)->nxt)
+      ;
+    *jp = j->nxt;
+    csound->ftgen_pending--;
+    if (UNLIKELY(j->err != 0 && csound->flist[j->ff.fno] == j->ftp)) {
+      csound->flist[j->ff.fno] = NULL;
+      csound->Free(csound, j->ftp->ftable);
+      csound->Free(csound, j->ftp);
+    }
+    csound->Free(csound, j);
+}
+
+static uintptr_t ftgen_thread(void *p)
+{
+    FTGENWORKER *w = (FTGENWORKER*) p;
+    FTGENPOOL   *pool = w->pool;
+    FTGENJOB    *j;
+
+    for (;;) {
+      csoundLockMutex(pool->lock);
+      if (pool->quit) {
+        csoundUnlockMutex(pool->lock);
+        break;
+      }
+      for (j = pool->jobs; j != NULL && j->state != FTGEN_QUEUED; j = j->nxt)
+        ;
+      if (j != NULL)
+        j->state = FTGEN_BUSY;
+      csoundUnlockMutex(pool->lock);
+      if (j == NULL) {
+        /* every job queued notifies, the timeout is only a safety net */
+        csoundWaitThreadLock(w->wakeup, 100);
+        continue;
+      }
+      ftgen_run(j);
+      csoundLockMutex(pool->lock);
+      j->state = FTGEN_DONE;
+      csoundUnlockMutex(pool->lock);
+    }
+    return 0;
+}
+
+static int ftgen_stop(CSOUND *csound, void *p)
+{
+    FTGENPOOL *pool = (FTGENPOOL*) csound->ftgen_pool;
+    int       i;
+
+    (void) p;
+    if (pool == NULL)
+      return OK;
+    csoundLockMutex(pool->lock);
+    pool->quit = 1;
+    csoundUnlockMutex(pool->lock);
+    for (i = 0; i < pool->nthreads; i++) {
+      csoundNotifyThreadLock(pool->worker[i].wakeup);
+      csoundJoinThread(pool->worker[i].thread);
+      csoundDestroyThreadLock(pool->worker[i].wakeup);
+    }
+    while (pool->jobs != NULL) {
+      FTGENJOB *j = pool->jobs;
+      pool->jobs = j->nxt;
+      csound->Free(csound, j);
+    }
+    csoundDestroyMutex(pool->lock);
+    csound->Free(csound, pool);
+    csound->ftgen_pool = NULL;
+    csound->ftgen_pending = 0;
+    return OK;
+}
+
+static FTGENPOOL *ftgen_pool(CSOUND *csound)
+{
+    FTGENPOOL *pool = (FTGENPOOL*) csound->ftgen_pool;
+    int       i, n = csound->oparms->ftgenThreads;
+
+    if (pool != NULL)
+      return pool;
+    if (n > FTGEN_MAXTHREADS)
+      n = FTGEN_MAXTHREADS;
+    pool = (FTGENPOOL*) csound->Calloc(csound, sizeof(FTGENPOOL));
+    pool->lock = csoundCreateMutex(0);
+    for (i = 0; i < n; i++) {
+      FTGENWORKER *w = &(pool->worker[pool->nthreads]);
+      w->pool = pool;
+      if ((w->wakeup = csoundCreateThreadLock()) == NULL)
+        break;
+      if ((w->thread = csoundCreateThread(ftgen_thread, (void*) w)) == NULL) {
+        csoundDestroyThreadLock(w->wakeup);
+        break;
+      }
+      pool->nthreads++;
+    }
+    csound->ftgen_pool = (void*) pool;
+    csound->RegisterResetCallback(csound, NULL, ftgen_stop);
+    return pool;
+}
+
+/* generate a table from a pure GEN: queue it for the pool, or make it
+   now (from the cache if there) when there are no threads or the table
+   is to be displayed */
+
+static int ftgen_start(FGDATA *ff, FUNC *ftp, int32 genum)
+{
+    CSOUND    *csound = ff->csound;
+    FTGENPOOL *pool;
+    FTGENJOB  *j, *d, *nxt, **jp;
+    int       i;
+
+    if (csound->oparms->ftgenThreads <= 0 || csound->oparms->displays ||
+        (pool = ftgen_pool(csound))->nthreads == 0) {
+      FTGENJOB job;
+      job.ff = *ff;
+      job.ftp = ftp;
+      job.genum = genum;
+      ftgen_run(&job);
+      if (job.err != 0)
+        return job.err;
+      ftdisplay(ff, ftp);
+      return OK;
+    }
+    j = (FTGENJOB*) csound->Calloc(csound, sizeof(FTGENJOB));
+    j->ff = *ff;
+    j->ff.e.strarg = NULL;              /* no string args, see ftgen_pure() */
+    j->ftp = ftp;
+    j->genum = genum;
+    j->state = FTGEN_QUEUED;
+    csoundLockMutex(pool->lock);
+    for (d = pool->jobs; d != NULL; d = nxt) {      /* drop finished jobs */
+      nxt = d->nxt;
+      if (d->state == FTGEN_DONE)
+        ftgen_reap(csound, pool, d);
+    }
+    for (jp = &pool->jobs; *jp != NULL; jp = &(*jp)->nxt)
+      ;
+    *jp = j;
+    csound->ftgen_pending++;
+    csoundUnlockMutex(pool->lock);
+    for (i = 0; i < pool->nthreads; i++)
+      csoundNotifyThreadLock(pool->worker[i].wakeup);
+    return OK;
+}
+
+/* finish table fno if it is queued or being generated */
+
+static void ftgen_wait(CSOUND *csound, int fno)
+{
+    FTGENPOOL *pool = (FTGENPOOL*) csound->ftgen_pool;
+    FTGENJOB  *j;
+
+    csoundLockMutex(pool->lock);
+    for (;;) {
+      for (j = pool->jobs; j != NULL && j->ff.fno != fno; j = j->nxt)
+        ;
+      if (j == NULL)
+        break;
+      if (j->state == FTGEN_DONE) {
+        ftgen_reap(csound, pool, j);
+        break;
+      }
+      if (j->state == FTGEN_BUSY) {     /* on a pool thread: help out */
+        for (j = pool->jobs; j != NULL && j->state != FTGEN_QUEUED; j = j->nxt)
+          ;
+        if (j == NULL) {
+          csoundUnlockMutex(pool->lock);
+          csoundSleep(0);
+          csoundLockMutex(pool->lock);
+          continue;
+        }
+      }
+      j->state = FTGEN_BUSY;
+      csoundUnlockMutex(pool->lock);
+      ftgen_run(j);
+      csoundLockMutex(pool->lock);
+      j->state = FTGEN_DONE;
+    }
+    csoundUnlockMutex(pool->lock);
+}
+
+/* finish all queued tables */
+
+void ftgen_sync(CSOUND *csound)
+{
+    while (csound->ftgen_pending) {
+      FTGENPOOL *pool = (FTGENPOOL*) csound->ftgen_pool;
+      int       fno = 0;
+      csoundLockMutex(pool->lock);
+      if (pool->jobs != NULL)
+        fno = pool->jobs->ff.fno;
+      csoundUnlockMutex(pool->lock);
+      if (fno != 0)
+        ftgen_wait(csound, fno);
+    }
+}
+
 /* alloc ftable space for fno (or replace one) */
 /*  set ftp to point to that structure         */
 
 static CS_NOINLINE FUNC *ftalloc(const FGDATA *ff)
 {
     CSOUND  *csound = ff->csound;
-    FUNC    *ftp = csound->flist[ff->fno];
+    FUNC    *ftp;
 
+    if (UNLIKELY(csound->ftgen_pending))
+      ftgen_wait(csound, ff->fno);
+    ftp = csound->flist[ff->fno];
     if (UNLIKELY(ftp != NULL)) {
       csound->Warning(csound, Str("replacing previous ftable %d"), ff->fno);
       if (ff->flen != (int32)ftp->flen) {       /* if redraw & diff len, */
-        csound->Free(csound, ftp->ftable);
+        if (!gen01_unmap(csound, ftp))
+          csound->Free(csound, ftp->ftable);
         csound->Free(csound, (void*) ftp);             /*   release old space   */
         csound->flist[ff->fno] = ftp = NULL;
         if (csound->actanchor.nxtact != NULL) { /*   & chk for danger    */
@@ -2322,7 +2769,9 @@ static CS_NOINLINE FUNC *ftalloc(const FGDATA *ff)
       else {
                                     /* else clear it to zero */
         MYFLT *tmp = ftp->ftable;
-        memset((void*) ftp->ftable, 0, sizeof(MYFLT)*(ff->flen+1));
+        if (gen01_unmap(csound, ftp))
+          tmp = (MYFLT*) csound->Malloc(csound, (1+ff->flen) * sizeof(MYFLT));
+        memset((void*) tmp, 0, sizeof(MYFLT)*(ff->flen+1));
         memset((void*) ftp, 0, sizeof(FUNC));
         ftp->ftable = tmp; /* restore table pointer */
       }
@@ -2345,6 +2794,8 @@ FUNC *csoundFTFind(CSOUND *csound, MYFLT *argp)
     int     fno;
 
     fno = MYFLT2LONG(*argp);
+    if (UNLIKELY(csound->ftgen_pending))
+      ftgen_wait(csound, fno);
     if (UNLIKELY(fno == -1)) {
       if (UNLIKELY(csound->sinetable==NULL)) generate_sine_tab(csound);
       return csound->sinetable;
@@ -2377,6 +2828,8 @@ FUNC *csoundFTFind2(CSOUND *csound, MYFLT *argp)
     int     fno;
 
     fno = MYFLT2LONG(*argp);
+    if (UNLIKELY(csound->ftgen_pending))
+      ftgen_wait(csound, fno);
     if (UNLIKELY(fno == -1)) {
       if (UNLIKELY(csound->sinetable==NULL)) generate_sine_tab(csound);
       return csound->sinetable;
@@ -2429,6 +2882,8 @@ PUBLIC int csoundGetTable(CSOUND *csound, MYFLT **tablePtr, int tableNum)
 
     if (UNLIKELY((unsigned int) (tableNum - 1) >= (unsigned int) csound->maxfnum))
       goto err_return;
+    if (UNLIKELY(csound->ftgen_pending))
+      ftgen_wait(csound, tableNum);
     ftp = csound->flist[tableNum];
     if (UNLIKELY(ftp == NULL))
       goto err_return;
@@ -2450,6 +2905,8 @@ PUBLIC int csoundGetTableArgs(CSOUND *csound, MYFLT **argsPtr, int tableNum)
     FUNC    *ftp;
     if (UNLIKELY((unsigned int) (tableNum - 1) >= (unsigned int) csound->maxfnum))
       goto err_return;
+    if (UNLIKELY(csound->ftgen_pending))
+      ftgen_wait(csound, tableNum);
     ftp = csound->flist[tableNum];
     if (UNLIKELY(ftp == NULL))
       goto err_return;
@@ -2487,6 +2944,8 @@ FUNC *csoundFTFindP(CSOUND *csound, MYFLT *argp)
      * contains pointers to FUNC data structures for each table.
      */
     fno = MYFLT2LONG(*argp);
+    if (UNLIKELY(csound->ftgen_pending))
+      ftgen_wait(csound, fno);
     if (UNLIKELY(fno == -1)) {
       if (UNLIKELY(csound->sinetable==NULL)) generate_sine_tab(csound);
       return csound->sinetable;
@@ -2515,6 +2974,8 @@ FUNC *csoundFTnp2Find(CSOUND *csound, MYFLT *argp)
     FUNC    *ftp;
     int     fno = MYFLT2LONG(*argp);
 
+    if (UNLIKELY(csound->ftgen_pending))
+      ftgen_wait(csound, fno);
     if (UNLIKELY(fno == -1)) {
       if (UNLIKELY(csound->sinetable==NULL)) generate_sine_tab(csound);
       return csound->sinetable;
@@ -2578,6 +3039,236 @@ static const int gen01_format_table[11] = {
     AE_LONG,    AE_FLOAT,   AE_UNCH,    AE_24INT,   AE_DOUBLE
 };
 
+#ifdef GEN01_MMAP
+/* With --mmap-gen1, GEN01 decodes the sound file once into a cache file
+   of MYFLT values in the directory named by GEN01CACHE (or TMPDIR), and
+   the table is a copy-on-write mapping of that file: pages are read from
+   disk when an opcode first touches them, and tablew still works.  The
+   cache is named after a hash of the sound file's path and of everything
+   that changes the decoded values, so later runs map it without decoding
+   while the sound file is unchanged.  Mapping a cache refreshes its
+   modification time, and writing a new one removes the caches (and
+   temporary files left by killed runs) not used for GEN01_CACHE_DAYS. */
+
+#define GEN01_CACHE_DAYS    7
+
+typedef struct {
+    char    magic[8];           /* "CSGEN01" */
+    int64_t size, mtime;        /* of the sound file */
+    double  skiptime, e0dbfs;
+    int32   myflt, nvals;       /* sizeof(MYFLT), values incl. guard point */
+    int32   channel, format, rescale, guardreq;
+    int32   inlocs;             /* samples read from the file, not a key */
+} GEN01CACHE;
+
+typedef struct gen01map_ {
+    FUNC    *ftp;
+    void    *addr;
+    size_t  len;
+    struct gen01map_ *nxt;
+} GEN01MAP;
+
+static int gen01_mapped(CSOUND *csound, const FUNC *ftp)
+{
+    GEN01MAP *m;
+    for (m = (GEN01MAP*) csound->gen01_maps; m != NULL; m = m->nxt)
+      if (m->ftp == ftp)
+        return 1;
+    return 0;
+}
+
+/* unmap the table data of ftp, if mapped; returns non-zero if it was */
+
+static int gen01_unmap(CSOUND *csound, FUNC *ftp)
+{
+    GEN01MAP **mp = (GEN01MAP**) &csound->gen01_maps, *m;
+
+    for ( ; (m = *mp) != NULL; mp = &m->nxt) {
+      if (m->ftp == ftp) {
+        munmap(m->addr, m->len);
+        ftp->ftable = NULL;
+        *mp = m->nxt;
+        csound->Free(csound, m);
+        return 1;
+      }
+    }
+    return 0;
+}
+
+static int gen01_unmap_all(CSOUND *csound, void *p)
+{
+    (void) p;
+    while (csound->gen01_maps != NULL)
+      gen01_unmap(csound, ((GEN01MAP*) csound->gen01_maps)->ftp);
+    return OK;
+}
+
+static const char *gen01_cache_dir(CSOUND *csound)
+{
+    const char  *dir = csound->GetEnv(csound, "GEN01CACHE");
+
+    if (dir == NULL || *dir == '\0')
+      dir = getenv("TMPDIR");
+    if (dir == NULL || *dir == '\0')
+      dir = "/tmp";
+    return dir;
+}
+
+static void gen01_cache_name(CSOUND *csound, char *name, size_t size,
+                             const char *path, const GEN01CACHE *key)
+{
+    const unsigned char *c;
+    uint64_t    h = 0xcbf29ce484222325ULL;      /* FNV-1a */
+    size_t      i;
+
+    for (c = (const unsigned char*) path; *c != '\0'; c++)
+      h = (h ^ *c) * 0x100000001b3ULL;
+    for (c = (const unsigned char*) key, i = 0;
+         i < offsetof(GEN01CACHE, inlocs); i++)
+      h = (h ^ c[i]) * 0x100000001b3ULL;
+    snprintf(name, size, "%s/csgen01-%016llx.dat",
+             gen01_cache_dir(csound), (unsigned long long) h);
+}
+
+/* remove the caches not mapped for GEN01_CACHE_DAYS */
+
+static void gen01_cache_evict(CSOUND *csound)
+{
+    const char  *dir = gen01_cache_dir(csound);
+    DIR         *d = opendir(dir);
+    struct dirent *e;
+    struct stat st;
+    char        name[1024];
+    time_t      old = time(NULL) - (time_t) GEN01_CACHE_DAYS * 86400;
+
+    if (d == NULL)
+      return;
+    while ((e = readdir(d)) != NULL) {
+      if (strncmp(e->d_name, "csgen01-", 8) != 0)
+        continue;
+      snprintf(name, sizeof(name), "%s/%s", dir, e->d_name);
+      if (lstat(name, &st) == 0 && S_ISREG(st.st_mode) &&
+          st.st_mtime < old) {
+        if (csound->oparms->msglevel & 7)
+          csound->Message(csound, Str("GEN1: removing unused cache %s\n"),
+                          name);
+        unlink(name);
+      }
+    }
+    closedir(d);
+}
+
+/* Point ftp->ftable at a mapping of the cached table, decoding the sound
+   file into a new cache first if there is none.  The cached values are
+   already rescaled and have their guard point, so ftresdisp() skips
+   mapped tables.  Returns the number of samples read from the file, or
+   -1 if the table could not be mapped and must be read into memory, in
+   which case nothing has been read from fd yet. */
+
+static int32 gen01_map(FGDATA *ff, FUNC *ftp, SOUNDIN *p, SNDFILE *fd,
+                       int table_length, int def)
+{
+    CSOUND      *csound = ff->csound;
+    GEN01CACHE  key, hdr;
+    GEN01MAP    *m;
+    struct stat st;
+    char        name[1024], tmpname[1040];
+    const char  *path = csound->GetFileName(p->fd);
+    MYFLT       *ftable = ftp->ftable;
+    size_t      len;
+    void        *addr;
+    int         fdc;
+
+    if (path == NULL || stat(path, &st) != 0)
+      return -1;
+    memset(&key, 0, sizeof(GEN01CACHE));
+    memcpy(key.magic, "CSGEN01", 8);
+    key.size = (int64_t) st.st_size;
+    key.mtime = (int64_t) st.st_mtime;
+    key.skiptime = (double) p->skiptime;
+    key.e0dbfs = (double) csound->e0dbfs;
+    key.myflt = (int32) sizeof(MYFLT);
+    key.nvals = ff->flen + 1;
+    key.channel = p->channel;
+    key.format = p->format;
+    key.rescale = (ff->e.p[4] > FL(0.0));
+    key.guardreq = ff->guardreq;
+    len = sizeof(GEN01CACHE) + (size_t) key.nvals * sizeof(MYFLT);
+    gen01_cache_name(csound, name, sizeof(name), path, &key);
+
+    fdc = open(name, O_RDONLY);
+    if (fdc >= 0 &&
+        (pread(fdc, &hdr, sizeof(GEN01CACHE), 0) != sizeof(GEN01CACHE) ||
+         memcmp(&hdr, &key, offsetof(GEN01CACHE, inlocs)) != 0 ||
+         fstat(fdc, &st) != 0 || (size_t) st.st_size != len)) {
+      close(fdc);                       /* stale: write a new one */
+      fdc = -1;
+    }
+    if (fdc < 0) {
+      MYFLT   *tab;
+      gen01_cache_evict(csound);
+      snprintf(tmpname, sizeof(tmpname), "%s.XXXXXX", name);
+      if ((fdc = mkstemp(tmpname)) < 0) {
+        csound->Warning(csound, Str("GEN1: cannot create cache %s, "
+                                    "reading into memory"), tmpname);
+        return -1;
+      }
+      if (ftruncate(fdc, (off_t) len) != 0 ||
+          (addr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED,
+                       fdc, 0)) == MAP_FAILED) {
+        close(fdc);
+        unlink(tmpname);
+        return -1;
+      }
+      tab = (MYFLT*) ((char*) addr + sizeof(GEN01CACHE));
+      key.inlocs = getsndin(csound, fd, tab, table_length, p);
+      ftp->ftable = tab;                /* same order as in memory */
+      ftresdisp(ff, ftp);
+      if (def)
+        tab[ff->flen] = tab[0];
+      memcpy(addr, &key, sizeof(GEN01CACHE));
+      munmap(addr, len);
+      if (rename(tmpname, name) != 0)
+        unlink(tmpname);                /* still mapped below */
+      hdr = key;
+    }
+    else {
+      futimens(fdc, NULL);              /* in use: not to be evicted */
+      if (csound->oparms->msglevel & 7)
+        csound->Message(csound, Str("GEN1: mapping cached %s\n"), name);
+    }
+    addr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fdc, 0);
+    close(fdc);
+    if (UNLIKELY(addr == MAP_FAILED)) {
+      ftp->ftable = ftable;
+      return -2;
+    }
+    csound->Free(csound, ftable);
+    if (csound->gen01_maps == NULL)
+      csound->RegisterResetCallback(csound, NULL, gen01_unmap_all);
+    m = (GEN01MAP*) csound->Malloc(csound, sizeof(GEN01MAP));
+    m->ftp = ftp;
+    m->addr = addr;
+    m->len = len;
+    m->nxt = (GEN01MAP*) csound->gen01_maps;
+    csound->gen01_maps = (void*) m;
+    ftp->ftable = (MYFLT*) ((char*) addr + sizeof(GEN01CACHE));
+    return hdr.inlocs;
+}
+#else
+static int gen01_mapped(CSOUND *csound, const FUNC *ftp)
+{
+    (void) csound; (void) ftp;
+    return 0;
+}
+
+static int gen01_unmap(CSOUND *csound, FUNC *ftp)
+{
+    (void) csound; (void) ftp;
+    return 0;
+}
+#endif
+
 /* read ftable values from a sound file */
 /* stops reading when table is full     */
 
@@ -2728,7 +3419,14 @@ static int gen01raw(FGDATA *ff, FUNC *ftp)
     }
     /* read sound with opt gain */
 
-    if (UNLIKELY((inlocs=getsndin(csound, fd, ftp->ftable, table_length, p)) < 0)) {
+    inlocs = -1;
+#ifdef GEN01_MMAP
+    if (csound->oparms->gen01mmap)
+      inlocs = gen01_map(ff, ftp, p, fd, table_length, def);
+#endif
+    if (inlocs == -1)
+      inlocs = getsndin(csound, fd, ftp->ftable, table_length, p);
+    if (UNLIKELY(inlocs < 0)) {
       return fterror(ff, Str("GEN1 read error"));
     }
 
@@ -2743,8 +3441,10 @@ static int gen01raw(FGDATA *ff, FUNC *ftp)
     csound->FileClose(csound, p->fd);
     if (def) {
       MYFLT *tab = ftp->ftable;
-      ftresdisp(ff, ftp);       /* VL: 11.01.05  for deferred alloc tables */
-      tab[ff->flen] = tab[0];  /* guard point */
+      if (!gen01_mapped(csound, ftp)) {  /* else done in the cache */
+        ftresdisp(ff, ftp);     /* VL: 11.01.05  for deferred alloc tables */
+        tab[ff->flen] = tab[0];  /* guard point */
+      }
       ftp->flen -= 1;  /* exclude guard point */
     }
     /* save arguments */
@@ -3361,7 +4061,16 @@ int resize_table(CSOUND *csound, RESIZE *p)
     }
     if ((ftp = csound->FTFind(csound, p->fn)) == NULL)
       return NOTOK;
-    if (ftp->flen<fsize)
+    if (gen01_mapped(csound, ftp)) {
+      /* a mapped GEN01 table cannot be reallocated: copy it to memory */
+      MYFLT   *tab = (MYFLT *) csound->Calloc(csound,
+                                              sizeof(MYFLT)*(fsize+1));
+      memcpy(tab, ftp->ftable,
+             sizeof(MYFLT)*((ftp->flen < fsize ? ftp->flen : fsize)+1));
+      gen01_unmap(csound, ftp);
+      ftp->ftable = tab;
+    }
+    else if (ftp->flen<fsize)
       ftp->ftable = (MYFLT *) csound->ReAlloc(csound, ftp->ftable,
                                               sizeof(MYFLT)*(fsize+1));
     ftp->flen = fsize+1;
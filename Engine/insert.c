@@ -40,6 +40,11 @@ static  void    schedofftim(CSOUND *, INSDS *);
 void    beatexpire(CSOUND *, double);
 void    timexpire(CSOUND *, double);
 static  void    instance(CSOUND *, int);
+static  void    udo_argrefs_free(CSOUND *, UDO_ARGREFS *);
+static  int     instance_pool_get(CSOUND *, INSTRTXT *);
+static  void    instance_pool_update(CSOUND *, INSTRTXT *);
+static  void    init_pass_enqueue(CSOUND *, INSDS *);
+int     init_pass_pending(CSOUND *);
 extern int argsRequired(char* argString);
 
 int init0(CSOUND *csound)
@@ -164,7 +169,7 @@ int insert(CSOUND *csound, int insno, EVTBLK *newevtp)
       }
     }
     /* alloc new dspace if needed */
-    if (tp->act_instance == NULL || tp->isNew) {
+    if (!instance_pool_get(csound, tp)) {
       if (UNLIKELY(O->msglevel & RNGEMSG)) {
         char *name = csound->engineState.instrtxtp[insno]->insname;
         if (UNLIKELY(name))
@@ -193,6 +198,7 @@ int insert(CSOUND *csound, int insno, EVTBLK *newevtp)
     /* Add an active instrument */
     tp->active++;
     tp->instcnt++;
+    instance_pool_update(csound, tp);
     csound->dag_changed++;      /* Need to remake DAG */
     //printf("**** dag changed by insert\n");
     nxtp = &(csound->actanchor);    /* now splice into activ lst */
@@ -388,6 +394,9 @@ int insert(CSOUND *csound, int insno, EVTBLK *newevtp)
     if (newevtp->pinstance != NULL) {
       *((MYFLT *)newevtp->pinstance) = (MYFLT) ((long) ip);
     }
+    /* last: the init thread may set offtim, xtratim etc. from here on */
+    if (csound->realtime_audio_flag != 0)
+      init_pass_enqueue(csound, ip);
     return 0;
 }
 
@@ -434,7 +443,7 @@ int MIDIinsert(CSOUND *csound, int insno, MCHNBLK *chn, MEVENT *mep)
     csound->inerrcnt = 0;
     ipp = &chn->kinsptr[mep->dat1];       /* key insptr ptr           */
     /* alloc new dspace if needed */
-    if (tp->act_instance == NULL || tp->isNew) {
+    if (!instance_pool_get(csound, tp)) {
       if (UNLIKELY(O->msglevel & RNGEMSG)) {
         char *name = csound->engineState.instrtxtp[insno]->insname;
         if (UNLIKELY(name))
@@ -451,6 +460,7 @@ int MIDIinsert(CSOUND *csound, int insno, MCHNBLK *chn, MEVENT *mep)
     ip = tp->act_instance;
     tp->act_instance = ip->nxtact;
     ip->insno = (int16) insno;
+    instance_pool_update(csound, tp);
 
     if (UNLIKELY(O->odebug))
       csound->Message(csound, "Now %d active instr %d\n", tp->active, insno);
@@ -478,6 +488,7 @@ int MIDIinsert(CSOUND *csound, int insno, MCHNBLK *chn, MEVENT *mep)
     ip->nxtact       = nxtp;
     ip->prvact       = prvp;
     prvp->nxtact     = ip;
+    csound->dag_changed++;                /* Need to remake DAG */
     ip->actflg++;                         /* and mark the instr active */
     ip->m_chnbp      = chn;               /* rec address of chnl ctrl blk */
     ip->m_pitch      = (unsigned char) mep->dat1;    /* rec MIDI data   */
@@ -621,6 +632,8 @@ int MIDIinsert(CSOUND *csound, int insno, MCHNBLK *chn, MEVENT *mep)
         csound->Message(csound, Str("instr %d now active:\n"), insno);
       showallocs(csound);
     }
+    if (csound->realtime_audio_flag != 0)
+      init_pass_enqueue(csound, ip);
     return 0;
 }
 
@@ -827,6 +840,8 @@ void orcompact(CSOUND *csound)          /* free all inactive instr spaces */
     INSTRTXT  *txtp;
     INSDS     *ip, *nxtip, *prvip, **prvnxtloc;
     int       cnt = 0;
+    if (UNLIKELY(init_pass_pending(csound)))
+      return;         /* queued instances must stay valid; try next time */
     for (txtp = &(csound->engineState.instxtanchor);
          txtp != NULL;  txtp = txtp->nxtinstxt) {
       // csound->Message(csound, "txp=%p \n", txtp);
@@ -838,8 +853,12 @@ void orcompact(CSOUND *csound)          /* free all inactive instr spaces */
           if (!ip->actflg) {
             // csound->Message(csound, "ip=%p \n", ip);
             cnt++;
-            if (ip->opcod_iobufs && ip->insno > csound->engineState.maxinsno)
-              csound->Free(csound, ip->opcod_iobufs);          /* IV - Nov 10 2002 */
+            if (ip->opcod_iobufs && ip->insno > csound->engineState.maxinsno) {
+              OPCOD_IOBUFS *buf = (OPCOD_IOBUFS *) ip->opcod_iobufs;
+              if (buf->argrefs != NULL)
+                udo_argrefs_free(csound, buf->argrefs);
+              csound->Free(csound, buf);                /* IV - Nov 10 2002 */
+            }
             if (ip->fdchp != NULL)
               fdchclose(csound, ip);
             if (ip->auxchp != NULL)
@@ -883,8 +902,8 @@ void orcompact(CSOUND *csound)          /* free all inactive instr spaces */
             }
             active = active->nxtinstance;
           }
-          /* no active instances */
-          if (active == NULL) {
+          /* no active instances, and none waiting for init */
+          if (active == NULL && !init_pass_pending(csound)) {
             free_instrtxt(csound, csound->dead_instr_pool[i]);
             csound->dead_instr_pool[i] = NULL;
           }
@@ -1146,9 +1165,241 @@ int subinstrset(CSOUND *csound, SUBINST *p){
   scaled to denote the correct kcount in terms of local
   kcycles.
 
+  When the local ksmps is the caller's, a- and k-rate arguments
+  are passed by reference where that is safe: the argument pointers
+  of the opcodes in the UDO body that name the xin or xout variable
+  are set to the caller's variable, and useropcd2() does not copy it.
+  An input qualifies if nothing in the body writes to it, an output if
+  the body writes it at perf time, does not read it, and has no labels,
+  so that it is written on every k-cycle.  Opcodes flagged IW
+  (interlocks.h) write to their input arguments, some of them only now
+  and then (OSClisten), so a variable handed to one keeps its copies
+  whether it is an input or an output.  On the caller's side, inputs
+  must not be global variables, which the body could change, and outputs
+  must be local variables that are not passed twice.
+
 */
 int useropcd1(CSOUND *, UOPCODE*), useropcd2(CSOUND *, UOPCODE*);
 
+static CS_VARIABLE *udo_local_var(ARG *arg)
+{
+    return (arg != NULL && arg->type == ARG_LOCAL) ?
+      (CS_VARIABLE *) arg->argPtr : NULL;
+}
+
+/* true if the opcode is on the perf chain (see instance_new) */
+static int udo_perf_op(TEXT *t)
+{
+    if ((t->oentry->thread & 07) == 0)
+      return t->pftype != 'b';
+    return (t->oentry->thread & 06) != 0;
+}
+
+/* decide once per UDO which arguments may be passed by reference */
+static char *udo_ref_args(CSOUND *csound, OPCODINFO *inm, INSTRTXT *tp)
+{
+    int     nout = inm->outchns, nargs = inm->outchns + inm->inchns;
+    int     i, j, nxin = 0, nxout = 0, labels = 0;
+    char    *ref = (char *) csound->Calloc(csound, nargs + 1);
+    char    *written = (char *) csound->Calloc(csound, nargs + 1);
+    CS_VARIABLE **vars = (CS_VARIABLE **)
+      csound->Calloc(csound, (nargs + 1) * sizeof(CS_VARIABLE *));
+    OPTXT   *optxt = (OPTXT *) tp;
+    ARG     *arg;
+
+    while ((optxt = optxt->nxtop) != NULL) {
+      const char *name = optxt->t.oentry->opname;
+      if (!strcmp(name, "endop") || !strcmp(name, "endin"))
+        break;
+      if (!strcmp(name, "xin")) {
+        nxin++;
+        for (i = 0, arg = optxt->t.outArgs; arg != NULL && i < inm->inchns;
+             i++, arg = arg->next)
+          vars[nout + i] = udo_local_var(arg);
+      }
+      else if (!strcmp(name, "xout")) {
+        nxout++;
+        for (i = 0, arg = optxt->t.inArgs; arg != NULL && i < nout;
+             i++, arg = arg->next)
+          vars[i] = udo_local_var(arg);
+      }
+      else if (!strcmp(name, "$label"))
+        labels = 1;
+      else if (!strcmp(name, "setksmps"))
+        goto done;                      /* the local ksmps may differ */
+    }
+    for (i = 0; i < nargs; i++)
+      ref[i] = vars[i] != NULL &&
+               (vars[i]->varType == &CS_VAR_TYPE_A ||
+                vars[i]->varType == &CS_VAR_TYPE_K) &&
+               (i < nout ? (nxout == 1 && !labels) : nxin == 1);
+    /* a variable that is more than one argument keeps its copies */
+    for (i = 0; i < nargs; i++)
+      for (j = i + 1; j < nargs; j++)
+        if (vars[i] != NULL && vars[i] == vars[j])
+          ref[i] = ref[j] = 0;
+
+    optxt = (OPTXT *) tp;
+    while ((optxt = optxt->nxtop) != NULL) {
+      TEXT  *t = &optxt->t;
+      const char *name = t->oentry->opname;
+      int   inplace = (t->oentry->flags & IW) != 0;
+      if (!strcmp(name, "endop") || !strcmp(name, "endin"))
+        break;
+      if (!strcmp(name, "xin") || !strcmp(name, "xout"))
+        continue;
+      for (arg = t->outArgs; arg != NULL; arg = arg->next)
+        for (i = 0; i < nargs; i++)
+          if (vars[i] != NULL && udo_local_var(arg) == vars[i]) {
+            if (i >= nout)
+              ref[i] = 0;               /* the body writes an input */
+            else if (udo_perf_op(t))
+              written[i] = 1;
+          }
+      for (arg = t->inArgs; arg != NULL; arg = arg->next)
+        for (i = 0; i < nargs; i++)
+          if (vars[i] != NULL && udo_local_var(arg) == vars[i] &&
+              (i < nout || inplace))
+            ref[i] = 0;                 /* reads an output or writes an input */
+    }
+    for (i = 0; i < nout; i++)
+      if (!written[i])
+        ref[i] = 0;
+ done:
+    csound->Free(csound, vars);
+    csound->Free(csound, written);
+    return ref;
+}
+
+/* find the argument pointers in the body of instance ip that name the
+   UDO's own variables for arguments that may be passed by reference */
+static UDO_ARGREFS *udo_argrefs_new(CSOUND *csound, OPCODINFO *inm,
+                                    INSTRTXT *tp, INSDS *ip)
+{
+    int     nout = inm->outchns, nargs = inm->outchns + inm->inchns;
+    int     i, k, n, pass, nslots = 0;
+    UDO_ARGREFS *refs;
+    OPTXT   *optxt = (OPTXT *) tp;
+    ARG     *arg;
+
+    refs = (UDO_ARGREFS *)
+      csound->Calloc(csound, sizeof(UDO_ARGREFS) +
+                             nargs * (sizeof(MYFLT *) + sizeof(char)));
+    refs->local = (MYFLT **) (refs + 1);
+    refs->bound = (char *) (refs->local + nargs);
+    while ((optxt = optxt->nxtop) != NULL) {
+      const char *name = optxt->t.oentry->opname;
+      CS_VARIABLE *var;
+      if (!strcmp(name, "endop") || !strcmp(name, "endin"))
+        break;
+      if (!strcmp(name, "xin")) {
+        for (i = 0, arg = optxt->t.outArgs; arg != NULL && i < inm->inchns;
+             i++, arg = arg->next)
+          if ((var = udo_local_var(arg)) != NULL)
+            refs->local[nout + i] = ip->lclbas + var->memBlockIndex;
+      }
+      else if (!strcmp(name, "xout")) {
+        for (i = 0, arg = optxt->t.inArgs; arg != NULL && i < nout;
+             i++, arg = arg->next)
+          if ((var = udo_local_var(arg)) != NULL)
+            refs->local[i] = ip->lclbas + var->memBlockIndex;
+      }
+    }
+
+    /* count the pointers, then record them; the opcode data is laid out
+       as in instance_new() */
+    for (pass = 0; pass < 2; pass++) {
+      char  *nxtopds = (char *) ip->lclbas + tp->varPool->poolSize +
+                       (tp->varPool->varCount * sizeof(MYFLT));
+      if (pass == 1) {
+        if (nslots == 0)
+          break;
+        refs->slot = (MYFLT ***)
+          csound->Malloc(csound, nslots * (sizeof(MYFLT **) + sizeof(int)));
+        refs->arg = (int *) (refs->slot + nslots);
+        nslots = 0;
+      }
+      optxt = (OPTXT *) tp;
+      while ((optxt = optxt->nxtop) != NULL) {
+        TEXT  *t = &optxt->t;
+        const OENTRY *ep = t->oentry;
+        OPDS  *opds = (OPDS *) nxtopds;
+        MYFLT **argpp;
+        nxtopds += ep->dsblksiz;
+        if (!strcmp(ep->opname, "endin") || !strcmp(ep->opname, "endop"))
+          break;
+        if (!strcmp(ep->opname, "pset") || !strcmp(ep->opname, "$label") ||
+            !strcmp(ep->opname, "xin") || !strcmp(ep->opname, "xout"))
+          continue;
+        if (ep->useropinfo == NULL)
+          argpp = (MYFLT **) ((char *) opds + sizeof(OPDS));
+        else
+          argpp = &(((UOPCODE *) ((char *) opds))->ar[0]);
+        for (n = 0, arg = t->outArgs; arg != NULL; arg = arg->next)
+          n++;
+        if (n < (k = argsRequired(ep->outypes)))
+          n = k;
+        for (arg = t->inArgs; arg != NULL; arg = arg->next)
+          n++;
+        for (k = 0; k < n; k++)
+          for (i = 0; i < nargs; i++)
+            if (inm->refargs[i] && argpp[k] != NULL &&
+                argpp[k] == refs->local[i]) {
+              if (pass == 1) {
+                refs->slot[nslots] = &argpp[k];
+                refs->arg[nslots] = i;
+              }
+              nslots++;
+            }
+      }
+    }
+    refs->nslots = nslots;
+    return refs;
+}
+
+static void udo_argrefs_free(CSOUND *csound, UDO_ARGREFS *refs)
+{
+    if (refs->slot != NULL)
+      csound->Free(csound, refs->slot);
+    csound->Free(csound, refs);
+}
+
+/* point the UDO body at the caller's variables, or back at its own */
+static void udo_bind_args(CSOUND *csound, UOPCODE *p, OPCODINFO *inm,
+                          INSTRTXT *tp, int same_ksmps)
+{
+    UDO_ARGREFS *refs;
+    int     nout = inm->outchns, nargs = inm->outchns + inm->inchns;
+    int     i, j, byref;
+    ARG     *arg;
+
+    if (inm->refargs == NULL)
+      inm->refargs = udo_ref_args(csound, inm, tp);
+    if ((refs = p->buf->argrefs) == NULL)
+      refs = p->buf->argrefs = udo_argrefs_new(csound, inm, tp, p->ip);
+    byref = same_ksmps && csound->oparms->udoArgs == UDO_ARGS_REF;
+
+    for (i = 0, arg = p->h.optext->t.outArgs; i < nout; i++) {
+      refs->bound[i] = byref && inm->refargs[i] && arg != NULL &&
+                       arg->type == ARG_LOCAL;
+      for (j = 0; j < nargs && refs->bound[i]; j++)
+        if (j != i && p->ar[j] == p->ar[i])
+          refs->bound[i] = 0;
+      if (arg != NULL)
+        arg = arg->next;
+    }
+    for (arg = p->h.optext->t.inArgs; i < nargs; i++) {
+      refs->bound[i] = byref && inm->refargs[i] && arg != NULL &&
+                       arg->type != ARG_GLOBAL;
+      if (arg != NULL)
+        arg = arg->next;
+    }
+    for (i = 0; i < refs->nslots; i++) {
+      int a = refs->arg[i];
+      *(refs->slot[i]) = refs->bound[a] ? p->ar[a] : refs->local[a];
+    }
+}
+
 int useropcdset(CSOUND *csound, UOPCODE *p)
 {
     OPDS         *saved_ids = csound->ids;
@@ -1239,6 +1490,8 @@ int useropcdset(CSOUND *csound, UOPCODE *p)
       lcurip->kicvt = CS_KICVT;
     }
 
+    udo_bind_args(csound, p, inm, tp, local_ksmps == CS_KSMPS);
+
     /* VL 13-12-13 */
     /* this sets ksmps and kr local variables */
     /* create local ksmps variable and init with ksmps */
@@ -1356,7 +1609,8 @@ int xinset(CSOUND *csound, XIN *p)
       void* in = (void*)bufs[i];
       void* out = (void*)p->args[i];
       tmp[i + inm->outchns] = out;
-      current->varType->copyValue(csound, out, in);
+      if (buf->argrefs == NULL || !buf->argrefs->bound[i + inm->outchns])
+        current->varType->copyValue(csound, out, in);
       current = current->next;
     }
 
@@ -1383,7 +1637,9 @@ int xoutset(CSOUND *csound, XOUT *p)
       void* in = (void*)p->args[i];
       void* out = (void*)bufs[i];
       tmp[i] = in;
-      current->varType->copyValue(csound, out, in);
+      /* a bound output already holds what the body wrote */
+      if (buf->argrefs == NULL || !buf->argrefs->bound[i])
+        current->varType->copyValue(csound, out, in);
       current = current->next;
     }
 
@@ -1947,13 +2203,15 @@ int useropcd2(CSOUND *csound, UOPCODE *p)
 
     MYFLT** internal_ptrs = tmp;
     MYFLT** external_ptrs = p->ar;
+    char*   bound = p->buf->argrefs->bound;   /* passed by reference */
 
     /* copy inputs */
     current = inm->in_arg_pool->head;
     for (i = 0; i < inm->inchns; i++) {
       // this hardcoded type check for non-perf time vars needs to
       //change to use generic code...
-      if (current->varType != &CS_VAR_TYPE_I &&
+      if (!bound[i + inm->outchns] &&
+          current->varType != &CS_VAR_TYPE_I &&
           current->varType != &CS_VAR_TYPE_b &&
           current->subType != &CS_VAR_TYPE_I) {
         if (current->varType == &CS_VAR_TYPE_A && CS_KSMPS == 1) {
@@ -1986,7 +2244,8 @@ int useropcd2(CSOUND *csound, UOPCODE *p)
     for (i = 0; i < inm->outchns; i++) {
       // this hardcoded type check for non-perf time vars needs to change to
       // use generic code...
-      if (current->varType != &CS_VAR_TYPE_I &&
+      if (!bound[i] &&
+          current->varType != &CS_VAR_TYPE_I &&
           current->varType != &CS_VAR_TYPE_b &&
           current->subType != &CS_VAR_TYPE_I) {
         if (current->varType == &CS_VAR_TYPE_A && CS_KSMPS == 1) {
@@ -2031,10 +2290,11 @@ int findLabelMemOffset(CSOUND* csound, INSTRTXT* ip, char* labelName) {
 
 /* create instance of an instr template */
 /*   allocates and sets up all pntrs    */
+/* the new instance is not linked into any chain yet, so that the */
+/* instance pool thread can build one while the engine runs       */
 
-static void instance(CSOUND *csound, int insno)
+static INSDS *instance_new(CSOUND *csound, INSTRTXT *tp, int insno)
 {
-    INSTRTXT  *tp;
     INSDS     *ip;
     OPTXT     *optxt;
     OPDS      *opds, *prvids, *prvpds;
@@ -2051,7 +2311,6 @@ static void instance(CSOUND *csound, int insno)
     int       argStringCount;
     CS_VARIABLE* current;
 
-    tp = csound->engineState.instrtxtp[insno];
     n = 3;
     if (O->midiKey>n) n = O->midiKey;
     if (O->midiKeyCps>n) n = O->midiKeyCps;
@@ -2071,19 +2330,12 @@ static void instance(CSOUND *csound, int insno)
     ip->csound = csound;
     ip->m_chnbp = (MCHNBLK*) NULL;
     ip->instr = tp;
-    /* IV - Oct 26 2002: replaced with faster version (no search) */
-    ip->prvinstance = tp->lst_instance;
-    if (tp->lst_instance)
-      tp->lst_instance->nxtinstance = ip;
-    else
-      tp->instance = ip;
-    tp->lst_instance = ip;
-    /* link into free instance chain */
-    ip->nxtact = tp->act_instance;
-    tp->act_instance = ip;
     ip->insno = insno;
-    if (UNLIKELY(csound->oparms->odebug))
-      csoundMessage(csound,"instance(): tp->act_instance = %p \n", tp->act_instance);
+#ifdef HAVE_ATOMIC_BUILTIN
+    __sync_fetch_and_add(&tp->pool_allocated, 1);
+#else
+    tp->pool_allocated++;
+#endif
 
 
     if (insno > csound->engineState.maxinsno) {
@@ -2092,7 +2344,7 @@ static void instance(CSOUND *csound, int insno)
         OPCODINFO* info = tp->opcode_info;
       size_t pcnt = sizeof(OPCOD_IOBUFS) +
                     sizeof(MYFLT*) * (info->inchns + info->outchns);
-      ip->opcod_iobufs = (void*) csound->Malloc(csound, pcnt);
+      ip->opcod_iobufs = (void*) csound->Calloc(csound, pcnt);
     }
 
     /* gbloffbas = csound->globalVarPool; */
@@ -2237,31 +2489,159 @@ static void instance(CSOUND *csound, int insno)
 
     }
 
-    /* VL 13-12-13: point the memory to the local ksmps & kr variables,
-       and initialise them */
+    /* VL 13-12-13: initialise the local ksmps & kr variables.
+       Only this instance's copy is written: the CS_VARIABLE is shared by
+       all instances, and this may run on the instance pool thread. */
     CS_VARIABLE* var = csoundFindVariableWithName(csound,
                                                   ip->instr->varPool, "ksmps");
-    if (var) {
-      char* temp = (char*)(lclbas + var->memBlockIndex);
-      var->memBlock = (CS_VAR_MEM*)(temp - CS_VAR_TYPE_OFFSET);
-      var->memBlock->value = csound->ksmps;
-    }
+    if (var)
+      *((MYFLT *)(lclbas + var->memBlockIndex)) = csound->ksmps;
     var = csoundFindVariableWithName(csound, ip->instr->varPool, "kr");
-    if (var) {
-      char* temp = (char*)(lclbas + var->memBlockIndex);
-      var->memBlock = (CS_VAR_MEM*)(temp - CS_VAR_TYPE_OFFSET);
-      var->memBlock->value = csound->ekr;
-    }
+    if (var)
+      *((MYFLT *)(lclbas + var->memBlockIndex)) = csound->ekr;
 
     if (UNLIKELY(nxtopds > opdslim))
       csoundDie(csound, Str("inconsistent opds total"));
+    return ip;
+}
 
+/* link a new instance into the instance and free instance chains */
+static void instance_link(INSTRTXT *tp, INSDS *ip)
+{
+    /* IV - Oct 26 2002: replaced with faster version (no search) */
+    ip->prvinstance = tp->lst_instance;
+    if (tp->lst_instance)
+      tp->lst_instance->nxtinstance = ip;
+    else
+      tp->instance = ip;
+    tp->lst_instance = ip;
+    /* link into free instance chain */
+    ip->nxtact = tp->act_instance;
+    tp->act_instance = ip;
+}
+
+static void instance(CSOUND *csound, int insno)
+{
+    INSTRTXT  *tp = csound->engineState.instrtxtp[insno];
+
+    instance_link(tp, instance_new(csound, tp, insno));
+    if (UNLIKELY(csound->oparms->odebug))
+      csoundMessage(csound,"instance(): tp->act_instance = %p \n", tp->act_instance);
+}
+
+/* Make sure tp has a free instance without building one, taking over
+   those the pool thread has made ready.  Returns 0 when the caller has
+   to call instance(). */
+static int instance_pool_get(CSOUND *csound, INSTRTXT *tp)
+{
+    (void) csound;
+    if (UNLIKELY(tp->isNew)) {
+      tp->pool_misses++;
+      return 0;
+    }
+#ifdef HAVE_ATOMIC_BUILTIN
+    if (tp->act_instance == NULL && tp->pool_ready != NULL) {
+      INSDS *ip = __sync_lock_test_and_set(&tp->pool_ready, NULL);
+      while (ip != NULL) {
+        INSDS *nxt = ip->nxtact;
+        instance_link(tp, ip);
+        ip = nxt;
+      }
+    }
+#endif
+    if (tp->act_instance == NULL) {
+      tp->pool_misses++;
+      return 0;
+    }
+    tp->pool_hits++;
+    return 1;
+}
+
+/* Learn the polyphony of tp after an activation, and wake the pool
+   thread when it should build more instances */
+static void instance_pool_update(CSOUND *csound, INSTRTXT *tp)
+{
+    int target;
+    if (csound->instance_pool_wakeup == NULL)
+      return;
+    /* keep the peak seen so far plus some headroom */
+    target = tp->active + tp->active/4 + csound->oparms->instancePool;
+    if (target > tp->pool_target)
+      tp->pool_target = target;
+    if (tp->pool_allocated < tp->pool_target)
+      csoundNotifyThreadLock(csound->instance_pool_wakeup);
+}
+
+/**
+   With --instance-pool, this thread builds instances ahead of time so
+   that note activations on the performance thread only pop a pointer.
+   It is woken by instance_pool_update() and holds instance_pool_lock
+   while it looks at the instrument list, which orchestra compilation
+   takes before replacing instruments.
+   Only instruments already instantiated once by insert() are built
+   here, so that errors in instance() surface on the calling thread.
+   This thread is started by musmon() and stopped by csoundCleanup().
+*/
+#ifdef HAVE_ATOMIC_BUILTIN
+uintptr_t instance_pool_thread(void *p)
+{
+    CSOUND *csound = (CSOUND *) p;
+    INSTRTXT *tp;
+    INSDS *ip;
+    int insno;
+
+    while (csound->instance_pool_loop) {
+      csoundWaitThreadLock(csound->instance_pool_wakeup, 100);
+      csoundLockMutex(csound->instance_pool_lock);
+      for (insno = 1; insno <= csound->engineState.maxinsno &&
+             csound->instance_pool_loop; insno++) {
+        tp = csound->engineState.instrtxtp[insno];
+        if (tp == NULL || tp->isNew || tp->instance == NULL)
+          continue;
+        while (tp->pool_allocated < tp->pool_target &&
+               csound->instance_pool_loop) {
+          ip = instance_new(csound, tp, insno);
+          do {
+            ip->nxtact = tp->pool_ready;
+          } while (!__sync_bool_compare_and_swap(&tp->pool_ready,
+                                                 ip->nxtact, ip));
+        }
+      }
+      csoundUnlockMutex(csound->instance_pool_lock);
+    }
+    return 0;
+}
+#endif
+
+PUBLIC int csoundGetInstancePoolStats(CSOUND *csound, int insno,
+                                      CS_INSTANCE_POOL_STATS *stats)
+{
+    INSTRTXT *tp;
+    int i;
+
+    memset(stats, 0, sizeof(CS_INSTANCE_POOL_STATS));
+    if (UNLIKELY(insno > csound->engineState.maxinsno ||
+                 csound->engineState.instrtxtp == NULL))
+      return CSOUND_ERROR;
+    for (i = (insno > 0 ? insno : 1);
+         i <= (insno > 0 ? insno : csound->engineState.maxinsno); i++) {
+      if ((tp = csound->engineState.instrtxtp[i]) == NULL) {
+        if (insno > 0) return CSOUND_ERROR;
+        continue;
+      }
+      stats->target += tp->pool_target;
+      stats->allocated += tp->pool_allocated;
+      stats->hits += tp->pool_hits;
+      stats->misses += tp->pool_misses;
+    }
+    return CSOUND_SUCCESS;
 }
 
 
 
 int prealloc_(CSOUND *csound, AOP *p, int instname)
 {
+    INSTRTXT *tp;
     int     n, a;
 
     if (instname)
@@ -2276,7 +2656,10 @@ int prealloc_(CSOUND *csound, AOP *p, int instname)
 
     if (UNLIKELY(n < 1))
       return NOTOK;
-    a = (int) *p->a - csound->engineState.instrtxtp[n]->active;
+    tp = csound->engineState.instrtxtp[n];
+    if ((int) *p->a > tp->pool_target)
+      tp->pool_target = (int) *p->a;      /* the pool keeps this many */
+    a = (int) *p->a - tp->active;
     for ( ; a > 0; a--)
       instance(csound, n);
     return OK;
@@ -2417,61 +2800,185 @@ PUBLIC int csoundKillInstance(CSOUND *csound, MYFLT instr, char *instrName,
 
 
 
+/* Pending init passes in realtime mode: a bounded lock-free queue
+   (Vyukov's sequence-numbered ring) filled by insert() and MIDIinsert()
+   and drained by init_pass_thread().  If it ever fills up the thread
+   falls back to scanning the active chain once. */
+
+#define INIT_QUEUE_SIZE 1024    /* power of two */
+
+typedef struct {
+    volatile uint32_t seq;
+    INSDS       *ip;
+} INIT_QUEUE_CELL;
+
+typedef struct {
+    INIT_QUEUE_CELL cell[INIT_QUEUE_SIZE];
+    volatile uint32_t head;     /* enqueue position */
+    char        pad1[64 - sizeof(uint32_t)];
+    volatile uint32_t tail;     /* dequeue position */
+    char        pad2[64 - sizeof(uint32_t)];
+    volatile int rescan;
+    void        *wakeup;        /* thread lock the init thread waits on */
+} INIT_QUEUE;
+
+void *init_pass_queue_create(CSOUND *csound)
+{
+    INIT_QUEUE *q = (INIT_QUEUE*) csound->Calloc(csound, sizeof(INIT_QUEUE));
+    uint32_t i;
+    for (i = 0; i < INIT_QUEUE_SIZE; i++)
+      q->cell[i].seq = i;
+    q->wakeup = csoundCreateThreadLock();
+    return (void*) q;
+}
+
+void init_pass_queue_destroy(CSOUND *csound)
+{
+    INIT_QUEUE *q = (INIT_QUEUE*) csound->init_pass_queue;
+    if (q == NULL) return;
+    csound->init_pass_queue = NULL;
+    csoundDestroyThreadLock(q->wakeup);
+    csound->Free(csound, q);
+}
+
+/* wake the init thread, e.g. to make it notice the end of the loop */
+void init_pass_queue_wakeup(CSOUND *csound)
+{
+    INIT_QUEUE *q = (INIT_QUEUE*) csound->init_pass_queue;
+    if (q != NULL)
+      csoundNotifyThreadLock(q->wakeup);
+}
+
+/* true while instances may still be referenced from the queue */
+int init_pass_pending(CSOUND *csound)
+{
+    INIT_QUEUE *q = (INIT_QUEUE*) csound->init_pass_queue;
+    return (q != NULL && q->head != q->tail);
+}
+
+/* hand a new instance over to the init thread */
+static void init_pass_enqueue(CSOUND *csound, INSDS *ip)
+{
+    INIT_QUEUE *q = (INIT_QUEUE*) csound->init_pass_queue;
+    if (q == NULL)
+      return;                   /* polling thread: nothing to do */
+#ifdef HAVE_ATOMIC_BUILTIN
+    {
+      INIT_QUEUE_CELL *c;
+      uint32_t pos = q->head;
+      while (1) {
+        int32_t dif;
+        c = &q->cell[pos & (INIT_QUEUE_SIZE-1)];
+        dif = (int32_t) (c->seq - pos);
+        if (dif == 0) {
+          if (__sync_bool_compare_and_swap(&q->head, pos, pos+1))
+            break;
+        }
+        else if (dif < 0) {     /* full */
+          q->rescan = 1;
+          c = NULL;
+          break;
+        }
+        pos = q->head;
+      }
+      if (c != NULL) {
+        c->ip = ip;
+        __sync_synchronize();
+        c->seq = pos + 1;
+      }
+    }
+#else
+    (void) ip;
+    q->rescan = 1;
+#endif
+    csoundNotifyThreadLock(q->wakeup);
+}
+
+static INSDS *init_pass_dequeue(INIT_QUEUE *q)
+{
+#ifdef HAVE_ATOMIC_BUILTIN
+    /* single consumer: only the init thread moves the tail */
+    uint32_t pos = q->tail;
+    INIT_QUEUE_CELL *c = &q->cell[pos & (INIT_QUEUE_SIZE-1)];
+    INSDS *ip;
+    if ((int32_t) (c->seq - (pos + 1)) < 0)
+      return NULL;              /* empty */
+    __sync_synchronize();
+    ip = c->ip;
+    q->tail = pos + 1;
+    __sync_synchronize();
+    c->seq = pos + INIT_QUEUE_SIZE;
+    return ip;
+#else
+    (void) q;
+    return NULL;
+#endif
+}
+
+static void init_pass_run(CSOUND *csound, INSDS *ip)
+{
+    int done;
+#ifdef HAVE_ATOMIC_BUILTIN
+    done = __sync_fetch_and_add((int *) &ip->init_done, 0);
+#else
+    done = ip->init_done;
+#endif
+    /* it may have been turned off, or already done by a rescan */
+    if (done != 0 || !ip->actflg)
+      return;
+    csoundLockMutex(csound->init_pass_threadlock);
+    csound->ids = (OPDS *) (ip->nxti);
+    csound->curip = ip;
+    while (csound->ids != NULL) {
+      if (UNLIKELY(csound->oparms->odebug))
+        csound->Message(csound, "init %s:\n",
+                        csound->ids->optext->t.oentry->opname);
+      (*csound->ids->iopadr)(csound, csound->ids);
+      csound->ids = csound->ids->nxti;
+    }
+    ip->tieflag = 0;
+#ifdef HAVE_ATOMIC_BUILTIN
+    __sync_lock_test_and_set((int*)&ip->init_done,1);
+#else
+    ip->init_done = 1;
+#endif
+    if (ip->reinitflag==1) {
+      ip->reinitflag = 0;
+    }
+    csoundUnlockMutex(csound->init_pass_threadlock);
+}
+
 /**
    In realtime mode, this function takes care of the init pass in a
    separate thread.
-   Any new instances will have their init-pass code executed here.
+   Any new instances will have their init-pass code executed here, as
+   soon as insert() queues them and wakes the thread.
+   There is a single init thread: init code runs against the shared
+   csound->ids and csound->curip under init_pass_threadlock, so more
+   threads would only queue up on that lock.
    This thread is started by musmon() and killed by csoundCleanup()
 */
 void *init_pass_thread(void *p){
     CSOUND *csound = (CSOUND *) p;
+    INIT_QUEUE *q = (INIT_QUEUE*) csound->init_pass_queue;
     INSDS *ip;
-    int done;
-    float wakeup = (1000*csound->ksmps/csound->esr);
     _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
-    
-    while (csound->init_pass_loop) {
 
-#if defined(MACOSX) || defined(LINUX) || defined(HAIKU)
-      usleep(1000*wakeup);
-#else
-      csoundSleep(((int)wakeup > 0) ? wakeup : 1);
-#endif
-      ip = csound->actanchor.nxtact;
-      /* do init pass for this instr */
-      while (ip != NULL){
-        INSDS *nxt = ip->nxtact;
-#ifdef HAVE_ATOMIC_BUILTIN
-        done = __sync_fetch_and_add((int *) &ip->init_done, 0);
-#else
-        done = ip->init_done;
-#endif
-        if (done == 0) {
-          csoundLockMutex(csound->init_pass_threadlock);
-          csound->ids = (OPDS *) (ip->nxti);
-          csound->curip = ip;
-          while (csound->ids != NULL) {
-            if (UNLIKELY(csound->oparms->odebug))
-              csound->Message(csound, "init %s:\n",
-                              csound->ids->optext->t.oentry->opname);
-            (*csound->ids->iopadr)(csound, csound->ids);
-            csound->ids = csound->ids->nxti;
-          }
-          ip->tieflag = 0;
-#ifdef HAVE_ATOMIC_BUILTIN
-          __sync_lock_test_and_set((int*)&ip->init_done,1);
-#else
-          ip->init_done = 1;
-#endif
-          if (ip->reinitflag==1) {
-            ip->reinitflag = 0;
-          }
-          csoundUnlockMutex(csound->init_pass_threadlock);
+    while (csound->init_pass_loop) {
+      /* every enqueue notifies, the timeout is only a safety net */
+      csoundWaitThreadLock(q->wakeup, 100);
+      while ((ip = init_pass_dequeue(q)) != NULL)
+        init_pass_run(csound, ip);
+      if (q->rescan) {
+        q->rescan = 0;
+        ip = csound->actanchor.nxtact;
+        /* do init pass for this instr */
+        while (ip != NULL){
+          INSDS *nxt = ip->nxtact;
+          init_pass_run(csound, ip);
+          ip = nxt;
         }
-        ip = nxt;
-
       }
-
     }
     return NULL;
 }
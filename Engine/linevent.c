@@ -203,6 +203,109 @@ void csoundInputMessageInternal(CSOUND *csound, const char *message)
     STA(Linep) += size;
 }
 
+/* Binary real-time events: hosts write CS_SCORE_EVENT structs into a
+   multi-writer circular buffer with csoundSubmitScoreEvents(), and
+   sensevents() moves them to the sorted list of pending events once per
+   k-cycle.  Nothing is parsed, and neither side allocates or locks:
+   the free list of event nodes is primed with one node per queue slot
+   when the queue is made, so that a full queue can be scheduled without
+   reaching calloc() in insert_score_event_at_sample().  An EVTNODE is
+   large (PMAX p-fields), which is what bounds the queue size. */
+
+#define RT_EVENT_QUEUE  1024
+#define RT_EVENT_NODES  RT_EVENT_QUEUE
+
+void *rt_event_queue_create(CSOUND *csound)
+{
+    int     i;
+    for (i = 0; i < RT_EVENT_NODES; i++) {
+      EVTNODE *e = (EVTNODE*) calloc((size_t) 1, sizeof(EVTNODE));
+      if (UNLIKELY(e == NULL))
+        break;
+      e->nxt = csound->freeEvtNodes;
+      csound->freeEvtNodes = e;
+    }
+#ifdef HAVE_ATOMIC_BUILTIN
+    return csoundCreateMPSCCircularBuffer(csound, RT_EVENT_QUEUE,
+                                          sizeof(CS_SCORE_EVENT));
+#else
+    /* several writers need atomics; serialise them on API_lock instead */
+    return csoundCreateCircularBuffer(csound, RT_EVENT_QUEUE,
+                                      sizeof(CS_SCORE_EVENT));
+#endif
+}
+
+static int rt_event_insert(CSOUND *csound, EVTBLK *evt,
+                           const CS_SCORE_EVENT *ev)
+{
+    int     i, pcnt = ev->pcnt;
+    int64_t frame = ev->frame;
+    evt->opcod = ev->type;
+    evt->pcnt = (int16) pcnt;
+    for (i = 0; i < pcnt; i++)
+      evt->p[i + 1] = ev->p[i];
+    /* the start time is in 'frame'; never schedule in the past */
+    if (pcnt >= 2)
+      evt->p[2] = FL(0.0);
+    if (frame < csound->icurTime)
+      frame = csound->icurTime;
+    return insert_score_event_at_sample(csound, evt, frame);
+}
+
+/* Called from sensevents() once per k-cycle */
+void rt_event_queue_drain(CSOUND *csound)
+{
+    CS_SCORE_EVENT *seg1, *seg2;
+    EVTBLK  evt;
+    int     n1, n2, i, items;
+
+    if (csound->rt_event_queue == NULL)
+      return;
+    items = csoundReadCircularBufferReserve(csound, csound->rt_event_queue,
+                                            RT_EVENT_QUEUE,
+                                            (void **) &seg1, &n1,
+                                            (void **) &seg2, &n2);
+    if (items == 0)
+      return;
+    evt.strarg = NULL; evt.scnt = 0;
+    evt.pinstance = NULL;
+    for (i = 0; i < n1; i++)
+      rt_event_insert(csound, &evt, &seg1[i]);
+    for (i = 0; i < n2; i++)
+      rt_event_insert(csound, &evt, &seg2[i]);
+    csoundReadCircularBufferCommit(csound, csound->rt_event_queue, items);
+}
+
+PUBLIC int csoundSubmitScoreEvents(CSOUND *csound,
+                                   const CS_SCORE_EVENT *events, int n)
+{
+    int     i, items;
+
+    if (UNLIKELY(csound->rt_event_queue == NULL))
+      return CSOUND_ERROR;
+    for (i = 0; i < n; i++) {
+      switch (events[i].type) {
+      case 'i': case 'q': case 'f': case 'a': case 'e':
+        if (LIKELY((unsigned int) events[i].pcnt <=
+                   (unsigned int) CS_SCORE_EVENT_PFIELDS))
+          continue;
+        /* fall through */
+      default:
+        return CSOUND_ERROR;
+      }
+    }
+#ifdef HAVE_ATOMIC_BUILTIN
+    items = csoundWriteCircularBuffer(csound, csound->rt_event_queue,
+                                      events, n);
+#else
+    csoundLockMutex(csound->API_lock);
+    items = csoundWriteCircularBuffer(csound, csound->rt_event_queue,
+                                      events, n);
+    csoundUnlockMutex(csound->API_lock);
+#endif
+    return items;
+}
+
 /* accumlate RT Linein buffer, & place completed events in EVTBLK */
 /* does more syntax checking than rdscor, since not preprocessed  */
 
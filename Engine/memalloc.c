@@ -53,6 +53,59 @@ typedef struct memAllocBlock_s {
 
 #define MEMALLOC_DB (csound->memalloc_db)
 
+/* Small blocks come from per-instance pools of fixed size classes
+   (POOL_MIN << c bytes including the header), carved out of POOL_CHUNK
+   byte chunks that are only returned to the system by memRESET().  Each
+   class keeps a lock-free free list (a stack of block indices tagged
+   with a generation count against ABA), so allocation and release on
+   the performance and init-pass threads never take the memory lock or
+   enter malloc once the pool is warm.  Larger blocks still come from
+   the system heap and are kept in the MEMALLOC_DB chain.
+   A pooled block is recognised by the low bit of its 'prv' field,
+   which then holds (index << 8) | (class << 1) | 1; 'nxt' is the free
+   list link (index + 1, 0 terminates).
+*/
+#ifdef HAVE_ATOMIC_BUILTIN
+#define MEMPOOL
+#endif
+
+#define POOL_CLASSES    (9)             /* 32 .. 8192 bytes     */
+#define POOL_MIN        (32)
+#define POOL_CHUNK      (65536)
+#define POOL_MAXCHUNKS  (1024)          /* per class            */
+
+#define MEMPOOL_DB  ((memPool_t*) csound->mempool)
+
+/* Writers publish with a full barrier (__sync_synchronize or the CAS in
+   pool_push); readers need the matching acquire between loading a list
+   head or the pool pointer and reading what it points at.  Loads are not
+   reordered with other loads on x86, so there only the compiler has to
+   be stopped. */
+#if defined(__i386__) || defined(__x86_64__)
+#define POOL_ACQUIRE()  __asm__ __volatile__ ("" : : : "memory")
+#else
+#define POOL_ACQUIRE()  __sync_synchronize()
+#endif
+
+#define POOL_TAG(i,c)   ((memAllocBlock_t*) (((uintptr_t) (i) << 8) | \
+                                             ((uintptr_t) (c) << 1) | 1))
+#define IS_POOLED(pp)   (((uintptr_t) (pp)->prv) & 1)
+#define POOL_CLASS(pp)  ((int) ((((uintptr_t) (pp)->prv) >> 1) & 0x7F))
+#define POOL_INDEX(pp)  ((uint32_t) (((uintptr_t) (pp)->prv) >> 8))
+
+typedef struct {
+    volatile uint64_t head;             /* (tag << 32) | (index + 1)    */
+    int32_t         bsize, per_chunk;
+    volatile int32_t nchunks;
+    unsigned char   *chunk[POOL_MAXCHUNKS];
+    volatile int64_t allocs, frees, misses;
+} memPoolClass_t;
+
+typedef struct {
+    memPoolClass_t  cls[POOL_CLASSES];
+    volatile int64_t heap_allocs, heap_frees;
+} memPool_t;
+
 static void memdie(CSOUND *csound, size_t nbytes)
 {
     csound->ErrorMsg(csound, Str("memory allocate failure for %lu"),
@@ -60,22 +113,129 @@ static void memdie(CSOUND *csound, size_t nbytes)
     csound->LongJmp(csound, CSOUND_MEMORY);
 }
 
-void *mmalloc(CSOUND *csound, size_t size)
-{
-    void  *p;
+#ifdef MEMPOOL
 
-#ifdef MEMDEBUG
-    if (UNLIKELY(size == (size_t) 0)) {
-      csound->DebugMsg(csound,
-              " *** internal error: mmalloc() called with zero nbytes\n");
-      return NULL;
+static memPool_t *pool_get(CSOUND *csound)
+{
+    memPool_t *pool = MEMPOOL_DB;
+    if (UNLIKELY(pool == NULL)) {
+      int c;
+      CSOUND_MEM_SPINLOCK
+      if ((pool = MEMPOOL_DB) == NULL) {
+        pool = (memPool_t*) calloc(1, sizeof(memPool_t));
+        if (pool != NULL) {
+          for (c = 0; c < POOL_CLASSES; c++) {
+            pool->cls[c].bsize = POOL_MIN << c;
+            pool->cls[c].per_chunk = POOL_CHUNK / (POOL_MIN << c);
+          }
+          __sync_synchronize();
+          csound->mempool = (void*) pool;
+        }
+      }
+      CSOUND_MEM_SPINUNLOCK
     }
-#endif
-    /* allocate memory */
-    if (UNLIKELY((p = malloc(ALLOC_BYTES(size))) == NULL)) {
-        memdie(csound, size);     /* does a long jump */
+    else POOL_ACQUIRE();
+    return pool;
+}
+
+static inline int pool_class(size_t bytes)
+{
+    int c = 0;
+    if (bytes > (size_t) (POOL_MIN << (POOL_CLASSES-1)))
+      return -1;
+    while ((size_t) (POOL_MIN << c) < bytes) c++;
+    return c;
+}
+
+static inline memAllocBlock_t *pool_block(memPoolClass_t *pc, uint32_t i)
+{
+    return (memAllocBlock_t*)
+      (pc->chunk[i / pc->per_chunk] + (size_t) (i % pc->per_chunk) * pc->bsize);
+}
+
+/* push the chain first..last (linked through 'nxt') onto the free list */
+static inline void pool_push(memPoolClass_t *pc, memAllocBlock_t *first,
+                             memAllocBlock_t *last)
+{
+    uint64_t old, new;
+    do {
+      old = pc->head;
+      last->nxt = (memAllocBlock_t*) (uintptr_t) (old & 0xFFFFFFFFU);
+      new = ((old + ((uint64_t) 1 << 32)) & ~(uint64_t) 0xFFFFFFFFU)
+            | (uint64_t) (POOL_INDEX(first) + 1);
+    } while (!__sync_bool_compare_and_swap(&pc->head, old, new));
+}
+
+/* add a chunk to class c and return its first block, NULL if full */
+static memAllocBlock_t *pool_grow(CSOUND *csound, memPoolClass_t *pc, int c)
+{
+    unsigned char *mem;
+    memAllocBlock_t *pp = NULL;
+    int32_t i, n, base;
+
+    CSOUND_MEM_SPINLOCK
+    n = pc->nchunks;
+    if (n < POOL_MAXCHUNKS && (mem = (unsigned char*) malloc(POOL_CHUNK))) {
+      pc->chunk[n] = mem;
+      base = n * pc->per_chunk;
+      for (i = 0; i < pc->per_chunk; i++) {
+        pp = (memAllocBlock_t*) (mem + (size_t) i * pc->bsize);
+        pp->prv = POOL_TAG(base + i, c);
+        pp->nxt = (memAllocBlock_t*) (uintptr_t) (base + i + 2);
+      }
+      __sync_synchronize();
+      pc->nchunks = n + 1;
+      /* block 0 goes to the caller, the rest onto the free list */
+      pool_push(pc, (memAllocBlock_t*) (mem + pc->bsize), pp);
+      pp = (memAllocBlock_t*) mem;
     }
-    /* link into chain */
+    else pp = NULL;
+    CSOUND_MEM_SPINUNLOCK
+    return pp;
+}
+
+static memAllocBlock_t *pool_alloc(CSOUND *csound, size_t bytes)
+{
+    memPool_t *pool;
+    memPoolClass_t *pc;
+    uint64_t old, new;
+    uint32_t i;
+    int c = pool_class(bytes);
+
+    if (c < 0 || (pool = pool_get(csound)) == NULL)
+      return NULL;
+    pc = &pool->cls[c];
+    do {
+      old = pc->head;
+      /* the block and the chunk holding it were published before head */
+      POOL_ACQUIRE();
+      if ((i = (uint32_t) (old & 0xFFFFFFFFU)) == 0) {
+        memAllocBlock_t *pp;
+        __sync_fetch_and_add(&pc->misses, 1);
+        if ((pp = pool_grow(csound, pc, c)) != NULL)
+          __sync_fetch_and_add(&pc->allocs, 1);
+        return pp;
+      }
+      /* the link may be stale if another thread wins; the tag catches it */
+      new = ((old + ((uint64_t) 1 << 32)) & ~(uint64_t) 0xFFFFFFFFU)
+            | (uint64_t) (uintptr_t) pool_block(pc, i - 1)->nxt;
+    } while (!__sync_bool_compare_and_swap(&pc->head, old, new));
+    __sync_fetch_and_add(&pc->allocs, 1);
+    return pool_block(pc, i - 1);
+}
+
+static void pool_free(CSOUND *csound, memAllocBlock_t *pp)
+{
+    memPoolClass_t *pc = &MEMPOOL_DB->cls[POOL_CLASS(pp)];
+    __sync_fetch_and_add(&pc->frees, 1);
+    pool_push(pc, pp, pp);
+}
+
+#endif  /* MEMPOOL */
+
+/* link a block from the system heap into the chain */
+static void *heap_link(CSOUND *csound, void *p)
+{
 #ifdef MEMDEBUG
     ((memAllocBlock_t*) p)->magic = MEMALLOC_MAGIC;
     ((memAllocBlock_t*) p)->ptr = DATA_PTR(p);
@@ -86,11 +246,41 @@ void *mmalloc(CSOUND *csound, size_t size)
     if (MEMALLOC_DB != NULL)
       ((memAllocBlock_t*) MEMALLOC_DB)->prv = (memAllocBlock_t*) p;
     MEMALLOC_DB = (void*) p;
+#ifdef MEMPOOL
+    if (MEMPOOL_DB != NULL) MEMPOOL_DB->heap_allocs++;
+#endif
     CSOUND_MEM_SPINUNLOCK
     /* return with data pointer */
     return DATA_PTR(p);
 }
 
+void *mmalloc(CSOUND *csound, size_t size)
+{
+    void  *p;
+
+#ifdef MEMDEBUG
+    if (UNLIKELY(size == (size_t) 0)) {
+      csound->DebugMsg(csound,
+              " *** internal error: mmalloc() called with zero nbytes\n");
+      return NULL;
+    }
+#endif
+#ifdef MEMPOOL
+    if ((p = pool_alloc(csound, ALLOC_BYTES(size))) != NULL) {
+#ifdef MEMDEBUG
+      ((memAllocBlock_t*) p)->magic = MEMALLOC_MAGIC;
+      ((memAllocBlock_t*) p)->ptr = DATA_PTR(p);
+#endif
+      return DATA_PTR(p);
+    }
+#endif
+    /* allocate memory */
+    if (UNLIKELY((p = malloc(ALLOC_BYTES(size))) == NULL)) {
+        memdie(csound, size);     /* does a long jump */
+    }
+    return heap_link(csound, p);
+}
+
 void *mcalloc(CSOUND *csound, size_t size)
 {
     void  *p;
@@ -101,25 +291,22 @@ void *mcalloc(CSOUND *csound, size_t size)
               " *** internal error: csound->Calloc() called with zero nbytes\n");
       return NULL;
     }
+#endif
+#ifdef MEMPOOL
+    if ((p = pool_alloc(csound, ALLOC_BYTES(size))) != NULL) {
+#ifdef MEMDEBUG
+      ((memAllocBlock_t*) p)->magic = MEMALLOC_MAGIC;
+      ((memAllocBlock_t*) p)->ptr = DATA_PTR(p);
+#endif
+      memset(DATA_PTR(p), 0, size);
+      return DATA_PTR(p);
+    }
 #endif
     /* allocate memory */
     if (UNLIKELY((p = calloc(ALLOC_BYTES(size), (size_t) 1)) == NULL)) {
       memdie(csound, size);     /* does longjump */
     }
-    /* link into chain */
-#ifdef MEMDEBUG
-    ((memAllocBlock_t*) p)->magic = MEMALLOC_MAGIC;
-    ((memAllocBlock_t*) p)->ptr = DATA_PTR(p);
-#endif
-    CSOUND_MEM_SPINLOCK
-    ((memAllocBlock_t*) p)->prv = (memAllocBlock_t*) NULL;
-    ((memAllocBlock_t*) p)->nxt = (memAllocBlock_t*) MEMALLOC_DB;
-    if (MEMALLOC_DB != NULL)
-      ((memAllocBlock_t*) MEMALLOC_DB)->prv = (memAllocBlock_t*) p;
-    MEMALLOC_DB = (void*) p;
-    CSOUND_MEM_SPINUNLOCK
-    /* return with data pointer */
-    return DATA_PTR(p);
+    return heap_link(csound, p);
 }
 
 void mfree(CSOUND *csound, void *p)
@@ -141,6 +328,12 @@ void mfree(CSOUND *csound, void *p)
     }
     pp->magic = 0;
  #endif
+#ifdef MEMPOOL
+    if (IS_POOLED(pp)) {
+      pool_free(csound, pp);
+      return;
+    }
+#endif
     CSOUND_MEM_SPINLOCK
     /* unlink from chain */
     {
@@ -152,10 +345,13 @@ void mfree(CSOUND *csound, void *p)
       else
         MEMALLOC_DB = (void*)nxt;
     }
+#ifdef MEMPOOL
+    if (MEMPOOL_DB != NULL) MEMPOOL_DB->heap_frees++;
+#endif
+    CSOUND_MEM_SPINUNLOCK
     //csound->Message(csound, "free\n");
     /* free memory */
     free((void*) pp);
-    CSOUND_MEM_SPINUNLOCK
 }
 
 void *mrealloc(CSOUND *csound, void *oldp, size_t size)
@@ -178,24 +374,38 @@ void *mrealloc(CSOUND *csound, void *oldp, size_t size)
       /* as a result of a bug */
       exit(-1);
     }
+#endif
+#ifdef MEMPOOL
+    if (IS_POOLED(pp)) {
+      /* stay in the block while the class fits, else move */
+      size_t avail = (size_t) (POOL_MIN << POOL_CLASS(pp)) - HDR_SIZE;
+      if (size <= avail)
+        return oldp;
+      p = mmalloc(csound, size);
+      memcpy(p, oldp, avail);
+      mfree(csound, oldp);
+      return p;
+    }
+#endif
+#ifdef MEMDEBUG
     /* mark old header as invalid */
     pp->magic = 0;
     pp->ptr = NULL;
 #endif
+    /* the neighbours must not relink into the old block while it moves */
+    CSOUND_MEM_SPINLOCK
     /* allocate memory */
     p = realloc((void*) pp, ALLOC_BYTES(size));
     if (UNLIKELY(p == NULL)) {
 #ifdef MEMDEBUG
-      CSOUND_MEM_SPINLOCK
       /* alloc failed, restore original header */
       pp->magic = MEMALLOC_MAGIC;
       pp->ptr = oldp;
-      CSOUND_MEM_SPINUNLOCK
 #endif
+      CSOUND_MEM_SPINUNLOCK
       memdie(csound, size);
       return NULL;
     }
-    CSOUND_MEM_SPINLOCK
     /* create new header and update chain pointers */
     pp = (memAllocBlock_t*) p;
 #ifdef MEMDEBUG
@@ -219,6 +429,17 @@ void *mrealloc(CSOUND *csound, void *oldp, size_t size)
 void memRESET(CSOUND *csound)
 {
     memAllocBlock_t *pp, *nxtp;
+#ifdef MEMPOOL
+    memPool_t *pool = MEMPOOL_DB;
+    if (pool != NULL) {
+      int c, n;
+      csound->mempool = NULL;
+      for (c = 0; c < POOL_CLASSES; c++)
+        for (n = 0; n < pool->cls[c].nchunks; n++)
+          free(pool->cls[c].chunk[n]);
+      free(pool);
+    }
+#endif
 
     pp = (memAllocBlock_t*) MEMALLOC_DB;
     MEMALLOC_DB = NULL;
@@ -231,3 +452,48 @@ void memRESET(CSOUND *csound)
       pp = nxtp;
     }
 }
+
+PUBLIC void csoundGetMemoryStats(CSOUND *csound, CS_MEMORY_STATS *stats)
+{
+    memset(stats, 0, sizeof(CS_MEMORY_STATS));
+#ifdef MEMPOOL
+    {
+      memPool_t *pool = MEMPOOL_DB;
+      int c;
+      if (pool == NULL) return;
+      for (c = 0; c < POOL_CLASSES; c++) {
+        memPoolClass_t *pc = &pool->cls[c];
+        stats->pool_allocs += pc->allocs;
+        stats->pool_frees += pc->frees;
+        stats->pool_misses += pc->misses;
+        stats->pool_bytes += (int64_t) pc->nchunks * POOL_CHUNK;
+      }
+      stats->heap_allocs = pool->heap_allocs;
+      stats->heap_frees = pool->heap_frees;
+    }
+#else
+    (void) csound;
+#endif
+}
+
+PUBLIC int csoundReserveMemory(CSOUND *csound, size_t size, int count)
+{
+#ifdef MEMPOOL
+    memPool_t *pool;
+    memPoolClass_t *pc;
+    memAllocBlock_t *pp;
+    int c = pool_class(ALLOC_BYTES(size));
+    if (c < 0 || count <= 0 || (pool = pool_get(csound)) == NULL)
+      return 0;
+    pc = &pool->cls[c];
+    /* each new chunk is handed straight back to the free list */
+    while (count > 0 && (pp = pool_grow(csound, pc, c)) != NULL) {
+      pool_push(pc, pp, pp);
+      count -= pc->per_chunk;
+    }
+    return count > 0 ? CSOUND_MEMORY : 0;
+#else
+    (void) csound; (void) size; (void) count;
+    return 0;
+#endif
+}
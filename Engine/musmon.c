@@ -32,6 +32,7 @@
 #include "corfile.h"
 
 #include "csdebug.h"
+#include "csprofile.h"
 
 #define SEGAMPS AMPLMSG
 #define SORMSG  RNGEMSG
@@ -48,6 +49,9 @@ extern  void    iotranset(CSOUND *), sfclosein(CSOUND*), sfcloseout(CSOUND*);
 extern  void    MidiClose(CSOUND *);
 extern  void    RTclose(CSOUND *);
 extern  void    remote_Cleanup(CSOUND *);
+extern  void    chn_apply_updates(CSOUND *);
+extern  void    *rt_event_queue_create(CSOUND *);
+extern  void    rt_event_queue_drain(CSOUND *);
 extern  char    **csoundGetSearchPathFromEnv(CSOUND *, const char *);
 /* extern  void    initialize_instrument0(CSOUND *); */
 
@@ -352,8 +356,10 @@ int musmon(CSOUND *csound)
 #ifndef __EMSCRIPTEN__
     if(csound->realtime_audio_flag && csound->init_pass_loop == 0){
       extern void *init_pass_thread(void *);
+      extern void *init_pass_queue_create(CSOUND *);
       pthread_attr_t attr;
       csound->init_pass_threadlock = csoundCreateMutex(0);
+      csound->init_pass_queue = init_pass_queue_create(csound);
       csoundLockMutex(csound->init_pass_threadlock);
       csound->init_pass_loop = 1;
       csoundUnlockMutex(csound->init_pass_threadlock);
@@ -364,6 +370,19 @@ int musmon(CSOUND *csound)
 
     }
 #endif
+#ifdef HAVE_ATOMIC_BUILTIN
+    if (O->instancePool > 0 && csound->instance_pool_thread == NULL) {
+      extern uintptr_t instance_pool_thread(void *);
+      csound->instance_pool_lock = csoundCreateMutex(0);
+      csound->instance_pool_wakeup = csoundCreateThreadLock();
+      csound->instance_pool_loop = 1;
+      csound->instance_pool_thread =
+        csoundCreateThread(instance_pool_thread, (void*) csound);
+    }
+#endif
+
+    if (csound->rt_event_queue == NULL)
+      csound->rt_event_queue = rt_event_queue_create(csound);
 
     /* since we are running in components, we exit here to playevents later */
     return 0;
@@ -437,15 +456,33 @@ PUBLIC int csoundCleanup(CSOUND *csound)
 
 #ifndef __EMSCRIPTEN__
     if(csound->init_pass_loop == 1) {
+      extern void init_pass_queue_wakeup(CSOUND *);
+      extern void init_pass_queue_destroy(CSOUND *);
       csoundLockMutex(csound->init_pass_threadlock);
       csound->init_pass_loop = 0;
       csoundUnlockMutex(csound->init_pass_threadlock);
+      init_pass_queue_wakeup(csound);
       pthread_join(csound->init_pass_thread, NULL);
+      init_pass_queue_destroy(csound);
       csoundDestroyMutex(csound->init_pass_threadlock);
       csound->init_pass_threadlock = 0;
     }
 #endif
+    if (csound->instance_pool_thread != NULL) {
+      csound->instance_pool_loop = 0;
+      csoundNotifyThreadLock(csound->instance_pool_wakeup);
+      csoundJoinThread(csound->instance_pool_thread);
+      csoundDestroyThreadLock(csound->instance_pool_wakeup);
+      csoundDestroyMutex(csound->instance_pool_lock);
+      csound->instance_pool_thread = NULL;
+      csound->instance_pool_wakeup = NULL;
+      csound->instance_pool_lock = NULL;
+    }
 
+    if (csound->rt_event_queue != NULL) {
+      csoundDestroyCircularBuffer(csound, csound->rt_event_queue);
+      csound->rt_event_queue = NULL;
+    }
     while (csound->freeEvtNodes != NULL) {
       p = (void*) csound->freeEvtNodes;
       csound->freeEvtNodes = ((EVTNODE*) p)->nxt;
@@ -478,6 +515,8 @@ PUBLIC int csoundCleanup(CSOUND *csound)
                       csound->perferrcnt);
       print_benchmark_info(csound, Str("end of performance"));
     }
+    if (csound->csprofile_data != NULL)
+      csprofile_cleanup(csound);
 /* close line input (-L) */
     RTclose(csound);
     /* close MIDI input */
@@ -905,6 +944,7 @@ int sensevents(CSOUND *csound)
     if (data && data->status == CSDEBUG_STATUS_STOPPED) {
         return 0; /* don't process events if we're in debug mode and stopped */
     }
+    chn_apply_updates(csound);
 
     if (UNLIKELY(csound->MTrkend && O->termifend)) {   /* end of MIDI file:  */
       deactivate_all_notes(csound);
@@ -1040,6 +1080,7 @@ int sensevents(CSOUND *csound)
     /*   events is not sorted by instrument number */
     /*   (although it never was sorted anyway...)  */
 
+    rt_event_queue_drain(csound);
     if (UNLIKELY(O->RTevents || getRemoteSocksIn(csound))) {
       int nrecvd;
       /* run all registered callback functions */
@@ -88,6 +88,20 @@ typedef struct {
     MYFLT   *r, *a, *b, *def;
 } DIVZ;
 
+#define FUSED_ARGS   16         /* operands of a fused expression */
+#define FUSED_BLOCK  64         /* samples evaluated at a time */
+
+/* a chain of a-rate + - * / made into one opcode by the optimiser;
+   prog is the expression in postfix, 'x' for each operand in turn */
+typedef struct {
+    OPDS    h;
+    MYFLT   *r;
+    STRINGDAT *prog;
+    MYFLT   *args[FUSED_ARGS];
+    char    code[2*FUSED_ARGS];
+    char    vec[FUSED_ARGS];    /* operand is a-rate */
+} FUSED;
+
 typedef struct {
     OPDS    h;
     MYFLT   *r, *a;
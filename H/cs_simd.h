@@ -0,0 +1,58 @@
+/*
+    cs_simd.h:
+
+    Copyright (C) 2026 Csound developers
+
+    This file is part of Csound.
+
+    The Csound Library is free software; you can redistribute it
+    and/or modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    Csound is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with Csound; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+    02111-1307 USA
+*/
+
+#ifndef CS_SIMD_H
+#define CS_SIMD_H
+
+/* Vector kernels are written with GCC vector types, or as simple loops
+   the compiler can vectorise.  CS_CLONES before a function definition
+   compiles it for AVX2 as well as for the baseline on x86-64 Linux,
+   and the loader picks one at run time; elsewhere the code is built for
+   the compiler's target, or as plain C without GCC.  Kernels that must
+   give the same results as the scalar code keep the same operations in
+   the same order per sample (AVX2 does not bring in FMA contraction). */
+
+#if defined(__GNUC__)
+#  define CS_VEC        1
+typedef MYFLT cs_vec_t __attribute__((vector_size(32)));
+#  define CS_VLEN       ((int) (32 / sizeof(MYFLT)))
+/* the masks comparisons of cs_vec_t give */
+#  ifdef USE_DOUBLE
+typedef int64_t cs_mask_t __attribute__((vector_size(32)));
+#  else
+typedef int32_t cs_mask_t __attribute__((vector_size(32)));
+#  endif
+/* doubles whatever MYFLT is, and the masks their comparisons give */
+typedef double cs_dvec_t __attribute__((vector_size(32)));
+typedef int64_t cs_dmask_t __attribute__((vector_size(32)));
+#  define CS_DLEN       4
+#endif
+
+#if defined(CS_VEC) && defined(__x86_64__) && defined(__linux__) && \
+    !defined(__clang__) && (__GNUC__ >= 6)
+#  define CS_CLONES     __attribute__((target_clones("avx2", "default")))
+#else
+#  define CS_CLONES
+#endif
+
+#endif  /* CS_SIMD_H */
@@ -0,0 +1,101 @@
+/*
+    csprofile.h:
+
+    Copyright (C) 2026 Csound developers
+
+    This file is part of Csound.
+
+    The Csound Library is free software; you can redistribute it
+    and/or modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    Csound is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with Csound; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+    02111-1307 USA
+*/
+
+#ifndef CSPROFILE_H
+#define CSPROFILE_H
+
+/* Internal state of the performance profiler (Top/csprofile.c).  While
+   profiling, csound->kperf is kperf_profile, which times every k-cycle
+   and instrument instance, and every opcode on one k-cycle in 'period'. */
+
+#include "csoundCore.h"
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define CSPROFILE_WORST   (16)      /* worst k-cycles kept */
+#define CSPROFILE_TRACE   (16384)   /* trace events kept */
+#define CSPROFILE_PERIOD  (16)      /* default opcode sampling period */
+
+typedef struct {
+    OENTRY    *oentry;
+    int64_t   calls, ticks, max;
+} csprofile_op_t;
+
+typedef struct {
+    int64_t   calls, ticks, max;
+} csprofile_instr_t;
+
+typedef struct {
+    int64_t   kcount;
+    int64_t   start, ticks;         /* relative to the profile start */
+    int       insno;                /* 0 for the whole k-cycle */
+} csprofile_event_t;
+
+typedef struct csprofile_data_s {
+    int       period;               /* time opcodes every period k-cycles */
+    int       countdown;
+    int64_t   t0;                   /* start of profiling */
+    int64_t   kperiod;              /* duration of a k-period */
+    csprofile_op_t    *ops;         /* open hash on OENTRY pointer */
+    int       nops, opsize;
+    csprofile_instr_t *instr;       /* indexed by instrument number */
+    int       ninstr;
+    int64_t   cycles, cycle_ticks;
+    int64_t   hist[CS_PROFILE_BINS];
+    CS_PROFILE_CYCLE worst[CSPROFILE_WORST];
+    int       nworst;
+    csprofile_event_t *trace;       /* ring buffer */
+    int       trace_pos, trace_full;
+    char      *trace_file;          /* written by csoundCleanup */
+    int       report;               /* print a profile in csoundCleanup */
+} csprofile_data_t;
+
+/* Monotonic time in nanoseconds */
+static inline int64_t csprofile_ticks(void)
+{
+#ifdef WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER t;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (int64_t) ((double) t.QuadPart * 1.0e9 / (double) freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + (int64_t) ts.tv_nsec;
+#endif
+}
+
+void csprofile_op(CSOUND *csound, csprofile_data_t *data,
+                  OENTRY *ep, int64_t ticks);
+void csprofile_instr(CSOUND *csound, csprofile_data_t *data, INSDS *ip,
+                     int64_t start, int64_t ticks, int traced);
+void csprofile_cycle(CSOUND *csound, csprofile_data_t *data,
+                     int64_t start, int64_t ticks);
+int  csprofile_option(CSOUND *csound, int period, const char *trace_file);
+void csprofile_cleanup(CSOUND *csound);
+
+#endif  /* CSPROFILE_H */
@@ -72,6 +72,7 @@ typedef struct {
   MYFLT aOut_bufsize;
   void *cb;
   int  async;
+  void *stream;                 /* DISKIN_INST when async, see diskin2.c */
 } DISKIN2;
 
 typedef struct {
@@ -114,6 +115,7 @@ typedef struct {
   MYFLT aOut_bufsize;
   void *cb;
   int  async;
+  void *stream;                 /* DISKIN_INST when async, see diskin2.c */
 } DISKIN2_ARRAY;
 
 int diskin2_init(CSOUND *csound, DISKIN2 *p);
@@ -32,6 +32,11 @@
 extern "C" {
 #endif
 
+  /* planned transforms in fftplan.c; return 0 if the size is not handled
+     or the plan is in use, and fftlib.c should do the transform itself */
+  int fftplan_complex(CSOUND *csound, MYFLT *buf, int M, int inverse);
+  int fftplan_real(CSOUND *csound, MYFLT *buf, int M, int inverse);
+
   /**
    * Returns the amplitude scale that should be applied to the result of
    * an inverse complex FFT with a length of 'FFTsize' samples.
@@ -48,5 +48,7 @@ int csoundFTAlloc(CSOUND *csound, int tableNum, int len);
  */
 int csoundFTDelete(CSOUND *csound, int tableNum);
 
+void ftgen_sync(CSOUND *csound);
+
 #endif  /* CSOUND_FGENS_H */
 
@@ -57,10 +57,20 @@ typedef struct {
 /* the number of optional outputs defined in entry.c */
 #define SUBINSTNUMOUTS  8
 
+/* UDO arguments that the body uses in place of its own variables */
+typedef struct {
+    int     nslots;
+    MYFLT   ***slot;            /* argument pointers in the UDO body */
+    int     *arg;               /* the UDO argument each one refers to */
+    MYFLT   **local;            /* the UDO's own variable per argument */
+    char    *bound;             /* per argument: caller's variable in use */
+} UDO_ARGREFS;
+
 typedef struct {
     OPCODINFO *opcode_info;
     void    *uopcode_struct;
     INSDS   *parent_ip;
+    UDO_ARGREFS *argrefs;       /* NULL until the first useropcdset */
     MYFLT   *iobufp_ptrs[12];  /* expandable IV - Oct 26 2002 */ /* was 8 */
 } OPCOD_IOBUFS;
 
@@ -0,0 +1,71 @@
+/*
+    spectral.h:
+
+    Copyright (C) 2026 Csound developers
+
+    This file is part of Csound.
+
+    The Csound Library is free software; you can redistribute it
+    and/or modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    Csound is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with Csound; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+    02111-1307 USA
+*/
+
+#ifndef CSOUND_SPECTRAL_H
+#define CSOUND_SPECTRAL_H
+
+#if !defined(__BUILDING_LIBCSOUND)
+#  error "Csound plugins and host applications should not include spectral.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /* Per-bin kernels in spectral.c, shared by the pvs opcodes and the
+     spectral array opcodes.  Spectra are interleaved pairs, n is the
+     number of pairs, and out may be the same array as in.
+
+     'approx' is csound->oparms->spectralApprox: with 0 the trigonometry
+     is done by libm and the results are those of the loops these
+     kernels replace; 1 uses polynomials with errors of about 4e-8 for
+     atan2 and 2e-16 for sin and cos, 2 cheaper ones with 1.2e-5 and
+     3.3e-7. */
+
+  /* re, im to magnitude, phase */
+  void spec_polar(MYFLT *out, const MYFLT *in, int n, int approx);
+  /* magnitude, phase to re, im */
+  void spec_rect(MYFLT *out, const MYFLT *in, int n, int approx);
+  /* the same from separate arrays of magnitudes and phases */
+  void spec_rect2(MYFLT *out, const MYFLT *mag, const MYFLT *ph, int n,
+                  int approx);
+  /* magnitudes or phases only, one value per pair */
+  void spec_mags(MYFLT *out, const MYFLT *in, int n);
+  void spec_phases(MYFLT *out, const MYFLT *in, int n, int approx);
+  /* sin(x) of n values */
+  void spec_sin(double *out, const double *x, int n, int approx);
+
+  /* amp, freq frames of fsigs */
+  void spec_mix(float *out, const float *a, const float *b, int n);
+  void spec_filter(float *out, const float *in, const float *fil, int n,
+                   MYFLT dirgain, MYFLT depth, float g);
+  void spec_smooth(float *out, const float *in, float *del, int n,
+                   double coef1, double coef2);
+  /* acc[i] += frame[i] for the 2n values of a frame */
+  void spec_accum(double *acc, const float *frame, int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* CSOUND_SPECTRAL_H */
@@ -23,43 +23,98 @@
 
 #include <csoundCore.h>
 
+/* Lock-free ring buffer for one reader and one writer, or, when created
+   with csoundCreateMPSCCircularBuffer(), several writers.
+   wp is only stored by the (committing) writer and rp by the reader;
+   each side publishes its index with a release barrier after copying
+   and reads the other's with an acquire barrier before copying.  The
+   indices live on separate cache lines so that the two sides do not
+   keep stealing the line from each other.
+   Several writers first reserve a range by moving 'wres' with a CAS,
+   copy their items, and then publish wp in reservation order. */
+
+#define CB_CACHE_LINE 64
+
+#ifdef HAVE_ATOMIC_BUILTIN
+#define CB_LOAD_ACQ(dst, x)  { dst = (x); __sync_synchronize(); }
+#define CB_STORE_REL(x, v)   { __sync_synchronize(); (x) = (v); }
+#else
+#define CB_LOAD_ACQ(dst, x)  { dst = (x); }
+#define CB_STORE_REL(x, v)   { (x) = (v); }
+#endif
+
 typedef struct _circular_buffer {
   char *buffer;
-  int  wp;
-  int rp;
   int numelem;
   int elemsize; /* in number of bytes */
+  int mpsc;     /* several writers */
+  char pad0[CB_CACHE_LINE];
+  volatile int wp;      /* written by the writer */
+  volatile int wres;    /* reserved by writers (MPSC only) */
+  char pad1[CB_CACHE_LINE - 2*sizeof(int)];
+  volatile int rp;      /* written by the reader */
+  char pad2[CB_CACHE_LINE - sizeof(int)];
 } circular_buffer;
 
-void *csoundCreateCircularBuffer(CSOUND *csound, int numelem, int elemsize){
+static circular_buffer *create_buffer(CSOUND *csound, int numelem,
+                                      int elemsize, int mpsc)
+{
     circular_buffer *p;
     if ((p = (circular_buffer *)
-         csound->Malloc(csound, sizeof(circular_buffer))) == NULL) {
+         csound->Calloc(csound, sizeof(circular_buffer))) == NULL) {
       return NULL;
     }
     p->numelem = numelem;
-    p->wp = p->rp = 0;
+    p->wp = p->wres = p->rp = 0;
     p->elemsize = elemsize;
+    p->mpsc = mpsc;
 
     if ((p->buffer = (char *) csound->Malloc(csound, numelem*elemsize)) == NULL) {
       return NULL;
     }
     memset(p->buffer, 0, numelem*elemsize);
-    return (void *)p;
+    return p;
 }
 
-static int checkspace(circular_buffer *p, int writeCheck){
-    int wp = p->wp, rp = p->rp, numelem = p->numelem;
-    if(writeCheck){
-      if (wp > rp) return rp - wp + numelem - 1;
-      else if (wp < rp) return rp - wp - 1;
-      else return numelem - 1;
-    }
-    else {
-      if (wp > rp) return wp - rp;
-      else if (wp < rp) return wp - rp + numelem;
-      else return 0;
-    }
+void *csoundCreateCircularBuffer(CSOUND *csound, int numelem, int elemsize){
+    return (void *) create_buffer(csound, numelem, elemsize, 0);
+}
+
+void *csoundCreateMPSCCircularBuffer(CSOUND *csound, int numelem,
+                                     int elemsize){
+    return (void *) create_buffer(csound, numelem, elemsize, 1);
+}
+
+/* items that can be read between rp and wp */
+static inline int readspace(int wp, int rp, int numelem){
+    return wp >= rp ? wp - rp : wp - rp + numelem;
+}
+
+/* items that can be written between wp and rp (one slot stays empty) */
+static inline int writespace(int wp, int rp, int numelem){
+    return rp > wp ? rp - wp - 1 : rp - wp + numelem - 1;
+}
+
+/* split 'items' starting at index 'pos' into two contiguous segments */
+static inline int firstseg(int pos, int items, int numelem){
+    return items < numelem - pos ? items : numelem - pos;
+}
+
+static inline void copy_out(circular_buffer *p, int rp, void *out, int items){
+    int n1 = firstseg(rp, items, p->numelem), elemsize = p->elemsize;
+    memcpy(out, p->buffer + (size_t) rp*elemsize, (size_t) n1*elemsize);
+    if (items > n1)
+      memcpy((char *) out + (size_t) n1*elemsize, p->buffer,
+             (size_t) (items - n1)*elemsize);
+}
+
+static inline void copy_in(circular_buffer *p, int wp, const void *in,
+                           int items){
+    int n1 = firstseg(wp, items, p->numelem), elemsize = p->elemsize;
+    memcpy(p->buffer + (size_t) wp*elemsize, in, (size_t) n1*elemsize);
+    if (items > n1)
+      memcpy(p->buffer, (const char *) in + (size_t) n1*elemsize,
+             (size_t) (items - n1)*elemsize);
 }
 
 int csoundReadCircularBuffer(CSOUND *csound, void *p, void *out, int items)
@@ -67,27 +122,16 @@ int csoundReadCircularBuffer(CSOUND *csound, void *p, void *out, int items)
     IGN(csound);
     if (p == NULL) return 0;
     {
-      int remaining;
-      int itemsread, numelem = ((circular_buffer *)p)->numelem;
-      int elemsize = ((circular_buffer *)p)->elemsize;
-      int i=0, rp = ((circular_buffer *)p)->rp;
-      char *buffer = ((circular_buffer *)p)->buffer;
-      if ((remaining = checkspace(p, 0)) == 0) {
+      circular_buffer *cb = (circular_buffer *) p;
+      int wp, rp = cb->rp, itemsread;
+      CB_LOAD_ACQ(wp, cb->wp);
+      if ((itemsread = readspace(wp, rp, cb->numelem)) == 0)
         return 0;
-      }
-      itemsread = items > remaining ? remaining : items;
-      for (i=0; i < itemsread; i++){
-        memcpy((char *) out + (i * elemsize),
-               &(buffer[elemsize * rp++]),  elemsize);
-        if (rp == numelem) {
-          rp = 0;
-        }
-      }
-#ifdef HAVE_ATOMIC_BUILTIN
-      __sync_lock_test_and_set(&((circular_buffer *)p)->rp,rp);
-#else
-      ((circular_buffer *)p)->rp = rp;
-#endif
+      if (itemsread > items) itemsread = items;
+      copy_out(cb, rp, out, itemsread);
+      rp += itemsread;
+      if (rp >= cb->numelem) rp -= cb->numelem;
+      CB_STORE_REL(cb->rp, rp);
       return itemsread;
     }
 }
@@ -96,22 +140,13 @@ int csoundPeekCircularBuffer(CSOUND *csound, void *p, void *out, int items)
 {
     IGN(csound);
     if (p == NULL) return 0;
-    int remaining;
-    int itemsread, numelem = ((circular_buffer *)p)->numelem;
-    int elemsize = ((circular_buffer *)p)->elemsize;
-    int i=0, rp = ((circular_buffer *)p)->rp;
-    char *buffer = ((circular_buffer *)p)->buffer;
-    if ((remaining = checkspace(p, 0)) == 0) {
-        return 0;
-    }
-    itemsread = items > remaining ? remaining : items;
-    for(i=0; i < itemsread; i++){
-        memcpy((char *) out + (i * elemsize),
-               &(buffer[elemsize * rp++]),  elemsize);
-        if (rp == numelem) {
-            rp = 0;
-        }
-    }
+    circular_buffer *cb = (circular_buffer *) p;
+    int wp, rp = cb->rp, itemsread;
+    CB_LOAD_ACQ(wp, cb->wp);
+    if ((itemsread = readspace(wp, rp, cb->numelem)) == 0)
+      return 0;
+    if (itemsread > items) itemsread = items;
+    copy_out(cb, rp, out, itemsread);
     return itemsread;
 }
 
@@ -119,52 +154,148 @@ void csoundFlushCircularBuffer(CSOUND *csound, void *p)
 {
     IGN(csound);
     if (p == NULL) return;
-    int remaining;
-    int itemsread, numelem = ((circular_buffer *)p)->numelem;
-    int i=0, rp = ((circular_buffer *)p)->rp;
-    //MYFLT *buffer = ((circular_buffer *)p)->buffer;
-    if ((remaining = checkspace(p, 0)) == 0) {
-        return;
-    }
-    itemsread = numelem > remaining ? remaining: numelem;
-    for (i=0; i < itemsread; i++){
-        rp++;
-        if(rp == numelem) rp = 0;
+    circular_buffer *cb = (circular_buffer *) p;
+    int wp;
+    CB_LOAD_ACQ(wp, cb->wp);
+    CB_STORE_REL(cb->rp, wp);
+}
+
+/* reserve up to 'items' slots for writing; returns the start index */
+static int write_reserve(circular_buffer *cb, int *items)
+{
+    int wp, rp, n;
+    if (!cb->mpsc) {
+      wp = cb->wp;
+      CB_LOAD_ACQ(rp, cb->rp);
+      n = writespace(wp, rp, cb->numelem);
+      if (*items > n) *items = n;
+      return wp;
     }
 #ifdef HAVE_ATOMIC_BUILTIN
-      __sync_lock_test_and_set(&((circular_buffer *)p)->rp,rp);
+    while (1) {
+      int end;
+      wp = cb->wres;
+      CB_LOAD_ACQ(rp, cb->rp);
+      if ((n = writespace(wp, rp, cb->numelem)) == 0) {
+        *items = 0;
+        return wp;
+      }
+      if (n > *items) n = *items;
+      end = wp + n;
+      if (end >= cb->numelem) end -= cb->numelem;
+      /* wres only moves forward, it cannot come back to 'wp' unless
+         a whole buffer's worth has been written and read meanwhile */
+      if (__sync_bool_compare_and_swap(&cb->wres, wp, end)) {
+        *items = n;
+        return wp;
+      }
+    }
 #else
-      ((circular_buffer *)p)->rp = rp;
+    *items = 0;
+    return cb->wp;
 #endif
 }
 
+/* publish n items written from 'start' */
+static void write_commit(circular_buffer *cb, int start, int n)
+{
+    int end = start + n;
+    if (end >= cb->numelem) end -= cb->numelem;
+    if (cb->mpsc) {
+      /* earlier reservations are published first; give way to a
+         writer that was preempted in the middle of its copy */
+      int spin = 0;
+      while (cb->wp != start) {
+        if (++spin == 1024) {
+          csoundSleep(0);
+          spin = 0;
+        }
+#ifdef HAVE_ATOMIC_BUILTIN
+        __sync_synchronize();
+#endif
+      }
+    }
+    CB_STORE_REL(cb->wp, end);
+}
 
 int csoundWriteCircularBuffer(CSOUND *csound, void *p, const void *in, int items)
 {
     IGN(csound);
     if (p == NULL) return 0;
-    int remaining;
-    int itemswrite, numelem = ((circular_buffer *)p)->numelem;
-    int elemsize = ((circular_buffer *)p)->elemsize;
-    int i=0, wp = ((circular_buffer *)p)->wp;
-    char *buffer = ((circular_buffer *)p)->buffer;
-    if ((remaining = checkspace(p, 1)) == 0) {
-        return 0;
-    }
-    itemswrite = items > remaining ? remaining : items;
-    for(i=0; i < itemswrite; i++){
-        memcpy(&(buffer[elemsize * wp++]),
-                ((char *) in) + (i * elemsize),  elemsize);
-        if(wp == numelem) wp = 0;
-    }
-#ifdef HAVE_ATOMIC_BUILTIN
-      __sync_lock_test_and_set(&((circular_buffer *)p)->wp,wp);
-#else
-      ((circular_buffer *)p)->wp = wp;
-#endif
+    circular_buffer *cb = (circular_buffer *) p;
+    int wp, itemswrite = items;
+    wp = write_reserve(cb, &itemswrite);
+    if (itemswrite == 0)
+      return 0;
+    copy_in(cb, wp, in, itemswrite);
+    write_commit(cb, wp, itemswrite);
     return itemswrite;
 }
 
+static int segments(circular_buffer *cb, int pos, int items,
+                    void **seg1, int *n1, void **seg2, int *n2)
+{
+    int first = firstseg(pos, items, cb->numelem);
+    *seg1 = cb->buffer + (size_t) pos*cb->elemsize;
+    *n1 = first;
+    *seg2 = items > first ? cb->buffer : NULL;
+    *n2 = items - first;
+    return items;
+}
+
+int csoundReadCircularBufferReserve(CSOUND *csound, void *p, int items,
+                                    void **seg1, int *n1,
+                                    void **seg2, int *n2)
+{
+    IGN(csound);
+    *seg1 = *seg2 = NULL;
+    *n1 = *n2 = 0;
+    if (p == NULL) return 0;
+    circular_buffer *cb = (circular_buffer *) p;
+    int wp, n;
+    CB_LOAD_ACQ(wp, cb->wp);
+    if ((n = readspace(wp, cb->rp, cb->numelem)) == 0)
+      return 0;
+    return segments(cb, cb->rp, n < items ? n : items, seg1, n1, seg2, n2);
+}
+
+void csoundReadCircularBufferCommit(CSOUND *csound, void *p, int items)
+{
+    IGN(csound);
+    if (p == NULL || items <= 0) return;
+    circular_buffer *cb = (circular_buffer *) p;
+    int rp = cb->rp + items;
+    if (rp >= cb->numelem) rp -= cb->numelem;
+    CB_STORE_REL(cb->rp, rp);
+}
+
+int csoundWriteCircularBufferReserve(CSOUND *csound, void *p, int items,
+                                     void **seg1, int *n1,
+                                     void **seg2, int *n2)
+{
+    IGN(csound);
+    *seg1 = *seg2 = NULL;
+    *n1 = *n2 = 0;
+    if (p == NULL) return 0;
+    circular_buffer *cb = (circular_buffer *) p;
+    int wp, rp, n;
+    if (cb->mpsc) return 0;     /* the commit could not be ordered */
+    wp = cb->wp;
+    CB_LOAD_ACQ(rp, cb->rp);
+    if ((n = writespace(wp, rp, cb->numelem)) == 0)
+      return 0;
+    return segments(cb, wp, n < items ? n : items, seg1, n1, seg2, n2);
+}
+
+void csoundWriteCircularBufferCommit(CSOUND *csound, void *p, int items)
+{
+    IGN(csound);
+    if (p == NULL || items <= 0) return;
+    circular_buffer *cb = (circular_buffer *) p;
+    if (cb->mpsc) return;
+    write_commit(cb, cb->wp, items);
+}
+
 void csoundDestroyCircularBuffer(CSOUND *csound, void *p){
     if(p == NULL) return;
     csound->Free(csound, ((circular_buffer *)p)->buffer);
@@ -493,6 +493,104 @@ int modaa(CSOUND *csound, AOP *p)
     return OK;
 }
 
+/* Fused a-rate arithmetic: the whole expression is evaluated on blocks
+   of FUSED_BLOCK samples, each operator a single loop over the block,
+   so that the intermediate results stay in the cache.  The last
+   operator writes the output directly; it reads its operands at the
+   same index first, so the output may be one of them.  Only the
+   optimiser emits ##fused, from --opt-level=1 up. */
+
+int fused_set(CSOUND *csound, FUSED *p)
+{
+    const char *c = p->prog->data;
+    int     nargs = (int) p->INOCOUNT - 1, arg = 0, sp = 0, n = 0;
+    char    vec[FUSED_ARGS];
+
+    if (UNLIKELY(c == NULL || nargs > FUSED_ARGS))
+      return csound->InitError(csound, Str("fused: invalid expression"));
+    for ( ; *c != '\0'; c++, n++) {
+      if (UNLIKELY(n >= 2*FUSED_ARGS - 1))
+        return csound->InitError(csound, Str("fused: invalid expression"));
+      if (*c == 'x') {
+        if (UNLIKELY(arg >= nargs))
+          return csound->InitError(csound, Str("fused: invalid expression"));
+        p->vec[arg] = vec[sp++] = IS_ASIG_ARG(p->args[arg]);
+        arg++;
+      }
+      else if (strchr("+-*/", *c) != NULL && sp >= 2 &&
+               (vec[sp-2] || vec[sp-1])) {
+        vec[sp-2] = 1;
+        sp--;
+      }
+      else
+        return csound->InitError(csound, Str("fused: invalid expression"));
+      p->code[n] = *c;
+    }
+    if (UNLIKELY(sp != 1 || arg != nargs || n < 3))
+      return csound->InitError(csound, Str("fused: invalid expression"));
+    p->code[n] = '\0';
+    return OK;
+}
+
+#define FUSED_OP(OP)                                    \
+    if (x != NULL && y != NULL)                         \
+      for (i = 0; i < n; i++) d[i] = x[i] OP y[i];      \
+    else if (x != NULL)                                 \
+      for (i = 0; i < n; i++) d[i] = x[i] OP b;         \
+    else                                                \
+      for (i = 0; i < n; i++) d[i] = a OP y[i];
+
+int fused_perf(CSOUND *csound, FUSED *p)
+{
+    MYFLT    buf[FUSED_ARGS][FUSED_BLOCK];
+    MYFLT    *vp[FUSED_ARGS], sv[FUSED_ARGS];   /* vector, or scalar */
+    MYFLT    *r = p->r;
+    uint32_t offset = p->h.insdshead->ksmps_offset;
+    uint32_t early  = p->h.insdshead->ksmps_no_end;
+    uint32_t i, n, base, nsmps = CS_KSMPS;
+
+    if (UNLIKELY(offset)) memset(r, '\0', offset*sizeof(MYFLT));
+    if (UNLIKELY(early)) {
+      nsmps -= early;
+      memset(&r[nsmps], '\0', early*sizeof(MYFLT));
+    }
+    for (base = offset; base < nsmps; base += n) {
+      const char *c;
+      int      sp = 0, arg = 0;
+      n = nsmps - base < FUSED_BLOCK ? nsmps - base : FUSED_BLOCK;
+      for (c = p->code; *c != '\0'; c++) {
+        MYFLT *x, *y, *d, a, b;
+        if (*c == 'x') {
+          if (p->vec[arg])
+            vp[sp] = p->args[arg] + base;
+          else {
+            vp[sp] = NULL;
+            sv[sp] = *p->args[arg];
+          }
+          sp++;
+          arg++;
+          continue;
+        }
+        sp--;
+        x = vp[sp-1]; a = sv[sp-1];
+        y = vp[sp];   b = sv[sp];
+        d = (c[1] == '\0') ? r + base : buf[sp-1];
+        switch (*c) {
+        case '+': FUSED_OP(+); break;
+        case '-': FUSED_OP(-); break;
+        case '*': FUSED_OP(*); break;
+        default:
+          if (UNLIKELY(y == NULL && b == FL(0.0) && base == offset))
+            csound->Warning(csound, Str("Division by zero"));
+          FUSED_OP(/);
+          break;
+        }
+        vp[sp-1] = d;
+      }
+    }
+    return OK;
+}
+
 int divzkk(CSOUND *csound, DIVZ *p)
 {
     IGN(csound);
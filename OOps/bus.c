@@ -303,10 +303,108 @@ int pvsout_perf(CSOUND *csound, FCHAN *p)
 
 /* "chn" opcodes and bus interface by Istvan Varga */
 
+static inline int *channel_lock(CHNENTRY *pp)
+{
+#ifndef MACOSX
+#if defined(HAVE_PTHREAD_SPIN_LOCK)
+    return (int*)pp->lock;
+#else
+    return &(pp->lock);
+#endif
+#else
+    return &(pp->lock);
+#endif
+}
+
+/* Control channel updates queued by csoundSetControlChannels() and
+   applied by the performance thread at the start of a k-cycle.  Hosts
+   serialise on 'lock' and write a whole batch before publishing it, so
+   the performance thread reads without locking and sees either all of a
+   batch or none of it. */
+
+#define CHN_UPDATE_QUEUE 4096
+
+typedef struct {
+    CHNENTRY  *chn;
+    MYFLT     value;
+} CHN_UPDATE;
+
+typedef struct {
+    void      *buffer;          /* circular buffer of CHN_UPDATE */
+    void      *lock;            /* serialises writers */
+} CHN_UPDATE_QUEUE_T;
+
+static int create_update_queue(CSOUND *csound)
+{
+    CHN_UPDATE_QUEUE_T *q = (CHN_UPDATE_QUEUE_T *)
+      csound->Calloc(csound, sizeof(CHN_UPDATE_QUEUE_T));
+    if (UNLIKELY(q == NULL))
+      return CSOUND_MEMORY;
+    q->buffer = csoundCreateCircularBuffer(csound, CHN_UPDATE_QUEUE,
+                                           sizeof(CHN_UPDATE));
+    q->lock = csoundCreateMutex(0);
+    if (UNLIKELY(q->buffer == NULL || q->lock == NULL))
+      return CSOUND_MEMORY;
+    csound->chn_updates = (void *) q;
+    return CSOUND_SUCCESS;
+}
+
+static void delete_update_queue(CSOUND *csound)
+{
+    CHN_UPDATE_QUEUE_T *q = (CHN_UPDATE_QUEUE_T *) csound->chn_updates;
+    if (q == NULL)
+      return;
+    csound->chn_updates = NULL;
+    if (q->lock != NULL)
+      csoundDestroyMutex(q->lock);
+    csoundDestroyCircularBuffer(csound, q->buffer);
+    csound->Free(csound, q);
+}
+
+static inline void chn_store_control(CHNENTRY *pp, MYFLT val)
+{
+#ifdef HAVE_ATOMIC_BUILTIN
+    union {
+      MYFLT d;
+      MYFLT_INT_TYPE i;
+    } x;
+    x.d = val;
+    __sync_lock_test_and_set((MYFLT_INT_TYPE *) pp->data, x.i);
+#else
+    int *lock = channel_lock(pp);
+    csoundSpinLock(lock);
+    *(pp->data) = val;
+    csoundSpinUnLock(lock);
+#endif
+}
+
+/* Called from sensevents() once per k-cycle */
+void chn_apply_updates(CSOUND *csound)
+{
+    CHN_UPDATE_QUEUE_T *q = (CHN_UPDATE_QUEUE_T *) csound->chn_updates;
+    CHN_UPDATE *seg1, *seg2;
+    int     n1, n2, i, items;
+
+    if (q == NULL)
+      return;
+    items = csoundReadCircularBufferReserve(csound, q->buffer,
+                                            CHN_UPDATE_QUEUE,
+                                            (void **) &seg1, &n1,
+                                            (void **) &seg2, &n2);
+    if (items == 0)
+      return;
+    for (i = 0; i < n1; i++)
+      chn_store_control(seg1[i].chn, seg1[i].value);
+    for (i = 0; i < n2; i++)
+      chn_store_control(seg2[i].chn, seg2[i].value);
+    csoundReadCircularBufferCommit(csound, q->buffer, items);
+}
+
 static int delete_channel_db(CSOUND *csound, void *p)
 {
     CONS_CELL *head, *values;
 
+    delete_update_queue(csound);
     if (csound->chn_db == NULL) {
       return 0;
     }
@@ -408,6 +506,8 @@ static CS_NOINLINE int create_new_channel(CSOUND *csound, const char *name,
           return CSOUND_MEMORY;
       if (UNLIKELY(csound->chn_db == NULL))
         return CSOUND_MEMORY;
+      if (UNLIKELY(create_update_queue(csound) != CSOUND_SUCCESS))
+        return CSOUND_MEMORY;
     }
     /* allocate new entry */
     pp = alloc_channel(csound, name, type);
@@ -471,18 +571,118 @@ PUBLIC int *csoundGetChannelLock(CSOUND *csound,
     if (UNLIKELY(name == NULL))
       return NULL;
     pp = find_channel(csound, name);
-    if (pp) {
-#ifndef MACOSX
-#if defined(HAVE_PTHREAD_SPIN_LOCK)
-      return (int*)pp->lock;
-#else
-      return &(pp->lock);
-#endif
+    if (pp)
+      return channel_lock(pp);
+    else return NULL;
+}
+
+PUBLIC void *csoundGetChannelHandle(CSOUND *csound, const char *name,
+                                    int type)
+{
+    MYFLT   *p;
+
+    if (csoundGetChannelPtr(csound, &p, name, type) != CSOUND_SUCCESS)
+      return NULL;
+    return (void *) find_channel(csound, name);
+}
+
+/* the data pointer is read on each access, as chnexport can rebind it */
+
+static inline CHNENTRY *handle_channel(void *handle, int type)
+{
+    CHNENTRY  *pp = (CHNENTRY *) handle;
+    if (UNLIKELY(pp == NULL ||
+                 (pp->type & CSOUND_CHANNEL_TYPE_MASK) != type))
+      return NULL;
+    return pp;
+}
+
+PUBLIC MYFLT csoundGetControlChannelHandle(CSOUND *csound, void *handle)
+{
+    CHNENTRY  *pp = handle_channel(handle, CSOUND_CONTROL_CHANNEL);
+    union {
+      MYFLT d;
+      MYFLT_INT_TYPE i;
+    } x;
+    IGN(csound);
+    if (UNLIKELY(pp == NULL))
+      return FL(0.0);
+#ifdef HAVE_ATOMIC_BUILTIN
+    x.i = __sync_fetch_and_add((MYFLT_INT_TYPE *) pp->data, 0);
 #else
-      return &(pp->lock);
+    x.d = *(pp->data);
 #endif
+    return x.d;
+}
+
+PUBLIC void csoundSetControlChannelHandle(CSOUND *csound, void *handle,
+                                          MYFLT val)
+{
+    CHNENTRY  *pp = handle_channel(handle, CSOUND_CONTROL_CHANNEL);
+    IGN(csound);
+    if (LIKELY(pp != NULL))
+      chn_store_control(pp, val);
+}
+
+PUBLIC void csoundGetAudioChannelHandle(CSOUND *csound, void *handle,
+                                        MYFLT *samples)
+{
+    CHNENTRY  *pp = handle_channel(handle, CSOUND_AUDIO_CHANNEL);
+    int       *lock;
+    if (UNLIKELY(pp == NULL))
+      return;
+    lock = channel_lock(pp);
+    csoundSpinLock(lock);
+    memcpy(samples, pp->data, csound->ksmps*sizeof(MYFLT));
+    csoundSpinUnLock(lock);
+}
+
+PUBLIC void csoundSetAudioChannelHandle(CSOUND *csound, void *handle,
+                                        const MYFLT *samples)
+{
+    CHNENTRY  *pp = handle_channel(handle, CSOUND_AUDIO_CHANNEL);
+    int       *lock;
+    if (UNLIKELY(pp == NULL))
+      return;
+    lock = channel_lock(pp);
+    csoundSpinLock(lock);
+    memcpy(pp->data, samples, csound->ksmps*sizeof(MYFLT));
+    csoundSpinUnLock(lock);
+}
+
+PUBLIC int csoundSetControlChannels(CSOUND *csound, void **handles,
+                                    const MYFLT *values, int n)
+{
+    CHN_UPDATE_QUEUE_T *q = (CHN_UPDATE_QUEUE_T *) csound->chn_updates;
+    CHN_UPDATE *seg1, *seg2;
+    int     n1, n2, i;
+
+    if (n <= 0)
+      return 0;
+    if (UNLIKELY(q == NULL || n >= CHN_UPDATE_QUEUE))
+      return CSOUND_ERROR;
+    for (i = 0; i < n; i++)
+      if (UNLIKELY(handle_channel(handles[i], CSOUND_CONTROL_CHANNEL) == NULL))
+        return CSOUND_ERROR;
+    csoundLockMutex(q->lock);
+    if (csoundWriteCircularBufferReserve(csound, q->buffer, n,
+                                         (void **) &seg1, &n1,
+                                         (void **) &seg2, &n2) < n) {
+      /* the performance thread has not caught up: nothing is queued */
+      csoundUnlockMutex(q->lock);
+      return 0;
     }
-    else return NULL;
+    for (i = 0; i < n1; i++) {
+      seg1[i].chn = (CHNENTRY *) handles[i];
+      seg1[i].value = values[i];
+    }
+    for (i = 0; i < n2; i++) {
+      seg2[i].chn = (CHNENTRY *) handles[n1+i];
+      seg2[i].value = values[n1+i];
+    }
+    csoundWriteCircularBufferCommit(csound, q->buffer, n);
+    csoundUnlockMutex(q->lock);
+    return n;
 }
 
 static int cmp_func(const void *p1, const void *p2)
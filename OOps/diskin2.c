@@ -25,13 +25,409 @@
 #include "soundio.h"
 #include "diskin2.h"
 #include <math.h>
+#include <limits.h>
+#if defined(LINUX)
+#  define DISKIN_FADVISE
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+/* Asynchronous streams (diskin2 in real-time mode without iforceSync)
+   are read ahead into a circular buffer by a pool of I/O threads shared
+   by all instances.  A stream queues itself from its perf function when
+   fewer than 'low' frames are left in the buffer; the threads take the
+   queued stream with the least audio left first and fill it up in
+   blocks of 'block' frames.  A stream is filled at init, so that its
+   first k-period is there, and removing it ends a fill after the
+   block being read. */
+
+#define DISKIN_MAXTHREADS 16
+
+enum { DISKIN_IDLE = 0, DISKIN_QUEUED, DISKIN_BUSY };
+
+struct DISKIN_STREAMS_;
 
 typedef struct DISKIN_INST_ {
   CSOUND *csound;
-  DISKIN2 *diskin;
+  struct DISKIN_STREAMS_ *streams;
+  void   *diskin;                   /* DISKIN2 or DISKIN2_ARRAY */
+  int    (*read)(CSOUND *, void *); /* writes 'block' frames to cb */
+  void   *cb;
+  int    chans;
+  int    block, low;                /* in sample frames */
+  int    state;                     /* DISKIN_IDLE, _QUEUED or _BUSY */
+  volatile int stop;                /* being removed: end the fill */
+  void   *idle;                     /* notified when a stopped fill ends */
+  int    insno;
+  int64_t underruns;                /* k-cycles that found too few frames */
+#ifdef DISKIN_FADVISE
+  int    fd;                        /* for read-ahead hints, or -1 */
+  double bytesPerFrame;
+  int64_t *pos_frac;
+  int32  hinted;                    /* frames hinted so far */
+#endif
   struct DISKIN_INST_ *nxt;
 } DISKIN_INST;
 
+typedef struct {
+  struct DISKIN_STREAMS_ *streams;
+  void   *wakeup;
+  void   *thread;
+} DISKIN_WORKER;
+
+typedef struct DISKIN_STREAMS_ {
+  void   *lock;                     /* protects the list and the states */
+  DISKIN_WORKER worker[DISKIN_MAXTHREADS];
+  int    nthreads, next;
+  int    quit;
+  DISKIN_INST *list;
+} DISKIN_STREAMS;
+
+int diskin_file_read(CSOUND *csound, DISKIN2 *p);
+int diskin_file_read_array(CSOUND *csound, DISKIN2_ARRAY *p);
+
+/* frames that can be read from a stream's buffer */
+
+static inline int diskin_stream_frames(DISKIN_INST *s)
+{
+    void *seg1, *seg2;
+    int  n1, n2;
+    return csoundReadCircularBufferReserve(s->csound, s->cb, INT_MAX,
+                                           &seg1, &n1, &seg2, &n2) / s->chans;
+}
+
+/* frames that can be written to a stream's buffer */
+
+static inline int diskin_stream_space(DISKIN_INST *s)
+{
+    void *seg1, *seg2;
+    int  n1, n2;
+    return csoundWriteCircularBufferReserve(s->csound, s->cb, INT_MAX,
+                                            &seg1, &n1, &seg2, &n2) / s->chans;
+}
+
+#ifdef DISKIN_FADVISE
+/* ask the kernel to read ahead of the stream's file position; the
+   offset is estimated from the file size, which is close enough for
+   the page cache */
+
+static void diskin_stream_hint(DISKIN_INST *s)
+{
+    int32 pos, len = 16 * s->block;
+    if (s->fd < 0)
+      return;
+    pos = (int32) (*(s->pos_frac) >> POS_FRAC_SHIFT);
+    if (pos < 0 || (pos >= s->hinted - len && pos + len/2 < s->hinted))
+      return;                           /* well inside the last hint */
+    posix_fadvise(s->fd, (off_t) (pos * s->bytesPerFrame),
+                  (off_t) (len * s->bytesPerFrame), POSIX_FADV_WILLNEED);
+    s->hinted = pos + len;
+}
+#endif
+
+static void diskin_stream_fill(DISKIN_INST *s)
+{
+#ifdef DISKIN_FADVISE
+    diskin_stream_hint(s);
+#endif
+    while (!s->stop && diskin_stream_space(s) >= s->block)
+      if (s->read(s->csound, s->diskin) != OK)
+        break;
+}
+
+static uintptr_t diskin_io_thread(void *p)
+{
+    DISKIN_WORKER  *w = (DISKIN_WORKER*) p;
+    DISKIN_STREAMS *st = w->streams;
+    DISKIN_INST    *s, *next;
+    int            n, left;
+
+    _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
+    for (;;) {
+      csoundLockMutex(st->lock);
+      if (st->quit) {
+        csoundUnlockMutex(st->lock);
+        break;
+      }
+      next = NULL;
+      left = INT_MAX;
+      for (s = st->list; s != NULL; s = s->nxt)     /* earliest deadline */
+        if (s->state == DISKIN_QUEUED && (n = diskin_stream_frames(s)) < left) {
+          next = s;
+          left = n;
+        }
+      if (next != NULL)
+        next->state = DISKIN_BUSY;
+      csoundUnlockMutex(st->lock);
+      if (next == NULL) {
+        /* every request notifies, the timeout is only a safety net */
+        csoundWaitThreadLock(w->wakeup, 100);
+        continue;
+      }
+      diskin_stream_fill(next);
+      csoundLockMutex(st->lock);
+      next->state = DISKIN_IDLE;
+      if (next->stop)
+        csoundNotifyThreadLock(next->idle);
+      csoundUnlockMutex(st->lock);
+    }
+    return 0;
+}
+
+/* queue a stream for refilling, counting an underrun if it ran dry */
+
+static void diskin_stream_request(DISKIN_INST *s, int underrun)
+{
+    DISKIN_STREAMS *st = s->streams;
+    DISKIN_WORKER  *w = NULL;
+
+    csoundLockMutex(st->lock);
+    s->underruns += underrun;
+    if (s->state == DISKIN_IDLE) {
+      s->state = DISKIN_QUEUED;
+      w = &(st->worker[st->next]);
+      if (++st->next >= st->nthreads)
+        st->next = 0;
+    }
+    csoundUnlockMutex(st->lock);
+    if (w != NULL)
+      csoundNotifyThreadLock(w->wakeup);
+}
+
+static int diskin_streams_stop(CSOUND *csound, void *p)
+{
+    DISKIN_STREAMS *st;
+    int            i;
+
+    (void) p;
+    if ((st = (DISKIN_STREAMS*)
+         csound->QueryGlobalVariable(csound, "DISKIN_STREAMS")) == NULL)
+      return OK;
+    csoundLockMutex(st->lock);
+    st->quit = 1;
+    csoundUnlockMutex(st->lock);
+    for (i = 0; i < st->nthreads; i++) {
+      csoundNotifyThreadLock(st->worker[i].wakeup);
+      csoundJoinThread(st->worker[i].thread);
+      csoundDestroyThreadLock(st->worker[i].wakeup);
+    }
+    while (st->list != NULL) {          /* instances not deinitialised */
+      DISKIN_INST *s = st->list;
+      st->list = s->nxt;
+#ifdef DISKIN_FADVISE
+      if (s->fd >= 0)
+        close(s->fd);
+#endif
+      csoundDestroyThreadLock(s->idle);
+      csound->Free(csound, s);
+    }
+    csoundDestroyMutex(st->lock);
+    csound->DestroyGlobalVariable(csound, "DISKIN_STREAMS");
+    return OK;
+}
+
+/* the I/O threads, started with the first stream and kept until reset */
+
+static DISKIN_STREAMS *diskin_streams(CSOUND *csound)
+{
+    DISKIN_STREAMS *st;
+    int            i, n = csound->oparms->diskinThreads;
+
+    if ((st = (DISKIN_STREAMS*)
+         csound->QueryGlobalVariable(csound, "DISKIN_STREAMS")) != NULL)
+      return st;
+#ifdef __EMSCRIPTEN__
+    n = 0;                              /* no threads */
+#endif
+    if (n <= 0)
+      return NULL;
+    if (n > DISKIN_MAXTHREADS)
+      n = DISKIN_MAXTHREADS;
+    if (csound->CreateGlobalVariable(csound, "DISKIN_STREAMS",
+                                     sizeof(DISKIN_STREAMS)) != CSOUND_SUCCESS)
+      return NULL;
+    st = (DISKIN_STREAMS*) csound->QueryGlobalVariable(csound, "DISKIN_STREAMS");
+    st->lock = csoundCreateMutex(0);
+    for (i = 0; i < n; i++) {
+      DISKIN_WORKER *w = &(st->worker[st->nthreads]);
+      w->streams = st;
+      if ((w->wakeup = csoundCreateThreadLock()) == NULL)
+        break;
+      if ((w->thread = csoundCreateThread(diskin_io_thread, (void*) w)) == NULL) {
+        csoundDestroyThreadLock(w->wakeup);
+        break;
+      }
+      st->nthreads++;
+    }
+    csound->RegisterResetCallback(csound, NULL, diskin_streams_stop);
+    if (st->nthreads == 0) {
+      diskin_streams_stop(csound, NULL);
+      return NULL;
+    }
+    return st;
+}
+
+/* make a stream whose circular buffer holds twice the frames of the
+   file buffer (bufSize), and at least four k-periods; it is not served
+   until diskin_stream_start() */
+
+static DISKIN_INST *diskin_stream_new(CSOUND *csound, void *p,
+                                      int (*read)(CSOUND *, void *),
+                                      int chans, int bufSize, int ksmps)
+{
+    DISKIN_STREAMS *st;
+    DISKIN_INST    *s;
+    int            size = 2 * bufSize;
+
+    if ((st = diskin_streams(csound)) == NULL)
+      return NULL;
+    if (size < 4 * ksmps)
+      size = 4 * ksmps;
+    s = (DISKIN_INST*) csound->Calloc(csound, sizeof(DISKIN_INST));
+    /* one slot of the circular buffer always stays empty */
+    if ((s->cb = csound->CreateCircularBuffer(csound, size * chans + 1,
+                                              sizeof(MYFLT))) == NULL) {
+      csound->Free(csound, s);
+      return NULL;
+    }
+    if ((s->idle = csoundCreateThreadLock()) == NULL) {
+      csound->DestroyCircularBuffer(csound, s->cb);
+      csound->Free(csound, s);
+      return NULL;
+    }
+    csoundWaitThreadLock(s->idle, 0);   /* created notified */
+    s->csound = csound;
+    s->streams = st;
+    s->diskin = p;
+    s->read = read;
+    s->chans = chans;
+    s->block = size / 4;
+    s->low = size / 2;
+#ifdef DISKIN_FADVISE
+    s->fd = -1;
+#endif
+    return s;
+}
+
+static void diskin_stream_start(CSOUND *csound, DISKIN_INST *s,
+                                const char *name, int insno,
+                                int64_t *pos_frac, int32 fileLength)
+{
+    DISKIN_STREAMS *st = s->streams;
+    DISKIN_INST    **sp;
+
+    s->insno = insno;
+#ifdef DISKIN_FADVISE
+    s->pos_frac = pos_frac;
+    if (name != NULL && fileLength > 0 &&
+        (s->fd = open(name, O_RDONLY)) >= 0) {
+      struct stat sb;
+      if (fstat(s->fd, &sb) == 0 && sb.st_size > 0) {
+        s->bytesPerFrame = (double) sb.st_size / (double) fileLength;
+        posix_fadvise(s->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+      }
+      else {
+        close(s->fd);
+        s->fd = -1;
+      }
+    }
+#else
+    (void) name; (void) pos_frac; (void) fileLength;
+#endif
+    diskin_stream_fill(s);              /* before the first read */
+    csoundLockMutex(st->lock);
+    for (sp = &(st->list); *sp != NULL; sp = &((*sp)->nxt))
+      ;
+    *sp = s;
+    csoundUnlockMutex(st->lock);
+}
+
+static void diskin_stream_remove(CSOUND *csound, DISKIN_INST *s)
+{
+    DISKIN_STREAMS *st;
+    DISKIN_INST    **sp;
+
+    if ((st = (DISKIN_STREAMS*)
+         csound->QueryGlobalVariable(csound, "DISKIN_STREAMS")) == NULL)
+      return;                           /* already freed on reset */
+    csoundLockMutex(st->lock);
+    if (s->state == DISKIN_BUSY) {
+      /* an I/O thread is filling it: wait for the block being read */
+      s->stop = 1;
+      csoundUnlockMutex(st->lock);
+      csoundWaitThreadLockNoTimeout(s->idle);
+      csoundLockMutex(st->lock);
+    }
+    for (sp = &(st->list); *sp != NULL && *sp != s; sp = &((*sp)->nxt))
+      ;
+    if (*sp != NULL)
+      *sp = s->nxt;
+    csoundUnlockMutex(st->lock);
+    if (s->underruns > 0)
+      csound->Warning(csound, Str("diskin2: instr %d: %lld underruns"),
+                      s->insno, (long long) s->underruns);
+#ifdef DISKIN_FADVISE
+    if (s->fd >= 0)
+      close(s->fd);
+#endif
+    csoundDestroyThreadLock(s->idle);
+    csound->DestroyCircularBuffer(csound, s->cb);
+    csound->Free(csound, s);
+}
+
+/* move the next k-period's frames from a stream's buffer to the
+   outputs, zeroing whatever is missing, and ask for a refill when the
+   buffer runs low */
+
+static void diskin_stream_read(CSOUND *csound, DISKIN_INST *s, MYFLT **out,
+                               uint32_t offset, uint32_t nsmps)
+{
+    void    *seg1, *seg2;
+    MYFLT   *s1, *s2, scal = csound->e0dbfs;
+    int     n1, n2, avail, want, got, i, chn, chans = s->chans;
+    uint32_t nn;
+
+    avail = csoundReadCircularBufferReserve(csound, s->cb, INT_MAX,
+                                            &seg1, &n1, &seg2, &n2);
+    avail -= avail % chans;
+    want = (int) (nsmps - offset) * chans;
+    got = want < avail ? want : avail;
+    s1 = (MYFLT*) seg1;
+    s2 = (MYFLT*) seg2;
+    for (nn = offset, i = 0; i < got; nn++)
+      for (chn = 0; chn < chans; chn++, i++)
+        out[chn][nn] = scal * (i < n1 ? s1[i] : s2[i - n1]);
+    for ( ; nn < nsmps; nn++)
+      for (chn = 0; chn < chans; chn++)
+        out[chn][nn] = FL(0.0);
+    csoundReadCircularBufferCommit(csound, s->cb, got);
+    if ((avail - got) / chans < s->low)
+      diskin_stream_request(s, got < want);
+}
+
+PUBLIC int csoundGetStreamStats(CSOUND *csound, CS_STREAM_STATS *stats, int n)
+{
+    DISKIN_STREAMS *st;
+    DISKIN_INST    *s;
+    int            cnt = 0;
+
+    if ((st = (DISKIN_STREAMS*)
+         csound->QueryGlobalVariable(csound, "DISKIN_STREAMS")) == NULL)
+      return 0;
+    csoundLockMutex(st->lock);
+    for (s = st->list; s != NULL; s = s->nxt, cnt++) {
+      if (cnt >= n)
+        continue;
+      stats[cnt].insno = s->insno;
+      stats[cnt].buffered = diskin_stream_frames(s);
+      stats[cnt].underruns = s->underruns;
+    }
+    csoundUnlockMutex(st->lock);
+    return cnt;
+}
+
 
 static CS_NOINLINE void diskin2_read_buffer(CSOUND *csound,
                                             DISKIN2 *p, int bufReadPos)
@@ -265,6 +661,7 @@ static int diskin2_init_(CSOUND *csound, DISKIN2 *p, int stringname)
     void    *fd;
     SF_INFO sfinfo;
     int     n;
+    DISKIN_INST *stream;
 
     /* check number of channels */
     p->nChannels = (int)(p->OUTOCOUNT);
@@ -375,55 +772,24 @@ static int diskin2_init_(CSOUND *csound, DISKIN2 *p, int stringname)
 
     memset(p->buf, 0, n*sizeof(MYFLT));
 
-    // create circular buffer, on fail set mode to synchronous
-    if(csound->realtime_audio_flag==1 && p->fforceSync==0 &&
-       (p->cb = csound->CreateCircularBuffer(csound,
-                                             p->bufSize*p->nChannels*2,
-                                             sizeof(MYFLT))) != NULL){
-      DISKIN_INST **top, *current;
-      int *start;
-      // allocate buffer
-      n = CS_KSMPS*sizeof(MYFLT)*p->nChannels;
+    /* stream asynchronously if there are I/O threads, else synchronously */
+    if (csound->realtime_audio_flag==1 && p->fforceSync==0 &&
+        (stream = diskin_stream_new(csound, p, (int (*)(CSOUND *, void *))
+                                    diskin_file_read,
+                                    p->nChannels, p->bufSize,
+                                    (int) CS_KSMPS)) != NULL) {
+      n = stream->block*sizeof(MYFLT)*p->nChannels;
       if (n != (int)p->auxData2.size)
         csound->AuxAlloc(csound, (int32) n, &(p->auxData2));
       p->aOut_buf = (MYFLT *) (p->auxData2.auxp);
       memset(p->aOut_buf, 0, n);
-      p->aOut_bufsize = CS_KSMPS;
-
-#ifndef __EMSCRIPTEN__
-      if ((top=(DISKIN_INST **)csound->QueryGlobalVariable(csound,
-                                                       "DISKIN_INST")) == NULL){
-        csound->CreateGlobalVariable(csound, "DISKIN_INST", sizeof(DISKIN_INST *));
-        top = (DISKIN_INST **) csound->QueryGlobalVariable(csound, "DISKIN_INST");
-        *top = (DISKIN_INST *) csound->Calloc(csound, sizeof(DISKIN_INST));
-        csound->CreateGlobalVariable(csound, "DISKIN_PTHREAD", sizeof(pthread_t));
-        csound->CreateGlobalVariable(csound, "DISKIN_THREAD_START", sizeof(int));
-        current = *top;
-      }
-      else
-#endif
-      {
-        current = *top;
-        while(current->nxt != NULL) { /* find next empty slot in chain */
-          current = current->nxt;
-        }
-        current->nxt = (DISKIN_INST *) csound->Calloc(csound, sizeof(DISKIN_INST));
-        current = current->nxt;
-      }
-      current->csound = csound;
-      current->diskin = p;
-      current->nxt = NULL;
-
-#ifndef __EMSCRIPTEN__
-      if( *(start = csound->QueryGlobalVariable(csound,
-                                                "DISKIN_THREAD_START")) == 0) {
-        void *diskin_io_thread(void *p);
-        *start = 1;
-        pthread_create((pthread_t *)csound->QueryGlobalVariable(csound,
-                                                                "DISKIN_PTHREAD"),
-                       NULL, diskin_io_thread, *top);
-      }
-#endif
+      p->aOut_bufsize = stream->block;
+      p->cb = stream->cb;
+      p->stream = stream;
+      p->initDone = 1;                  /* the stream is filled now */
+      diskin_stream_start(csound, stream, csound->GetFileName(fd),
+                          p->h.insdshead->insno, &(p->pos_frac),
+                          p->fileLength);
       csound->RegisterDeinitCallback(csound, p, diskin2_async_deinit);
       p->async = 1;
 
@@ -440,6 +806,7 @@ static int diskin2_init_(CSOUND *csound, DISKIN2 *p, int stringname)
     else {
       p->aOut_buf = NULL;
       p->aOut_bufsize = 0;
+      p->cb = p->stream = NULL;
       p->async = 0;
       /* print file information */
       if (UNLIKELY((csound->oparms_.msglevel & 7) == 7)) {
@@ -458,38 +825,10 @@ static int diskin2_init_(CSOUND *csound, DISKIN2 *p, int stringname)
 }
 
 int diskin2_async_deinit(CSOUND *csound,  void *p){
-
-  DISKIN_INST **top, *current, *prv;
-
-  if ((top = (DISKIN_INST **)
-       csound->QueryGlobalVariable(csound, "DISKIN_INST")) == NULL) return NOTOK;
-   current = *top;
-   prv = NULL;
-   while(current->diskin != (DISKIN2 *)p) {
-        prv = current;
-        current = current->nxt;
-   }
-   if(prv == NULL) *top = current->nxt;
-   else prv->nxt = current->nxt;
-
-#ifndef __EMSCRIPTEN__
-   if(*top == NULL) {
-     int *start; pthread_t *pt;
-
-     start = (int *) csound->QueryGlobalVariable(csound,"DISKIN_THREAD_START");
-     *start = 0;
-     pt = (pthread_t *) csound->QueryGlobalVariable(csound,"DISKIN_PTHREAD");
-     //csound->Message(csound, "dealloc %p %d\n", start, *start);
-     pthread_join(*pt, NULL);
-     csound->DestroyGlobalVariable(csound, "DISKIN_PTHREAD");
-     csound->DestroyGlobalVariable(csound, "DISKIN_THREAD_START");
-     csound->DestroyGlobalVariable(csound, "DISKIN_INST");
-   }
-#endif
-   csound->Free(csound, current);
-   csound->DestroyCircularBuffer(csound, ((DISKIN2 *)p)->cb);
-
-   return OK;
+    DISKIN2 *d = (DISKIN2 *) p;
+    diskin_stream_remove(csound, (DISKIN_INST *) d->stream);
+    d->stream = d->cb = NULL;
+    return OK;
 }
 
 static inline void diskin2_file_pos_inc(DISKIN2 *p, int32 *ndx)
@@ -697,8 +1036,8 @@ int diskin2_perf_synchronous(CSOUND *csound, DISKIN2 *p)
 
 int diskin_file_read(CSOUND *csound, DISKIN2 *p)
 {
-     /* nsmps is bufsize in frames */
-    int nsmps = p->aOut_bufsize - p->h.insdshead->ksmps_offset;
+     /* nsmps is the block size in frames */
+    int nsmps = (int) p->aOut_bufsize;
     int i, nn;
     int chn, chans = p->nChannels;
     double  d, frac_d, x, c, v, pidwarp_d;
@@ -870,14 +1209,13 @@ int diskin_file_read(CSOUND *csound, DISKIN2 *p)
         }
     }
     {
-    /* write to circular buffer */
+    /* write to circular buffer, the I/O thread has made sure it fits */
     int lc, mc=0, nc=nsmps*p->nChannels;
-    int *start = csound->QueryGlobalVariable(csound,"DISKIN_THREAD_START");
     do{
       lc = csound->WriteCircularBuffer(csound, p->cb, &aOut[mc], nc);
       nc -= lc;
       mc += lc;
-    } while(nc && *start);
+    } while(nc && lc);
     }
     return OK;
  file_error:
@@ -891,9 +1229,7 @@ int diskin2_perf_asynchronous(CSOUND *csound, DISKIN2 *p)
     uint32_t offset = p->h.insdshead->ksmps_offset;
     uint32_t early  = p->h.insdshead->ksmps_no_end;
     uint32_t nn, nsmps = CS_KSMPS;
-    MYFLT samp;
     int chn;
-    void *cb = p->cb;
     int chans = p->nChannels;
 
     if(offset || early) {
@@ -908,39 +1244,12 @@ int diskin2_perf_asynchronous(CSOUND *csound, DISKIN2 *p)
       return csound->PerfError(csound, p->h.insdshead,
                                Str("diskin2: not initialised"));
     }
-    for (nn = offset; nn < nsmps; nn++){
-
-    for (chn = 0; chn < chans; chn++) {
-      //int i =0;
-      //do {
-      // i =
-       csound->ReadCircularBuffer(csound, cb, &samp, 1);
-        //} while(i==0);
-        p->aOut[chn][nn] = csound->e0dbfs*samp;
-      }
-    }
+    diskin_stream_read(csound, (DISKIN_INST *) p->stream, p->aOut,
+                       offset, nsmps);
     return OK;
 }
 
 
-void *diskin_io_thread(void *p){
-  DISKIN_INST *current = (DISKIN_INST *) p;
-  int wakeup = 1000*current->csound->ksmps/current->csound->esr;
-  int *start =
-    current->csound->QueryGlobalVariable(current->csound,"DISKIN_THREAD_START");
-  _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
-  while(*start){
-    current = (DISKIN_INST *) p;
-    csoundSleep(wakeup > 0 ? wakeup : 1);
-    while(current != NULL){
-      diskin_file_read(current->csound, current->diskin);
-      current = current->nxt;
-  }
-  }
-  return NULL;
-}
-
-
 int diskin2_perf(CSOUND *csound, DISKIN2 *p) {
   if(!p->async) return diskin2_perf_synchronous(csound, p);
   else return diskin2_perf_asynchronous(csound, p);
@@ -1484,48 +1793,17 @@ static inline void diskin2_get_sample_array(CSOUND *csound,
 }
 
 int diskin2_async_deinit_array(CSOUND *csound,  void *p){
-
-  DISKIN_INST **top, *current, *prv;
-
-  if ((top = (DISKIN_INST **)
-       csound->QueryGlobalVariable(csound, "DISKIN_INST_ARRAY")) == NULL)
-    return NOTOK;
-   current = *top;
-   prv = NULL;
-   while(current->diskin != (DISKIN2 *)p) {
-        prv = current;
-        current = current->nxt;
-   }
-   if(prv == NULL) *top = current->nxt;
-   else prv->nxt = current->nxt;
-
-#ifndef __EMSCRIPTEN__
-   if(*top == NULL) {
-     int *start; pthread_t *pt;
-
-     start = (int *) csound->QueryGlobalVariable(csound,
-                                                 "DISKIN_THREAD_START_ARRAY");
-     *start = 0;
-     pt = (pthread_t *) csound->QueryGlobalVariable(csound,"DISKIN_PTHREAD_ARRAY");
-     //csound->Message(csound, "dealloc %p %d\n", start, *start);
-     pthread_join(*pt, NULL);
-     csound->DestroyGlobalVariable(csound, "DISKIN_PTHREAD_ARRAY");
-     csound->DestroyGlobalVariable(csound, "DISKIN_THREAD_START_ARRAY");
-     csound->DestroyGlobalVariable(csound, "DISKIN_INST_ARRAY");
-   }
-#endif
-
-   csound->Free(csound, current);
-   csound->DestroyCircularBuffer(csound, ((DISKIN2_ARRAY *)p)->cb);
-
-   return OK;
+    DISKIN2_ARRAY *d = (DISKIN2_ARRAY *) p;
+    diskin_stream_remove(csound, (DISKIN_INST *) d->stream);
+    d->stream = d->cb = NULL;
+    return OK;
 }
 
 
 int diskin_file_read_array(CSOUND *csound, DISKIN2_ARRAY *p)
 {
-     /* nsmps is bufsize in frames */
-    int nsmps = p->aOut_bufsize - p->h.insdshead->ksmps_offset;
+     /* nsmps is the block size in frames */
+    int nsmps = (int) p->aOut_bufsize;
     int i, nn;
     int chn, chans = p->nChannels;
     double  d, frac_d, x, c, v, pidwarp_d;
@@ -1697,14 +1975,13 @@ int diskin_file_read_array(CSOUND *csound, DISKIN2_ARRAY *p)
         }
     }
     {
-    /* write to circular buffer */
+    /* write to circular buffer, the I/O thread has made sure it fits */
     int lc, mc=0, nc=nsmps*p->nChannels;
-    int *start = csound->QueryGlobalVariable(csound,"DISKIN_THREAD_START");
     do{
       lc = csound->WriteCircularBuffer(csound, p->cb, &aOut[mc], nc);
       nc -= lc;
       mc += lc;
-    } while(nc && *start);
+    } while(nc && lc);
     }
     return OK;
  file_error:
@@ -1712,25 +1989,6 @@ int diskin_file_read_array(CSOUND *csound, DISKIN2_ARRAY *p)
    return NOTOK;
 }
 
-void *diskin_io_thread_array(void *p){
-  DISKIN_INST *current = (DISKIN_INST *) p;
-  int wakeup = 1000*current->csound->ksmps/current->csound->esr;
-  int *start =
-    current->csound->QueryGlobalVariable(current->csound,
-                                         "DISKIN_THREAD_START_ARRAY");
-  _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
-  while(*start){
-    current = (DISKIN_INST *) p;
-    csoundSleep(wakeup > 0 ? wakeup : 1);
-    while(current != NULL){
-      diskin_file_read_array(current->csound, (DISKIN2_ARRAY *)current->diskin);
-      current = current->nxt;
-  }
-  }
-  return NULL;
-}
-
-
 static int diskin2_init_array(CSOUND *csound, DISKIN2_ARRAY *p, int stringname)
 {
     double  pos;
@@ -1738,6 +1996,7 @@ static int diskin2_init_array(CSOUND *csound, DISKIN2_ARRAY *p, int stringname)
     void    *fd;
     SF_INFO sfinfo;
     int     n;
+    DISKIN_INST *stream;
     ARRAYDAT *t = p->aOut;
 
     /* if already open, close old file first */
@@ -1858,61 +2117,24 @@ static int diskin2_init_array(CSOUND *csound, DISKIN2_ARRAY *p, int stringname)
 
     memset(p->buf, 0, n*sizeof(MYFLT));
 
-    // create circular buffer, on fail set mode to synchronous
-    if(csound->realtime_audio_flag==1 && p->fforceSync==0 &&
-       (p->cb = csound->CreateCircularBuffer(csound,
-                                             p->bufSize*p->nChannels*2,
-                                             sizeof(MYFLT))) != NULL){
-      DISKIN_INST **top, *current;
-      int *start;
-      // allocate buffer
-      n = CS_KSMPS*sizeof(MYFLT)*p->nChannels;
+    /* stream asynchronously if there are I/O threads, else synchronously */
+    if (csound->realtime_audio_flag==1 && p->fforceSync==0 &&
+        (stream = diskin_stream_new(csound, p, (int (*)(CSOUND *, void *))
+                                    diskin_file_read_array,
+                                    p->nChannels, p->bufSize,
+                                    (int) CS_KSMPS)) != NULL) {
+      n = stream->block*sizeof(MYFLT)*p->nChannels;
       if (n != (int)p->auxData2.size)
         csound->AuxAlloc(csound, (int32) n, &(p->auxData2));
       p->aOut_buf = (MYFLT *) (p->auxData2.auxp);
       memset(p->aOut_buf, 0, n);
-      p->aOut_bufsize = CS_KSMPS;
-
-#ifndef __EMSCRIPTEN__
-      if ((top=(DISKIN_INST **)
-           csound->QueryGlobalVariable(csound,
-                                       "DISKIN_INST_ARRAY")) == NULL){
-        csound->CreateGlobalVariable(csound,
-                                     "DISKIN_INST_ARRAY", sizeof(DISKIN_INST *));
-        top = (DISKIN_INST **) csound->QueryGlobalVariable(csound,
-                                                           "DISKIN_INST_ARRAY");
-        *top = (DISKIN_INST *) csound->Calloc(csound, sizeof(DISKIN_INST));
-        csound->CreateGlobalVariable(csound,
-                                     "DISKIN_PTHREAD_ARRAY", sizeof(pthread_t));
-        csound->CreateGlobalVariable(csound,
-                                     "DISKIN_THREAD_START_ARRAY", sizeof(int));
-        current = *top;
-      }
-      else
-#endif
-      {
-        current = *top;
-        while(current->nxt != NULL) { /* find next empty slot in chain */
-          current = current->nxt;
-        }
-        current->nxt = (DISKIN_INST *) csound->Calloc(csound, sizeof(DISKIN_INST));
-        current = current->nxt;
-      }
-      current->csound = csound;
-      current->diskin =  (DISKIN2 *) p;
-      current->nxt = NULL;
-
-#ifndef __EMSCRIPTEN__
-      if (*(start =
-            csound->QueryGlobalVariable(csound,
-                                        "DISKIN_THREAD_START_ARRAY")) == 0) {
-        void *diskin_io_thread(void *p);
-        *start = 1;
-        pthread_create((pthread_t *)csound->QueryGlobalVariable(csound,
-                                                       "DISKIN_PTHREAD_ARRAY"),
-                       NULL, diskin_io_thread_array, *top);
-      }
-#endif
+      p->aOut_bufsize = stream->block;
+      p->cb = stream->cb;
+      p->stream = stream;
+      p->initDone = 1;                  /* the stream is filled now */
+      diskin_stream_start(csound, stream, csound->GetFileName(fd),
+                          p->h.insdshead->insno, &(p->pos_frac),
+                          p->fileLength);
       csound->RegisterDeinitCallback(csound, (DISKIN2 *) p,
                                      diskin2_async_deinit_array);
       p->async = 1;
@@ -1930,6 +2152,7 @@ static int diskin2_init_array(CSOUND *csound, DISKIN2_ARRAY *p, int stringname)
     else {
       p->aOut_buf = NULL;
       p->aOut_bufsize = 0;
+      p->cb = p->stream = NULL;
       p->async = 0;
       /* print file information */
       if (UNLIKELY((csound->oparms_.msglevel & 7) == 7)) {
@@ -2142,11 +2365,10 @@ int diskin2_perf_asynchronous_array(CSOUND *csound, DISKIN2_ARRAY *p)
     uint32_t offset = p->h.insdshead->ksmps_offset;
     uint32_t early  = p->h.insdshead->ksmps_no_end;
     uint32_t nn, nsmps = CS_KSMPS, ksmps = CS_KSMPS;
-    MYFLT samp;
     int chn;
-    void *cb = p->cb;
     int chans = p->nChannels;
     MYFLT *aOut = (MYFLT *) p->aOut->data;
+    MYFLT *out[DISKIN2_MAXCHN];
 
     if(offset || early) {
    for (chn = 0; chn < chans; chn++)
@@ -2160,17 +2382,9 @@ int diskin2_perf_asynchronous_array(CSOUND *csound, DISKIN2_ARRAY *p)
       return csound->PerfError(csound, p->h.insdshead,
                                Str("diskin2: not initialised"));
     }
-    for (nn = offset; nn < nsmps; nn++){
-
-    for (chn = 0; chn < chans; chn++) {
-      //int i =0;
-      //do {
-      // i =
-       csound->ReadCircularBuffer(csound, cb, &samp, 1);
-        //} while(i==0);
-        aOut[chn*ksmps+nn] = csound->e0dbfs*samp;
-      }
-    }
+    for (chn = 0; chn < chans; chn++)
+      out[chn] = aOut + chn*ksmps;
+    diskin_stream_read(csound, (DISKIN_INST *) p->stream, out, offset, nsmps);
     return OK;
 }
 
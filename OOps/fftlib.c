@@ -3239,6 +3239,8 @@ void csoundComplexFFT(CSOUND *csound, MYFLT *buf, int FFTsize)
     int   M;
 
     M = ConvertFFTSize(csound, FFTsize);
+    if (fftplan_complex(csound, buf, M, 0))
+      return;
     getTablePointers(csound, &Utbl, &BRLow, M, M / 2);
     ffts1(buf, M, Utbl, BRLow);
 }
@@ -3259,6 +3261,8 @@ void csoundInverseComplexFFT(CSOUND *csound, MYFLT *buf, int FFTsize)
     int   M;
 
     M = ConvertFFTSize(csound, FFTsize);
+    if (fftplan_complex(csound, buf, M, 1))
+      return;
     getTablePointers(csound, &Utbl, &BRLow, M, M / 2);
     iffts1(buf, M, Utbl, BRLow);
 }
@@ -3278,6 +3282,8 @@ void csoundRealFFT(CSOUND *csound, MYFLT *buf, int FFTsize)
     int   M;
 
     M = ConvertFFTSize(csound, FFTsize);
+    if (fftplan_real(csound, buf, M, 0))
+      return;
     getTablePointers(csound, &Utbl, &BRLow, M, (M - 1) / 2);
     rffts1(buf, M, Utbl, BRLow);
 }
@@ -3299,6 +3305,8 @@ void csoundInverseRealFFT(CSOUND *csound, MYFLT *buf, int FFTsize)
     int   M;
 
     M = ConvertFFTSize(csound, FFTsize);
+    if (fftplan_real(csound, buf, M, 1))
+      return;
     getTablePointers(csound, &Utbl, &BRLow, M, (M - 1) / 2);
     riffts1(buf, M, Utbl, BRLow);
 }
@@ -0,0 +1,422 @@
+/*
+    fftplan.c:
+
+    Copyright (C) 2026 Csound developers
+
+    This file is part of Csound.
+
+    The Csound Library is free software; you can redistribute it
+    and/or modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    Csound is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with Csound; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+    02111-1307 USA
+*/
+
+/* Planned power-of-two FFTs used by csoundComplexFFT(), csoundRealFFT()
+   and their inverses in fftlib.c.
+
+   The transform is a Stockham autosort FFT of radix 4 (with radix 2
+   stages when needed) on split real/imaginary arrays, so no bit
+   reversal is needed and the butterflies of each stage run over
+   contiguous memory.  Those inner loops are written with the vector
+   types of cs_simd.h, and the stage kernels are compiled for AVX2 as
+   well as for the baseline where that header allows it.
+
+   A plan holds the twiddle factors of every stage and a work area, and
+   is made once per size.  The work area belongs to whoever sets 'busy';
+   a concurrent transform of the same size falls back to fftlib.c.
+   The results have the scaling and layout of the fftlib.c routines. */
+
+#include "csoundCore.h"
+#include "fftlib.h"
+#include "cs_simd.h"
+
+#define FFTPLAN_MINM    4       /* smaller sizes are left to fftlib.c */
+#define FFTPLAN_MAXM    28
+
+typedef struct {
+    int     M, N;               /* N = 2^M complex points */
+    int     nstages;
+    int     radix[FFTPLAN_MAXM];
+    MYFLT   *tw[FFTPLAN_MAXM];  /* per stage: w1, w2, w3 (re, im) for each p */
+    MYFLT   *rtw;               /* real transform of 2N points: W^k, k <= N/2 */
+    MYFLT   *work;              /* two split buffers of N complex values */
+    volatile int busy;
+} FFT_PLAN;
+
+static FFT_PLAN *plan_create(CSOUND *csound, int M)
+{
+    FFT_PLAN *pl;
+    int     n, i, p, m, N = 1 << M, r4, r2;
+
+    pl = (FFT_PLAN *) csound->Calloc(csound, sizeof(FFT_PLAN));
+    pl->M = M;
+    pl->N = N;
+    /* radix 4 where possible, the odd factor of 2 done last */
+    r4 = M / 2;
+    r2 = M & 1;
+    for (i = 0; i < r4; i++) pl->radix[i] = 4;
+    if (r2) pl->radix[r4] = 2;
+    pl->nstages = r4 + r2;
+    for (i = 0, n = N; i < pl->nstages; n /= pl->radix[i], i++) {
+      MYFLT *tw;
+      m = n / pl->radix[i];
+      tw = pl->tw[i] = (MYFLT *)
+        csound->Malloc(csound, 6 * m * sizeof(MYFLT));
+      for (p = 0; p < m; p++) {
+        double th = -TWOPI * (double) p / (double) n;
+        tw[6*p]   = (MYFLT) cos(th);
+        tw[6*p+1] = (MYFLT) sin(th);
+        tw[6*p+2] = (MYFLT) cos(2.0 * th);
+        tw[6*p+3] = (MYFLT) sin(2.0 * th);
+        tw[6*p+4] = (MYFLT) cos(3.0 * th);
+        tw[6*p+5] = (MYFLT) sin(3.0 * th);
+      }
+    }
+    pl->rtw = (MYFLT *) csound->Malloc(csound, (N + 2) * sizeof(MYFLT));
+    for (i = 0; i <= N / 2; i++) {
+      double th = -PI * (double) i / (double) N;
+      pl->rtw[2*i]   = (MYFLT) cos(th);
+      pl->rtw[2*i+1] = (MYFLT) sin(th);
+    }
+    pl->work = (MYFLT *) csound->Malloc(csound, 4 * N * sizeof(MYFLT));
+    return pl;
+}
+
+#ifdef HAVE_ATOMIC_BUILTIN
+static void plan_destroy(CSOUND *csound, FFT_PLAN *pl)
+{
+    int     i;
+    for (i = 0; i < pl->nstages; i++)
+      csound->Free(csound, pl->tw[i]);
+    csound->Free(csound, pl->rtw);
+    csound->Free(csound, pl->work);
+    csound->Free(csound, pl);
+}
+#endif
+
+/* Plans are looked up from the perf threads, the realtime init thread
+   and the pvsanal/ftconv workers at once.  The table and each plan are
+   only published by a compare and swap once fully built, and read with
+   a barrier after the load; a thread losing the race frees its copy. */
+
+static FFT_PLAN *plan_get(CSOUND *csound, int M)
+{
+    FFT_PLAN **plans = (FFT_PLAN **) csound->FFT_plans;
+    FFT_PLAN *pl;
+#ifdef HAVE_ATOMIC_BUILTIN
+    if (UNLIKELY(plans == NULL)) {
+      plans = (FFT_PLAN **)
+        csound->Calloc(csound, (FFTPLAN_MAXM + 1) * sizeof(FFT_PLAN *));
+      if (!__sync_bool_compare_and_swap(&csound->FFT_plans, NULL,
+                                        (void *) plans)) {
+        csound->Free(csound, plans);
+        plans = (FFT_PLAN **) csound->FFT_plans;
+      }
+    }
+    __sync_synchronize();
+    if (UNLIKELY((pl = plans[M]) == NULL)) {
+      pl = plan_create(csound, M);
+      if (!__sync_bool_compare_and_swap(&plans[M], NULL, pl)) {
+        plan_destroy(csound, pl);
+        pl = plans[M];
+      }
+    }
+    __sync_synchronize();
+    if (__sync_lock_test_and_set(&pl->busy, 1))
+      return NULL;
+#else
+    if (UNLIKELY(plans == NULL)) {
+      plans = (FFT_PLAN **)
+        csound->Calloc(csound, (FFTPLAN_MAXM + 1) * sizeof(FFT_PLAN *));
+      csound->FFT_plans = (void *) plans;
+    }
+    if (UNLIKELY((pl = plans[M]) == NULL))
+      pl = plans[M] = plan_create(csound, M);
+    if (pl->busy)
+      return NULL;
+    pl->busy = 1;
+#endif
+    return pl;
+}
+
+static inline void plan_release(FFT_PLAN *pl)
+{
+#ifdef HAVE_ATOMIC_BUILTIN
+    __sync_lock_release(&pl->busy);
+#else
+    pl->busy = 0;
+#endif
+}
+
+/* One radix-4 stage: n = 4m points with stride s, x -> y */
+
+CS_CLONES
+static void stage4(int m, int s, const MYFLT *tw,
+                   const MYFLT *xr, const MYFLT *xi, MYFLT *yr, MYFLT *yi)
+{
+    int     p, q;
+    for (p = 0; p < m; p++) {
+      const MYFLT w1r = tw[6*p],   w1i = tw[6*p+1];
+      const MYFLT w2r = tw[6*p+2], w2i = tw[6*p+3];
+      const MYFLT w3r = tw[6*p+4], w3i = tw[6*p+5];
+      const MYFLT *ar = xr + s*p,       *ai = xi + s*p;
+      const MYFLT *br = xr + s*(p+m),   *bi = xi + s*(p+m);
+      const MYFLT *cr = xr + s*(p+2*m), *ci = xi + s*(p+2*m);
+      const MYFLT *dr = xr + s*(p+3*m), *di = xi + s*(p+3*m);
+      MYFLT *y0r = yr + s*4*p, *y0i = yi + s*4*p;
+      MYFLT *y1r = y0r + s,    *y1i = y0i + s;
+      MYFLT *y2r = y1r + s,    *y2i = y1i + s;
+      MYFLT *y3r = y2r + s,    *y3i = y2i + s;
+      q = 0;
+#ifdef CS_VEC
+      for (; q + CS_VLEN <= s; q += CS_VLEN) {
+        cs_vec_t var, vai, vbr, vbi, vcr, vci, vdr, vdi;
+        cs_vec_t s0r, s0i, d0r, d0i, s1r, s1i, d1r, d1i, tr, ti;
+        memcpy(&var, ar+q, sizeof(cs_vec_t)); memcpy(&vai, ai+q, sizeof(cs_vec_t));
+        memcpy(&vbr, br+q, sizeof(cs_vec_t)); memcpy(&vbi, bi+q, sizeof(cs_vec_t));
+        memcpy(&vcr, cr+q, sizeof(cs_vec_t)); memcpy(&vci, ci+q, sizeof(cs_vec_t));
+        memcpy(&vdr, dr+q, sizeof(cs_vec_t)); memcpy(&vdi, di+q, sizeof(cs_vec_t));
+        s0r = var + vcr; s0i = vai + vci;     /* a + c */
+        d0r = var - vcr; d0i = vai - vci;     /* a - c */
+        s1r = vbr + vdr; s1i = vbi + vdi;     /* b + d */
+        d1r = vbi - vdi; d1i = vdr - vbr;     /* -i (b - d) */
+        tr = s0r + s1r; ti = s0i + s1i;
+        memcpy(y0r+q, &tr, sizeof(cs_vec_t)); memcpy(y0i+q, &ti, sizeof(cs_vec_t));
+        tr = d0r + d1r; ti = d0i + d1i;
+        {
+          cs_vec_t ur = tr*w1r - ti*w1i, ui = tr*w1i + ti*w1r;
+          memcpy(y1r+q, &ur, sizeof(cs_vec_t)); memcpy(y1i+q, &ui, sizeof(cs_vec_t));
+        }
+        tr = s0r - s1r; ti = s0i - s1i;
+        {
+          cs_vec_t ur = tr*w2r - ti*w2i, ui = tr*w2i + ti*w2r;
+          memcpy(y2r+q, &ur, sizeof(cs_vec_t)); memcpy(y2i+q, &ui, sizeof(cs_vec_t));
+        }
+        tr = d0r - d1r; ti = d0i - d1i;
+        {
+          cs_vec_t ur = tr*w3r - ti*w3i, ui = tr*w3i + ti*w3r;
+          memcpy(y3r+q, &ur, sizeof(cs_vec_t)); memcpy(y3i+q, &ui, sizeof(cs_vec_t));
+        }
+      }
+#endif
+      for (; q < s; q++) {
+        MYFLT s0r = ar[q] + cr[q], s0i = ai[q] + ci[q];
+        MYFLT d0r = ar[q] - cr[q], d0i = ai[q] - ci[q];
+        MYFLT s1r = br[q] + dr[q], s1i = bi[q] + di[q];
+        MYFLT d1r = bi[q] - di[q], d1i = dr[q] - br[q];
+        MYFLT tr, ti;
+        y0r[q] = s0r + s1r; y0i[q] = s0i + s1i;
+        tr = d0r + d1r; ti = d0i + d1i;
+        y1r[q] = tr*w1r - ti*w1i; y1i[q] = tr*w1i + ti*w1r;
+        tr = s0r - s1r; ti = s0i - s1i;
+        y2r[q] = tr*w2r - ti*w2i; y2i[q] = tr*w2i + ti*w2r;
+        tr = d0r - d1r; ti = d0i - d1i;
+        y3r[q] = tr*w3r - ti*w3i; y3i[q] = tr*w3i + ti*w3r;
+      }
+    }
+}
+
+/* One radix-2 stage: n = 2m points with stride s, x -> y */
+
+CS_CLONES
+static void stage2(int m, int s, const MYFLT *tw,
+                   const MYFLT *xr, const MYFLT *xi, MYFLT *yr, MYFLT *yi)
+{
+    int     p, q;
+    for (p = 0; p < m; p++) {
+      const MYFLT wr = tw[6*p], wi = tw[6*p+1];
+      const MYFLT *ar = xr + s*p,     *ai = xi + s*p;
+      const MYFLT *br = xr + s*(p+m), *bi = xi + s*(p+m);
+      MYFLT *y0r = yr + s*2*p, *y0i = yi + s*2*p;
+      MYFLT *y1r = y0r + s,    *y1i = y0i + s;
+      q = 0;
+#ifdef CS_VEC
+      for (; q + CS_VLEN <= s; q += CS_VLEN) {
+        cs_vec_t var, vai, vbr, vbi, tr, ti, ur, ui;
+        memcpy(&var, ar+q, sizeof(cs_vec_t)); memcpy(&vai, ai+q, sizeof(cs_vec_t));
+        memcpy(&vbr, br+q, sizeof(cs_vec_t)); memcpy(&vbi, bi+q, sizeof(cs_vec_t));
+        tr = var + vbr; ti = vai + vbi;
+        memcpy(y0r+q, &tr, sizeof(cs_vec_t)); memcpy(y0i+q, &ti, sizeof(cs_vec_t));
+        tr = var - vbr; ti = vai - vbi;
+        ur = tr*wr - ti*wi; ui = tr*wi + ti*wr;
+        memcpy(y1r+q, &ur, sizeof(cs_vec_t)); memcpy(y1i+q, &ui, sizeof(cs_vec_t));
+      }
+#endif
+      for (; q < s; q++) {
+        MYFLT tr = ar[q] - br[q], ti = ai[q] - bi[q];
+        y0r[q] = ar[q] + br[q]; y0i[q] = ai[q] + bi[q];
+        y1r[q] = tr*wr - ti*wi; y1i[q] = tr*wi + ti*wr;
+      }
+    }
+}
+
+/* First stage (s = 1, radix 4) reading interleaved data: re[2i], im[2i] */
+
+CS_CLONES
+static void first4(int m, const MYFLT *tw, const MYFLT *re, const MYFLT *im,
+                   MYFLT *yr, MYFLT *yi)
+{
+    int     p;
+    for (p = 0; p < m; p++) {
+      MYFLT s0r = re[2*p] + re[2*(p+2*m)], s0i = im[2*p] + im[2*(p+2*m)];
+      MYFLT d0r = re[2*p] - re[2*(p+2*m)], d0i = im[2*p] - im[2*(p+2*m)];
+      MYFLT s1r = re[2*(p+m)] + re[2*(p+3*m)];
+      MYFLT s1i = im[2*(p+m)] + im[2*(p+3*m)];
+      MYFLT d1r = im[2*(p+m)] - im[2*(p+3*m)];
+      MYFLT d1i = re[2*(p+3*m)] - re[2*(p+m)];
+      MYFLT tr, ti;
+      yr[4*p] = s0r + s1r; yi[4*p] = s0i + s1i;
+      tr = d0r + d1r; ti = d0i + d1i;
+      yr[4*p+1] = tr*tw[6*p] - ti*tw[6*p+1];
+      yi[4*p+1] = tr*tw[6*p+1] + ti*tw[6*p];
+      tr = s0r - s1r; ti = s0i - s1i;
+      yr[4*p+2] = tr*tw[6*p+2] - ti*tw[6*p+3];
+      yi[4*p+2] = tr*tw[6*p+3] + ti*tw[6*p+2];
+      tr = d0r - d1r; ti = d0i - d1i;
+      yr[4*p+3] = tr*tw[6*p+4] - ti*tw[6*p+5];
+      yi[4*p+3] = tr*tw[6*p+5] + ti*tw[6*p+4];
+    }
+}
+
+/* Last stage (m = 1, no twiddles) writing interleaved, scaled data */
+
+CS_CLONES
+static void last4(int s, const MYFLT *xr, const MYFLT *xi,
+                  MYFLT *re, MYFLT *im, MYFLT scl)
+{
+    int     q;
+    for (q = 0; q < s; q++) {
+      MYFLT s0r = xr[q] + xr[q+2*s], s0i = xi[q] + xi[q+2*s];
+      MYFLT d0r = xr[q] - xr[q+2*s], d0i = xi[q] - xi[q+2*s];
+      MYFLT s1r = xr[q+s] + xr[q+3*s], s1i = xi[q+s] + xi[q+3*s];
+      MYFLT d1r = xi[q+s] - xi[q+3*s], d1i = xr[q+3*s] - xr[q+s];
+      re[2*q] = (s0r + s1r) * scl;       im[2*q] = (s0i + s1i) * scl;
+      re[2*(q+s)] = (d0r + d1r) * scl;   im[2*(q+s)] = (d0i + d1i) * scl;
+      re[2*(q+2*s)] = (s0r - s1r) * scl; im[2*(q+2*s)] = (s0i - s1i) * scl;
+      re[2*(q+3*s)] = (d0r - d1r) * scl; im[2*(q+3*s)] = (d0i - d1i) * scl;
+    }
+}
+
+CS_CLONES
+static void last2(int s, const MYFLT *xr, const MYFLT *xi,
+                  MYFLT *re, MYFLT *im, MYFLT scl)
+{
+    int     q;
+    for (q = 0; q < s; q++) {
+      re[2*q] = (xr[q] + xr[q+s]) * scl;
+      im[2*q] = (xi[q] + xi[q+s]) * scl;
+      re[2*(q+s)] = (xr[q] - xr[q+s]) * scl;
+      im[2*(q+s)] = (xi[q] - xi[q+s]) * scl;
+    }
+}
+
+/* In-place complex transform of interleaved data.  The inverse is the
+   forward transform with real and imaginary parts swapped on the way
+   in and out, scaled by 1/N. */
+
+static void plan_complex(FFT_PLAN *pl, MYFLT *buf, int inverse)
+{
+    MYFLT   *xr = pl->work, *xi = xr + pl->N;
+    MYFLT   *yr = xi + pl->N, *yi = yr + pl->N, *t;
+    MYFLT   *re = buf + inverse, *im = buf + 1 - inverse;
+    int     i, n, s, last = pl->nstages - 1;
+
+    first4(pl->N / 4, pl->tw[0], re, im, xr, xi);
+    for (i = 1, n = pl->N / 4, s = 4; i < last; i++) {
+      int m = n / pl->radix[i];
+      if (pl->radix[i] == 4)
+        stage4(m, s, pl->tw[i], xr, xi, yr, yi);
+      else
+        stage2(m, s, pl->tw[i], xr, xi, yr, yi);
+      t = xr; xr = yr; yr = t;
+      t = xi; xi = yi; yi = t;
+      n = m;
+      s *= pl->radix[i];
+    }
+    if (pl->radix[last] == 4)
+      last4(s, xr, xi, re, im,
+            inverse ? FL(1.0) / (MYFLT) pl->N : FL(1.0));
+    else
+      last2(s, xr, xi, re, im,
+            inverse ? FL(1.0) / (MYFLT) pl->N : FL(1.0));
+}
+
+int fftplan_complex(CSOUND *csound, MYFLT *buf, int M, int inverse)
+{
+    FFT_PLAN *pl;
+    if (M < FFTPLAN_MINM || M > FFTPLAN_MAXM ||
+        csound->oparms->fftBackend != FFT_BACKEND_PLAN)
+      return 0;
+    if ((pl = plan_get(csound, M)) == NULL)
+      return 0;
+    plan_complex(pl, buf, inverse);
+    plan_release(pl);
+    return 1;
+}
+
+/* Real transform of 2^M points as a complex one of 2^(M-1) points on
+   the same buffer, with the two halves of the spectrum separated
+   afterwards (or combined beforehand for the inverse). */
+
+int fftplan_real(CSOUND *csound, MYFLT *buf, int M, int inverse)
+{
+    FFT_PLAN *pl;
+    MYFLT   *w;
+    int     k, N;
+
+    if (M - 1 < FFTPLAN_MINM || M - 1 > FFTPLAN_MAXM ||
+        csound->oparms->fftBackend != FFT_BACKEND_PLAN)
+      return 0;
+    if ((pl = plan_get(csound, M - 1)) == NULL)
+      return 0;
+    N = pl->N;
+    w = pl->rtw;
+    if (!inverse) {
+      MYFLT r0, i0;
+      plan_complex(pl, buf, 0);
+      r0 = buf[0]; i0 = buf[1];
+      buf[0] = r0 + i0;                 /* DC */
+      buf[1] = r0 - i0;                 /* Nyquist */
+      for (k = 1; k <= N / 2; k++) {
+        int j = N - k;
+        MYFLT ar = buf[2*k], ai = buf[2*k+1];
+        MYFLT br = buf[2*j], bi = -buf[2*j+1];   /* conj(Z[N-k]) */
+        MYFLT er = FL(0.5) * (ar + br), ei = FL(0.5) * (ai + bi);
+        MYFLT or_ = FL(0.5) * (ar - br), oi = FL(0.5) * (ai - bi);
+        MYFLT tr = w[2*k] * or_ - w[2*k+1] * oi;
+        MYFLT ti = w[2*k] * oi + w[2*k+1] * or_;
+        buf[2*k] = er + ti;  buf[2*k+1] = ei - tr;
+        buf[2*j] = er - ti;  buf[2*j+1] = -ei - tr;
+      }
+    }
+    else {
+      MYFLT r0 = buf[0], rn = buf[1];
+      buf[0] = FL(0.5) * (r0 + rn);
+      buf[1] = FL(0.5) * (r0 - rn);
+      for (k = 1; k <= N / 2; k++) {
+        int j = N - k;
+        MYFLT ar = buf[2*k], ai = buf[2*k+1];
+        MYFLT br = buf[2*j], bi = -buf[2*j+1];   /* conj(X[N-k]) */
+        MYFLT er = FL(0.5) * (ar + br), ei = FL(0.5) * (ai + bi);
+        /* T = i (X[k] - conj(X[N-k])) / 2, O = T conj(W^k) */
+        MYFLT tr = -FL(0.5) * (ai - bi), ti = FL(0.5) * (ar - br);
+        MYFLT or_ = w[2*k] * tr + w[2*k+1] * ti;
+        MYFLT oi = w[2*k] * ti - w[2*k+1] * tr;
+        buf[2*k] = er + or_;  buf[2*k+1] = ei + oi;
+        buf[2*j] = er - or_;  buf[2*j+1] = -(ei - oi);
+      }
+      plan_complex(pl, buf, 1);
+    }
+    plan_release(pl);
+    return 1;
+}
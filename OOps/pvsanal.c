@@ -29,6 +29,7 @@
 #include <math.h>
 #include "csoundCore.h"
 #include "pstream.h"
+#include "spectral.h"
 
         double  besseli(double x);
 static  void    hamming(MYFLT *win, int winLen, int even);
@@ -94,6 +95,308 @@ static CS_NOINLINE int PVS_CreateWindow(CSOUND *csound, MYFLT *buf,
 }
 
 
+/* make the normalised analysis window of M points (plus one if M is
+   even) for an fftsize of N; returns a pointer to its centre */
+
+static MYFLT *pvsanal_window(CSOUND *csound, MYFLT *analwinbase,
+                             int wintype, int32 N, int32 M)
+{
+    MYFLT *analwinhalf;
+    MYFLT sum;
+    int32 halfwinsize = M/2;
+    int   i, Mf = 1 - M%2;
+
+    analwinhalf = analwinbase + halfwinsize;
+
+    if (UNLIKELY(PVS_CreateWindow(csound, analwinhalf, wintype, M) != OK))
+      return NULL;
+
+    for (i = 1; i <= halfwinsize; i++)
+      *(analwinhalf - i) = *(analwinhalf + i - Mf);
+    if (M > N) {
+      double dN = (double)N;
+      /*  sinc function */
+      if (Mf)
+        *analwinhalf *= (MYFLT)(dN * sin(PI*0.5/dN) / (PI*0.5));
+      for (i = 1; i <= halfwinsize; i++)
+        *(analwinhalf + i) *= (MYFLT)
+          (dN * sin((double)(PI*(i+0.5*Mf)/dN)) / (PI*(i+0.5*Mf)));
+      for (i = 1; i <= halfwinsize; i++)
+        *(analwinhalf - i) = *(analwinhalf + i - Mf);
+    }
+    /* get net amp */
+    sum = FL(0.0);
+
+    for (i = -halfwinsize; i <= halfwinsize; i++)
+      sum += *(analwinhalf + i);
+    sum = FL(2.0) / sum;  /* factor of 2 comes in later in trig identity */
+    for (i = -halfwinsize; i <= halfwinsize; i++)
+      *(analwinhalf + i) *= sum;
+    return analwinhalf;
+}
+
+/* Analysis engine.  pvsanal instances with the same fftsize, overlap,
+   window size and built-in window type form a group, which holds their
+   analysis window.  With --pvs-batch the group also transforms their
+   frames together: at each hop an instance hands over its windowed
+   input and gets back the spectrum of the one it handed over at the
+   previous hop, so the output is one hop later than without batching.
+   The frames handed over in one k-cycle form a batch, which is closed
+   when the group is next run in a later k-cycle.  A closed batch is
+   transformed there and then, in one pass, or with --pvs-batch=thread
+   by a worker thread until the instances need the results. */
+
+enum { PVSB_NONE = 0, PVSB_QUEUED, PVSB_BUSY, PVSB_DONE };
+
+typedef struct PVSANAL_GROUP_ {
+    void    *engine;
+    int32   N, overlap, M;
+    int     wintype;
+    MYFLT   *window;                    /* centre of the shared window */
+    MYFLT   *winbase;
+    int64_t kcount;                     /* k-cycle of the open batch */
+    PVSANAL **open, **closed;           /* frames handed over */
+    int     nopen, nclosed, size;
+    struct PVSANAL_GROUP_ *nxt;
+} PVSANAL_GROUP;
+
+typedef struct {
+    CSOUND  *csound;
+    void    *lock;                      /* protects the groups' batches */
+    void    *wakeup, *thread;           /* worker, with --pvs-batch=thread */
+    int     quit;
+    PVSANAL_GROUP *groups;
+} PVSANAL_ENGINE;
+
+static void generate_spectrum(CSOUND *csound, PVSANAL *p, MYFLT *anal);
+
+/* take a frame of a group's closed batch that nobody works on yet */
+
+static PVSANAL *batch_claim(PVSANAL_GROUP *g)
+{
+    int i;
+    for (i = 0; i < g->nclosed; i++)
+      if (g->closed[i] != NULL && g->closed[i]->batchstate == PVSB_QUEUED) {
+        g->closed[i]->batchstate = PVSB_BUSY;
+        return g->closed[i];
+      }
+    return NULL;
+}
+
+static void batch_run(PVSANAL_ENGINE *e, PVSANAL *q)
+{
+    generate_spectrum(e->csound, q, (MYFLT *) q->batchbuf.auxp);
+    csoundLockMutex(e->lock);
+    q->batchstate = PVSB_DONE;
+    csoundUnlockMutex(e->lock);
+}
+
+/* wait for a frame of a closed batch, transforming it here if the
+   worker has not taken it; called and returns with the lock held */
+
+static void batch_wait(PVSANAL_ENGINE *e, PVSANAL *q)
+{
+    while (q->batchstate == PVSB_QUEUED || q->batchstate == PVSB_BUSY) {
+      if (q->batchstate == PVSB_QUEUED) {
+        q->batchstate = PVSB_BUSY;
+        csoundUnlockMutex(e->lock);
+        batch_run(e, q);
+      }
+      else {
+        csoundUnlockMutex(e->lock);
+        csoundSleep(0);                 /* the worker is on it */
+      }
+      csoundLockMutex(e->lock);
+    }
+}
+
+/* close the open batch if it is from an earlier k-cycle; the lock is
+   held */
+
+static void batch_close(PVSANAL_ENGINE *e, PVSANAL_GROUP *g)
+{
+    PVSANAL **tmp, *q;
+    int     i;
+
+    if (g->nopen == 0 || g->kcount == (int64_t) e->csound->kcounter)
+      return;
+    for (i = 0; i < g->nclosed; i++)    /* the one before must be done */
+      if (g->closed[i] != NULL)
+        batch_wait(e, g->closed[i]);
+    tmp = g->closed;
+    g->closed = g->open;
+    g->open = tmp;
+    g->nclosed = g->nopen;
+    g->nopen = 0;
+    if (e->thread != NULL) {
+      csoundNotifyThreadLock(e->wakeup);
+      return;
+    }
+    while ((q = batch_claim(g)) != NULL) {
+      csoundUnlockMutex(e->lock);
+      batch_run(e, q);
+      csoundLockMutex(e->lock);
+    }
+}
+
+static uintptr_t pvsanal_worker(void *arg)
+{
+    PVSANAL_ENGINE *e = (PVSANAL_ENGINE *) arg;
+    PVSANAL_GROUP  *g;
+    PVSANAL        *q;
+
+    _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
+    for (;;) {
+      csoundLockMutex(e->lock);
+      if (e->quit) {
+        csoundUnlockMutex(e->lock);
+        break;
+      }
+      q = NULL;
+      for (g = e->groups; g != NULL && q == NULL; g = g->nxt)
+        q = batch_claim(g);
+      csoundUnlockMutex(e->lock);
+      if (q == NULL) {
+        /* every batch closed notifies, the timeout is only a safety net */
+        csoundWaitThreadLock(e->wakeup, 100);
+        continue;
+      }
+      batch_run(e, q);
+    }
+    return 0;
+}
+
+static int pvsanal_engine_stop(CSOUND *csound, void *arg)
+{
+    PVSANAL_ENGINE *e;
+    PVSANAL_GROUP  *g;
+
+    (void) arg;
+    if ((e = (PVSANAL_ENGINE *)
+         csound->QueryGlobalVariable(csound, "PVSANAL_ENGINE")) == NULL)
+      return OK;
+    if (e->thread != NULL) {
+      csoundLockMutex(e->lock);
+      e->quit = 1;
+      csoundUnlockMutex(e->lock);
+      csoundNotifyThreadLock(e->wakeup);
+      csoundJoinThread(e->thread);
+      csoundDestroyThreadLock(e->wakeup);
+    }
+    while ((g = e->groups) != NULL) {
+      e->groups = g->nxt;
+      csound->Free(csound, g->winbase);
+      csound->Free(csound, g->open);
+      csound->Free(csound, g->closed);
+      csound->Free(csound, g);
+    }
+    csoundDestroyMutex(e->lock);
+    csound->DestroyGlobalVariable(csound, "PVSANAL_ENGINE");
+    return OK;
+}
+
+static PVSANAL_ENGINE *pvsanal_engine(CSOUND *csound)
+{
+    PVSANAL_ENGINE *e;
+
+    if ((e = (PVSANAL_ENGINE *)
+         csound->QueryGlobalVariable(csound, "PVSANAL_ENGINE")) != NULL)
+      return e;
+    if (csound->CreateGlobalVariable(csound, "PVSANAL_ENGINE",
+                                     sizeof(PVSANAL_ENGINE)) != CSOUND_SUCCESS)
+      return NULL;
+    e = (PVSANAL_ENGINE *) csound->QueryGlobalVariable(csound, "PVSANAL_ENGINE");
+    e->csound = csound;
+    e->lock = csoundCreateMutex(0);
+#ifndef __EMSCRIPTEN__
+    if (csound->oparms->pvsBatch > 1 &&
+        (e->wakeup = csoundCreateThreadLock()) != NULL &&
+        (e->thread = csoundCreateThread(pvsanal_worker, (void *) e)) == NULL) {
+      csoundDestroyThreadLock(e->wakeup);
+      e->wakeup = NULL;
+    }
+#endif
+    csound->RegisterResetCallback(csound, NULL, pvsanal_engine_stop);
+    return e;
+}
+
+/* find or make the group of an analysis setup */
+
+static PVSANAL_GROUP *pvsanal_group(CSOUND *csound, int32 N, int32 overlap,
+                                    int32 M, int wintype)
+{
+    PVSANAL_ENGINE *e;
+    PVSANAL_GROUP  *g;
+
+    if ((e = pvsanal_engine(csound)) == NULL)
+      return NULL;
+    csoundLockMutex(e->lock);
+    for (g = e->groups; g != NULL; g = g->nxt)
+      if (g->N == N && g->overlap == overlap && g->M == M &&
+          g->wintype == wintype)
+        break;
+    csoundUnlockMutex(e->lock);
+    if (g != NULL)
+      return g;
+    g = (PVSANAL_GROUP *) csound->Calloc(csound, sizeof(PVSANAL_GROUP));
+    g->winbase = (MYFLT *) csound->Calloc(csound, (M + 1) * sizeof(MYFLT));
+    if ((g->window = pvsanal_window(csound, g->winbase, wintype, N, M)) == NULL) {
+      csound->Free(csound, g->winbase);
+      csound->Free(csound, g);
+      return NULL;
+    }
+    g->engine = e;
+    g->N = N;
+    g->overlap = overlap;
+    g->M = M;
+    g->wintype = wintype;
+    if (e->thread != NULL) {
+      /* set up the transform of this size before the worker uses it */
+      MYFLT *tmp = (MYFLT *) csound->Calloc(csound, (N + 2) * sizeof(MYFLT));
+      if (!(N & (N - 1)))
+        csound->RealFFT(csound, tmp, N);
+      else
+        csound->RealFFTnp2(csound, tmp, N);
+      csound->Free(csound, tmp);
+    }
+    csoundLockMutex(e->lock);
+    g->nxt = e->groups;
+    e->groups = g;
+    csoundUnlockMutex(e->lock);
+    return g;
+}
+
+/* take an instance out of its group's batches */
+
+static int pvsanal_batch_deinit(CSOUND *csound, void *arg)
+{
+    PVSANAL        *p = (PVSANAL *) arg;
+    PVSANAL_ENGINE *e;
+    PVSANAL_GROUP  *g = (PVSANAL_GROUP *) p->group;
+    int            i;
+
+    if (g == NULL || (e = (PVSANAL_ENGINE *)
+                      csound->QueryGlobalVariable(csound,
+                                                  "PVSANAL_ENGINE")) == NULL)
+      return OK;
+    csoundLockMutex(e->lock);
+    while (p->batchstate == PVSB_BUSY) {
+      csoundUnlockMutex(e->lock);
+      csoundSleep(0);
+      csoundLockMutex(e->lock);
+    }
+    for (i = 0; i < g->nopen; i++)
+      if (g->open[i] == p)
+        g->open[i] = NULL;
+    for (i = 0; i < g->nclosed; i++)
+      if (g->closed[i] == p)
+        g->closed[i] = NULL;
+    p->batchstate = PVSB_NONE;
+    csoundUnlockMutex(e->lock);
+    return OK;
+}
+
+
 int pvssanalset(CSOUND *csound, PVSANAL *p)
 {
     /* opcode params */
@@ -160,10 +463,9 @@ int pvssanalset(CSOUND *csound, PVSANAL *p)
 
 int pvsanalset(CSOUND *csound, PVSANAL *p)
 {
-    MYFLT *analwinhalf,*analwinbase;
-    MYFLT sum;
+    PVSANAL_GROUP *g;
     int32 halfwinsize,buflen;
-    int i,nBins,Mf/*,Lf*/;
+    int nBins,Mf/*,Lf*/;
 
     /* opcode params */
     uint32_t N =(int32) *(p->fftsize);
@@ -172,8 +474,12 @@ int pvsanalset(CSOUND *csound, PVSANAL *p)
     int wintype = (int) *p->wintype;
     /* deal with iinit and iformat later on! */
 
-    if (overlap<CS_KSMPS || overlap<=10) /* 10 is a guess.... */
+    if (overlap<CS_KSMPS || overlap<=10) { /* 10 is a guess.... */
+      if (p->group != NULL)
+        pvsanal_batch_deinit(csound, p);
+      p->group = NULL;
       return pvssanalset(csound, p);
+    }
     if (UNLIKELY(N <= 32))
       return csound->InitError(csound,
                                Str("pvsanal: fftsize of 32 is too small!\n"));
@@ -205,41 +511,32 @@ int pvsanalset(CSOUND *csound, PVSANAL *p)
 
     csound->AuxAlloc(csound, overlap * sizeof(MYFLT), &p->overlapbuf);
     csound->AuxAlloc(csound, (N+2) * sizeof(MYFLT), &p->analbuf);
-    csound->AuxAlloc(csound, (M+Mf) * sizeof(MYFLT), &p->analwinbuf);
     csound->AuxAlloc(csound, nBins * sizeof(MYFLT), &p->oldInPhase);
     csound->AuxAlloc(csound, buflen * sizeof(MYFLT), &p->input);
     /* the signal itself */
     csound->AuxAlloc(csound, (N+2) * sizeof(MYFLT), &p->fsig->frame);
 
-    /* make the analysis window*/
-    analwinbase = (MYFLT *) (p->analwinbuf.auxp);
-    analwinhalf = analwinbase + halfwinsize;
-
-    if (UNLIKELY(PVS_CreateWindow(csound, analwinhalf, wintype, M) != OK))
-      return NOTOK;
-
-    for (i = 1; i <= halfwinsize; i++)
-      *(analwinhalf - i) = *(analwinhalf + i - Mf);
-    if (M > N) {
-      double dN = (double)N;
-      /*  sinc function */
-      if (Mf)
-        *analwinhalf *= (MYFLT)(dN * sin(PI*0.5/dN) / (PI*0.5));
-      for (i = 1; i <= halfwinsize; i++)
-        *(analwinhalf + i) *= (MYFLT)
-          (dN * sin((double)(PI*(i+0.5*Mf)/dN)) / (PI*(i+0.5*Mf)));
-      for (i = 1; i <= halfwinsize; i++)
-        *(analwinhalf - i) = *(analwinhalf + i - Mf);
+    /* make the analysis window, or share that of the group */
+    if (p->group != NULL)
+      pvsanal_batch_deinit(csound, p);
+    p->group = NULL;
+    if (wintype >= 0 &&
+        (g = pvsanal_group(csound, N, overlap, M, wintype)) != NULL) {
+      p->analwin = g->window;
+      if (csound->oparms->pvsBatch) {
+        csound->AuxAlloc(csound, (N+2) * sizeof(MYFLT), &p->batchbuf);
+        p->group = g;
+        p->batchstate = PVSB_NONE;
+        csound->RegisterDeinitCallback(csound, p, pvsanal_batch_deinit);
+      }
+    }
+    else {
+      csound->AuxAlloc(csound, (M+Mf) * sizeof(MYFLT), &p->analwinbuf);
+      p->analwin = pvsanal_window(csound, (MYFLT *) (p->analwinbuf.auxp),
+                                  wintype, N, M);
+      if (UNLIKELY(p->analwin == NULL))
+        return NOTOK;
     }
-    /* get net amp */
-    sum = FL(0.0);
-
-    for (i = -halfwinsize; i <= halfwinsize; i++)
-      sum += *(analwinhalf + i);
-    sum = FL(2.0) / sum;  /* factor of 2 comes in later in trig identity */
-    for (i = -halfwinsize; i <= halfwinsize; i++)
-      *(analwinhalf + i) *= sum;
-
 
   /*    p->invR = (float)(FL(1.0) / csound->esr); */
     p->RoverTwoPi = (float)(p->arate / TWOPI_F);
@@ -264,22 +561,19 @@ int pvsanalset(CSOUND *csound, PVSANAL *p)
     return OK;
 }
 
-static void generate_frame(CSOUND *csound, PVSANAL *p)
+/* take in the samples of the last hop and fold the windowed input
+   into anal, ready for the transform */
+
+static void generate_input(PVSANAL *p, MYFLT *anal)
 {
-  int got, tocp,i,j,k,ii;
+    int got, tocp,i,j,k;
     int N = p->fsig->N;
-    int N2 = N/2;
     int32 buflen = p->buflen;
     int32 analWinLen = p->fsig->winsize/2;
     int32 synWinLen = analWinLen;
-    float *ofp;                 /* RWD MUST be 32bit */
     MYFLT *fp;
-    MYFLT *anal = (MYFLT *) (p->analbuf.auxp);
     MYFLT *input = (MYFLT *) (p->input.auxp);
-    MYFLT *analWindow = (MYFLT *) (p->analwinbuf.auxp) + analWinLen;
-    MYFLT *oldInPhase = (MYFLT *) (p->oldInPhase.auxp);
-    MYFLT angleDif,real,imag,phase;
-    double rratio;
+    MYFLT *analWindow = p->analwin;
 
     got = p->fsig->overlap;      /*always assume */
     fp = (MYFLT *) (p->overlapbuf.auxp);
@@ -326,6 +620,37 @@ static void generate_frame(CSOUND *csound, PVSANAL *p)
       /* *(anal + k) += *(analWindow + i) * *(input + j); */
       anal[k] += analWindow[i] * input[j];
     }
+
+    p->nI += p->fsig->overlap;                          /* increment time */
+    if (p->nI > (synWinLen + p->fsig->overlap))
+      p->Ii = /*I*/p->fsig->overlap;
+    else
+      if (p->nI > synWinLen)
+        p->Ii = p->nI - synWinLen;
+      else {
+        p->Ii = 0;
+
+        /*  for (i=p->nO+synWinLen; i<buflen; i++)
+            if (i > 0)
+            *(output+i) = 0.0f;
+            */
+      }
+
+    p->IOi = p->Ii;
+}
+
+/* transform the folded input in anal and convert it to amplitudes and
+   frequencies */
+
+static void generate_spectrum(CSOUND *csound, PVSANAL *p, MYFLT *anal)
+{
+    int i,ii;
+    int N = p->fsig->N;
+    int N2 = N/2;
+    MYFLT *oldInPhase = (MYFLT *) (p->oldInPhase.auxp);
+    MYFLT angleDif,real,imag,phase;
+    double rratio;
+
     if (!(N & (N - 1))) {
       csound->RealFFT(csound, anal, N);
       anal[N] = anal[1];
@@ -368,19 +693,27 @@ static void generate_frame(CSOUND *csound, PVSANAL *p)
     }
 #endif
     /*if (format==PVS_AMP_FREQ) {*/
+    /* magnitudes and phases first: with --spectral-approx in one vector
+       pass, else as they always were */
+    if (csound->oparms->spectralApprox)
+      spec_polar(anal, anal, N2 + 1, csound->oparms->spectralApprox);
+    else
+      for (i=ii=0; i <= N2; i++,ii+=2) {
+        real = anal[ii];
+        imag = anal[ii+1];
+        anal[ii] = HYPOT(real, imag);
+        rratio =  atan2((double)imag,(double)real);
+        anal[ii+1] = (MYFLT)rratio;
+      }
     for (i=ii=0    /*,i0=anal,i1=anal+1,oi=oldInPhase*/;
          i <= N2;
          i++,ii+=2 /*i0+=2,i1+=2, oi++*/) {
-      real = anal[ii] /* *i0 */;
-      imag = anal[ii+1] /* *i1 */;
-      /**i0*/ anal[ii] = HYPOT(real, imag);
       /* phase unwrapping */
       /*if (*i0 == 0.)*/
       if (UNLIKELY(/* *i0 */ anal[ii] < FL(1.0E-10)))
         angleDif = FL(0.0);
       else {
-        rratio =  atan2((double)imag,(double)real);
-        angleDif  = (phase = (MYFLT)rratio) - /**oi*/ oldInPhase[i];
+        angleDif  = (phase = anal[ii+1]) - /**oi*/ oldInPhase[i];
         /* *oi */ oldInPhase[i] = phase;
       }
 
@@ -394,29 +727,57 @@ static void generate_frame(CSOUND *csound, PVSANAL *p)
 
     }
     /* } */
+}
+
+static void generate_output(PVSANAL *p, MYFLT *anal)
+{
+    int i, N = p->fsig->N;
+    MYFLT *fp = anal;
+    float *ofp = (float *) (p->fsig->frame.auxp);  /* RWD MUST be 32bit */
     /* else must be PVOC_COMPLEX */
-    fp = anal;
-    ofp = (float *) (p->fsig->frame.auxp);      /* RWD MUST be 32bit */
     for (i=0;i < N+2;i++)
       /* *ofp++ = (float)(*fp++); */
       ofp[i] = (float) fp[i];
+}
 
-    p->nI += p->fsig->overlap;                          /* increment time */
-    if (p->nI > (synWinLen + p->fsig->overlap))
-      p->Ii = /*I*/p->fsig->overlap;
-    else
-      if (p->nI > synWinLen)
-        p->Ii = p->nI - synWinLen;
-      else {
-        p->Ii = 0;
+static void generate_frame(CSOUND *csound, PVSANAL *p)
+{
+    MYFLT *anal = (MYFLT *) (p->analbuf.auxp);
+    generate_input(p, anal);
+    generate_spectrum(csound, p, anal);
+    generate_output(p, anal);
+}
 
-        /*  for (i=p->nO+synWinLen; i<buflen; i++)
-            if (i > 0)
-            *(output+i) = 0.0f;
-            */
-      }
+/* with --pvs-batch: output the spectrum of the frame handed over at the
+   last hop, and hand over this one */
 
-    p->IOi = p->Ii;
+static void generate_frame_batched(CSOUND *csound, PVSANAL *p)
+{
+    PVSANAL_GROUP  *g = (PVSANAL_GROUP *) p->group;
+    PVSANAL_ENGINE *e = (PVSANAL_ENGINE *) g->engine;
+    MYFLT          *anal = (MYFLT *) (p->batchbuf.auxp);
+
+    csoundLockMutex(e->lock);
+    if (p->batchstate != PVSB_NONE) {
+      batch_wait(e, p);
+      csoundUnlockMutex(e->lock);
+      generate_output(p, anal);
+    }
+    else
+      csoundUnlockMutex(e->lock);
+    generate_input(p, anal);
+    csoundLockMutex(e->lock);
+    if (g->nopen == g->size) {
+      g->size = g->size ? 2 * g->size : 16;
+      g->open = (PVSANAL **)
+        csound->ReAlloc(csound, g->open, g->size * sizeof(PVSANAL *));
+      g->closed = (PVSANAL **)
+        csound->ReAlloc(csound, g->closed, g->size * sizeof(PVSANAL *));
+    }
+    g->open[g->nopen++] = p;
+    g->kcount = (int64_t) csound->kcounter;
+    p->batchstate = PVSB_QUEUED;
+    csoundUnlockMutex(e->lock);
 }
 
 static void anal_tick(CSOUND *csound, PVSANAL *p,MYFLT samp)
@@ -424,7 +785,10 @@ static void anal_tick(CSOUND *csound, PVSANAL *p,MYFLT samp)
     MYFLT *inbuf = (MYFLT *) (p->overlapbuf.auxp);
 
     if (p->inptr== p->fsig->overlap) {
-      generate_frame(csound, p);
+      if (p->group != NULL)
+        generate_frame_batched(csound, p);
+      else
+        generate_frame(csound, p);
       p->fsig->framecount++;
       p->inptr = 0;
 
@@ -683,6 +1047,13 @@ int pvsanal(CSOUND *csound, PVSANAL *p)
       if (overlap<(int)nsmps || overlap<10) /* 10 is a guess.... */
         return pvssanal(csound, p);
     }
+    if (p->group != NULL) {
+      PVSANAL_ENGINE *e = (PVSANAL_ENGINE *)
+        ((PVSANAL_GROUP *) p->group)->engine;
+      csoundLockMutex(e->lock);
+      batch_close(e, (PVSANAL_GROUP *) p->group);
+      csoundUnlockMutex(e->lock);
+    }
     nsmps -= early;
     for (i=offset; i < nsmps; i++)
       anal_tick(csound,p,ain[i]);
@@ -895,7 +1266,6 @@ static void process_frame(CSOUND *csound, PVSYNTH *p)
     else if (format == PVS_AMP_FREQ) {
 #endif
       for (i=ii=0 /*, i0=syn, i1=syn+1*/; i<= NO2; i++, ii+=2 /*i0+=2,  i1+=2*/) {
-        mag = syn[ii]; /* *i0; */
         /* RWD variation to keep phase wrapped within +- TWOPI */
         /* this is spread across several frame cycles, as the problem does not
            develop for a while */
@@ -906,10 +1276,18 @@ static void process_frame(CSOUND *csound, PVSYNTH *p)
           the_phase = (MYFLT) fmod(the_phase,TWOPI);
         /* *(oldOutPhase + i) = the_phase; */
         oldOutPhase[i] = the_phase;
-        phase = the_phase;
-        /* *i0 */ syn[ii]  = (MYFLT)((double)mag * cos((double)phase));
-        /* *i1 */ syn[ii+1] = (MYFLT)((double)mag * sin((double)phase));
+        syn[ii+1] = the_phase;
       }
+      /* then to re, im: with --spectral-approx in one vector pass */
+      if (csound->oparms->spectralApprox)
+        spec_rect(syn, syn, NO2 + 1, csound->oparms->spectralApprox);
+      else
+        for (i=ii=0; i<= NO2; i++, ii+=2) {
+          mag = syn[ii];
+          phase = syn[ii+1];
+          /* *i0 */ syn[ii]  = (MYFLT)((double)mag * cos((double)phase));
+          /* *i1 */ syn[ii+1] = (MYFLT)((double)mag * sin((double)phase));
+        }
 #ifdef NOTDEF
     }
 #endif
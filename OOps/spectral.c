@@ -0,0 +1,354 @@
+/*
+    spectral.c:
+
+    Copyright (C) 2026 Csound developers
+
+    This file is part of Csound.
+
+    The Csound Library is free software; you can redistribute it
+    and/or modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    Csound is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with Csound; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+    02111-1307 USA
+*/
+
+/* Per-bin kernels for the pvs opcodes (Opcodes/pvsbasic.c, pvsanal and
+   pvsynth) and the spectral array opcodes (Opcodes/arrays.c).
+
+   The kernels are built with CS_CLONES.  Conversions split a block of
+   pairs into arrays of doubles first, so each step is one loop over
+   contiguous memory whatever the aliasing of the caller's arrays.
+   atan2, sin and cos can be libm, as before, or branch-free polynomials
+   (--spectral-approx), written with the vector types of cs_simd.h as
+   the compiler will not if-convert floating point selections itself;
+   the scalar tails do the same operations:
+
+   atan2: the ratio of the smaller to the larger of |re| and |im| is
+   taken through atan(t), 0 <= t <= 1, with the polynomials of
+   Abramowitz and Stegun 4.4.49 (error 2e-8) or 4.4.47 (error 1e-5),
+   then moved to its octant.
+
+   sin, cos: x is reduced by the nearest multiple of pi/2 (in two parts,
+   so the reduction is exact for the phases met here), and both are
+   found on [-pi/4, pi/4]: with the fdlibm kernel polynomials at level 1,
+   or truncated series at level 2 (error 3e-7). */
+
+#include "csoundCore.h"
+#include "cs_simd.h"
+#include "spectral.h"
+#include <math.h>
+
+#define SPEC_BLOCK      64
+
+#define HALF_PI         1.57079632679489661923
+#define TWO_OVER_PI     0.63661977236758134308
+#define PIO2_HI         1.57079632673412561417e+00  /* first 33 bits */
+#define PIO2_LO         6.07710050650619224932e-11  /* pi/2 - PIO2_HI */
+#define ROUND_MAGIC     6755399441055744.0          /* 1.5 * 2^52 */
+
+/* the polynomials, for scalars or vectors: atan(t) with s = t*t, and
+   sin(r), cos(r) with z = r*r */
+
+#define ATAN_1(t, s)    ((t) * (0.9999993329 + (s) * (-0.3332985605 +     \
+                         (s) * (0.1994653599 + (s) * (-0.1390853351 +     \
+                         (s) * (0.0964200441 + (s) * (-0.0559098861 +     \
+                         (s) * (0.0218612288 + (s) * -0.0040540580))))))))
+#define ATAN_2(t, s)    ((t) * (0.9998660 + (s) * (-0.3302995 +           \
+                         (s) * (0.1801410 + (s) * (-0.0851330 +           \
+                         (s) * 0.0208351)))))
+#define SIN_1(r, z)     ((r) + (r) * (z) * (-1.66666666666666324348e-01 + \
+                         (z) * (8.33333333332248946124e-03 +              \
+                         (z) * (-1.98412698298579493134e-04 +             \
+                         (z) * (2.75573137070700676789e-06 +              \
+                         (z) * (-2.50507602534068634195e-08 +             \
+                         (z) * 1.58969099521155010221e-10))))))
+#define COS_1(z)        (1.0 - 0.5 * (z) + (z) * (z) *                    \
+                         (4.16666666666666019037e-02 +                    \
+                         (z) * (-1.38888888888741095749e-03 +             \
+                         (z) * (2.48015872894767294178e-05 +              \
+                         (z) * (-2.75573143513906633035e-07 +             \
+                         (z) * (2.08757232129817482790e-09 +              \
+                         (z) * -1.13596475577881948265e-11))))))
+#define SIN_2(r, z)     ((r) + (r) * (z) * (-1.0/6.0 + (z) * (1.0/120.0 + \
+                         (z) * (-1.0/5040.0))))
+#define COS_2(z)        (1.0 - 0.5 * (z) + (z) * (z) * (1.0/24.0 +        \
+                         (z) * (-1.0/720.0 + (z) * (1.0/40320.0))))
+
+#ifdef CS_VEC
+#  define VSEL(m, a, b) ((cs_dvec_t) (((cs_dmask_t) (a) & (m)) |          \
+                                      ((cs_dmask_t) (b) & ~(m))))
+#endif
+
+CS_CLONES
+static void atan2_block(double *ph, const double *y, const double *x,
+                        int n, int approx)
+{
+    int i = 0;
+    if (approx == 0) {
+      for (i = 0; i < n; i++)
+        ph[i] = atan2(y[i], x[i]);
+      return;
+    }
+#ifdef CS_VEC
+    for (; i + CS_DLEN <= n; i += CS_DLEN) {
+      const cs_dmask_t sgn = { INT64_MIN, INT64_MIN, INT64_MIN, INT64_MIN };
+      const cs_dvec_t one = { 1.0, 1.0, 1.0, 1.0 };
+      cs_dvec_t vx, vy, ax, ay, mx, mn, t, s, r;
+      cs_dmask_t m;
+      memcpy(&vx, x+i, sizeof(cs_dvec_t)); memcpy(&vy, y+i, sizeof(cs_dvec_t));
+      ax = (cs_dvec_t) ((cs_dmask_t) vx & ~sgn);
+      ay = (cs_dvec_t) ((cs_dmask_t) vy & ~sgn);
+      m = ax > ay;
+      mx = VSEL(m, ax, ay);
+      mn = VSEL(m, ay, ax);
+      t = mn / VSEL(mx > 0.0, mx, one);
+      s = t * t;
+      r = approx == 1 ? ATAN_1(t, s) : ATAN_2(t, s);
+      r = VSEL(ay > ax, HALF_PI - r, r);
+      r = VSEL(vx < 0.0, PI - r, r);
+      r = (cs_dvec_t) (((cs_dmask_t) r & ~sgn) | ((cs_dmask_t) vy & sgn));
+      memcpy(ph+i, &r, sizeof(cs_dvec_t));
+    }
+#endif
+    for (; i < n; i++) {
+      double ax = fabs(x[i]), ay = fabs(y[i]);
+      double mx = ax > ay ? ax : ay, mn = ax > ay ? ay : ax;
+      double t = mn / (mx > 0.0 ? mx : 1.0), s = t * t;
+      double r = approx == 1 ? ATAN_1(t, s) : ATAN_2(t, s);
+      r = ay > ax ? HALF_PI - r : r;
+      r = x[i] < 0.0 ? PI - r : r;
+      ph[i] = copysign(r, y[i]);
+    }
+}
+
+/* s = sin(x), c = cos(x); c may be NULL with approx 0.  x is r + k pi/2;
+   k is rounded by adding ROUND_MAGIC, which leaves its low bits at the
+   bottom of the mantissa (for |k| < 2^51, far beyond any phase met) */
+
+CS_CLONES
+static void sincos_block(double *s, double *c, const double *x,
+                         int n, int approx)
+{
+    int i = 0;
+    if (approx == 0) {
+      for (i = 0; i < n; i++)
+        s[i] = sin(x[i]);
+      if (c != NULL)
+        for (i = 0; i < n; i++)
+          c[i] = cos(x[i]);
+      return;
+    }
+#ifdef CS_VEC
+    for (; i + CS_DLEN <= n; i += CS_DLEN) {
+      cs_dvec_t v, k, r, z, sr, cr, vs, vc;
+      cs_dmask_t q, swap;
+      memcpy(&v, x+i, sizeof(cs_dvec_t));
+      k = v * TWO_OVER_PI + ROUND_MAGIC;
+      q = (cs_dmask_t) k;
+      k = k - ROUND_MAGIC;
+      r = (v - k * PIO2_HI) - k * PIO2_LO;
+      z = r * r;
+      if (approx == 1) {
+        sr = SIN_1(r, z);
+        cr = COS_1(z);
+      }
+      else {
+        sr = SIN_2(r, z);
+        cr = COS_2(z);
+      }
+      swap = (q & 1) != 0;
+      vs = VSEL(swap, cr, sr);
+      vc = VSEL(swap, sr, cr);
+      vs = (cs_dvec_t) ((cs_dmask_t) vs ^ ((q & 2) << 62));
+      vc = (cs_dvec_t) ((cs_dmask_t) vc ^ (((q + 1) & 2) << 62));
+      memcpy(s+i, &vs, sizeof(cs_dvec_t));
+      memcpy(c+i, &vc, sizeof(cs_dvec_t));
+    }
+#endif
+    for (; i < n; i++) {
+      double  k = x[i] * TWO_OVER_PI + ROUND_MAGIC, r, z, sr, cr;
+      int64_t q;
+      memcpy(&q, &k, sizeof(int64_t));  /* defined for any x, unlike a cast */
+      k = k - ROUND_MAGIC;
+      r = (x[i] - k * PIO2_HI) - k * PIO2_LO;
+      z = r * r;
+      if (approx == 1) {
+        sr = SIN_1(r, z);
+        cr = COS_1(z);
+      }
+      else {
+        sr = SIN_2(r, z);
+        cr = COS_2(z);
+      }
+      s[i] = (q & 1) ? cr : sr;
+      c[i] = (q & 1) ? sr : cr;
+      s[i] = (q & 2) ? -s[i] : s[i];
+      c[i] = ((q + 1) & 2) ? -c[i] : c[i];
+    }
+}
+
+CS_CLONES
+static void polar_block(MYFLT *out, const MYFLT *in, int n, int approx)
+{
+    double re[SPEC_BLOCK] = { 0.0 }, im[SPEC_BLOCK] = { 0.0 }, ph[SPEC_BLOCK];
+    MYFLT  mag[SPEC_BLOCK];
+    int    i;
+    for (i = 0; i < n; i++) {
+      re[i] = in[2*i];
+      im[i] = in[2*i+1];
+      mag[i] = sqrt(in[2*i]*in[2*i] + in[2*i+1]*in[2*i+1]);
+    }
+    atan2_block(ph, im, re, n, approx);
+    for (i = 0; i < n; i++) {
+      out[2*i] = mag[i];
+      out[2*i+1] = (MYFLT) ph[i];
+    }
+}
+
+void spec_polar(MYFLT *out, const MYFLT *in, int n, int approx)
+{
+    int i, m;
+    for (i = 0; i < n; i += m) {
+      m = n - i < SPEC_BLOCK ? n - i : SPEC_BLOCK;
+      polar_block(out + 2*i, in + 2*i, m, approx);
+    }
+}
+
+CS_CLONES
+static void rect_block(MYFLT *out, const MYFLT *mag, const MYFLT *ph,
+                       int stride, int n, int approx)
+{
+    double a[SPEC_BLOCK], x[SPEC_BLOCK] = { 0.0 }, s[SPEC_BLOCK], c[SPEC_BLOCK];
+    int    i;
+    for (i = 0; i < n; i++) {
+      a[i] = (double) mag[stride*i];
+      x[i] = (double) ph[stride*i];
+    }
+    sincos_block(s, c, x, n, approx);
+    for (i = 0; i < n; i++) {
+      out[2*i] = (MYFLT) (a[i] * c[i]);
+      out[2*i+1] = (MYFLT) (a[i] * s[i]);
+    }
+}
+
+void spec_rect(MYFLT *out, const MYFLT *in, int n, int approx)
+{
+    int i, m;
+    for (i = 0; i < n; i += m) {
+      m = n - i < SPEC_BLOCK ? n - i : SPEC_BLOCK;
+      rect_block(out + 2*i, in + 2*i, in + 2*i + 1, 2, m, approx);
+    }
+}
+
+void spec_rect2(MYFLT *out, const MYFLT *mag, const MYFLT *ph, int n,
+                int approx)
+{
+    int i, m;
+    for (i = 0; i < n; i += m) {
+      m = n - i < SPEC_BLOCK ? n - i : SPEC_BLOCK;
+      rect_block(out + 2*i, mag + i, ph + i, 1, m, approx);
+    }
+}
+
+CS_CLONES
+void spec_mags(MYFLT *out, const MYFLT *in, int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+      out[i] = sqrt(in[2*i]*in[2*i] + in[2*i+1]*in[2*i+1]);
+}
+
+CS_CLONES
+static void phases_block(MYFLT *out, const MYFLT *in, int n, int approx)
+{
+    double re[SPEC_BLOCK] = { 0.0 }, im[SPEC_BLOCK] = { 0.0 }, ph[SPEC_BLOCK];
+    int    i;
+    for (i = 0; i < n; i++) {
+      re[i] = in[2*i];
+      im[i] = in[2*i+1];
+    }
+    atan2_block(ph, im, re, n, approx);
+    for (i = 0; i < n; i++)
+      out[i] = (MYFLT) ph[i];
+}
+
+void spec_phases(MYFLT *out, const MYFLT *in, int n, int approx)
+{
+    int i, m;
+    for (i = 0; i < n; i += m) {
+      m = n - i < SPEC_BLOCK ? n - i : SPEC_BLOCK;
+      phases_block(out + i, in + 2*i, m, approx);
+    }
+}
+
+void spec_sin(double *out, const double *x, int n, int approx)
+{
+    double c[SPEC_BLOCK];
+    int    i, m;
+    for (i = 0; i < n; i += m) {
+      m = n - i < SPEC_BLOCK ? n - i : SPEC_BLOCK;
+      sincos_block(out + i, approx ? c : NULL, x + i, m, approx);
+    }
+}
+
+/* pvsmix: the bin of larger amplitude */
+
+CS_CLONES
+void spec_mix(float *out, const float *a, const float *b, int n)
+{
+    int i;
+    for (i = 0; i < 2*n; i += 2) {
+      int   t = a[i] >= b[i];
+      float amp = t ? a[i] : b[i], freq = t ? a[i+1] : b[i+1];
+      out[i] = amp;
+      out[i+1] = freq;
+    }
+}
+
+/* pvsfilter */
+
+CS_CLONES
+void spec_filter(float *out, const float *in, const float *fil, int n,
+                 MYFLT dirgain, MYFLT depth, float g)
+{
+    int i;
+    for (i = 0; i < 2*n; i += 2) {
+      float freq = in[i+1];
+      out[i] = (float) (in[i] * (dirgain + fil[i] * depth)) * g;
+      out[i+1] = freq;
+    }
+}
+
+/* pvsmooth: the freq term is delayed by coef1, as it always has been */
+
+CS_CLONES
+void spec_smooth(float *out, const float *in, float *del, int n,
+                 double coef1, double coef2)
+{
+    int i;
+    for (i = 0; i < 2*n; i += 2) {
+      float amp = (float) (in[i] * (1.0 + coef1) - del[i] * coef1);
+      float freq = (float) (in[i+1] * (1.0 + coef2) - del[i+1] * coef1);
+      out[i] = del[i] = amp;
+      out[i+1] = del[i+1] = freq;
+    }
+}
+
+/* pvsblur: one delayed frame into the running sums */
+
+CS_CLONES
+void spec_accum(double *acc, const float *frame, int n)
+{
+    int i;
+    for (i = 0; i < 2*n; i++)
+      acc[i] += frame[i];
+}
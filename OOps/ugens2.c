@@ -23,6 +23,7 @@
 
 #include "csoundCore.h" /*                              UGENS2.C        */
 #include "ugens2.h"
+#include "cs_simd.h"
 #include <math.h>
 
 /* Macro form of Istvan's speedup ; constant should be 3fefffffffffffff */
@@ -1190,163 +1191,185 @@ int oscset(CSOUND *csound, OSC *p)
     return NOTOK;
 }
 
-int koscil(CSOUND *csound, OSC *p)
+/* The a-rate oscillators work on blocks of OSC_BLOCK samples: the
+   phases of a block are found first (with a k-rate frequency that is a
+   multiply rather than a running sum), then the table is read. */
+
+#define OSC_BLOCK   64
+
+CS_CLONES
+static uint32_t osc_phases(uint32_t *ph, uint32_t phs, int32 inc,
+                           const MYFLT *cpsp, MYFLT sicvt, int n)
 {
-    FUNC    *ftp;
-    int32    phs, inc;
+    int i;
+    if (cpsp == NULL) {
+      for (i = 0; i < n; i++)
+        ph[i] = (phs + (uint32_t) i * (uint32_t) inc) & PHMASK;
+      return (phs + (uint32_t) n * (uint32_t) inc) & PHMASK;
+    }
+    for (i = 0; i < n; i++) {
+      ph[i] = phs;
+      phs = (phs + (uint32_t) MYFLT2LONG(cpsp[i] * sicvt)) & PHMASK;
+    }
+    return phs;
+}
 
-    ftp = p->ftp;
-    if (UNLIKELY(ftp==NULL)) goto err1;
-    phs = p->lphs;
-    inc = (int32) (*p->xcps * CS_KICVT);
-    *p->sr = ftp->ftable[phs >> ftp->lobits] * *p->xamp;
-    phs += inc;
-    phs &= PHMASK;
-    p->lphs = phs;
-    return OK;
- err1:
-    return csound->PerfError(csound, p->h.insdshead,
-                             Str("oscil(krate): not initialised"));
+CS_CLONES
+static void osc_look(MYFLT *ar, const FUNC *ftp, const uint32_t *ph,
+                     MYFLT amp, const MYFLT *ampp, int n)
+{
+    const MYFLT *ftbl = ftp->ftable;
+    int   i, lobits = ftp->lobits;
+    if (ampp == NULL)
+      for (i = 0; i < n; i++)
+        ar[i] = ftbl[ph[i] >> lobits] * amp;
+    else
+      for (i = 0; i < n; i++)
+        ar[i] = ftbl[ph[i] >> lobits] * ampp[i];
 }
 
-int osckk(CSOUND *csound, OSC *p)
+/* the amplitude is applied in a loop of its own: the product is the
+   same as in one expression, as the value is rounded to MYFLT first.
+   The lookups go to y, not ar, as ampp may be the output itself. */
+static inline void osc_amp(MYFLT *ar, const MYFLT *y, MYFLT amp,
+                           const MYFLT *ampp, int n)
 {
-    FUNC    *ftp;
-    MYFLT   amp, *ar, *ftbl;
-    int32   phs, inc, lobits;
-    uint32_t offset = p->h.insdshead->ksmps_offset;
-    uint32_t early  = p->h.insdshead->ksmps_no_end;
-    uint32_t n, nsmps = CS_KSMPS;
+    int i;
+    if (ampp == NULL)
+      for (i = 0; i < n; i++)
+        ar[i] = y[i] * amp;
+    else
+      for (i = 0; i < n; i++)
+        ar[i] = y[i] * ampp[i];
+}
 
-    ftp = p->ftp;
-    if (UNLIKELY(ftp==NULL)) goto err1;
-    ftbl = ftp->ftable;
-    phs = p->lphs;
-    inc = MYFLT2LONG(*p->xcps * csound->sicvt);
-    lobits = ftp->lobits;
-    amp = *p->xamp;
-    ar = p->sr;
-    if (UNLIKELY(offset)) memset(ar, '\0', offset*sizeof(MYFLT));
-    if (UNLIKELY(early)) {
-      nsmps -= early;
-      memset(&ar[nsmps], '\0', early*sizeof(MYFLT));
+CS_CLONES
+static void osc_looki(MYFLT *ar, const FUNC *ftp, const uint32_t *ph,
+                      MYFLT amp, const MYFLT *ampp, int n)
+{
+    const MYFLT *ft = ftp->ftable;
+    MYFLT y[OSC_BLOCK];
+    int   i, lobits = ftp->lobits;
+    for (i = 0; i < n; i++) {
+      MYFLT fract = PFRAC((int32) ph[i]);
+      const MYFLT *ftab = ft + (ph[i] >> lobits);
+      MYFLT v1 = ftab[0];
+      y[i] = v1 + (ftab[1] - v1) * fract;
     }
+    osc_amp(ar, y, amp, ampp, n);
+}
 
-    for (n=offset;n<nsmps;n++) {
-      ar[n] = ftbl[phs >> lobits] * amp;
-      /* phs += inc; */
-      /* phs &= PHMASK; */
-      phs = (phs+inc)&PHMASK;
+CS_CLONES
+static void osc_look3(MYFLT *ar, const FUNC *ftp, const uint32_t *ph,
+                      MYFLT amp, const MYFLT *ampp, int n)
+{
+    const MYFLT *ftab = ftp->ftable;
+    MYFLT y[OSC_BLOCK];
+    int32 flen = (int32) ftp->flen;
+    int   i, lobits = ftp->lobits;
+    for (i = 0; i < n; i++) {
+      MYFLT fract = PFRAC((int32) ph[i]);
+      int32 x0 = ph[i] >> lobits;
+      /* wrap round for the points either side */
+      MYFLT ym1 = ftab[x0 == 0 ? flen - 1 : x0 - 1];
+      MYFLT y0 = ftab[x0], y1 = ftab[x0 + 1];
+      MYFLT y2 = ftab[x0 + 2 > flen ? 1 : x0 + 2];
+      MYFLT frsq = fract*fract;
+      MYFLT frcu = frsq*ym1;
+      MYFLT t1 = y2 + y0+y0+y0;
+      y[i] = y0 + FL(0.5)*frcu +
+        fract*(y1 - frcu/FL(6.0) - t1/FL(6.0) - ym1/FL(3.0)) +
+        frsq*fract*(t1/FL(6.0) - FL(0.5)*y1) +
+        frsq*(FL(0.5)* y1 - y0);
     }
-    p->lphs = phs;
-    return OK;
- err1:
-    return csound->PerfError(csound, p->h.insdshead,
-                             Str("oscil: not initialised"));
+    osc_amp(ar, y, amp, ampp, n);
 }
 
-int oscka(CSOUND *csound, OSC *p)
+/* oscil (interp 0), oscili (1) and oscil3 (3) with k- or a-rate
+   frequency and amplitude */
+static void osc_perf(CSOUND *csound, OSC *p, int interp, int acps, int aamp)
 {
-    FUNC    *ftp;
-    MYFLT   *ar, amp, *cpsp, *ftbl;
-    int32    phs, lobits;
+    FUNC     *ftp = p->ftp;
+    MYFLT    *ar = p->sr, amp = *p->xamp;
+    MYFLT    *cpsp = acps ? p->xcps : NULL, *ampp = aamp ? p->xamp : NULL;
+    int32    inc = acps ? 0 : MYFLT2LONG(*p->xcps * csound->sicvt);
+    uint32_t phs = (uint32_t) p->lphs, ph[OSC_BLOCK];
     uint32_t offset = p->h.insdshead->ksmps_offset;
     uint32_t early  = p->h.insdshead->ksmps_no_end;
-    uint32_t n, nsmps = CS_KSMPS;
-    MYFLT   sicvt = csound->sicvt;
+    uint32_t n, m, nsmps = CS_KSMPS;
 
-    ftp = p->ftp;
-    if (UNLIKELY(ftp==NULL)) goto err1;
-    ftbl = ftp->ftable;
-    lobits = ftp->lobits;
-    amp = *p->xamp;
-    cpsp = p->xcps;
-    phs = p->lphs;
-    ar = p->sr;
     if (UNLIKELY(offset)) memset(ar, '\0', offset*sizeof(MYFLT));
     if (UNLIKELY(early)) {
       nsmps -= early;
       memset(&ar[nsmps], '\0', early*sizeof(MYFLT));
     }
-    for (n=offset;n<nsmps;n++) {
-      int32 inc = MYFLT2LONG(cpsp[n] * sicvt);
-      ar[n] = ftbl[phs >> lobits] * amp;
-      phs += inc;
-      phs &= PHMASK;
+    for (n = offset; n < nsmps; n += m) {
+      m = nsmps - n < OSC_BLOCK ? nsmps - n : OSC_BLOCK;
+      phs = osc_phases(ph, phs, inc, cpsp ? cpsp + n : NULL,
+                       csound->sicvt, m);
+      if (interp == 0)
+        osc_look(ar + n, ftp, ph, amp, ampp ? ampp + n : NULL, m);
+      else if (interp == 1)
+        osc_looki(ar + n, ftp, ph, amp, ampp ? ampp + n : NULL, m);
+      else
+        osc_look3(ar + n, ftp, ph, amp, ampp ? ampp + n : NULL, m);
     }
-    p->lphs = phs;
-    return OK;
- err1:
-    return csound->PerfError(csound, p->h.insdshead,
-                             Str("oscil: not initialised"));
+    p->lphs = (int32) phs;
 }
 
-int oscak(CSOUND *csound, OSC *p)
+int koscil(CSOUND *csound, OSC *p)
 {
     FUNC    *ftp;
-    MYFLT   *ar, *ampp, *ftbl;
-    int32    phs, inc, lobits;
-    uint32_t offset = p->h.insdshead->ksmps_offset;
-    uint32_t early  = p->h.insdshead->ksmps_no_end;
-    uint32_t n, nsmps = CS_KSMPS;
+    int32    phs, inc;
 
     ftp = p->ftp;
     if (UNLIKELY(ftp==NULL)) goto err1;
-    ftbl = ftp->ftable;
-    lobits = ftp->lobits;
     phs = p->lphs;
-    inc = MYFLT2LONG(*p->xcps * csound->sicvt);
-    ampp = p->xamp;
-    ar = p->sr;
-    if (UNLIKELY(offset)) memset(ar, '\0', offset*sizeof(MYFLT));
-    if (UNLIKELY(early)) {
-      nsmps -= early;
-      memset(&ar[nsmps], '\0', early*sizeof(MYFLT));
-    }
-    for (n=offset;n<nsmps;n++) {
-      ar[n] = ftbl[phs >> lobits] * ampp[n];
-      phs = (phs+inc) & PHMASK;
-    }
+    inc = (int32) (*p->xcps * CS_KICVT);
+    *p->sr = ftp->ftable[phs >> ftp->lobits] * *p->xamp;
+    phs += inc;
+    phs &= PHMASK;
     p->lphs = phs;
     return OK;
  err1:
     return csound->PerfError(csound, p->h.insdshead,
-                             Str("oscil: not initialised"));
+                             Str("oscil(krate): not initialised"));
 }
 
-int oscaa(CSOUND *csound, OSC *p)
+int osckk(CSOUND *csound, OSC *p)
 {
-    FUNC    *ftp;
-    MYFLT   *ar, *ampp, *cpsp, *ftbl;
-    int32    phs, lobits;
-    uint32_t offset = p->h.insdshead->ksmps_offset;
-    uint32_t early  = p->h.insdshead->ksmps_no_end;
-    uint32_t n, nsmps = CS_KSMPS;
-    MYFLT   sicvt = csound->sicvt;
+    if (UNLIKELY(p->ftp==NULL))
+      return csound->PerfError(csound, p->h.insdshead,
+                               Str("oscil: not initialised"));
+    osc_perf(csound, p, 0, 0, 0);
+    return OK;
+}
 
-    ftp = p->ftp;
-    if (UNLIKELY(ftp==NULL)) goto err1;
-    ftbl = ftp->ftable;
-    lobits = ftp->lobits;
-    phs = p->lphs;
-    ampp = p->xamp;
-    cpsp = p->xcps;
-    ar = p->sr;
-    if (UNLIKELY(offset)) memset(ar, '\0', offset*sizeof(MYFLT));
-    if (UNLIKELY(early)) {
-      nsmps -= early;
-      memset(&ar[nsmps], '\0', early*sizeof(MYFLT));
-    }
-    for (n=offset;n<nsmps;n++) {
-      int32 inc = MYFLT2LONG(cpsp[n] * sicvt);
-      ar[n] = ftbl[phs >> lobits] * ampp[n];
-      phs = (phs+inc) & PHMASK;
-    }
-    p->lphs = phs;
+int oscka(CSOUND *csound, OSC *p)
+{
+    if (UNLIKELY(p->ftp==NULL))
+      return csound->PerfError(csound, p->h.insdshead,
+                               Str("oscil: not initialised"));
+    osc_perf(csound, p, 0, 1, 0);
+    return OK;
+}
+
+int oscak(CSOUND *csound, OSC *p)
+{
+    if (UNLIKELY(p->ftp==NULL))
+      return csound->PerfError(csound, p->h.insdshead,
+                               Str("oscil: not initialised"));
+    osc_perf(csound, p, 0, 0, 1);
+    return OK;
+}
+
+int oscaa(CSOUND *csound, OSC *p)
+{
+    if (UNLIKELY(p->ftp==NULL))
+      return csound->PerfError(csound, p->h.insdshead,
+                               Str("oscil: not initialised"));
+    osc_perf(csound, p, 0, 1, 1);
     return OK;
- err1:
-    return csound->PerfError(csound, p->h.insdshead,
-                             Str("oscil: not initialised"));
 }
 
 int koscli(CSOUND *csound, OSC   *p)
@@ -1374,152 +1397,38 @@ int koscli(CSOUND *csound, OSC   *p)
 
 int osckki(CSOUND *csound, OSC   *p)
 {
-    FUNC    *ftp;
-    MYFLT   fract, v1, amp, *ar, *ft, *ftab;
-    int32   phs, inc, lobits;
-    uint32_t offset = p->h.insdshead->ksmps_offset;
-    uint32_t early  = p->h.insdshead->ksmps_no_end;
-    uint32_t n, nsmps = CS_KSMPS;
-
-    if (UNLIKELY((ftp = p->ftp)==NULL)) goto err1;
-    lobits = ftp->lobits;
-    phs = p->lphs;
-    inc = MYFLT2LONG(*p->xcps * csound->sicvt);
-    amp = *p->xamp;
-    ar = p->sr;
-    if (UNLIKELY(offset)) memset(ar, '\0', offset*sizeof(MYFLT));
-    if (UNLIKELY(early)) {
-      nsmps -= early;
-      memset(&ar[nsmps], '\0', early*sizeof(MYFLT));
-    }
-    ft = ftp->ftable;
-    for (n=offset; n<nsmps; n++) {
-      fract = PFRAC(phs);
-      ftab = ft + (phs >> lobits);
-      v1 = ftab[0];
-      ar[n] = (v1 + (ftab[1] - v1) * fract) * amp;
-      phs = (phs+inc) & PHMASK;
-    }
-    p->lphs = phs;
+    if (UNLIKELY(p->ftp==NULL))
+      return csound->PerfError(csound, p->h.insdshead,
+                               Str("oscili: not initialised"));
+    osc_perf(csound, p, 1, 0, 0);
     return OK;
- err1:
-    return csound->PerfError(csound, p->h.insdshead,
-                             Str("oscili: not initialised"));
 }
 
 int osckai(CSOUND *csound, OSC   *p)
 {
-    FUNC    *ftp;
-    MYFLT   *ar, amp, *cpsp, fract, v1, *ftab, *ft;
-    int32    phs, lobits;
-    uint32_t offset = p->h.insdshead->ksmps_offset;
-    uint32_t early  = p->h.insdshead->ksmps_no_end;
-    uint32_t n, nsmps = CS_KSMPS;
-    MYFLT   sicvt = csound->sicvt;
-
-    ftp = p->ftp;
-    if (UNLIKELY(ftp==NULL)) goto err1;
-    lobits = ftp->lobits;
-    amp = *p->xamp;
-    cpsp = p->xcps;
-    phs = p->lphs;
-    ar = p->sr;
-    if (UNLIKELY(offset)) memset(ar, '\0', offset*sizeof(MYFLT));
-    if (UNLIKELY(early)) {
-      nsmps -= early;
-      memset(&ar[nsmps], '\0', early*sizeof(MYFLT));
-    }
-    ft = ftp->ftable;
-    for (n=offset;n<nsmps;n++) {
-      int32 inc;
-      inc = MYFLT2LONG(cpsp[n] * sicvt);
-      fract = PFRAC(phs);
-      ftab = ft + (phs >> lobits);
-      v1 = ftab[0];
-      ar[n] = (v1 + (ftab[1] - v1) * fract) * amp;
-      phs += inc;
-      phs &= PHMASK;
-    }
-    p->lphs = phs;
+    if (UNLIKELY(p->ftp==NULL))
+      return csound->PerfError(csound, p->h.insdshead,
+                               Str("oscili: not initialised"));
+    osc_perf(csound, p, 1, 1, 0);
     return OK;
- err1:
-    return csound->PerfError(csound, p->h.insdshead,
-                             Str("oscili: not initialised"));
 }
 
 int oscaki(CSOUND *csound, OSC   *p)
 {
-    FUNC    *ftp;
-    MYFLT    v1, fract, *ar, *ampp, *ftab, *ft;
-    int32    phs, inc, lobits;
-    uint32_t offset = p->h.insdshead->ksmps_offset;
-    uint32_t early  = p->h.insdshead->ksmps_no_end;
-    uint32_t n, nsmps = CS_KSMPS;
-
-    ftp = p->ftp;
-    if (UNLIKELY(ftp==NULL)) goto err1;
-    lobits = ftp->lobits;
-    phs = p->lphs;
-    inc = MYFLT2LONG(*p->xcps * csound->sicvt);
-    ampp = p->xamp;
-    ar = p->sr;
-    if (UNLIKELY(offset)) memset(ar, '\0', offset*sizeof(MYFLT));
-    if (UNLIKELY(early)) {
-      nsmps -= early;
-      memset(&ar[nsmps], '\0', early*sizeof(MYFLT));
-    }
-    ft = ftp->ftable;
-    for (n=offset;n<nsmps;n++) {
-      fract = (MYFLT) PFRAC(phs);
-      ftab = ft + (phs >> lobits);
-      v1 = ftab[0];
-      ar[n] = (v1 + (ftab[1] - v1) * fract) * ampp[n];
-      phs = (phs+inc) & PHMASK;
-    }
-    p->lphs = phs;
+    if (UNLIKELY(p->ftp==NULL))
+      return csound->PerfError(csound, p->h.insdshead,
+                               Str("oscili: not initialised"));
+    osc_perf(csound, p, 1, 0, 1);
     return OK;
- err1:
-    return csound->PerfError(csound, p->h.insdshead,
-                             Str("oscili: not initialised"));
 }
 
 int oscaai(CSOUND *csound, OSC   *p)
 {
-    FUNC    *ftp;
-    MYFLT   v1, fract, *ar, *ampp, *cpsp, *ftab, *ft;
-    int32   phs, lobits;
-    uint32_t offset = p->h.insdshead->ksmps_offset;
-    uint32_t early  = p->h.insdshead->ksmps_no_end;
-    uint32_t n, nsmps = CS_KSMPS;
-    MYFLT   sicvt = csound->sicvt;
-
-    ftp = p->ftp;
-    if (UNLIKELY(ftp==NULL)) goto err1;
-    ft = ftp->ftable;
-    lobits = ftp->lobits;
-    phs = p->lphs;
-    ampp = p->xamp;
-    cpsp = p->xcps;
-    ar = p->sr;
-    if (UNLIKELY(offset)) memset(ar, '\0', offset*sizeof(MYFLT));
-    if (UNLIKELY(early)) {
-      nsmps -= early;
-      memset(&ar[nsmps], '\0', early*sizeof(MYFLT));
-    }
-    for (n=offset;n<nsmps;n++) {
-      int32 inc;
-      inc = MYFLT2LONG(cpsp[n] * sicvt);
-      fract = (MYFLT) PFRAC(phs);
-      ftab = ft + (phs >> lobits);
-      v1 = ftab[0];
-      ar[n] = (v1 + (ftab[1] - v1) * fract) * ampp[n];
-      phs = (phs+inc) & PHMASK;
-    }
-    p->lphs = phs;
+    if (UNLIKELY(p->ftp==NULL))
+      return csound->PerfError(csound, p->h.insdshead,
+                               Str("oscili: not initialised"));
+    osc_perf(csound, p, 1, 1, 1);
     return OK;
- err1:
-    return csound->PerfError(csound, p->h.insdshead,
-                             Str("oscili: not initialised"));
 }
 
 int koscl3(CSOUND *csound, OSC   *p)
@@ -1565,223 +1474,36 @@ int koscl3(CSOUND *csound, OSC   *p)
 
 int osckk3(CSOUND *csound, OSC   *p)
 {
-    FUNC    *ftp;
-    MYFLT   fract, amp, *ar, *ftab;
-    int32    phs, inc, lobits;
-    uint32_t offset = p->h.insdshead->ksmps_offset;
-    uint32_t early  = p->h.insdshead->ksmps_no_end;
-    uint32_t n, nsmps = CS_KSMPS;
-    int32   x0;
-    MYFLT   y0, y1, ym1, y2;
-
-    ftp = p->ftp;
-    if (UNLIKELY(ftp==NULL)) goto err1;
-    ftab = ftp->ftable;
-    lobits = ftp->lobits;
-    phs = p->lphs;
-    inc = MYFLT2LONG(*p->xcps * csound->sicvt);
-    amp = *p->xamp;
-    ar = p->sr;
-    if (UNLIKELY(offset)) memset(ar, '\0', offset*sizeof(MYFLT));
-    if (UNLIKELY(early)) {
-      nsmps -= early;
-      memset(&ar[nsmps], '\0', early*sizeof(MYFLT));
-    }
-    for (n=offset;n<nsmps;n++) {
-      fract = PFRAC(phs);
-      x0 = (phs >> lobits);
-      x0--;
-      if (UNLIKELY(x0<0)) {
-        ym1 = ftab[ftp->flen-1]; x0 = 0;
-      }
-      else ym1 = ftab[x0++];
-      y0 = ftab[x0++];
-      y1 = ftab[x0++];
-      if (UNLIKELY(x0>(int32)ftp->flen)) y2 = ftab[1]; else y2 = ftab[x0];
-/*    printf("fract = %f; y = %f, %f, %f, %f\n", fract,ym1,y0,y1,y2); */
-      {
-        MYFLT frsq = fract*fract;
-        MYFLT frcu = frsq*ym1;
-        MYFLT t1 = y2 + y0+y0+y0;
-/*      MYFLT old = (y0 + (y1 - y0) * fract) * amp; */
-/*      double x = ((double)(x0-2)+fract)*twopi/32.0; */
-/*      MYFLT tr = amp*sin(x); */
-        ar[n] = amp * (y0 + FL(0.5)*frcu +
-                       fract*(y1 - frcu/FL(6.0) - t1/FL(6.0) - ym1/FL(3.0)) +
-                       frsq*fract*(t1/FL(6.0) - FL(0.5)*y1) +
-                       frsq*(FL(0.5)* y1 - y0));
-/*      printf("oscilkk3: old=%.4f new=%.4f true=%.4f (%f; %f)\n", */
-/*                       old, *(ar-1), tr, fabs(*(ar-1)-tr), fabs(old-tr)); */
-      }
-      phs = (phs+inc) & PHMASK;
-    }
-    p->lphs = phs;
+    if (UNLIKELY(p->ftp==NULL))
+      return csound->PerfError(csound, p->h.insdshead,
+                               Str("oscil3: not initialised"));
+    osc_perf(csound, p, 3, 0, 0);
     return OK;
- err1:
-    return csound->PerfError(csound, p->h.insdshead,
-                             Str("oscil3: not initialised"));
 }
 
 int oscka3(CSOUND *csound, OSC   *p)
 {
-    FUNC    *ftp;
-    MYFLT   *ar, amp, *cpsp, fract, *ftab;
-    int32    phs, lobits;
-    uint32_t offset = p->h.insdshead->ksmps_offset;
-    uint32_t early  = p->h.insdshead->ksmps_no_end;
-    uint32_t n, nsmps = CS_KSMPS;
-    int32   x0;
-    MYFLT   y0, y1, ym1, y2;
-    MYFLT   sicvt = csound->sicvt;
-
-    ftp = p->ftp;
-    if (UNLIKELY(ftp==NULL)) goto err1;
-    ftab = ftp->ftable;
-    lobits = ftp->lobits;
-    amp = *p->xamp;
-    cpsp = p->xcps;
-    phs = p->lphs;
-    ar = p->sr;
-    if (UNLIKELY(offset)) memset(ar, '\0', offset*sizeof(MYFLT));
-    if (UNLIKELY(early)) {
-      nsmps -= early;
-      memset(&ar[nsmps], '\0', early*sizeof(MYFLT));
-    }
-    for (n=offset;n<nsmps;n++) {
-      int32 inc;
-      inc = MYFLT2LONG(cpsp[n] * sicvt);
-      fract = PFRAC(phs);
-      x0 = (phs >> lobits);
-      x0--;
-      if (UNLIKELY(x0<0)) {
-        ym1 = ftab[ftp->flen-1]; x0 = 0;
-      }
-      else ym1 = ftab[x0++];
-      y0 = ftab[x0++];
-      y1 = ftab[x0++];
-      if (UNLIKELY(x0>(int32)ftp->flen)) y2 = ftab[1]; else y2 = ftab[x0];
-      {
-        MYFLT frsq = fract*fract;
-        MYFLT frcu = frsq*ym1;
-        MYFLT t1 = y2 + y0+y0+y0;
-        ar[n] = amp * (y0 + FL(0.5)*frcu +
-                       fract*(y1 - frcu/FL(6.0) - t1/FL(6.0) - ym1/FL(3.0)) +
-                       frsq*fract*(t1/FL(6.0) - FL(0.5)*y1) + frsq*(FL(0.5)*
-                                                                    y1 - y0));
-      }
-      phs = (phs+inc) & PHMASK;
-    }
-    p->lphs = phs;
+    if (UNLIKELY(p->ftp==NULL))
+      return csound->PerfError(csound, p->h.insdshead,
+                               Str("oscil3: not initialised"));
+    osc_perf(csound, p, 3, 1, 0);
     return OK;
- err1:
-    return csound->PerfError(csound, p->h.insdshead,
-                             Str("oscil3: not initialised"));
 }
 
 int oscak3(CSOUND *csound, OSC   *p)
 {
-    FUNC    *ftp;
-    MYFLT   fract, *ar, *ampp, *ftab;
-    int32    phs, inc, lobits;
-    uint32_t offset = p->h.insdshead->ksmps_offset;
-    uint32_t early  = p->h.insdshead->ksmps_no_end;
-    uint32_t n, nsmps = CS_KSMPS;
-    int32   x0;
-    MYFLT   y0, y1, ym1, y2;
-
-    ftp = p->ftp;
-    if (UNLIKELY(ftp==NULL)) goto err1;
-    ftab = ftp->ftable;
-    lobits = ftp->lobits;
-    phs = p->lphs;
-    inc = MYFLT2LONG(*p->xcps * csound->sicvt);
-    ampp = p->xamp;
-    ar = p->sr;
-    if (UNLIKELY(offset)) memset(ar, '\0', offset*sizeof(MYFLT));
-    if (UNLIKELY(early)) {
-      nsmps -= early;
-      memset(&ar[nsmps], '\0', early*sizeof(MYFLT));
-    }
-    for (n=offset;n<nsmps;n++) {
-      fract = (MYFLT) PFRAC(phs);
-      x0 = (phs >> lobits);
-      x0--;
-      if (UNLIKELY(x0<0)) {
-        ym1 = ftab[ftp->flen-1]; x0 = 0;
-      }
-      else ym1 = ftab[x0++];
-      y0 = ftab[x0++];
-      y1 = ftab[x0++];
-      if (UNLIKELY(x0>(int32)ftp->flen)) y2 = ftab[1]; else y2 = ftab[x0];
-      {
-        MYFLT frsq = fract*fract;
-        MYFLT frcu = frsq*ym1;
-        MYFLT t1 = y2 + y0+y0+y0;
-        ar[n] = ampp[n] *(y0 + FL(0.5)*frcu
-                          + fract*(y1 - frcu/FL(6.0) - t1/FL(6.0) - ym1/FL(3.0))
-                          + frsq*fract*(t1/FL(6.0) - FL(0.5)*y1)
-                          + frsq*(FL(0.5)* y1 - y0));
-      }
-      phs = (phs+inc) & PHMASK;
-    }
-    p->lphs = phs;
+    if (UNLIKELY(p->ftp==NULL))
+      return csound->PerfError(csound, p->h.insdshead,
+                               Str("oscil3: not initialised"));
+    osc_perf(csound, p, 3, 0, 1);
     return OK;
- err1:
-    return csound->PerfError(csound, p->h.insdshead,
-                             Str("oscil3: not initialised"));
 }
 
 int oscaa3(CSOUND *csound, OSC   *p)
 {
-    FUNC    *ftp;
-    MYFLT    fract, *ar, *ampp, *cpsp, *ftab;
-    int32    phs, lobits;
-    uint32_t offset = p->h.insdshead->ksmps_offset;
-    uint32_t early  = p->h.insdshead->ksmps_no_end;
-    uint32_t n, nsmps = CS_KSMPS;
-    int32    x0;
-    MYFLT    y0, y1, ym1, y2;
-    MYFLT    sicvt = csound->sicvt;
-
-    ftp = p->ftp;
-    if (UNLIKELY(ftp==NULL)) goto err1;
-    ftab = ftp->ftable;
-    lobits = ftp->lobits;
-    phs = p->lphs;
-    ampp = p->xamp;
-    cpsp = p->xcps;
-    ar = p->sr;
-    if (UNLIKELY(offset)) memset(ar, '\0', offset*sizeof(MYFLT));
-    if (UNLIKELY(early)) {
-      nsmps -= early;
-      memset(&ar[nsmps], '\0', early*sizeof(MYFLT));
-    }
-    for (n=offset;n<nsmps;n++) {
-      int32 inc = MYFLT2LONG(cpsp[n] * sicvt);
-      fract = (MYFLT) PFRAC(phs);
-      x0 = (phs >> lobits);
-      x0--;
-      if (UNLIKELY(x0<0)) {
-        ym1 = ftab[ftp->flen-1]; x0 = 0;
-      }
-      else ym1 = ftab[x0++];
-      y0 = ftab[x0++];
-      y1 = ftab[x0++];
-      if (UNLIKELY(x0>(int32)ftp->flen)) y2 = ftab[1]; else y2 = ftab[x0];
-      {
-        MYFLT frsq = fract*fract;
-        MYFLT frcu = frsq*ym1;
-        MYFLT t1 = y2 + y0+y0+y0;
-        ar[n] = ampp[n] *(y0 + FL(0.5)*frcu
-                          + fract*(y1 - frcu/FL(6.0) - t1/FL(6.0) - ym1/FL(3.0))
-                          + frsq*fract*(t1/FL(6.0) - FL(0.5)*y1)
-                          + frsq*(FL(0.5)* y1 - y0));
-      }
-      phs = (phs+inc) & PHMASK;
-    }
-    p->lphs = phs;
+    if (UNLIKELY(p->ftp==NULL))
+      return csound->PerfError(csound, p->h.insdshead,
+                               Str("oscil3: not initialised"));
+    osc_perf(csound, p, 3, 1, 1);
     return OK;
- err1:
-    return csound->PerfError(csound, p->h.insdshead,
-                             Str("oscil3: not initialised"));
 }
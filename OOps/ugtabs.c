@@ -23,6 +23,7 @@
 
 #include "csoundCore.h"
 #include "ugtabs.h"
+#include "cs_simd.h"
 #include <math.h>
 
 //(x >= FL(0.0) ? (int32)x : (int32)((double)x - 0.99999999))
@@ -106,9 +107,88 @@ int tabler_kontrol(CSOUND *csound, TABL *p) {
 
 
 
+/* The a-rate readers work on blocks of TAB_BLOCK samples: the indices
+   of a block are found first, then the table is read, so that both
+   loops are free of branches for power-of-two and non-wrapping tables. */
+
+#define TAB_BLOCK   64
+
+CS_CLONES
+static void tab_index(int *ix, MYFLT *fr, const MYFLT *ndx_f,
+                      MYFLT offset, MYFLT mul, int len, int mask,
+                      int32 iwrap, int32 np2, int n)
+{
+    int i;
+    for (i = 0; i < n; i++) {
+      MYFLT tmp = (ndx_f[i] + offset)*mul;
+      ix[i] = MYFLOOR(tmp);
+      fr[i] = tmp - ix[i];
+    }
+    if (!iwrap) {
+      for (i = 0; i < n; i++)
+        ix[i] = ix[i] >= len ? len - 1 : (ix[i] < 0 ? 0 : ix[i]);
+    }
+    else if (!np2) {
+      for (i = 0; i < n; i++)
+        ix[i] &= mask;
+    }
+    else {
+      for (i = 0; i < n; i++) {
+        while (ix[i] >= len) ix[i] -= len;
+        while (ix[i] < 0)  ix[i] += len;
+      }
+    }
+}
+
+CS_CLONES
+static void tab_look(MYFLT *sig, const int *ix, const MYFLT *func, int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+      sig[i] = func[ix[i]];
+}
+
+CS_CLONES
+static void tab_looki(MYFLT *sig, const int *ix, const MYFLT *fr,
+                      const MYFLT *func, int n)
+{
+    int i;
+    for (i = 0; i < n; i++) {
+      MYFLT x1 = func[ix[i]], x2 = func[ix[i]+1];
+      sig[i] = x1 + (x2 - x1)*fr[i];
+    }
+}
+
+CS_CLONES
+static void tab_look3(MYFLT *sig, const int *ix, const MYFLT *fr,
+                      const MYFLT *func, int len, int n)
+{
+    int i;
+    for (i = 0; i < n; i++) {
+      int ndx = ix[i];
+      MYFLT frac = fr[i], x0, x1, x2, x3, temp1, fracub, fracsq;
+      if (UNLIKELY(ndx<1 || ndx==len-1 || len <4)) {
+        x1 = func[ndx];
+        x2 = func[ndx+1];
+        sig[i] = x1 + (x2 - x1)*frac;
+      } else {
+        x0 = func[ndx-1];
+        x1 = func[ndx];
+        x2 = func[ndx+1];
+        x3 = func[ndx+2];
+        fracsq = frac*frac;
+        fracub = fracsq*x0;
+        temp1 = x3+x1+x1+x1;
+        sig[i] =  x1 + FL(0.5)*fracub +
+          frac*(x2 - fracub/FL(6.0) - temp1/FL(6.0) - x0/FL(3.0)) +
+          fracsq*frac*(temp1/FL(6.0) - FL(0.5)*x2) + fracsq*(FL(0.5)*x2 - x1);
+      }
+    }
+}
+
 int tabler_audio(CSOUND *csound, TABL *p)
 {
-    int ndx, len = p->len, n, nsmps = CS_KSMPS;
+    int len = p->len, n, nsmps = CS_KSMPS;
     int mask = p->ftp->lenmask;
     MYFLT *sig = p->sig;
     MYFLT *ndx_f = p->ndx;
@@ -125,19 +205,12 @@ int tabler_audio(CSOUND *csound, TABL *p)
       memset(&sig[nsmps], '\0', early*sizeof(MYFLT));
     }
 
-    for (n=koffset; n < nsmps; n++) {
-      ndx = MYFLOOR((ndx_f[n] + offset)*mul);
-      if (iwrap) {
-        if (p->np2) {
-          while(ndx >= len) ndx -= len;
-          while(ndx < 0)  ndx += len;
-        }
-        else ndx &= mask;
-      } else {
-    if (UNLIKELY(ndx >= len)) ndx = len - 1;
-    else if (UNLIKELY(ndx < 0)) ndx = 0;
-      }
-      p->sig[n] = func[ndx];
+    for (n=koffset; n < nsmps; n += TAB_BLOCK) {
+      int ix[TAB_BLOCK];
+      MYFLT fr[TAB_BLOCK];
+      int nn = nsmps - n < TAB_BLOCK ? nsmps - n : TAB_BLOCK;
+      tab_index(ix, fr, &ndx_f[n], offset, mul, len, mask, iwrap, p->np2, nn);
+      tab_look(&sig[n], ix, func, nn);
     }
     return OK;
 }
@@ -213,13 +286,13 @@ int tableir_kontrol(CSOUND *csound, TABL *p) {
 
 int tableir_audio(CSOUND *csound, TABL *p)
 {
-    int ndx, len = p->len, n, nsmps = CS_KSMPS;
+    int len = p->len, n, nsmps = CS_KSMPS;
     int mask = p->ftp->lenmask;
     MYFLT *sig = p->sig;
     MYFLT *ndx_f = p->ndx;
     MYFLT *func = p->ftp->ftable;
     MYFLT offset = *p->offset;
-    MYFLT mul = p->mul, tmp, frac;
+    MYFLT mul = p->mul;
     int32 iwrap = p->iwrap;
     uint32_t    koffset = p->h.insdshead->ksmps_offset;
     uint32_t    early  = p->h.insdshead->ksmps_no_end;
@@ -230,24 +303,12 @@ int tableir_audio(CSOUND *csound, TABL *p)
       memset(&sig[nsmps], '\0', early*sizeof(MYFLT));
     }
 
-    for (n=koffset; n < nsmps; n++) {
-      MYFLT x1, x2;
-      tmp = (ndx_f[n] + offset)*mul;
-      ndx = MYFLOOR(tmp);
-      frac = tmp - ndx;
-      if (iwrap) {
-        if (p->np2) {
-          while(ndx >= len) ndx -= len;
-          while(ndx < 0)  ndx += len;
-        }
-        else ndx &= mask;
-      } else {
-        if (UNLIKELY(ndx >= len)) ndx = len - 1;
-        else if (UNLIKELY(ndx < 0)) ndx = 0;
-      }
-      x1 = func[ndx];
-      x2 = func[ndx+1];
-      p->sig[n] = x1 + (x2 - x1)*frac;
+    for (n=koffset; n < nsmps; n += TAB_BLOCK) {
+      int ix[TAB_BLOCK];
+      MYFLT fr[TAB_BLOCK];
+      int nn = nsmps - n < TAB_BLOCK ? nsmps - n : TAB_BLOCK;
+      tab_index(ix, fr, &ndx_f[n], offset, mul, len, mask, iwrap, p->np2, nn);
+      tab_looki(&sig[n], ix, fr, func, nn);
     }
     return OK;
 }
@@ -355,13 +416,13 @@ int table3r_kontrol(CSOUND *csound, TABL *p) {
 
 int table3r_audio(CSOUND *csound, TABL *p)
 {
-    int ndx, len = p->len, n, nsmps = CS_KSMPS;
+    int len = p->len, n, nsmps = CS_KSMPS;
     int mask = p->ftp->lenmask;
     MYFLT *sig = p->sig;
     MYFLT *ndx_f = p->ndx;
     MYFLT *func = p->ftp->ftable;
     MYFLT offset = *p->offset;
-    MYFLT mul = p->mul, tmp, frac;
+    MYFLT mul = p->mul;
     int32 iwrap = p->iwrap;
     uint32_t    koffset = p->h.insdshead->ksmps_offset;
     uint32_t    early  = p->h.insdshead->ksmps_no_end;
@@ -372,38 +433,12 @@ int table3r_audio(CSOUND *csound, TABL *p)
       memset(&sig[nsmps], '\0', early*sizeof(MYFLT));
     }
 
-    for (n=koffset; n < nsmps; n++) {
-      MYFLT x0,x1,x2,x3,temp1,fracub,fracsq;
-      tmp = (ndx_f[n] + offset)*mul;
-      ndx = MYFLOOR(tmp);
-      frac = tmp - ndx;
-      if (iwrap) {
-        if (p->np2) {
-          while(ndx >= len) ndx -= len;
-          while(ndx < 0)  ndx += len;
-        }
-        else ndx &= mask;
-      } else {
-        if (UNLIKELY(ndx >= len)) ndx = len - 1;
-        else if (UNLIKELY(ndx < 0)) ndx = 0;
-      }
-
-      if (UNLIKELY(ndx<1 || ndx==len-1 || len <4)) {
-        x1 = func[ndx];
-        x2 = func[ndx+1];
-        p->sig[n] = x1 + (x2 - x1)*frac;
-      } else {
-        x0 = func[ndx-1];
-        x1 = func[ndx];
-        x2 = func[ndx+1];
-        x3 = func[ndx+2];
-        fracsq = frac*frac;
-        fracub = fracsq*x0;
-        temp1 = x3+x1+x1+x1;
-        p->sig[n] =  x1 + FL(0.5)*fracub +
-          frac*(x2 - fracub/FL(6.0) - temp1/FL(6.0) - x0/FL(3.0)) +
-          fracsq*frac*(temp1/FL(6.0) - FL(0.5)*x2) + fracsq*(FL(0.5)*x2 - x1);
-      }
+    for (n=koffset; n < nsmps; n += TAB_BLOCK) {
+      int ix[TAB_BLOCK];
+      MYFLT fr[TAB_BLOCK];
+      int nn = nsmps - n < TAB_BLOCK ? nsmps - n : TAB_BLOCK;
+      tab_index(ix, fr, &ndx_f[n], offset, mul, len, mask, iwrap, p->np2, nn);
+      tab_look3(&sig[n], ix, fr, func, len, nn);
     }
     return OK;
 }
@@ -586,7 +586,7 @@ static int OSC_list(CSOUND *csound, OSCLISTEN *p)
 static OENTRY localops[] = {
 { "OSCsend", S(OSCSEND), 0, 3, "", "kSkSSN", (SUBR)osc_send_set, (SUBR)osc_send },
 { "OSCinit", S(OSCINIT), 0, 1, "i", "i", (SUBR)osc_listener_init },
-{ "OSClisten", S(OSCLISTEN),0, 3, "k", "iSSN", (SUBR)OSC_list_init, (SUBR)OSC_list}
+{ "OSClisten", S(OSCLISTEN),IW, 3, "k", "iSSN", (SUBR)OSC_list_init, (SUBR)OSC_list}
 };
 
 PUBLIC long csound_opcode_init(CSOUND *csound, OENTRY **ep)
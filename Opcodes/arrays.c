@@ -25,6 +25,8 @@
 #include "interlocks.h"
 #include "aops.h"
 #include "csound_orc_semantics.h"
+#include "spectral.h"
+#include "cs_simd.h"
 
 extern MYFLT MOD(MYFLT a, MYFLT bb);
 
@@ -281,6 +283,552 @@ typedef struct {
   MYFLT  *kstart, *kend;
 } TABSCALE;
 
+/* The element-wise arithmetic, the reductions and tabmap run through
+   the kernels below, built with CS_CLONES.  They are written with the
+   vector types of cs_simd.h, loading and storing a vector at a time, so
+   they stay vectorised when the answer is also an operand (kA = kA+kB).
+
+   An array is worked on in parts, whose bounds depend only on its size.
+   With --array-threads=N the parts of a large array are claimed in turn
+   by the caller and N-1 pool threads; otherwise the caller runs them in
+   order.  A claim is tagged with the generation of its split, so that a
+   thread still looking at the last split cannot take a part of the next.
+   Reductions keep a result per part and combine them in order, so they
+   do not depend on the number of threads, or on their timing.
+   Sums are kept in vector lanes, and so are added in a different order
+   to a plain loop; everything else gives the same results as before. */
+
+#define ARRAY_MAXTHREADS  16
+#define ARRAY_MAXPARTS    64
+#define ARRAY_PART        4096      /* elements in a part: arithmetic */
+#define ARRAY_PART_MAP    512       /*   and functions */
+#define ARRAY_SPLIT       4         /* parts in the least array shared */
+#define ARRAY_FIND        64        /* elements tested between exits */
+#define ARRAY_RANGE       4         /* vectors of extremes kept */
+#define ARRAY_GEN         (1<<16)   /* a split, in the claim word */
+
+typedef void (*ARRAY_TASK)(void *arg, int start, int end, int part);
+
+typedef struct array_pool_ ARRAY_POOL;
+
+typedef struct {
+    ARRAY_POOL *pool;
+    void    *thread, *wakeup;
+} ARRAY_WORKER;
+
+struct array_pool_ {
+    void    *lock;                      /* one split at a time */
+    ARRAY_WORKER worker[ARRAY_MAXTHREADS];
+    int     nthreads;
+    volatile int quit;
+    ARRAY_TASK task;                    /* the split being run */
+    void    *arg;
+    int     size, part;
+    volatile uint32_t claim;            /* generation, parts, next part */
+    volatile int done;                  /* parts finished */
+};
+
+/* claim and run parts of the current split until there are none left;
+   the claim word holds the generation in its upper 16 bits, then the
+   number of parts and the next part in 8 bits each, so a claim made with
+   a word read in an earlier split fails */
+
+static void array_claim(ARRAY_POOL *pool)
+{
+    uint32_t c;
+    int     i, nparts, start, end;
+
+    for (;;) {
+      c = pool->claim;
+      i = (int) (c & 0xFF);
+      nparts = (int) ((c >> 8) & 0xFF);
+      if (i >= nparts)
+        break;
+      if (!__sync_bool_compare_and_swap(&pool->claim, c, c + 1))
+        continue;                       /* taken, or a new split */
+      start = i * pool->part;
+      end = (i == nparts - 1 ? pool->size : start + pool->part);
+      pool->task(pool->arg, start, end, i);
+      __sync_fetch_and_add(&pool->done, 1);
+    }
+}
+
+static uintptr_t array_worker(void *arg)
+{
+    ARRAY_WORKER *w = (ARRAY_WORKER *) arg;
+    ARRAY_POOL   *pool = w->pool;
+
+    _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
+    for (;;) {
+      /* every split notifies, the timeout is only a safety net */
+      csoundWaitThreadLock(w->wakeup, 100);
+      if (pool->quit)
+        break;
+      array_claim(pool);
+    }
+    return 0;
+}
+
+static int array_pool_stop(CSOUND *csound, void *arg)
+{
+    ARRAY_POOL *pool = (ARRAY_POOL *) csound->array_pool;
+    int        i;
+
+    (void) arg;
+    if (pool == NULL)
+      return OK;
+    csound->array_pool = NULL;
+    pool->quit = 1;
+    for (i = 0; i < pool->nthreads; i++) {
+      csoundNotifyThreadLock(pool->worker[i].wakeup);
+      csoundJoinThread(pool->worker[i].thread);
+      csoundDestroyThreadLock(pool->worker[i].wakeup);
+    }
+    csoundDestroyMutex(pool->lock);
+    csound->Free(csound, pool);
+    return OK;
+}
+
+/* called by csoundStart() with --array-threads, before the perf and init
+   threads are started, so that they only ever read csound->array_pool */
+
+void array_pool_start(CSOUND *csound)
+{
+    ARRAY_POOL *pool;
+    int        i, n = csound->oparms->arrayThreads - 1;
+
+    if (csound->array_pool != NULL)
+      return;
+    pool = (ARRAY_POOL *) csound->Calloc(csound, sizeof(ARRAY_POOL));
+    pool->lock = csoundCreateMutex(0);
+    if (n > ARRAY_MAXTHREADS)
+      n = ARRAY_MAXTHREADS;
+#ifndef __EMSCRIPTEN__
+    for (i = 0; i < n; i++) {
+      ARRAY_WORKER *w = &(pool->worker[pool->nthreads]);
+      w->pool = pool;
+      if ((w->wakeup = csoundCreateThreadLock()) == NULL)
+        break;
+      if ((w->thread = csoundCreateThread(array_worker, (void *) w)) == NULL) {
+        csoundDestroyThreadLock(w->wakeup);
+        break;
+      }
+      pool->nthreads++;
+    }
+#else
+    (void) i;
+#endif
+    csound->array_pool = (void *) pool;
+    csound->RegisterResetCallback(csound, NULL, array_pool_stop);
+}
+
+/* run task over parts of size elements, each of part elements but the
+   last, sharing them with the pool if there is one and it is free;
+   returns the number of parts */
+
+static int array_split(CSOUND *csound, ARRAY_TASK task, void *arg,
+                       int size, int part)
+{
+    ARRAY_POOL *pool;
+    int        i, nparts;
+
+    if (size > part * ARRAY_MAXPARTS)
+      part = (size + ARRAY_MAXPARTS - 1) / ARRAY_MAXPARTS;
+    nparts = size > part ? (size + part - 1) / part : 1;
+    if (nparts >= ARRAY_SPLIT &&
+        (pool = (ARRAY_POOL *) csound->array_pool) != NULL &&
+        pool->nthreads > 0 &&
+        csoundLockMutexNoWait(pool->lock) == 0) {
+      pool->task = task;
+      pool->arg = arg;
+      pool->size = size;
+      pool->part = part;
+      pool->done = 0;
+      __sync_synchronize();
+      pool->claim = (pool->claim & ~(uint32_t) (ARRAY_GEN - 1)) + ARRAY_GEN
+                    + ((uint32_t) nparts << 8);
+      for (i = 0; i < pool->nthreads; i++)
+        csoundNotifyThreadLock(pool->worker[i].wakeup);
+      array_claim(pool);
+      while (__sync_fetch_and_add(&pool->done, 0) < nparts)
+        csoundSleep(0);                 /* the last parts are running */
+      csoundUnlockMutex(pool->lock);
+      return nparts;
+    }
+    for (i = 0; i < nparts; i++)
+      task(arg, i * part, i == nparts - 1 ? size : (i + 1) * part, i);
+    return nparts;
+}
+
+#ifdef CS_VEC
+#  define ARRAY_LOAD(v, p)      memcpy(&(v), (p), sizeof(cs_vec_t))
+#  define ARRAY_STORE(p, v)     memcpy((p), &(v), sizeof(cs_vec_t))
+/* a ? x : y, lane by lane */
+#  define ARRAY_SELECT(a, x, y)                                         \
+    ((cs_vec_t) (((cs_mask_t) (x) & (a)) | ((cs_mask_t) (y) & ~(a))))
+#  define ARRAY_VLOOP2(OP)                                              \
+    for (; i + CS_VLEN <= n; i += CS_VLEN) {                            \
+      cs_vec_t x, y;                                                    \
+      ARRAY_LOAD(x, l + i);                                             \
+      ARRAY_LOAD(y, r + i);                                             \
+      x = x OP y;                                                       \
+      ARRAY_STORE(ans + i, x);                                          \
+    }
+#  define ARRAY_VLOOPK(EXPR)                                            \
+    for (; i + CS_VLEN <= n; i += CS_VLEN) {                            \
+      cs_vec_t x;                                                       \
+      ARRAY_LOAD(x, l + i);                                             \
+      x = EXPR;                                                         \
+      ARRAY_STORE(ans + i, x);                                          \
+    }
+#else
+#  define ARRAY_VLOOP2(OP)
+#  define ARRAY_VLOOPK(EXPR)
+#endif
+
+/* element-wise kernels, ans = l op r or with the scalar k */
+
+typedef void (*ARRAY_KERNEL)(MYFLT *ans, const MYFLT *l, const MYFLT *r,
+                             MYFLT k, int n);
+
+#define ARRAY_OP2(NAME, OP)                                             \
+  CS_CLONES                                                             \
+  static void NAME(MYFLT *ans, const MYFLT *l, const MYFLT *r,          \
+                   MYFLT k, int n)                                      \
+  {                                                                     \
+    int i = 0;                                                          \
+    (void) k;                                                           \
+    ARRAY_VLOOP2(OP)                                                    \
+    for (; i < n; i++)                                                  \
+      ans[i] = l[i] OP r[i];                                            \
+  }
+
+#define ARRAY_OPK(NAME, EXPR)                                           \
+  CS_CLONES                                                             \
+  static void NAME(MYFLT *ans, const MYFLT *l, const MYFLT *r,          \
+                   MYFLT k, int n)                                      \
+  {                                                                     \
+    int i = 0;                                                          \
+    (void) r;                                                           \
+    ARRAY_VLOOPK(EXPR)                                                  \
+    for (; i < n; i++) {                                                \
+      MYFLT x = l[i];                                                   \
+      ans[i] = EXPR;                                                    \
+    }                                                                   \
+  }
+
+ARRAY_OP2(array_add, +)
+ARRAY_OP2(array_sub, -)
+ARRAY_OP2(array_mul, *)
+ARRAY_OP2(array_div, /)
+ARRAY_OPK(array_addk, x + k)
+ARRAY_OPK(array_subk, x - k)
+ARRAY_OPK(array_ksub, k - x)
+ARRAY_OPK(array_mulk, x * k)
+ARRAY_OPK(array_divk, x / k)
+ARRAY_OPK(array_kdiv, k / x)
+
+typedef struct {
+    ARRAY_KERNEL fn;
+    MYFLT   *ans;
+    const MYFLT *l, *r;
+    MYFLT   k;
+} ARRAY_ARITH;
+
+static void array_arith_part(void *arg, int start, int end, int part)
+{
+    ARRAY_ARITH *a = (ARRAY_ARITH *) arg;
+    (void) part;
+    a->fn(a->ans + start, a->l + start, a->r != NULL ? a->r + start : NULL,
+          a->k, end - start);
+}
+
+static void array_arith(CSOUND *csound, ARRAY_KERNEL fn, MYFLT *ans,
+                        const MYFLT *l, const MYFLT *r, MYFLT k, int n)
+{
+    ARRAY_ARITH a;
+    a.fn = fn;
+    a.ans = ans;
+    a.l = l;
+    a.r = r;
+    a.k = k;
+    array_split(csound, array_arith_part, &a, n, ARRAY_PART);
+}
+
+/* the index of the first element equal to v, or n */
+
+CS_CLONES
+static int array_find(const MYFLT *d, int n, MYFLT v)
+{
+    int     i = 0, j;
+#ifdef CS_VEC
+    for (; i + ARRAY_FIND <= n; i += ARRAY_FIND) {
+      cs_mask_t any = { 0 };
+      for (j = 0; j < ARRAY_FIND; j += CS_VLEN) {
+        cs_vec_t x;
+        ARRAY_LOAD(x, d + i + j);
+        any |= (x == v);
+      }
+      for (j = 0; j < CS_VLEN; j++)
+        if (any[j])
+          break;
+      if (j < CS_VLEN)
+        break;
+    }
+#endif
+    for (; i < n; i++)
+      if (d[i] == v)
+        return i;
+    return n;
+}
+
+/* the greatest and least of n elements and of *hi and *lo: an element
+   replaces one only by being greater or less, as in a plain loop */
+
+CS_CLONES
+static void array_range(const MYFLT *d, int n, MYFLT *lo, MYFLT *hi,
+                        int want_lo, int want_hi)
+{
+    MYFLT   l = *lo, h = *hi;
+    int     i = 0, j, m;
+#ifdef CS_VEC
+    if (n >= ARRAY_RANGE*CS_VLEN) {
+      /* independent vectors, as each compare and select waits for the
+         one before */
+      cs_vec_t vl[ARRAY_RANGE], vh[ARRAY_RANGE];
+      for (m = 0; m < ARRAY_RANGE; m++)
+        for (j = 0; j < CS_VLEN; j++)
+          vl[m][j] = l, vh[m][j] = h;
+      for (; i + ARRAY_RANGE*CS_VLEN <= n; i += ARRAY_RANGE*CS_VLEN)
+        for (m = 0; m < ARRAY_RANGE; m++) {
+          cs_vec_t x;
+          ARRAY_LOAD(x, d + i + m*CS_VLEN);
+          if (want_lo)
+            vl[m] = ARRAY_SELECT(x < vl[m], x, vl[m]);
+          if (want_hi)
+            vh[m] = ARRAY_SELECT(x > vh[m], x, vh[m]);
+        }
+      for (m = 0; m < ARRAY_RANGE; m++)
+        for (j = 0; j < CS_VLEN; j++) {
+          if (vl[m][j] < l) l = vl[m][j];
+          if (vh[m][j] > h) h = vh[m][j];
+        }
+    }
+#endif
+    for (; i < n; i++) {
+      if (want_lo && d[i] < l) l = d[i];
+      if (want_hi && d[i] > h) h = d[i];
+    }
+    *lo = l;
+    *hi = h;
+}
+
+CS_CLONES
+static MYFLT array_sum(const MYFLT *d, int n)
+{
+    MYFLT   s = d[0];
+    int     i = 1, j;
+#ifdef CS_VEC
+    if (n >= 2*CS_VLEN) {
+      cs_vec_t s0, s1;
+      ARRAY_LOAD(s0, d);
+      ARRAY_LOAD(s1, d + CS_VLEN);
+      for (i = 2*CS_VLEN; i + 2*CS_VLEN <= n; i += 2*CS_VLEN) {
+        cs_vec_t x, y;
+        ARRAY_LOAD(x, d + i);
+        ARRAY_LOAD(y, d + i + CS_VLEN);
+        s0 += x;
+        s1 += y;
+      }
+      s0 += s1;
+      s = s0[0];
+      for (j = 1; j < CS_VLEN; j++)
+        s += s0[j];
+    }
+#endif
+    for (; i < n; i++)
+      s += d[i];
+    return s;
+}
+
+/* the reductions, a result per part */
+
+typedef struct {
+    const MYFLT *d;
+    MYFLT   first;                      /* d[0], where every part starts */
+    int     want_lo, want_hi;
+    MYFLT   lo[ARRAY_MAXPARTS], hi[ARRAY_MAXPARTS];
+    int     pos[ARRAY_MAXPARTS];
+} ARRAY_REDUCE;
+
+static void array_range_part(void *arg, int start, int end, int part)
+{
+    ARRAY_REDUCE *a = (ARRAY_REDUCE *) arg;
+    a->lo[part] = a->hi[part] = a->first;
+    array_range(a->d + start, end - start, &a->lo[part], &a->hi[part],
+                a->want_lo, a->want_hi);
+}
+
+/* the first greatest (or least) element of a part, or -1 if none is
+   greater (less) than d[0] */
+
+static void array_extreme_part(void *arg, int start, int end, int part)
+{
+    ARRAY_REDUCE *a = (ARRAY_REDUCE *) arg;
+    MYFLT   v;
+    int     i;
+
+    array_range_part(arg, start, end, part);
+    v = a->want_hi ? a->hi[part] : a->lo[part];
+    if (a->want_hi ? v > a->first : v < a->first) {
+      i = array_find(a->d + start, end - start, v);
+      a->pos[part] = start + i;
+    }
+    else a->pos[part] = -1;
+}
+
+static void array_sum_part(void *arg, int start, int end, int part)
+{
+    ARRAY_REDUCE *a = (ARRAY_REDUCE *) arg;
+    a->lo[part] = array_sum(a->d + start, end - start);
+}
+
+/* the position of the greatest (hi) or least element of the n in d,
+   the first of them if there are several, and 0 if d[0] is a NaN */
+
+static int array_extreme(CSOUND *csound, const MYFLT *d, int n, int hi)
+{
+    ARRAY_REDUCE a;
+    int     i, nparts, pos = 0;
+
+    a.d = d;
+    a.first = d[0];
+    a.want_lo = !hi;
+    a.want_hi = hi;
+    nparts = array_split(csound, array_extreme_part, &a, n, ARRAY_PART);
+    for (i = 0; i < nparts; i++)
+      if (a.pos[i] >= 0 && (hi ? d[a.pos[i]] > d[pos] : d[a.pos[i]] < d[pos]))
+        pos = a.pos[i];
+    return pos;
+}
+
+/* the pure functions tabmap can run as a loop, rather than by calling
+   the opcode for each element */
+
+typedef void (*ARRAY_MAP)(MYFLT *r, const MYFLT *a, int n);
+
+extern int abs1(CSOUND *, EVAL *), exp01(CSOUND *, EVAL *);
+extern int log01(CSOUND *, EVAL *), sqrt1(CSOUND *, EVAL *);
+extern int sin1(CSOUND *, EVAL *), cos1(CSOUND *, EVAL *);
+extern int tan1(CSOUND *, EVAL *), asin1(CSOUND *, EVAL *);
+extern int acos1(CSOUND *, EVAL *), atan1(CSOUND *, EVAL *);
+extern int sinh1(CSOUND *, EVAL *), cosh1(CSOUND *, EVAL *);
+extern int tanh1(CSOUND *, EVAL *), log101(CSOUND *, EVAL *);
+extern int log21(CSOUND *, EVAL *), int1(CSOUND *, EVAL *);
+extern int frac1(CSOUND *, EVAL *), int1_round(CSOUND *, EVAL *);
+extern int int1_floor(CSOUND *, EVAL *), int1_ceil(CSOUND *, EVAL *);
+extern int dbamp(CSOUND *, EVAL *), ampdb(CSOUND *, EVAL *);
+
+/* as in aops.c */
+#define ARRAY_FLOOR(x) ((int32)((double)(x) >= 0.0 ? (x) : (x) - 0.99999999))
+#define ARRAY_CEIL(x)  ((int32)((double)(x) >= 0.0 ? (x) + 0.99999999 : (x)))
+
+static inline MYFLT array_int(MYFLT x)
+{
+    MYFLT   ip;
+    MODF(x, &ip);
+    return ip;
+}
+
+static inline MYFLT array_frac(MYFLT x)
+{
+    MYFLT   ip;
+    return MODF(x, &ip);
+}
+
+#define ARRAY_MAPFN(NAME, EXPR)                                         \
+  CS_CLONES                                                             \
+  static void NAME(MYFLT *r, const MYFLT *a, int n)                     \
+  {                                                                     \
+    int i;                                                              \
+    for (i = 0; i < n; i++) {                                           \
+      MYFLT x = a[i];                                                   \
+      r[i] = EXPR;                                                      \
+    }                                                                   \
+  }
+
+ARRAY_MAPFN(map_abs, FABS(x))
+ARRAY_MAPFN(map_exp, EXP(x))
+ARRAY_MAPFN(map_log, LOG(x))
+ARRAY_MAPFN(map_sqrt, SQRT(x))
+ARRAY_MAPFN(map_sin, SIN(x))
+ARRAY_MAPFN(map_cos, COS(x))
+ARRAY_MAPFN(map_tan, TAN(x))
+ARRAY_MAPFN(map_asin, ASIN(x))
+ARRAY_MAPFN(map_acos, ACOS(x))
+ARRAY_MAPFN(map_atan, ATAN(x))
+ARRAY_MAPFN(map_sinh, SINH(x))
+ARRAY_MAPFN(map_cosh, COSH(x))
+ARRAY_MAPFN(map_tanh, TANH(x))
+ARRAY_MAPFN(map_log10, LOG10(x))
+ARRAY_MAPFN(map_log2, LOG2(x))
+ARRAY_MAPFN(map_int, array_int(x))
+ARRAY_MAPFN(map_frac, array_frac(x))
+ARRAY_MAPFN(map_round, (MYFLT) MYFLT2LRND(x))
+ARRAY_MAPFN(map_floor, (MYFLT) (ARRAY_FLOOR(x)))
+ARRAY_MAPFN(map_ceil, (MYFLT) (ARRAY_CEIL(x)))
+ARRAY_MAPFN(map_dbamp, LOG(FABS(x)) / LOG10D20)
+ARRAY_MAPFN(map_ampdb, EXP(x * LOG10D20))
+
+static const struct {
+    int     (*fn)(CSOUND *, EVAL *);
+    ARRAY_MAP map;
+} array_maps[] = {
+    { abs1, map_abs },          { exp01, map_exp },
+    { log01, map_log },         { sqrt1, map_sqrt },
+    { sin1, map_sin },          { cos1, map_cos },
+    { tan1, map_tan },          { asin1, map_asin },
+    { acos1, map_acos },        { atan1, map_atan },
+    { sinh1, map_sinh },        { cosh1, map_cosh },
+    { tanh1, map_tanh },        { log101, map_log10 },
+    { log21, map_log2 },        { int1, map_int },
+    { frac1, map_frac },        { int1_round, map_round },
+    { int1_floor, map_floor },  { int1_ceil, map_ceil },
+    { dbamp, map_dbamp },       { ampdb, map_ampdb }
+};
+
+static ARRAY_MAP array_map_find(SUBR fn)
+{
+    size_t  i;
+    for (i = 0; i < sizeof(array_maps) / sizeof(array_maps[0]); i++)
+      if (fn == (SUBR) array_maps[i].fn)
+        return array_maps[i].map;
+    return NULL;
+}
+
+typedef struct {
+    ARRAY_MAP map;
+    MYFLT   *r;
+    const MYFLT *a;
+} ARRAY_MAPPING;
+
+static void array_map_part(void *arg, int start, int end, int part)
+{
+    ARRAY_MAPPING *m = (ARRAY_MAPPING *) arg;
+    (void) part;
+    m->map(m->r + start, m->a + start, end - start);
+}
+
+static void array_map(CSOUND *csound, ARRAY_MAP map, MYFLT *r,
+                      const MYFLT *a, int n)
+{
+    ARRAY_MAPPING m;
+    m.map = map;
+    m.r = r;
+    m.a = a;
+    array_split(csound, array_map_part, &m, n, ARRAY_PART_MAP);
+}
+
 static int tabarithset(CSOUND *csound, TABARITH *p)
 {
     if (LIKELY(p->left->data && p->right->data)) {
@@ -348,7 +896,6 @@ static int tabadd(CSOUND *csound, TABARITH *p)
     ARRAYDAT *l   = p->left;
     ARRAYDAT *r   = p->right;
     int size    = ans->sizes[0];
-    int i;
 
     if (UNLIKELY(p->ans->data == NULL ||
                  p->left->data==NULL || p->right->data==NULL))
@@ -357,8 +904,7 @@ static int tabadd(CSOUND *csound, TABARITH *p)
 
     if (l->sizes[0]<size) size = l->sizes[0];
     if (r->sizes[0]<size) size = r->sizes[0];
-    for (i=0; i<size; i++)
-      ans->data[i] = l->data[i] + r->data[i];
+    array_arith(csound, array_add, ans->data, l->data, r->data, FL(0.0), size);
     return OK;
 }
 
@@ -368,7 +914,6 @@ static int tabsub(CSOUND *csound, TABARITH *p)
     ARRAYDAT *l   = p->left;
     ARRAYDAT *r   = p->right;
     int size    = ans->sizes[0];
-    int i;
 
     if (UNLIKELY(p->ans->data == NULL ||
                  p->left->data==NULL || p->right->data==NULL))
@@ -377,8 +922,7 @@ static int tabsub(CSOUND *csound, TABARITH *p)
 
     if (l->sizes[0]<size) size = l->sizes[0];
     if (r->sizes[0]<size) size = r->sizes[0];
-    for (i=0; i<size; i++)
-      ans->data[i] = l->data[i] - r->data[i];
+    array_arith(csound, array_sub, ans->data, l->data, r->data, FL(0.0), size);
     return OK;
 }
 
@@ -405,7 +949,6 @@ static int tabmult(CSOUND *csound, TABARITH *p)
     ARRAYDAT *l   = p->left;
     ARRAYDAT *r   = p->right;
     int size    = ans->sizes[0];
-    int i;
 
     if (UNLIKELY(p->ans->data == NULL ||
                  p->left->data== NULL || p->right->data==NULL))
@@ -415,8 +958,7 @@ static int tabmult(CSOUND *csound, TABARITH *p)
     //printf("sizes %d %d %d\n", l->sizes[0], r->sizes[0], size);
     if (l->sizes[0]<size) size = l->sizes[0];
     if (r->sizes[0]<size) size = r->sizes[0];
-    for (i=0; i<size; i++)
-      ans->data[i] = l->data[i] * r->data[i];
+    array_arith(csound, array_mul, ans->data, l->data, r->data, FL(0.0), size);
     return OK;
 }
 
@@ -435,13 +977,13 @@ static int tabdiv(CSOUND *csound, TABARITH *p)
 
     if (l->sizes[0]<size) size = l->sizes[0];
     if (r->sizes[0]<size) size = r->sizes[0];
-    for (i=0; i<size; i++)
-      if (LIKELY(r->data[i]!=0))
-        ans->data[i] = l->data[i] / r->data[i];
-      else
-        return
-          csound->PerfError(csound, p->h.insdshead,
-                            Str("division by zero in array-var at index %d"), i);
+    /* the elements before a zero divisor are still divided */
+    i = array_find(r->data, size, FL(0.0));
+    array_arith(csound, array_div, ans->data, l->data, r->data, FL(0.0), i);
+    if (UNLIKELY(i<size))
+      return
+        csound->PerfError(csound, p->h.insdshead,
+                          Str("division by zero in array-var at index %d"), i);
     return OK;
 }
 
@@ -510,7 +1052,6 @@ IIARRAY(tabpowi,tabpow)
 static int tabiadd(CSOUND *csound, ARRAYDAT *ans, ARRAYDAT *l, MYFLT r, void *p)
 {
     int size    = ans->sizes[0];
-    int i;
 
     if (UNLIKELY(ans->data == NULL || l->data== NULL))
       return csound->PerfError(csound, ((TABARITH *) p)->h.insdshead,
@@ -518,8 +1059,7 @@ static int tabiadd(CSOUND *csound, ARRAYDAT *ans, ARRAYDAT *l, MYFLT r, void *p)
 
     if (l->sizes[0]<size) size = l->sizes[0];
     if (ans->sizes[0]<size) size = ans->sizes[0];
-    for (i=0; i<size; i++)
-      ans->data[i] = l->data[i] + r;
+    array_arith(csound, array_addk, ans->data, l->data, NULL, r, size);
     return OK;
 }
 
@@ -548,7 +1088,6 @@ static int tabaisub(CSOUND *csound, TABARITH1 *p)
     ARRAYDAT *l   = p->left;
     MYFLT r       = *p->right;
     int size      = ans->sizes[0];
-    int i;
 
     if (UNLIKELY(p->ans->data == NULL || l->data== NULL))
       return csound->PerfError(csound, p->h.insdshead,
@@ -556,8 +1095,7 @@ static int tabaisub(CSOUND *csound, TABARITH1 *p)
 
     if (l->sizes[0]<size) size = l->sizes[0];
     if (ans->sizes[0]<size) size = ans->sizes[0];
-    for (i=0; i<size; i++)
-      ans->data[i] = l->data[i] - r;
+    array_arith(csound, array_subk, ans->data, l->data, NULL, r, size);
     return OK;
 }
 
@@ -568,7 +1106,6 @@ static int tabiasub(CSOUND *csound, TABARITH2 *p)
     ARRAYDAT *l   = p->right;
     MYFLT r     = *p->left;
     int size    = ans->sizes[0];
-    int i;
 
     if (UNLIKELY(p->ans->data == NULL || l->data== NULL))
       return csound->PerfError(csound, p->h.insdshead,
@@ -576,8 +1113,7 @@ static int tabiasub(CSOUND *csound, TABARITH2 *p)
 
     if (l->sizes[0]<size) size = l->sizes[0];
     if (ans->sizes[0]<size) size = ans->sizes[0];
-    for (i=0; i<size; i++)
-      ans->data[i] = r - l->data[i];
+    array_arith(csound, array_ksub, ans->data, l->data, NULL, r, size);
     return OK;
 }
 
@@ -585,7 +1121,6 @@ static int tabiasub(CSOUND *csound, TABARITH2 *p)
 static int tabimult(CSOUND *csound, ARRAYDAT *ans, ARRAYDAT *l, MYFLT r, void *p)
 {
     int size    = ans->sizes[0];
-    int i;
 
     if (UNLIKELY(ans->data == NULL || l->data== NULL))
       return csound->PerfError(csound, ((TABARITH1 *)p)->h.insdshead,
@@ -593,8 +1128,7 @@ static int tabimult(CSOUND *csound, ARRAYDAT *ans, ARRAYDAT *l, MYFLT r, void *p
 
     if (l->sizes[0]<size) size = l->sizes[0];
     if (ans->sizes[0]<size) size = ans->sizes[0];
-    for (i=0; i<size; i++)
-      ans->data[i] = l->data[i] * r;
+    array_arith(csound, array_mulk, ans->data, l->data, NULL, r, size);
     return OK;
 }
 
@@ -623,7 +1157,6 @@ static int tabaidiv(CSOUND *csound, TABARITH1 *p)
     ARRAYDAT *l   = p->left;
     MYFLT r       = *p->right;
     int size      = ans->sizes[0];
-    int i;
 
     if (UNLIKELY(r==FL(0.0)))
       return csound->PerfError(csound, p->h.insdshead,
@@ -634,8 +1167,7 @@ static int tabaidiv(CSOUND *csound, TABARITH1 *p)
 
     if (l->sizes[0]<size) size = l->sizes[0];
     if (ans->sizes[0]<size) size = ans->sizes[0];
-    for (i=0; i<size; i++)
-      ans->data[i] = l->data[i] / r;
+    array_arith(csound, array_divk, ans->data, l->data, NULL, r, size);
     return OK;
 }
 
@@ -646,7 +1178,6 @@ static int tabiadiv(CSOUND *csound, TABARITH2 *p)
     ARRAYDAT *l   = p->right;
     MYFLT r     = *p->left;
     int size    = ans->sizes[0];
-    int i;
 
     if (UNLIKELY(r==FL(0.0)))
       return csound->PerfError(csound, p->h.insdshead,
@@ -657,8 +1188,7 @@ static int tabiadiv(CSOUND *csound, TABARITH2 *p)
 
     if (l->sizes[0]<size) size = l->sizes[0];
     if (ans->sizes[0]<size) size = ans->sizes[0];
-    for (i=0; i<size; i++)
-      ans->data[i] = r / l->data[i];
+    array_arith(csound, array_kdiv, ans->data, l->data, NULL, r, size);
     return OK;
 }
 
@@ -812,8 +1342,7 @@ static int tabqset1(CSOUND *csound, TABQUERY1 *p)
 static int tabmax(CSOUND *csound, TABQUERY *p)
 {
     ARRAYDAT *t = p->tab;
-    int i, size = 0, pos = 0;;
-    MYFLT ans;
+    int i, size = 0, pos;
 
     if (UNLIKELY(t->data == NULL))
       return csound->PerfError(csound, p->h.insdshead,
@@ -823,13 +1352,8 @@ static int tabmax(CSOUND *csound, TABQUERY *p)
     /*      Str("array-variable not vector")); */
 
     for (i=0; i<t->dimensions; i++) size += t->sizes[i];
-    ans = t->data[0];
-    for (i=1; i<size; i++)
-      if (t->data[i]>ans) {
-        ans = t->data[i];
-        pos = i;
-      }
-    *p->ans = ans;
+    pos = array_extreme(csound, t->data, size, 1);
+    *p->ans = t->data[pos];
     if (p->OUTOCOUNT>1) *p->pos = (MYFLT)pos;
     return OK;
 }
@@ -843,8 +1367,7 @@ static int tabmax1(CSOUND *csound, TABQUERY *p)
 static int tabmin(CSOUND *csound, TABQUERY *p)
 {
     ARRAYDAT *t = p->tab;
-    int i, size = 0, pos = 0;
-    MYFLT ans;
+    int i, size = 0, pos;
 
     if (UNLIKELY(t->data == NULL))
       return csound->PerfError(csound, p->h.insdshead,
@@ -854,13 +1377,8 @@ static int tabmin(CSOUND *csound, TABQUERY *p)
          p->h.insdshead, Str("array-variable not a vector")); */
 
     for (i=0; i<t->dimensions; i++) size += t->sizes[i];
-    ans = t->data[0];
-    for (i=1; i<size; i++)
-      if (t->data[i]<ans) {
-        ans = t->data[i];
-        pos = i;
-      }
-    *p->ans = ans;
+    pos = array_extreme(csound, t->data, size, 0);
+    *p->ans = t->data[pos];
     if (p->OUTOCOUNT>1) *p->pos = (MYFLT)pos;
     return OK;
 }
@@ -874,7 +1392,8 @@ static int tabmin1(CSOUND *csound, TABQUERY *p)
 static int tabsum(CSOUND *csound, TABQUERY1 *p)
 {
     ARRAYDAT *t = p->tab;
-    int i, size = 0;
+    ARRAY_REDUCE a;
+    int i, size = 0, nparts;
     MYFLT ans;
 
     if (UNLIKELY(t->data == NULL))
@@ -883,10 +1402,13 @@ static int tabsum(CSOUND *csound, TABQUERY1 *p)
     if (UNLIKELY(t->dimensions!=1))
       return csound->PerfError(csound, p->h.insdshead,
                                Str("array-variable not a vector"));
-    ans = t->data[0];
     for (i=0; i<t->dimensions; i++) size += t->sizes[i];
-    for (i=1; i<size; i++)
-      ans += t->data[i];
+    a.d = t->data;
+    a.lo[0] = t->data[0];               /* replaced by the first part */
+    nparts = array_split(csound, array_sum_part, &a, size, ARRAY_PART);
+    ans = a.lo[0];
+    for (i=1; i<nparts; i++)
+      ans += a.lo[i];
     *p->ans = ans;
     return OK;
 }
@@ -897,6 +1419,36 @@ static int tabsum1(CSOUND *csound, TABQUERY1 *p)
     else return NOTOK;
 }
 
+typedef struct {
+    MYFLT   *d;
+    MYFLT   min, range, base;
+} ARRAY_SCALE;
+
+/* d = (d-min)*range + base */
+
+CS_CLONES
+static void array_scale(MYFLT *d, int n, MYFLT min, MYFLT range, MYFLT base)
+{
+    int     i = 0;
+#ifdef CS_VEC
+    for (; i + CS_VLEN <= n; i += CS_VLEN) {
+      cs_vec_t x;
+      ARRAY_LOAD(x, d + i);
+      x = (x - min)*range + base;
+      ARRAY_STORE(d + i, x);
+    }
+#endif
+    for (; i < n; i++)
+      d[i] = (d[i]-min)*range + base;
+}
+
+static void array_scale_part(void *arg, int start, int end, int part)
+{
+    ARRAY_SCALE *sc = (ARRAY_SCALE *) arg;
+    (void) part;
+    array_scale(sc->d + start, end - start, sc->min, sc->range, sc->base);
+}
+
 static int tabscaleset(CSOUND *csound, TABSCALE *p)
 {
     if (LIKELY(p->tab->data && p->tab->dimensions==1)) return OK;
@@ -910,8 +1462,9 @@ static int tabscale(CSOUND *csound, TABSCALE *p)
     ARRAYDAT *t = p->tab;
     MYFLT tmin;
     MYFLT tmax;
-    int i;
+    int i, nparts;
     MYFLT range;
+    ARRAY_REDUCE a;
 
     tmin = t->data[strt];
     tmax = tmin;
@@ -925,15 +1478,27 @@ static int tabscale(CSOUND *csound, TABSCALE *p)
       int x = end; end = strt; strt = x;
     }
     // get data range
-    for (i=strt+1; i<end; i++) {
-      if (t->data[i]<tmin) tmin = t->data[i];
-      if (t->data[i]>tmax) tmax = t->data[i];
+    if (strt+1<end) {
+      a.d = t->data + strt + 1;
+      a.first = tmin;
+      a.want_lo = a.want_hi = 1;
+      nparts = array_split(csound, array_range_part, &a, end-strt-1,
+                           ARRAY_PART);
+      for (i=0; i<nparts; i++) {
+        if (a.lo[i]<tmin) tmin = a.lo[i];
+        if (a.hi[i]>tmax) tmax = a.hi[i];
+      }
     }
     /* printf("start/end %d/%d max/min = %g/%g tmax/tmin = %g/%g range=%g\n",  */
     /*        strt, end, max, min, tmax, tmin, range); */
     range = (max-min)/(tmax-tmin);
-    for (i=strt; i<end; i++) {
-      t->data[i] = (t->data[i]-tmin)*range + min;
+    if (strt<end) {
+      ARRAY_SCALE sc;
+      sc.d = t->data + strt;
+      sc.min = tmin;
+      sc.range = range;
+      sc.base = min;
+      array_split(csound, array_scale_part, &sc, end-strt, ARRAY_PART);
     }
     return OK;
 }
@@ -1165,6 +1730,7 @@ typedef struct {
   STRINGDAT *str;
   int    len;
   OENTRY *opc;
+  ARRAY_MAP map;        /* the loop for a pure function, or NULL */
 } TABMAP;
 
 
@@ -1192,15 +1758,19 @@ static int tabmap_set(CSOUND *csound, TABMAP *p)
     if (UNLIKELY(opc == NULL))
       return csound->InitError(csound, Str("%s not found"), p->str->data);
     p->opc = opc;
-    for (n=0; n < size; n++) {
-      eval.a = &tabin[n];
-      eval.r = &data[n];
-      opc->iopadr(csound, (void *) &eval);
-    }
+    if ((p->map = array_map_find(opc->iopadr)) != NULL)
+      array_map(csound, p->map, data, tabin, size);
+    else
+      for (n=0; n < size; n++) {
+        eval.a = &tabin[n];
+        eval.r = &data[n];
+        opc->iopadr(csound, (void *) &eval);
+      }
 
     opc = find_opcode_new(csound, p->str->data, "k", "k");
 
     p->opc = opc;
+    p->map = opc != NULL ? array_map_find(opc->kopadr) : NULL;
     return OK;
 }
 
@@ -1222,6 +1792,10 @@ static int tabmap_perf(CSOUND *csound, TABMAP *p)
     if (UNLIKELY(opc == NULL))
       return csound->PerfError(csound,
                                p->h.insdshead, Str("map fn not found at k rate"));
+    if (p->map != NULL) {
+      array_map(csound, p->map, data, tabin, size);
+      return OK;
+    }
     for (n=0; n < size; n++) {
       eval.a = &tabin[n];
       eval.r = &data[n];
@@ -1466,28 +2040,20 @@ int init_recttopol(CSOUND *csound, FFT *p){
 }
 
 int perf_recttopol(CSOUND *csound, FFT *p){
-    int i, end = p->out->sizes[0];
-    MYFLT *in, *out, mag, ph;
+    int end = p->out->sizes[0];
+    MYFLT *in, *out;
     in = p->in->data;
     out = p->out->data;
-    for (i=2;i<end;i+=2 ){
-      mag = sqrt(in[i]*in[i] + in[i+1]*in[i+1]);
-      ph = atan2(in[i+1],in[i]);
-      out[i] = mag; out[i+1] = ph;
-    }
+    spec_polar(out+2, in+2, (end-1)/2, csound->oparms->spectralApprox);
     return OK;
 }
 
 int perf_poltorect(CSOUND *csound, FFT *p){
-    int i, end = p->out->sizes[0];
-    MYFLT *in, *out, re, im;
+    int end = p->out->sizes[0];
+    MYFLT *in, *out;
     in = p->in->data;
     out = p->out->data;
-    for(i=2;i<end;i+=2){
-      re = in[i]*cos(in[i+1]);
-      im = in[i]*sin(in[i+1]);
-      out[i] = re; out[i+1] = im;
-    }
+    spec_rect(out+2, in+2, (end-1)/2, csound->oparms->spectralApprox);
     return OK;
 }
 
@@ -1503,16 +2069,12 @@ int init_poltorect2(CSOUND *csound, FFT *p){
 
 
 int perf_poltorect2(CSOUND *csound, FFT *p){
-    int i,j, end = p->in->sizes[0]-1;
-    MYFLT *mags, *phs, *out, re, im;
+    int end = p->in->sizes[0]-1;
+    MYFLT *mags, *phs, *out;
     mags = p->in->data;
     phs = p->in2->data;
     out = p->out->data;
-    for(i=2,j=1;j<end;i+=2, j++){
-      re = mags[j]*cos(phs[j]);
-      im = mags[j]*sin(phs[j]);
-      out[i] = re; out[i+1] = im;
-    }
+    spec_rect2(out+2, mags+1, phs+1, end-1, csound->oparms->spectralApprox);
     out[0] = mags[0];
     out[1] = mags[end];
     return OK;
@@ -1525,24 +2087,22 @@ int init_mags(CSOUND *csound, FFT *p){
 }
 
 int perf_mags(CSOUND *csound, FFT *p){
-    int i,j, end = p->out->sizes[0];
+    int end = p->out->sizes[0];
     MYFLT *in, *out;
     in = p->in->data;
     out = p->out->data;
-    for(i=2,j=1;j<end-1;i+=2,j++)
-      out[j] = sqrt(in[i]*in[i] + in[i+1]*in[i+1]);
+    spec_mags(out+1, in+2, end-2);
     out[0] = in[0];
     out[end-1] = in[1];
     return OK;
 }
 
 int perf_phs(CSOUND *csound, FFT *p){
-    int i,j, end = p->out->sizes[0];
+    int end = p->out->sizes[0];
     MYFLT *in, *out;
     in = p->in->data;
     out = p->out->data;
-    for(i=0,j=0;j<end;i+=2,j++)
-      out[j] = atan2(in[i+1],in[i]);
+    spec_phases(out, in, end, csound->oparms->spectralApprox);
     return OK;
 }
 
@@ -1907,13 +2467,13 @@ static OENTRY arrayvars_localops[] =
     { "array", 0xffff },
     { "array.k", sizeof(TABFILL), _QQ, 1, "k[]", "m", (SUBR)tabfill     },
     { "array.i", sizeof(TABFILL), _QQ, 1, "i[]", "m", (SUBR)tabfill     },
-    { "##array_set.i", sizeof(ARRAY_SET), 0, 1, "", "i[]im", (SUBR)array_set },
-    { "##array_init", sizeof(ARRAY_SET), 0, 1, "", ".[]im", (SUBR)array_set },
-    { "##array_set.k0", sizeof(ARRAY_SET), 0, 2, "", "k[]kz",
+    { "##array_set.i", sizeof(ARRAY_SET), IW, 1, "", "i[]im", (SUBR)array_set },
+    { "##array_init", sizeof(ARRAY_SET), IW, 1, "", ".[]im", (SUBR)array_set },
+    { "##array_set.k0", sizeof(ARRAY_SET), IW, 2, "", "k[]kz",
       NULL, (SUBR)array_set },
-    { "##array_set.i2", sizeof(ARRAY_SET), 0, 3, "", ".[].m",
+    { "##array_set.i2", sizeof(ARRAY_SET), IW, 3, "", ".[].m",
       (SUBR)array_set, (SUBR)array_set },
-    { "##array_set.k", sizeof(ARRAY_SET), 0, 2, "", ".[].z",
+    { "##array_set.k", sizeof(ARRAY_SET), IW, 2, "", ".[].z",
       NULL, (SUBR)array_set },
     { "##array_get.i", sizeof(ARRAY_GET), 0, 1, "i", "i[]m", (SUBR)array_get },
     { "##array_get.k0", sizeof(ARRAY_GET), 0, 3, "k", "k[]z",
@@ -2029,12 +2589,12 @@ static OENTRY arrayvars_localops[] =
     { "sumarray.k", sizeof(TABQUERY1),0, 3, "k", "k[]",
       (SUBR) tabqset1, (SUBR) tabsum },
     { "sumarray.i", sizeof(TABQUERY1),0, 1, "i", "i[]", (SUBR) tabsum1   },
-    { "scalet", sizeof(TABSCALE), _QQ, 3, "",  "k[]kkOJ",
+    { "scalet", sizeof(TABSCALE), IW|_QQ, 3, "",  "k[]kkOJ",
       (SUBR) tabscaleset,(SUBR) tabscale },
     { "scalearray", 0xffff},
-    { "scalearray.k", sizeof(TABSCALE), 0, 3, "",  "k[]kkOJ",
+    { "scalearray.k", sizeof(TABSCALE), IW, 3, "",  "k[]kkOJ",
       (SUBR) tabscaleset,(SUBR) tabscale },
-    { "scalearray.1", sizeof(TABSCALE), 0, 1, "",  "i[]iiOJ",   (SUBR) tabscale1 },
+    { "scalearray.1", sizeof(TABSCALE), IW, 1, "",  "i[]iiOJ",   (SUBR) tabscale1 },
     { "=.I", sizeof(TABCPY), 0, 1, "i[]", "i[]", (SUBR)tabcopy, NULL },
     { "=._", sizeof(TABCPY), 0, 3, ".[]", ".[]", (SUBR)tabcopy, (SUBR)tabcopy },
     { "tabgen", sizeof(TABGEN), _QQ, 1, "k[]", "iip", (SUBR) tabgen, NULL    },
@@ -2062,13 +2622,13 @@ static OENTRY arrayvars_localops[] =
     //    { "slicearray.s", sizeof(TABSLICE), 0, 3, "S[]", "[]ii",
     //                                  (SUBR) tabsliceS, (SUBR) tabsliceS, NULL },
     { "copy2ftab", sizeof(TABCOPY), TW|_QQ, 2, "", "k[]k", NULL, (SUBR) tab2ftab },
-    { "copy2ttab", sizeof(TABCOPY), TR|_QQ, 2, "", "k[]k", NULL, (SUBR) ftab2tab },
+    { "copy2ttab", sizeof(TABCOPY), TR|IW|_QQ, 2, "", "k[]k", NULL, (SUBR) ftab2tab },
     { "copya2ftab.k", sizeof(TABCOPY), TW, 3, "", "k[]k",
       (SUBR) tab2ftab, (SUBR) tab2ftab },
-    { "copyf2array.k", sizeof(TABCOPY), TR, 3, "", "k[]k",
+    { "copyf2array.k", sizeof(TABCOPY), TR|IW, 3, "", "k[]k",
       (SUBR) ftab2tab, (SUBR) ftab2tab },
     { "copya2ftab.i", sizeof(TABCOPY), TW, 1, "", "i[]i", (SUBR) tab2ftab },
-    { "copyf2array.i", sizeof(TABCOPY), TR, 1, "", "i[]i", (SUBR) ftab2tab },
+    { "copyf2array.i", sizeof(TABCOPY), TR|IW, 1, "", "i[]i", (SUBR) ftab2tab },
     /* { "lentab", 0xffff}, */
     { "lentab.i", sizeof(TABQUERY1), _QQ, 1, "i", "k[]p", (SUBR) tablength },
     { "lentab.k", sizeof(TABQUERY1), _QQ, 1, "k", "k[]p", NULL, (SUBR) tablength },
@@ -1544,9 +1544,9 @@ static OENTRY localops[] = {
         (SUBR) fprintf_set_S,     (SUBR) fprintf_k,   (SUBR) NULL, NULL,},
     { "fprintks.i",   S(FPRINTF),    WR, 3,  "",     "iSM",
         (SUBR) fprintf_set,     (SUBR) fprintf_k,   (SUBR) NULL, NULL},
-     { "vincr",      S(INCR),        0, 4,  "",     "aa",
+     { "vincr",      S(INCR),        IW, 4,  "",     "aa",
         (SUBR) NULL,            (SUBR) NULL,        (SUBR) incr, NULL         },
-    { "clear",      S(CLEARS),      0, 4,  "",     "y",
+    { "clear",      S(CLEARS),      IW, 4,  "",     "y",
 
         (SUBR) NULL,            (SUBR) NULL,        (SUBR) clear, NULL},
     { "fout",       S(OUTFILE),     0, 5,  "",     "Siy",
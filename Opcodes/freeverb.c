@@ -22,6 +22,7 @@
 */
 
 #include "stdopcod.h"
+#include "cs_simd.h"
 #include <math.h>
 
 #define DEFAULT_SRATE   44100.0
@@ -81,7 +82,7 @@ typedef struct {
     MYFLT           *iSkipInit;
     freeVerbComb    *Comb[NR_COMB][2];
     freeVerbAllPass *AllPass[NR_ALLPASS][2];
-    MYFLT           *tmpBuf;
+    MYFLT           *tmpBuf[2];
     AUXCH           auxData;
     MYFLT           prvDampFactor;
     double          dampValue;
@@ -128,7 +129,7 @@ static int freeverb_init(CSOUND *csound, FREEVERB *p)
       nbytes += allpass_nbytes(p, allpass_delays[i][0]);
       nbytes += allpass_nbytes(p, allpass_delays[i][1]);
     }
-    nbytes += (int) sizeof(MYFLT) * (int) CS_KSMPS;
+    nbytes += 2 * (int) sizeof(MYFLT) * (int) CS_KSMPS;
     /* allocate space if size has changed */
     if (nbytes != (int) p->auxData.size)
       csound->AuxAlloc(csound, (int32) nbytes, &(p->auxData));
@@ -158,7 +159,8 @@ static int freeverb_init(CSOUND *csound, FREEVERB *p)
         allpassp->buf[j] = FL(0.0);
       nbytes += allpass_nbytes(p, allpass_delays[i >> 1][i & 1]);
     }
-    p->tmpBuf = (MYFLT*) ((unsigned char*)p->auxData.auxp + (int)nbytes);
+    p->tmpBuf[0] = (MYFLT*) ((unsigned char*)p->auxData.auxp + (int)nbytes);
+    p->tmpBuf[1] = p->tmpBuf[0] + CS_KSMPS;
     p->prvDampFactor = -FL(1.0);
     if (*(p->iSampleRate) >= MIN_SRATE)
       p->srFact = pow((DEFAULT_SRATE / *(p->iSampleRate)), 0.8);
@@ -167,12 +169,94 @@ static int freeverb_init(CSOUND *csound, FREEVERB *p)
     return OK;
 }
 
+/* The sixteen comb filters (eight per channel) are run side by side,
+   one lane each, with the delay lines addressed as offsets from the
+   start of the shared buffer: only the one-pole filter of each comb is
+   recursive, so each sample is a handful of vector operations.  The
+   allpass filters are in series; each is run in pieces that stop at the
+   end of its buffer (allpass_filter), so a piece touches every slot of
+   the buffer at most once and reads no value it wrote itself, which
+   makes it one vector loop without recursion.  Both give the same
+   result, sample for sample, as filtering one comb or allpass at a time. */
+
+#define NR_LANES        (NR_COMB << 1)
+
+CS_CLONES
+static void comb_bank(FREEVERB *p, uint32_t nsmps,
+                      double feedback, double damp1, double damp2)
+{
+    MYFLT   *base = (MYFLT*) p->auxData.auxp;
+    MYFLT   *outL = p->tmpBuf[0], *outR = p->tmpBuf[1];
+    double  filterState[NR_LANES];
+    MYFLT   v[NR_LANES];
+    int     start[NR_LANES], end[NR_LANES], pos[NR_LANES];
+    uint32_t n;
+    int     i;
+
+    for (i = 0; i < NR_LANES; i++) {
+      freeVerbComb *combp = p->Comb[i % NR_COMB][i / NR_COMB];
+      start[i] = (int) (combp->buf - base);
+      end[i] = start[i] + combp->nSamples;
+      pos[i] = start[i] + combp->bufPos;
+      filterState[i] = combp->filterState;
+    }
+    for (n = 0; n < nsmps; n++) {
+      MYFLT   sumL = FL(0.0), sumR = FL(0.0);
+      double  inL = (double) p->aInL[n], inR = (double) p->aInR[n];
+      double  x[NR_LANES];
+      for (i = 0; i < NR_LANES; i++) {
+        v[i] = base[pos[i]];
+        filterState[i] = (filterState[i] * damp1) + ((double) v[i] * damp2);
+        x[i] = filterState[i] * feedback + (i < NR_COMB ? inL : inR);
+      }
+      for (i = 0; i < NR_COMB; i++) {
+        sumL += v[i];
+        sumR += v[i + NR_COMB];
+      }
+      outL[n] = sumL;
+      outR[n] = sumR;
+      for (i = 0; i < NR_LANES; i++)
+        base[pos[i]] = (MYFLT) x[i];
+      for (i = 0; i < NR_LANES; i++)
+        pos[i] = pos[i] + 1 >= end[i] ? start[i] : pos[i] + 1;
+    }
+    for (i = 0; i < NR_LANES; i++) {
+      freeVerbComb *combp = p->Comb[i % NR_COMB][i / NR_COMB];
+      combp->bufPos = pos[i] - start[i];
+      combp->filterState = filterState[i];
+    }
+}
+
+CS_CLONES
+static void allpass_run(MYFLT *buf, MYFLT *sig, int n)
+{
+    int     i;
+    for (i = 0; i < n; i++) {
+      double  x = (double) buf[i] - (double) sig[i];
+      buf[i] = buf[i] * (MYFLT) allPassFeedBack + sig[i];
+      sig[i] = (MYFLT) x;
+    }
+}
+
+static void allpass_filter(freeVerbAllPass *allpassp, MYFLT *sig,
+                           uint32_t nsmps)
+{
+    uint32_t n = 0;
+    while (n < nsmps) {
+      int m = allpassp->nSamples - allpassp->bufPos;
+      if ((uint32_t) m > nsmps - n)
+        m = (int) (nsmps - n);
+      allpass_run(&allpassp->buf[allpassp->bufPos], &sig[n], m);
+      n += m;
+      if ((allpassp->bufPos += m) >= allpassp->nSamples)
+        allpassp->bufPos = 0;
+    }
+}
+
 static int freeverb_perf(CSOUND *csound, FREEVERB *p)
 {
-    double          feedback, damp1, damp2, x;
-    freeVerbComb    *combp;
-    freeVerbAllPass *allpassp;
-    int             i;
+    double          feedback, damp1, damp2;
+    int             i, j;
     uint32_t offset = p->h.insdshead->ksmps_offset;
     uint32_t early  = p->h.insdshead->ksmps_no_end;
     uint32_t n, nsmps = CS_KSMPS;
@@ -192,78 +276,27 @@ static int freeverb_perf(CSOUND *csound, FREEVERB *p)
     else
       damp1 = p->dampValue;
     damp2 = 1.0 - damp1;
-    /* comb filters (left channel) */
-    memset(p->tmpBuf,0, sizeof(MYFLT)*nsmps);
-    for (i = 0; i < NR_COMB; i++) {
-      combp = p->Comb[i][0];
-      for (n = 0; n < nsmps; n++) {
-        p->tmpBuf[n] += combp->buf[combp->bufPos];
-        x = (double) combp->buf[combp->bufPos];
-        combp->filterState = (combp->filterState * damp1) + (x * damp2);
-        x = combp->filterState * feedback + (double) p->aInL[n];
-        combp->buf[combp->bufPos] = (MYFLT) x;
-        if (UNLIKELY(++(combp->bufPos) >= combp->nSamples))
-          combp->bufPos = 0;
-      }
-    }
-    /* allpass filters (left channel) */
-    for (i = 0; i < NR_ALLPASS; i++) {
-      allpassp = p->AllPass[i][0];
-      for (n = 0; n < nsmps; n++) {
-        x = (double) allpassp->buf[allpassp->bufPos] - (double) p->tmpBuf[n];
-        allpassp->buf[allpassp->bufPos] *= (MYFLT) allPassFeedBack;
-        allpassp->buf[allpassp->bufPos] += p->tmpBuf[n];
-        if (UNLIKELY(++(allpassp->bufPos) >= allpassp->nSamples))
-          allpassp->bufPos = 0;
-        p->tmpBuf[n] = (MYFLT) x;
-      }
-    }
+    /* comb filters (both channels) */
+    comb_bank(p, nsmps, feedback, damp1, damp2);
+    /* allpass filters */
+    for (j = 0; j < 2; j++)
+      for (i = 0; i < NR_ALLPASS; i++)
+        allpass_filter(p->AllPass[i][j], p->tmpBuf[j], nsmps);
 
-    /* write left channel output */
-    if (UNLIKELY(offset)) memset(p->aOutL, '\0', offset*sizeof(MYFLT));
-    if (UNLIKELY(early)) {
-      nsmps -= early;
-      memset(&p->aOutL[nsmps], '\0', early*sizeof(MYFLT));
+    /* write output */
+    if (UNLIKELY(offset)) {
+      memset(p->aOutL, '\0', offset*sizeof(MYFLT));
+      memset(p->aOutR, '\0', offset*sizeof(MYFLT));
     }
-    for (n = offset; n < nsmps; n++)
-      p->aOutL[n] = p->tmpBuf[n] * (MYFLT) fixedGain;
-    /* comb filters (right channel) */
-    memset(p->tmpBuf, 0, sizeof(MYFLT)*nsmps);
-    /* for (n = 0; n < nsmps; n++) */
-    /*   p->tmpBuf[n] = FL(0.0); */
-    for (i = 0; i < NR_COMB; i++) {
-      combp = p->Comb[i][1];
-      for (n = 0; n < nsmps; n++) {
-        p->tmpBuf[n] += combp->buf[combp->bufPos];
-        x = (double) combp->buf[combp->bufPos];
-        combp->filterState = (combp->filterState * damp1) + (x * damp2);
-        x = combp->filterState * feedback + (double) p->aInR[n];
-        combp->buf[combp->bufPos] = (MYFLT) x;
-        if (UNLIKELY(++(combp->bufPos) >= combp->nSamples))
-          combp->bufPos = 0;
-      }
-    }
-    /* allpass filters (right channel) */
-    for (i = 0; i < NR_ALLPASS; i++) {
-      allpassp = p->AllPass[i][1];
-      for (n = 0; n < nsmps; n++) {
-        x = (double) allpassp->buf[allpassp->bufPos] - (double) p->tmpBuf[n];
-        allpassp->buf[allpassp->bufPos] *= (MYFLT) allPassFeedBack;
-        allpassp->buf[allpassp->bufPos] += p->tmpBuf[n];
-        if (UNLIKELY(++(allpassp->bufPos) >= allpassp->nSamples))
-          allpassp->bufPos = 0;
-        p->tmpBuf[n] = (MYFLT) x;
-      }
-    }
-    nsmps = CS_KSMPS;
-    /* write right channel output */
-    if (UNLIKELY(offset)) memset(p->aOutR, '\0', offset*sizeof(MYFLT));
     if (UNLIKELY(early)) {
       nsmps -= early;
+      memset(&p->aOutL[nsmps], '\0', early*sizeof(MYFLT));
       memset(&p->aOutR[nsmps], '\0', early*sizeof(MYFLT));
     }
-    for (n = offset; n < nsmps; n++)
-      p->aOutR[n] = p->tmpBuf[n] * (MYFLT) fixedGain;
+    for (n = offset; n < nsmps; n++) {
+      p->aOutL[n] = p->tmpBuf[0][n] * (MYFLT) fixedGain;
+      p->aOutR[n] = p->tmpBuf[1][n] * (MYFLT) fixedGain;
+    }
 
     return OK;
  err1:
@@ -25,6 +25,43 @@
 #include <math.h>
 
 #define FTCONV_MAXCHN   8
+#define FTCONV_MAXTAIL  4       /* tail stages in non-uniform mode */
+
+#define TAIL_IDLE       0
+#define TAIL_QUEUED     1
+#define TAIL_BUSY       2
+
+/* A tail stage of the non-uniform mode is a uniformly partitioned
+   convolver for a later part of the impulse response, with partitions
+   four times as long as those of the stage before it.  When a block of
+   input is complete it is handed to the stage's worker thread, and the
+   result is played out from the end of the next block on; the audio
+   thread computes it itself if the worker has not started by then.
+   Stage s, with partitions of partSize << 2*s, starts at frame
+   2 * (partSize << 2*s) - partSize of the response, which leaves a
+   whole block of time for the worker at no extra latency. */
+
+typedef struct {
+    CSOUND  *csound;
+    int     nChannels;
+    int     partSize;           /* partition length in sample frames        */
+    int     nPartitions;
+    int     start;              /* first frame of the response covered      */
+    int     cnt;                /* position in the block being filled       */
+    int     rbCnt;              /* ring buffer index                        */
+    uint32_t seq;               /* blocks handed over so far                */
+    uint32_t job;               /* the block handed over last               */
+    MYFLT   *inBuf[2];          /* input blocks, filled and used in turn    */
+    MYFLT   *tmpBuf;
+    MYFLT   *ringBuf;
+    MYFLT   *IR_Data[FTCONV_MAXCHN];
+    MYFLT   *olap[FTCONV_MAXCHN];       /* second half of the last IFFT     */
+    MYFLT   *outBuf[FTCONV_MAXCHN][2];  /* results, played out in turn      */
+    volatile int state;         /* TAIL_IDLE, TAIL_QUEUED or TAIL_BUSY      */
+    volatile int quit;
+    void    *thread;
+    void    *wakeup;
+} FTCONV_TAIL;
 
 typedef struct {
     OPDS    h;
@@ -35,6 +72,7 @@ typedef struct {
     MYFLT   *iSkipSamples;
     MYFLT   *iTotLen;
     MYFLT   *iSkipInit;
+    MYFLT   *iNonUniform;
  /* ------------------------- */
     int     initDone;
     int     nChannels;
@@ -47,6 +85,10 @@ typedef struct {
     MYFLT   *IR_Data[FTCONV_MAXCHN];    /* impulse responses (scaled)       */
     MYFLT   *outBuffers[FTCONV_MAXCHN]; /* output buffer (size=partSize*2)  */
     AUXCH   auxData;
+    int     nTails;             /* tail stages, non-uniform mode only       */
+    MYFLT   *tailMix[FTCONV_MAXCHN];    /* output of the tails (size=ksmps) */
+    FTCONV_TAIL tail[FTCONV_MAXTAIL];
+    AUXCH   auxTail;
 } FTCONV;
 
 static void multiply_fft_buffers(MYFLT *outBuf, MYFLT *ringBuf,
@@ -144,11 +186,262 @@ static void set_buf_pointers(FTCONV *p,
     }
 }
 
+/* FFTs of nPartitions partitions of the impulse response from frame
+   'start' on (skipped samples included), stored in reverse order and
+   scaled for the inverse FFT */
+
+static void load_ir_partitions(CSOUND *csound, FUNC *ftp, MYFLT *IR_Data,
+                               int nChannels, int chn, int partSize,
+                               int nPartitions, int start)
+{
+    MYFLT   FFTscale;
+    int     i, k, n;
+
+    FFTscale = csound->GetInverseRealFFTScale(csound, (partSize << 1));
+    i = (start * nChannels) + chn;              /* table read position */
+    n = (partSize << 1) * (nPartitions - 1);    /* IR write position */
+    do {
+      for (k = 0; k < partSize; k++) {
+        if (i >= 0 && i < (int) ftp->flen)
+          IR_Data[n + k] = ftp->ftable[i] * FFTscale;
+        else
+          IR_Data[n + k] = FL(0.0);
+        i += nChannels;
+      }
+      /* pad second half of IR to zero */
+      for (k = partSize; k < (partSize << 1); k++)
+        IR_Data[n + k] = FL(0.0);
+      /* calculate FFT */
+      csound->RealFFT(csound, &(IR_Data[n]), (partSize << 1));
+      n -= (partSize << 1);
+    } while (n >= 0);
+}
+
+/* split a response of n frames into the head and the tail stages;
+   returns the number of head partitions */
+
+static int tail_layout(FTCONV *p, int n)
+{
+    int     partSize = p->partSize << 2;
+    int     start = (partSize << 1) - p->partSize;
+    int     headParts = (n + (p->partSize - 1)) / p->partSize;
+
+    p->nTails = 0;
+    if (*(p->iNonUniform) == FL(0.0) || n <= start)
+      return headParts;
+    headParts = start / p->partSize;
+    while (start < n) {
+      FTCONV_TAIL *t = &(p->tail[p->nTails++]);
+      int     end = ((partSize << 3) - p->partSize);   /* next start */
+      if (p->nTails == FTCONV_MAXTAIL || end > n)
+        end = n;
+      t->partSize = partSize;
+      t->start = start;
+      t->nPartitions = (end - start + (partSize - 1)) / partSize;
+      start = end;
+      partSize <<= 2;
+    }
+    return headParts;
+}
+
+static int tail_bytes_alloc(FTCONV *p, int ksmps)
+{
+    int     i, nSmps = ksmps * p->nChannels;            /* tailMix */
+
+    if (!p->nTails)
+      return 0;
+    for (i = 0; i < p->nTails; i++) {
+      int   N = p->tail[i].partSize, nParts = p->tail[i].nPartitions;
+      nSmps += (N << 1);                                /* inBuf    */
+      nSmps += (N << 1);                                /* tmpBuf   */
+      nSmps += (N << 1) * nParts;                       /* ringBuf  */
+      nSmps += (N << 1) * nParts * p->nChannels;        /* IR_Data  */
+      nSmps += N * 3 * p->nChannels;                    /* olap, outBuf */
+    }
+    return ((int) sizeof(MYFLT) * nSmps);
+}
+
+static void set_tail_pointers(CSOUND *csound, FTCONV *p, int ksmps)
+{
+    MYFLT   *ptr = (MYFLT*) (p->auxTail.auxp);
+    int     i, j;
+
+    for (j = 0; j < p->nChannels; j++) {
+      p->tailMix[j] = ptr;
+      ptr += ksmps;
+    }
+    for (i = 0; i < p->nTails; i++) {
+      FTCONV_TAIL *t = &(p->tail[i]);
+      int   N = t->partSize;
+      t->csound = csound;
+      t->nChannels = p->nChannels;
+      t->inBuf[0] = ptr;
+      t->inBuf[1] = ptr + N;
+      ptr += (N << 1);
+      t->tmpBuf = ptr;
+      ptr += (N << 1);
+      t->ringBuf = ptr;
+      ptr += (N << 1) * t->nPartitions;
+      for (j = 0; j < p->nChannels; j++) {
+        t->IR_Data[j] = ptr;
+        ptr += (N << 1) * t->nPartitions;
+      }
+      for (j = 0; j < p->nChannels; j++) {
+        t->olap[j] = ptr;
+        t->outBuf[j][0] = ptr + N;
+        t->outBuf[j][1] = ptr + (N << 1);
+        ptr += N * 3;
+      }
+    }
+}
+
+/* convolve the block handed over last, and overlap-add the result */
+
+static void tail_run(FTCONV_TAIL *t)
+{
+    CSOUND  *csound = t->csound;
+    int     i, n, nSamples = t->partSize, rBufPos;
+    MYFLT   *rBuf = &(t->ringBuf[t->rbCnt * (nSamples << 1)]);
+
+    memcpy(rBuf, t->inBuf[t->job & 1], nSamples * sizeof(MYFLT));
+    memset(&rBuf[nSamples], 0, nSamples * sizeof(MYFLT));
+    csound->RealFFT(csound, rBuf, (nSamples << 1));
+    if (++t->rbCnt >= t->nPartitions)
+      t->rbCnt = 0;
+    rBufPos = t->rbCnt * (nSamples << 1);
+    for (n = 0; n < t->nChannels; n++) {
+      MYFLT *x = t->outBuf[n][t->job & 1], *o = t->olap[n];
+      multiply_fft_buffers(t->tmpBuf, t->ringBuf, t->IR_Data[n],
+                           nSamples, t->nPartitions, rBufPos);
+      csound->InverseRealFFT(csound, t->tmpBuf, (nSamples << 1));
+      for (i = 0; i < nSamples; i++) {
+        x[i] = t->tmpBuf[i] + o[i];
+        o[i] = t->tmpBuf[i + nSamples];
+      }
+    }
+}
+
+#ifdef HAVE_ATOMIC_BUILTIN
+/* run the queued block, unless another thread has already taken it */
+
+static int tail_claim(FTCONV_TAIL *t)
+{
+    if (!__sync_bool_compare_and_swap(&(t->state), TAIL_QUEUED, TAIL_BUSY))
+      return 0;
+    tail_run(t);
+    __sync_synchronize();
+    t->state = TAIL_IDLE;
+    return 1;
+}
+
+static uintptr_t tail_thread(void *arg)
+{
+    FTCONV_TAIL *t = (FTCONV_TAIL*) arg;
+    CSOUND      *csound = t->csound;
+
+    while (!t->quit) {
+      /* every hand-over notifies, the timeout is only a safety net */
+      csound->WaitThreadLock(t->wakeup, 100);
+      tail_claim(t);
+    }
+    return 0;
+}
+#endif
+
+/* the result of the block handed over last is due now */
+
+static void tail_sync(CSOUND *csound, FTCONV_TAIL *t)
+{
+#ifdef HAVE_ATOMIC_BUILTIN
+    int     spin = 0;
+    if (t->state == TAIL_IDLE || tail_claim(t)) {
+      __sync_synchronize();
+      return;
+    }
+    while (t->state != TAIL_IDLE) {
+      if (++spin == 1024) {
+        csound->Sleep(0);
+        spin = 0;
+      }
+      __sync_synchronize();
+    }
+#else
+    (void) csound;
+    (void) t;
+#endif
+}
+
+static void tail_start(CSOUND *csound, FTCONV_TAIL *t)
+{
+    t->job = t->seq++;
+    if (t->thread == NULL) {
+      tail_run(t);
+      return;
+    }
+#ifdef HAVE_ATOMIC_BUILTIN
+    __sync_synchronize();
+    t->state = TAIL_QUEUED;
+    csound->NotifyThreadLock(t->wakeup);
+#endif
+}
+
+static int ftconv_deinit(CSOUND *csound, FTCONV *p);
+
+/* start the workers that are not running; every init pass that calls
+   this, including one skipped with iskipinit, registers the deinit
+   callback that stops them, as those are dropped when the note ends */
+static void tail_threads_start(CSOUND *csound, FTCONV *p)
+{
+#ifdef HAVE_ATOMIC_BUILTIN
+    int     i;
+    if (p->nTails > 0)
+      csound->RegisterDeinitCallback(csound, p,
+                                     (int (*)(CSOUND *, void *)) ftconv_deinit);
+    for (i = 0; i < p->nTails; i++) {
+      FTCONV_TAIL *t = &(p->tail[i]);
+      if (t->thread != NULL)
+        continue;
+      t->state = TAIL_IDLE;
+      t->quit = 0;
+      if ((t->wakeup = csound->CreateThreadLock()) == NULL)
+        continue;
+      t->thread = csound->CreateThread(tail_thread, (void*) t);
+      if (t->thread == NULL) {
+        csound->DestroyThreadLock(t->wakeup);
+        t->wakeup = NULL;
+      }
+    }
+#else
+    (void) csound;
+    (void) p;
+#endif
+}
+
+static void tail_threads_stop(CSOUND *csound, FTCONV *p)
+{
+    int     i;
+    for (i = 0; i < FTCONV_MAXTAIL; i++) {
+      FTCONV_TAIL *t = &(p->tail[i]);
+      if (t->thread == NULL)
+        continue;
+      t->quit = 1;
+      csound->NotifyThreadLock(t->wakeup);
+      csound->JoinThread(t->thread);
+      csound->DestroyThreadLock(t->wakeup);
+      t->thread = t->wakeup = NULL;
+    }
+}
+
+static int ftconv_deinit(CSOUND *csound, FTCONV *p)
+{
+    tail_threads_stop(csound, p);
+    return OK;
+}
+
 static int ftconv_init(CSOUND *csound, FTCONV *p)
 {
     FUNC    *ftp;
-    int     i, j, k, n, nBytes, skipSamples;
-    MYFLT   FFTscale;
+    int     i, j, n, nBytes, tailBytes, skipSamples;
 
     /* check parameters */
     p->nChannels = (int) p->OUTOCOUNT;
@@ -175,13 +468,22 @@ static int ftconv_init(CSOUND *csound, FTCONV *p)
                                Str("ftconv: invalid length, or insufficient"
                                    " IR data for convolution"));
     }
-    p->nPartitions = (n + (p->partSize - 1)) / p->partSize;
+    p->nPartitions = tail_layout(p, n);
     /* calculate the amount of aux space to allocate (in bytes) */
     nBytes = buf_bytes_alloc(p->nChannels, p->partSize, p->nPartitions);
+    tailBytes = tail_bytes_alloc(p, (int) CS_KSMPS);
+    if (nBytes == (int) p->auxData.size &&
+        tailBytes == (int) p->auxTail.size &&
+        p->initDone > 0 && *(p->iSkipInit) != FL(0.0)) {
+      tail_threads_start(csound, p);
+      return OK;    /* skip initialisation if requested */
+    }
+    /* the workers must not see the buffers change under them */
+    tail_threads_stop(csound, p);
     if (nBytes != (int) p->auxData.size)
       csound->AuxAlloc(csound, (int32) nBytes, &(p->auxData));
-    else if (p->initDone > 0 && *(p->iSkipInit) != FL(0.0))
-      return OK;    /* skip initialisation if requested */
+    if (p->nTails && tailBytes != (int) p->auxTail.size)
+      csound->AuxAlloc(csound, (int32) tailBytes, &(p->auxTail));
     /* if skipping samples: check for possible truncation of IR */
     if (skipSamples > 0 && (csound->oparms->msglevel & WARNMSG)) {
       n = skipSamples * p->nChannels;
@@ -208,25 +510,23 @@ static int ftconv_init(CSOUND *csound, FTCONV *p)
     p->rbCnt = 0;
     /* calculate FFT of impulse response partitions, in reverse order */
     /* also apply FFT amplitude scale here */
-    FFTscale = csound->GetInverseRealFFTScale(csound, (p->partSize << 1));
-    for (j = 0; j < p->nChannels; j++) {
-      i = (skipSamples * p->nChannels) + j;           /* table read position */
-      n = (p->partSize << 1) * (p->nPartitions - 1);  /* IR write position */
-      do {
-        for (k = 0; k < p->partSize; k++) {
-          if (i >= 0 && i < (int) ftp->flen)
-            p->IR_Data[j][n + k] = ftp->ftable[i] * FFTscale;
-          else
-            p->IR_Data[j][n + k] = FL(0.0);
-          i += p->nChannels;
-        }
-        /* pad second half of IR to zero */
-        for (k = p->partSize; k < (p->partSize << 1); k++)
-          p->IR_Data[j][n + k] = FL(0.0);
-        /* calculate FFT */
-        csound->RealFFT(csound, &(p->IR_Data[j][n]), (p->partSize << 1));
-        n -= (p->partSize << 1);
-      } while (n >= 0);
+    for (j = 0; j < p->nChannels; j++)
+      load_ir_partitions(csound, ftp, p->IR_Data[j], p->nChannels, j,
+                         p->partSize, p->nPartitions, skipSamples);
+    /* same for the tail stages, with their buffers and positions */
+    if (p->nTails) {
+      set_tail_pointers(csound, p, (int) CS_KSMPS);
+      memset(p->auxTail.auxp, 0, p->auxTail.size);
+      for (i = 0; i < p->nTails; i++) {
+        FTCONV_TAIL *t = &(p->tail[i]);
+        for (j = 0; j < p->nChannels; j++)
+          load_ir_partitions(csound, ftp, t->IR_Data[j], p->nChannels, j,
+                             t->partSize, t->nPartitions,
+                             skipSamples + t->start);
+        t->cnt = t->rbCnt = 0;
+        t->seq = t->job = 0;
+      }
+      tail_threads_start(csound, p);
     }
     /* clear output buffers to zero */
     /*memset(p->outBuffers, 0, p->nChannels*(p->partSize << 1)*sizeof(MYFLT));*/
@@ -239,6 +539,39 @@ static int ftconv_init(CSOUND *csound, FTCONV *p)
     return OK;
 }
 
+/* feed a tail stage with this cycle's input, and write what it has to
+   play out to tailMix; the first stage sets tailMix, the others add */
+
+static void tail_perf(CSOUND *csound, FTCONV *p, FTCONV_TAIL *t,
+                      uint32_t offset, uint32_t nsmps)
+{
+    uint32_t nn = offset;
+    int      i, n;
+
+    while (nn < nsmps) {
+      int     m = t->partSize - t->cnt;
+      int     play = (int) ((t->job + 1) & 1);
+      if ((uint32_t) m > nsmps - nn)
+        m = (int) (nsmps - nn);
+      memcpy(&(t->inBuf[t->seq & 1][t->cnt]), &(p->aIn[nn]),
+             m * sizeof(MYFLT));
+      for (n = 0; n < p->nChannels; n++) {
+        MYFLT *y = &(t->outBuf[n][play][t->cnt]), *mix = &(p->tailMix[n][nn]);
+        if (t == p->tail)
+          memcpy(mix, y, m * sizeof(MYFLT));
+        else
+          for (i = 0; i < m; i++)
+            mix[i] += y[i];
+      }
+      nn += m;
+      if ((t->cnt += m) >= t->partSize) {
+        t->cnt = 0;
+        tail_sync(csound, t);
+        tail_start(csound, t);
+      }
+    }
+}
+
 static int ftconv_perf(CSOUND *csound, FTCONV *p)
 {
     MYFLT         *x, *rBuf;
@@ -258,12 +591,19 @@ static int ftconv_perf(CSOUND *csound, FTCONV *p)
       for (n = 0; n < p->nChannels; n++)
         memset(&p->aOut[n][nsmps], '\0', early*sizeof(MYFLT));
     }
+    /* the tail stages go first, as the output may overwrite the input */
+    for (i = 0; i < p->nTails; i++)
+      tail_perf(csound, p, &(p->tail[i]), offset, nsmps);
     for (nn = offset; nn < nsmps; nn++) {
       /* store input signal in buffer */
       rBuf[p->cnt] = p->aIn[nn];
       /* copy output signals from buffer */
-      for (n = 0; n < p->nChannels; n++)
-        p->aOut[n][nn] = p->outBuffers[n][p->cnt];
+      if (p->nTails)
+        for (n = 0; n < p->nChannels; n++)
+          p->aOut[n][nn] = p->outBuffers[n][p->cnt] + p->tailMix[n][nn];
+      else
+        for (n = 0; n < p->nChannels; n++)
+          p->aOut[n][nn] = p->outBuffers[n][p->cnt];
       /* is input buffer full ? */
       if (++p->cnt < nSamples)
         continue;                   /* no, continue with next sample */
@@ -305,7 +645,8 @@ static int ftconv_perf(CSOUND *csound, FTCONV *p)
 int ftconv_init_(CSOUND *csound)
 {
     return csound->AppendOpcode(csound, "ftconv",
-                                (int) sizeof(FTCONV), TR, 5, "mmmmmmmm", "aiiooo",
+                                (int) sizeof(FTCONV), TR, 5,
+                                "mmmmmmmm", "aiioooo",
                                 (int (*)(CSOUND *, void *)) ftconv_init,
                                 (int (*)(CSOUND *, void *)) NULL,
                                 (int (*)(CSOUND *, void *)) ftconv_perf);
@@ -115,17 +115,18 @@ static int wavetable(FGDATA *ff, FUNC *ftp)
     MYFLT   *fp_filter, *pInp, *pBuf;
     MYFLT   order = ff->e.p[6];
     MYFLT   resc = ff->e.p[7];
-    int     ffilno = (int)ff->e.p[5];
     unsigned int     i;
     unsigned int     steps, newLen, *pnewLen;
     int     nargs = ff->e.pcnt - 4;
     int     *pOrder, *xfree;
-    FUNC    *srcfil = csound->flist[ffilno];
+    FUNC    *srcfil = csound->FTnp2Find(csound, &(ff->e.p[5]));
     MYFLT   *mirr;
     WAVELET wave, *pwaveS;
 
     if (UNLIKELY(nargs < 3))
       csound->Warning(csound, Str("insufficient arguments"));
+    if (UNLIKELY(srcfil == NULL))
+      return NOTOK;
     fp_filter = srcfil->ftable;
     newLen  = srcfil->flen;
     mirr = (MYFLT*)malloc(sizeof(MYFLT)*srcfil->flen);
@@ -23,6 +23,7 @@
 
 #include "stdopcod.h"
 #include "oscbnk.h"
+#include "cs_simd.h"
 #include <math.h>
 
 static inline STDOPCOD_GLOBALS *get_oscbnk_globals(CSOUND *csound)
@@ -166,10 +167,11 @@ static MYFLT oscbnk_interp_read_limit(MYFLT phase, MYFLT *ft, int32 flen)
     return x;
 }
 
-/* LFO / modulation */
+/* LFO / modulation of oscillator i */
 
-static void oscbnk_lfo(OSCBNK *p, OSCBNK_OSC *o)
+static void oscbnk_lfo(OSCBNK *p, int i)
 {
+    OSCBNK_OSC  *o = &(p->osc);
     uint32   n;
     int     eqmode;
     MYFLT   f, l, q, k, kk, vk, vkk, vkdq, sq;
@@ -178,47 +180,47 @@ static void oscbnk_lfo(OSCBNK *p, OSCBNK_OSC *o)
     /* lfo1val = LFO1 output, lfo2val = LFO2 output */
 
     if (p->ilfomode & 0xF0) {                       /* LFO 1 */
-      n = o->LFO1phs >> p->l1t_lobits; lfo1val = p->l1t[n++];
+      n = o->LFO1phs[i] >> p->l1t_lobits; lfo1val = p->l1t[n++];
       lfo1val += (p->l1t[n] - lfo1val)
-        * (MYFLT) ((int32) (o->LFO1phs & p->l1t_mask)) * p->l1t_pfrac;
+        * (MYFLT) ((int32) (o->LFO1phs[i] & p->l1t_mask)) * p->l1t_pfrac;
       /* update phase */
-      f = o->LFO1frq * p->lf1_scl + p->lf1_ofs;
-      o->LFO1phs = (o->LFO1phs + OSCBNK_PHS2INT(f)) & OSCBNK_PHSMSK;
+      f = o->LFO1frq[i] * p->lf1_scl + p->lf1_ofs;
+      o->LFO1phs[i] = (o->LFO1phs[i] + OSCBNK_PHS2INT(f)) & OSCBNK_PHSMSK;
     }
 
     if (p->ilfomode & 0x0F) {                       /* LFO 2 */
-      n = o->LFO2phs >> p->l2t_lobits; lfo2val = p->l2t[n++];
+      n = o->LFO2phs[i] >> p->l2t_lobits; lfo2val = p->l2t[n++];
       lfo2val += (p->l2t[n] - lfo2val)
-        * (MYFLT) ((int32) (o->LFO2phs & p->l2t_mask)) * p->l2t_pfrac;
+        * (MYFLT) ((int32) (o->LFO2phs[i] & p->l2t_mask)) * p->l2t_pfrac;
       /* update phase */
-      f = o->LFO2frq * p->lf2_scl + p->lf2_ofs;
-      o->LFO2phs = (o->LFO2phs + OSCBNK_PHS2INT(f)) & OSCBNK_PHSMSK;
+      f = o->LFO2frq[i] * p->lf2_scl + p->lf2_ofs;
+      o->LFO2phs[i] = (o->LFO2phs[i] + OSCBNK_PHS2INT(f)) & OSCBNK_PHSMSK;
     }
 
     /* modulate phase, frequency, and amplitude */
 
-      o->osc_frq = FL(0.0);
+      o->osc_frq[i] = FL(0.0);
     if (p->ilfomode & 0x88) {               /* FM */
-      if (p->ilfomode & 0x80) o->osc_frq += lfo1val;
-      if (p->ilfomode & 0x08) o->osc_frq += lfo2val;
-      o->osc_frq = o->osc_frq * *(p->args[3]);
+      if (p->ilfomode & 0x80) o->osc_frq[i] += lfo1val;
+      if (p->ilfomode & 0x08) o->osc_frq[i] += lfo2val;
+      o->osc_frq[i] = o->osc_frq[i] * *(p->args[3]);
     }
 
     if (p->ilfomode & 0x44) {               /* AM */
-      o->osc_amp = FL(0.0);
-      if (p->ilfomode & 0x40) o->osc_amp += lfo1val;
-      if (p->ilfomode & 0x04) o->osc_amp += lfo2val;
-      o->osc_amp--; o->osc_amp *= *(p->args[2]); o->osc_amp++;
+      o->osc_amp[i] = FL(0.0);
+      if (p->ilfomode & 0x40) o->osc_amp[i] += lfo1val;
+      if (p->ilfomode & 0x04) o->osc_amp[i] += lfo2val;
+      o->osc_amp[i]--; o->osc_amp[i] *= *(p->args[2]); o->osc_amp[i]++;
     }
     else {
-      o->osc_amp = FL(1.0);
+      o->osc_amp[i] = FL(1.0);
     }
 
-    o->osc_phm = FL(0.0);                   /* PM */
+    o->osc_phm[i] = FL(0.0);                   /* PM */
     if (p->ilfomode & 0x22) {
-      if (p->ilfomode & 0x20) o->osc_phm += lfo1val;
-      if (p->ilfomode & 0x02) o->osc_phm += lfo2val;
-      o->osc_phm *= *(p->args[4]);
+      if (p->ilfomode & 0x20) o->osc_phm[i] += lfo1val;
+      if (p->ilfomode & 0x02) o->osc_phm[i] += lfo2val;
+      o->osc_phm[i] *= *(p->args[4]);
     }
 
     if ((eqmode = p->ieqmode) < 0) return;          /* EQ disabled  */
@@ -251,24 +253,25 @@ static void oscbnk_lfo(OSCBNK *p, OSCBNK_OSC *o)
     kk = k * k; vk = l * k; vkk = l * kk; vkdq = vk / q;    /* Q         */
 
     if (eqmode != 0) {
-      o->b0 = FL(1.0) + sq * k + vkk;
-      o->b1 = FL(2.0) * (vkk - FL(1.0));
-      o->b2 = FL(1.0) - sq * k + vkk;
+      o->b0[i] = FL(1.0) + sq * k + vkk;
+      o->b1[i] = FL(2.0) * (vkk - FL(1.0));
+      o->b2[i] = FL(1.0) - sq * k + vkk;
     }
     else {
-      o->b0 = FL(1.0) + vkdq + kk;
-      o->b1 = FL(2.0) * (kk - FL(1.0));
-      o->b2 = FL(1.0) - vkdq + kk;
+      o->b0[i] = FL(1.0) + vkdq + kk;
+      o->b1[i] = FL(2.0) * (kk - FL(1.0));
+      o->b2[i] = FL(1.0) - vkdq + kk;
     }
     l = FL(1.0) + (k / q) + kk;                 /* l = a0 */
-    o->a1 = FL(2.0) * (kk - FL(1.0));
-    o->a2 = FL(1.0) - (k / q) + kk;
+    o->a1[i] = FL(2.0) * (kk - FL(1.0));
+    o->a2[i] = FL(1.0) - (k / q) + kk;
     if (eqmode == 2) {
-      o->a1 = -(o->a1);
-      o->b1 = -(o->b1);
+      o->a1[i] = -(o->a1[i]);
+      o->b1[i] = -(o->b1[i]);
     }
     l = FL(1.0) / l;
-    o->a1 *= l; o->a2 *= l; o->b0 *= l; o->b1 *= l; o->b2 *= l;
+    o->a1[i] *= l; o->a2[i] *= l;
+    o->b0[i] *= l; o->b1[i] *= l; o->b2[i] *= l;
 }
 
 /* ---------------- oscbnk set-up ---------------- */
@@ -369,10 +372,26 @@ static int oscbnkset(CSOUND *csound, OSCBNK *p)
     /* allocate space */
 
     if (p->nr_osc < 1) return OK;
-    i = (uint32_t) p->nr_osc * (int32) sizeof (OSCBNK_OSC);
+    i = (uint32_t) p->nr_osc * (14 * sizeof(MYFLT) + 3 * sizeof(uint32));
     if ((p->auxdata.auxp == NULL) || (p->auxdata.size < i))
       csound->AuxAlloc(csound, i, &(p->auxdata));
-    p->osc = (OSCBNK_OSC *) p->auxdata.auxp;
+    {
+      MYFLT   *fp = (MYFLT *) p->auxdata.auxp;
+      uint32  *up;
+      OSCBNK_OSC  *o = &(p->osc);
+      int     n = p->nr_osc;
+      o->LFO1frq = fp; fp += n;   o->LFO2frq = fp; fp += n;
+      o->osc_phm = fp; fp += n;   o->osc_frq = fp; fp += n;
+      o->osc_amp = fp; fp += n;
+      o->xnm1 = fp; fp += n;      o->xnm2 = fp; fp += n;
+      o->ynm1 = fp; fp += n;      o->ynm2 = fp; fp += n;
+      o->a1 = fp; fp += n;        o->a2 = fp; fp += n;
+      o->b0 = fp; fp += n;        o->b1 = fp; fp += n;
+      o->b2 = fp; fp += n;
+      up = (uint32 *) fp;
+      o->LFO1phs = up; up += n;   o->LFO2phs = up; up += n;
+      o->osc_phs = up;
+    }
 
     memset(p->outft, 0, p->outft_len*sizeof(MYFLT));
 
@@ -380,40 +399,227 @@ static int oscbnkset(CSOUND *csound, OSCBNK *p)
 
     for (i = 0; i < (uint32_t)p->nr_osc; i++) {
       /* oscillator phase */
-      x = oscbnk_rand(p); p->osc[i].osc_phs = OSCBNK_PHS2INT(x);
+      x = oscbnk_rand(p); p->osc.osc_phs[i] = OSCBNK_PHS2INT(x);
       /* LFO1 phase */
-      x = oscbnk_rand(p); p->osc[i].LFO1phs = OSCBNK_PHS2INT(x);
+      x = oscbnk_rand(p); p->osc.LFO1phs[i] = OSCBNK_PHS2INT(x);
       /* LFO1 frequency */
-      p->osc[i].LFO1frq = oscbnk_rand(p);
+      p->osc.LFO1frq[i] = oscbnk_rand(p);
       /* LFO2 phase */
-      x = oscbnk_rand(p); p->osc[i].LFO2phs = OSCBNK_PHS2INT(x);
+      x = oscbnk_rand(p); p->osc.LFO2phs[i] = OSCBNK_PHS2INT(x);
       /* LFO2 frequency */
-      p->osc[i].LFO2frq = oscbnk_rand(p);
+      p->osc.LFO2frq[i] = oscbnk_rand(p);
       /* EQ data */
-      p->osc[i].xnm1 = p->osc[i].xnm2 = FL(0.0);
-      p->osc[i].ynm1 = p->osc[i].ynm2 = FL(0.0);
-      p->osc[i].b0 = FL(1.0);
-      p->osc[i].a1 = p->osc[i].b1 = FL(0.0);
-      p->osc[i].a2 = p->osc[i].b2 = FL(0.0);
+      p->osc.xnm1[i] = p->osc.xnm2[i] = FL(0.0);
+      p->osc.ynm1[i] = p->osc.ynm2[i] = FL(0.0);
+      p->osc.b0[i] = FL(1.0);
+      p->osc.a1[i] = p->osc.b1[i] = FL(0.0);
+      p->osc.a2[i] = p->osc.b2[i] = FL(0.0);
     }
     return OK;
 }
 
 /* ---------------- oscbnk performance ---------------- */
 
+/* The oscillators are rendered in groups of OSCBNK_LANES, a block of   */
+/* up to OSCBNK_BLOCK samples at a time: the table read, amplitude ramp */
+/* and EQ of the group run across the lanes into a buffer that holds    */
+/* OSCBNK_LANES values per sample, and the buffer is then mixed to the  */
+/* output in oscillator order, so the sums are the same as with one     */
+/* oscillator at a time. Unused lanes of the last group have zero state */
+/* and are not mixed. Without AM, a_d is zero and a is 1.               */
+
+#define OSCBNK_LANES    8
+#define OSCBNK_BLOCK    64
+
+typedef struct {
+    uint32  ph[OSCBNK_LANES], f_i[OSCBNK_LANES];
+    MYFLT   a[OSCBNK_LANES], a_d[OSCBNK_LANES];
+    MYFLT   a1[OSCBNK_LANES], a2[OSCBNK_LANES];
+    MYFLT   b0[OSCBNK_LANES], b1[OSCBNK_LANES], b2[OSCBNK_LANES];
+    MYFLT   a1_d[OSCBNK_LANES], a2_d[OSCBNK_LANES];
+    MYFLT   b0_d[OSCBNK_LANES], b1_d[OSCBNK_LANES], b2_d[OSCBNK_LANES];
+    MYFLT   xnm1[OSCBNK_LANES], xnm2[OSCBNK_LANES];
+    MYFLT   ynm1[OSCBNK_LANES], ynm2[OSCBNK_LANES];
+} OSCBNK_GROUP;
+
+/* render nsmps samples of a group to buf; eqmode is 0 (no EQ), 1 (EQ)  */
+/* or 2 (EQ with coefficient interpolation)                             */
+
+#if defined(CS_VEC) && defined(USE_DOUBLE)
+
+/* With GCC vector types the lanes are done CS_DLEN at a time, one      */
+/* vector of them for the whole block before the next. The table is    */
+/* read a pair of points per lane, found from a scalar copy of the      */
+/* phases; the fraction comes from a vector copy: a phase below 2^52    */
+/* ORed into the bits of 2^52 gives 2^52 + phase as a double.           */
+
+typedef uint64_t oscbnk_phs_t __attribute__((vector_size(32)));
+typedef double oscbnk_pair_t __attribute__((vector_size(16)));
+
+#define OSCBNK_VECS     (OSCBNK_LANES / CS_DLEN)
+#define OSCBNK_2P52     4503599627370496.0          /* 2^52 */
+#define OSCBNK_LOAD(x, y)   memcpy(&(x), (y) + v * CS_DLEN, sizeof(x))
+#define OSCBNK_STORE(x, y)  memcpy((y) + v * CS_DLEN, &(x), sizeof(x))
+
+/* lanes i, j, k and l of x and y, where 0 to 3 are x and 4 to 7 are y; */
+/* clang has __builtin_shufflevector instead of __builtin_shuffle        */
+#if defined(__clang__)
+#  define OSCBNK_SHUFFLE(x, y, i, j, k, l)                              \
+    __builtin_shufflevector(x, y, i, j, k, l)
+#else
+#  define OSCBNK_SHUFFLE(x, y, i, j, k, l)                              \
+    __builtin_shuffle(x, y, (cs_dmask_t) { i, j, k, l })
+#endif
+
+/* k = table value at phase ph, and advance ph */
+#define OSCBNK_READ(k)                                                  \
+    do {                                                                \
+      oscbnk_pair_t p0_, p1_, p2_, p3_;                                 \
+      cs_dvec_t     lo_, hi_;                                           \
+      memcpy(&p0_, ft + (ph0 >> lobits), sizeof(p0_));                  \
+      memcpy(&p1_, ft + (ph1 >> lobits), sizeof(p1_));                  \
+      memcpy(&p2_, ft + (ph2 >> lobits), sizeof(p2_));                  \
+      memcpy(&p3_, ft + (ph3 >> lobits), sizeof(p3_));                  \
+      lo_ = (cs_dvec_t) { p0_[0], p0_[1], p2_[0], p2_[1] };             \
+      hi_ = (cs_dvec_t) { p1_[0], p1_[1], p3_[0], p3_[1] };             \
+      k = OSCBNK_SHUFFLE(lo_, hi_, 0, 4, 2, 6);                         \
+      hi_ = OSCBNK_SHUFFLE(lo_, hi_, 1, 5, 3, 7);                       \
+      k += (hi_ - k) * ((cs_dvec_t) ((ph & mask) | p52) - two52) * pfrac; \
+      ph = (ph + f_i) & OSCBNK_PHSMSK;                                  \
+      ph0 = (ph0 + f0) & OSCBNK_PHSMSK;                                 \
+      ph1 = (ph1 + f1) & OSCBNK_PHSMSK;                                 \
+      ph2 = (ph2 + f2) & OSCBNK_PHSMSK;                                 \
+      ph3 = (ph3 + f3) & OSCBNK_PHSMSK;                                 \
+    } while (0)
+
+CS_CLONES
+static void oscbnk_lanes(OSCBNK_GROUP *lp, MYFLT *buf, const MYFLT *ft,
+                         uint32 lobits, uint32 mask, MYFLT pfrac,
+                         int eqmode, int nsmps)
+{
+    const cs_dvec_t     two52 = { OSCBNK_2P52, OSCBNK_2P52,
+                                  OSCBNK_2P52, OSCBNK_2P52 };
+    const oscbnk_phs_t  p52 = (oscbnk_phs_t) two52;
+    oscbnk_phs_t  ph, f_i;
+    uint32      ph0, ph1, ph2, ph3, f0, f1, f2, f3;
+    cs_dvec_t   a, a_d, a1, a2, b0, b1, b2, a1_d, a2_d, b0_d, b1_d, b2_d;
+    cs_dvec_t   xnm1, xnm2, ynm1, ynm2, k, yn;
+    MYFLT       *bp;
+    int         nn, v;
+
+    for (v = 0; v < OSCBNK_VECS; v++) {
+      ph0 = lp->ph[v * CS_DLEN];     ph1 = lp->ph[v * CS_DLEN + 1];
+      ph2 = lp->ph[v * CS_DLEN + 2]; ph3 = lp->ph[v * CS_DLEN + 3];
+      f0 = lp->f_i[v * CS_DLEN];     f1 = lp->f_i[v * CS_DLEN + 1];
+      f2 = lp->f_i[v * CS_DLEN + 2]; f3 = lp->f_i[v * CS_DLEN + 3];
+      ph = (oscbnk_phs_t) { ph0, ph1, ph2, ph3 };
+      f_i = (oscbnk_phs_t) { f0, f1, f2, f3 };
+      OSCBNK_LOAD(a, lp->a); OSCBNK_LOAD(a_d, lp->a_d);
+      bp = buf + v * CS_DLEN;
+      if (!eqmode) {
+        for (nn = 0; nn < nsmps; nn++, bp += OSCBNK_LANES) {
+          OSCBNK_READ(k);
+          /* amplitude modulation */
+          k *= (a += a_d);
+          memcpy(bp, &k, sizeof(k));
+        }
+      }
+      else {
+        OSCBNK_LOAD(a1, lp->a1); OSCBNK_LOAD(a2, lp->a2);
+        OSCBNK_LOAD(b0, lp->b0); OSCBNK_LOAD(b1, lp->b1);
+        OSCBNK_LOAD(b2, lp->b2);
+        OSCBNK_LOAD(xnm1, lp->xnm1); OSCBNK_LOAD(xnm2, lp->xnm2);
+        OSCBNK_LOAD(ynm1, lp->ynm1); OSCBNK_LOAD(ynm2, lp->ynm2);
+        if (eqmode == 2) {      /* EQ w/ interpolation */
+          OSCBNK_LOAD(a1_d, lp->a1_d); OSCBNK_LOAD(a2_d, lp->a2_d);
+          OSCBNK_LOAD(b0_d, lp->b0_d); OSCBNK_LOAD(b1_d, lp->b1_d);
+          OSCBNK_LOAD(b2_d, lp->b2_d);
+          for (nn = 0; nn < nsmps; nn++, bp += OSCBNK_LANES) {
+            /* update ramps */
+            a1 += a1_d; a2 += a2_d;
+            b0 += b0_d; b1 += b1_d; b2 += b2_d;
+            OSCBNK_READ(k);
+            /* amplitude modulation */
+            k *= (a += a_d);
+            /* EQ */
+            yn = b2 * xnm2; yn += b1 * (xnm2 = xnm1); yn += b0 * (xnm1 = k);
+            yn -= a2 * ynm2; yn -= a1 * (ynm2 = ynm1); ynm1 = yn;
+            memcpy(bp, &yn, sizeof(yn));
+          }
+          OSCBNK_STORE(a1, lp->a1); OSCBNK_STORE(a2, lp->a2);
+          OSCBNK_STORE(b0, lp->b0); OSCBNK_STORE(b1, lp->b1);
+          OSCBNK_STORE(b2, lp->b2);
+        }
+        else {                  /* EQ w/o interpolation */
+          for (nn = 0; nn < nsmps; nn++, bp += OSCBNK_LANES) {
+            OSCBNK_READ(k);
+            /* amplitude modulation */
+            k *= (a += a_d);
+            /* EQ */
+            yn = b2 * xnm2; yn += b1 * (xnm2 = xnm1); yn += b0 * (xnm1 = k);
+            yn -= a2 * ynm2; yn -= a1 * (ynm2 = ynm1); ynm1 = yn;
+            memcpy(bp, &yn, sizeof(yn));
+          }
+        }
+        OSCBNK_STORE(xnm1, lp->xnm1); OSCBNK_STORE(xnm2, lp->xnm2);
+        OSCBNK_STORE(ynm1, lp->ynm1); OSCBNK_STORE(ynm2, lp->ynm2);
+      }
+      OSCBNK_STORE(a, lp->a);
+      lp->ph[v * CS_DLEN] = ph0;     lp->ph[v * CS_DLEN + 1] = ph1;
+      lp->ph[v * CS_DLEN + 2] = ph2; lp->ph[v * CS_DLEN + 3] = ph3;
+    }
+}
+
+#else
+
+static void oscbnk_lanes(OSCBNK_GROUP *lp, MYFLT *buf, const MYFLT *ft,
+                         uint32 lobits, uint32 mask, MYFLT pfrac,
+                         int eqmode, int nsmps)
+{
+    OSCBNK_GROUP    l = *lp;    /* local copy, so that buf cannot alias */
+    int     nn, j;
+
+    for (nn = 0; nn < nsmps; nn++, buf += OSCBNK_LANES) {
+      for (j = 0; j < OSCBNK_LANES; j++) {
+        uint32  ph = l.ph[j], n = ph >> lobits;
+        MYFLT   yn, k = ft[n++];
+        if (eqmode == 2) {      /* update ramps */
+          l.a1[j] += l.a1_d[j]; l.a2[j] += l.a2_d[j];
+          l.b0[j] += l.b0_d[j]; l.b1[j] += l.b1_d[j]; l.b2[j] += l.b2_d[j];
+        }
+        /* read from table */
+        k += (ft[n] - k) * (MYFLT) ((int32) (ph & mask)) * pfrac;
+        /* amplitude modulation */
+        k *= (l.a[j] += l.a_d[j]);
+        if (eqmode) {           /* EQ */
+          yn = l.b2[j] * l.xnm2[j]; yn += l.b1[j] * (l.xnm2[j] = l.xnm1[j]);
+          yn += l.b0[j] * (l.xnm1[j] = k);
+          yn -= l.a2[j] * l.ynm2[j]; yn -= l.a1[j] * (l.ynm2[j] = l.ynm1[j]);
+          k = l.ynm1[j] = yn;
+        }
+        buf[j] = k;
+        /* update phase */
+        l.ph[j] = (ph + l.f_i[j]) & OSCBNK_PHSMSK;
+      }
+    }
+    *lp = l;
+}
+
+#endif
+
 static int oscbnk(CSOUND *csound, OSCBNK *p)
 {
-    int     osc_cnt, pm_enabled, am_enabled;
+    int     osc_cnt, pm_enabled, am_enabled, eqmode, first, cnt, j;
     FUNC    *ftp;
-    MYFLT   *ft;
-    uint32   n, lobits, mask, ph, f_i;
+    MYFLT   *ft, *aout;
+    uint32   lobits, mask, ph;
     MYFLT   pfrac, pm, a, f, a1, a2, b0, b1, b2;
-    MYFLT   k, a_d = FL(0.0), a1_d, a2_d, b0_d, b1_d, b2_d;
-    MYFLT   yn, xnm1, xnm2, ynm1, ynm2;
     OSCBNK_OSC      *o;
+    OSCBNK_GROUP    l;
+    MYFLT   buf[OSCBNK_BLOCK * OSCBNK_LANES];
     uint32_t offset = p->h.insdshead->ksmps_offset;
     uint32_t early  = p->h.insdshead->ksmps_no_end;
-    uint32_t nn, nsmps = CS_KSMPS;
+    uint32_t nn, n, m, nsmps = CS_KSMPS;
 
     /* clear output signal */
     memset(p->args[0], '\0', nsmps*sizeof(MYFLT));
@@ -421,7 +627,7 @@ static int oscbnk(CSOUND *csound, OSCBNK *p)
     if (p->nr_osc == -1) {
       return OK;         /* nothing to render */
     }
-    else if (UNLIKELY((p->seed == 0L) || (p->osc == NULL))) goto err1;
+    else if (UNLIKELY((p->seed == 0L) || (p->osc.osc_phs == NULL))) goto err1;
 
     /* check oscillator ftable */
 
@@ -433,6 +639,7 @@ static int oscbnk(CSOUND *csound, OSCBNK *p)
     /* some constants */
     pm_enabled = (p->ilfomode & 0x22 ? 1 : 0);
     am_enabled = (p->ilfomode & 0x44 ? 1 : 0);
+    eqmode = (p->ieqmode < 0 ? 0 : (p->eq_interp ? 2 : 1));
     p->frq_scl = csound->onedsr;                      /* osc. freq.   */
     p->lf1_scl = (*(p->args[8]) - *(p->args[7])) * CS_ONEDKR;
     p->lf1_ofs = *(p->args[7]) * CS_ONEDKR;      /* LFO1 freq.   */
@@ -446,104 +653,82 @@ static int oscbnk(CSOUND *csound, OSCBNK *p)
     }
 
     if (UNLIKELY(early)) nsmps -= early;
-    for (osc_cnt = 0, o = p->osc; osc_cnt < p->nr_osc; osc_cnt++, o++) {
-      if (p->init_k) oscbnk_lfo(p, o);
-      ph = o->osc_phs;                        /* phase        */
-      pm = o->osc_phm;                        /* phase mod.   */
-      if ((p->init_k) && (pm_enabled)) {
-        f = pm - (MYFLT) ((int32) pm);
-        ph = (ph + OSCBNK_PHS2INT(f)) & OSCBNK_PHSMSK;
-      }
-      a = o->osc_amp;                         /* amplitude    */
-      f = o->osc_frq;                         /* frequency    */
-      if (p->ieqmode < 0) {           /* EQ disabled */
-        oscbnk_lfo(p, o);
+    o = &(p->osc);
+    aout = p->args[0];
+    for (first = 0; first < p->nr_osc; first += OSCBNK_LANES) {
+      cnt = p->nr_osc - first;
+      if (cnt > OSCBNK_LANES) cnt = OSCBNK_LANES;
+      memset(&l, 0, sizeof(OSCBNK_GROUP));
+      /* k-rate set-up of each oscillator in the group */
+      for (j = 0; j < cnt; j++) {
+        osc_cnt = first + j;
+        if (p->init_k) oscbnk_lfo(p, osc_cnt);
+        ph = o->osc_phs[osc_cnt];                 /* phase        */
+        pm = o->osc_phm[osc_cnt];                 /* phase mod.   */
+        if ((p->init_k) && (pm_enabled)) {
+          f = pm - (MYFLT) ((int32) pm);
+          ph = (ph + OSCBNK_PHS2INT(f)) & OSCBNK_PHSMSK;
+        }
+        a = o->osc_amp[osc_cnt];                  /* amplitude    */
+        f = o->osc_frq[osc_cnt];                  /* frequency    */
+        a1 = o->a1[osc_cnt]; a2 = o->a2[osc_cnt]; /* EQ coeffs    */
+        b0 = o->b0[osc_cnt]; b1 = o->b1[osc_cnt]; b2 = o->b2[osc_cnt];
+        oscbnk_lfo(p, osc_cnt);
         /* initialise ramps */
-        f = ((o->osc_frq + f) * FL(0.5) + *(p->args[1])) * p->frq_scl;
+        f = ((o->osc_frq[osc_cnt] + f) * FL(0.5) + *(p->args[1]))
+            * p->frq_scl;
         if (pm_enabled) {
-          f += (MYFLT) ((double) o->osc_phm - (double) pm) / (nsmps-offset);
+          f += (MYFLT) ((double) o->osc_phm[osc_cnt] - (double) pm)
+               / (nsmps-offset);
           f -= (MYFLT) ((int32) f);
         }
-        f_i = OSCBNK_PHS2INT(f);
-        if (am_enabled) a_d = (o->osc_amp - a)  / (nsmps-offset);
-        /* oscillator */
-        for (nn = offset; nn < nsmps; nn++) {
-          /* read from table */
-          n = ph >> lobits; k = ft[n++];
-          k += (ft[n] - k) * (MYFLT) ((int32) (ph & mask)) * pfrac;
-          /* amplitude modulation */
-          if (am_enabled) k *= (a += a_d);
-          /* mix to output */
-          p->args[0][nn] += k;
-          /* update phase */
-          ph = (ph + f_i) & OSCBNK_PHSMSK;
+        l.ph[j] = ph;
+        l.f_i[j] = OSCBNK_PHS2INT(f);
+        l.a[j] = a;
+        if (am_enabled)
+          l.a_d[j] = (o->osc_amp[osc_cnt] - a) / (nsmps-offset);
+        if (eqmode) {
+          l.a1[j] = a1; l.a2[j] = a2;
+          l.b0[j] = b0; l.b1[j] = b1; l.b2[j] = b2;
+          if (eqmode == 2) {      /* EQ w/ interpolation */
+            l.a1_d[j] = (o->a1[osc_cnt] - a1) / (nsmps-offset);
+            l.a2_d[j] = (o->a2[osc_cnt] - a2) / (nsmps-offset);
+            l.b0_d[j] = (o->b0[osc_cnt] - b0) / (nsmps-offset);
+            l.b1_d[j] = (o->b1[osc_cnt] - b1) / (nsmps-offset);
+            l.b2_d[j] = (o->b2[osc_cnt] - b2) / (nsmps-offset);
+          }
+          l.xnm1[j] = o->xnm1[osc_cnt]; l.xnm2[j] = o->xnm2[osc_cnt];
+          l.ynm1[j] = o->ynm1[osc_cnt]; l.ynm2[j] = o->ynm2[osc_cnt];
         }
       }
-      else {                        /* EQ enabled */
-        a1 = o->a1; a2 = o->a2;         /* EQ coeffs    */
-        b0 = o->b0; b1 = o->b1; b2 = o->b2;
-        xnm1 = o->xnm1; xnm2 = o->xnm2;
-        ynm1 = o->ynm1; ynm2 = o->ynm2;
-        oscbnk_lfo(p, o);
-        /* initialise ramps */
-        f = ((o->osc_frq + f) * FL(0.5) + *(p->args[1])) * p->frq_scl;
-        if (pm_enabled) {
-          f += (MYFLT) ((double) o->osc_phm - (double) pm) / (nsmps-offset);
-          f -= (MYFLT) ((int32) f);
+      /* oscillators */
+      for (nn = offset; nn < nsmps; nn += n) {
+        n = nsmps - nn;
+        if (n > OSCBNK_BLOCK) n = OSCBNK_BLOCK;
+        oscbnk_lanes(&l, buf, ft, lobits, mask, pfrac, eqmode, (int) n);
+        /* mix to output */
+        for (m = 0; m < n; m++) {
+          MYFLT *bp = buf + m * OSCBNK_LANES, y = aout[nn + m];
+          for (j = 0; j < cnt; j++)
+            y += bp[j];
+          aout[nn + m] = y;
         }
-        f_i = OSCBNK_PHS2INT(f);
-        if (am_enabled) a_d = (o->osc_amp - a) / (nsmps-offset);
-        if (p->eq_interp) {     /* EQ w/ interpolation */
-          a1_d = (o->a1 - a1) / (nsmps-offset);
-          a2_d = (o->a2 - a2) / (nsmps-offset);
-          b0_d = (o->b0 - b0) / (nsmps-offset);
-          b1_d = (o->b1 - b1) / (nsmps-offset);
-          b2_d = (o->b2 - b2) / (nsmps-offset);
-          /* oscillator */
-          for (nn = offset; nn < nsmps; nn++) {
-            /* update ramps */
-            a1 += a1_d; a2 += a2_d;
-            b0 += b0_d; b1 += b1_d; b2 += b2_d;
-            /* read from table */
-            n = ph >> lobits; k = ft[n++];
-            k += (ft[n] - k) * (MYFLT) ((int32) (ph & mask)) * pfrac;
-            /* amplitude modulation */
-            if (am_enabled) k *= (a += a_d);
-            /* EQ */
-            yn = b2 * xnm2; yn += b1 * (xnm2 = xnm1); yn += b0 * (xnm1 = k);
-            yn -= a2 * ynm2; yn -= a1 * (ynm2 = ynm1); ynm1 = yn;
-            /* mix to output */
-            p->args[0][nn] += yn;
-            /* update phase */
-            ph = (ph + f_i) & OSCBNK_PHSMSK;
-          }
-          /* save EQ coeffs */
-          o->a1 = a1; o->a2 = a2;
-          o->b0 = b0; o->b1 = b1; o->b2 = b2;
+      }
+      /* save amplitude, phase, and EQ state */
+      for (j = 0; j < cnt; j++) {
+        osc_cnt = first + j;
+        o->osc_amp[osc_cnt] = l.a[j];
+        o->osc_phs[osc_cnt] = l.ph[j];
+        if (eqmode) {
+          o->xnm1[osc_cnt] = l.xnm1[j]; o->xnm2[osc_cnt] = l.xnm2[j];
+          o->ynm1[osc_cnt] = l.ynm1[j]; o->ynm2[osc_cnt] = l.ynm2[j];
         }
-        else {                /* EQ w/o interpolation */
-          /* oscillator */
-          for (nn = offset; nn < nsmps; nn++) {
-            /* read from table */
-            n = ph >> lobits; k = ft[n++];
-            k += (ft[n] - k) * (MYFLT) ((int32) (ph & mask)) * pfrac;
-            /* amplitude modulation */
-            if (am_enabled) k *= (a += a_d);
-            /* EQ */
-            yn = b2 * xnm2; yn += b1 * (xnm2 = xnm1); yn += b0 * (xnm1 = k);
-            yn -= a2 * ynm2; yn -= a1 * (ynm2 = ynm1); ynm1 = yn;
-            /* mix to output */
-            p->args[0][nn] += yn;
-            /* update phase */
-            ph = (ph + f_i) & OSCBNK_PHSMSK;
-          }
+        if (eqmode == 2) {      /* save EQ coeffs */
+          o->a1[osc_cnt] = l.a1[j]; o->a2[osc_cnt] = l.a2[j];
+          o->b0[osc_cnt] = l.b0[j]; o->b1[osc_cnt] = l.b1[j];
+          o->b2[osc_cnt] = l.b2[j];
         }
-        o->xnm1 = xnm1; o->xnm2 = xnm2; /* save EQ state */
-        o->ynm1 = ynm1; o->ynm2 = ynm2;
       }
-      /* save amplitude and phase */
-      o->osc_amp = a;
-      o->osc_phs = ph;
     }
     p->init_k = 0;
     return OK;
@@ -589,10 +774,14 @@ static int grain2set(CSOUND *csound, GRAIN2 *p)
     /* allocate space */
 
     if (p->nr_osc == -1) return OK;                 /* no oscillators */
-    n = (uint32_t) p->nr_osc * (int32) sizeof(GRAIN2_OSC);
+    n = (uint32_t) p->nr_osc * (int32) (2 * sizeof(GRAIN2_OSC)
+                                        + 2 * sizeof(int32));
     if ((p->auxdata.auxp == NULL) || (p->auxdata.size < n))
       csound->AuxAlloc(csound, n, &(p->auxdata));
     p->osc = (GRAIN2_OSC *) p->auxdata.auxp;
+    p->grain = p->osc + p->nr_osc;
+    p->ev_smp = (int32 *) (p->grain + p->nr_osc);
+    p->ev_ord = p->ev_smp + p->nr_osc;
 
     /* initialise oscillators */
 
@@ -654,27 +843,99 @@ static void grain2_init_grain(GRAIN2 *p, GRAIN2_OSC *o)
 
 /* ---- grain2 opcode ---- */
 
+/* grain2 renders one oscillator at a time, GRAIN2_BLOCK samples at a   */
+/* time, with the phases of a block found by multiplication. The window */
+/* phase does not depend on the grain, so the samples where new grains  */
+/* start are found first, for a span of at most GRAIN2_SPAN samples in  */
+/* which no oscillator starts more than one; the new grains are then    */
+/* drawn in order of sample and oscillator, as a sample by sample loop  */
+/* would do, and the oscillators are mixed in order.                    */
+
+#define GRAIN2_BLOCK    64
+#define GRAIN2_SPAN     256
+
+typedef struct {
+    const MYFLT *ft;            /* table, its mask etc., and        */
+    uint32  lobits, mask;       /* interpolation (0: no, 1: yes)    */
+    MYFLT   pfrac;
+    int     interp;
+} GRAIN2_TAB;
+
+/* read n values from a table at phases ph */
+
+static inline void grain2_read(MYFLT *y, const GRAIN2_TAB *t,
+                               const uint32 *ph, int n)
+{
+    const MYFLT *ft = t->ft;
+    uint32  lobits = t->lobits, mask = t->mask;
+    MYFLT   pfrac = t->pfrac;
+    int     i;
+
+    if (t->interp) {
+      for (i = 0; i < n; i++) {
+        uint32  m = ph[i] >> lobits;
+        MYFLT   k = ft[m];
+        y[i] = k + (ft[m + 1] - k) * (MYFLT) ((int32) (ph[i] & mask)) * pfrac;
+      }
+    }
+    else {
+      for (i = 0; i < n; i++)
+        y[i] = ft[ph[i] >> lobits];
+    }
+}
+
+/* mix n samples of a grain, with its window, to out */
+
+CS_CLONES
+static void grain2_mix(MYFLT *out, const GRAIN2_TAB *gt, const GRAIN2_TAB *wt,
+                       uint32 g_phs, uint32 g_frq, uint32 w_phs, uint32 w_frq,
+                       int n)
+{
+    uint32  ph[GRAIN2_BLOCK];
+    MYFLT   k[GRAIN2_BLOCK], a[GRAIN2_BLOCK];
+    int     i, m;
+
+    for ( ; n > 0; n -= m, out += m) {
+      m = (n < GRAIN2_BLOCK ? n : GRAIN2_BLOCK);
+      /* grain waveform */
+      for (i = 0; i < m; i++)
+        ph[i] = (g_phs + (uint32) i * g_frq) & OSCBNK_PHSMSK;
+      grain2_read(k, gt, ph, m);
+      /* window waveform */
+      for (i = 0; i < m; i++)
+        ph[i] = w_phs + (uint32) i * w_frq;
+      grain2_read(a, wt, ph, m);
+      /* mix to output */
+      for (i = 0; i < m; i++)
+        out[i] += a[i] * k[i];
+      g_phs = (g_phs + (uint32) m * g_frq) & OSCBNK_PHSMSK;
+      w_phs += (uint32) m * w_frq;
+    }
+}
+
 static int grain2(CSOUND *csound, GRAIN2 *p)
 {
     uint32_t offset = p->h.insdshead->ksmps_offset;
     uint32_t early  = p->h.insdshead->ksmps_no_end;
     uint32_t nn, nsmps = CS_KSMPS;
-    int         i, w_interp, g_interp, f_nolock;
-    MYFLT       *aout, *ft, *w_ft, grain_frq, frq_scl, pfrac, w_pfrac, f, a, k;
-    uint32 n, mask, lobits, w_mask, w_lobits;
-    uint32 g_frq, w_frq;
-    GRAIN2_OSC  *o;
+    int         i, f_nolock, nev;
+    MYFLT       *aout, grain_frq, frq_scl, f;
+    uint32 g_frq, w_frq, w_phs, span, len, t;
+    int32       cnt[GRAIN2_SPAN + 1];
+    GRAIN2_OSC  *o, *g;
+    GRAIN2_TAB  gt, wt;
     FUNC        *ftp;
 
     /* assign object data to local variables */
 
     aout     = p->ar;                   /* audio output                 */
     o        = p->osc;                  /* oscillator array             */
-    w_interp = (p->mode & 8 ? 1 : 0);   /* interpolate window   */
-    g_interp = (p->mode & 4 ? 0 : 1);   /* interpolate grain    */
     f_nolock = (p->mode & 2 ? 1 : 0);   /* don't lock grain frq */
-    w_ft     = p->wft;                  /* window ftable                */
-    w_mask   = p->wft_mask; w_lobits = p->wft_lobits; w_pfrac = p->wft_pfrac;
+    wt.ft    = p->wft;                  /* window ftable                */
+    wt.mask  = p->wft_mask; wt.lobits = p->wft_lobits;
+    wt.pfrac = p->wft_pfrac;
+    wt.interp = (p->mode & 8 ? 1 : 0);  /* interpolate window   */
+    gt.interp = (p->mode & 4 ? 0 : 1);  /* interpolate grain    */
 
     /* clear output signal */
     memset(aout, 0, nsmps*sizeof(MYFLT));
@@ -688,8 +949,9 @@ static int grain2(CSOUND *csound, GRAIN2 *p)
     /* check grain ftable */
 
     ftp = csound->FTFindP(csound, p->kfn);
-    if (UNLIKELY((ftp == NULL) || ((ft = ftp->ftable) == NULL))) return NOTOK;
-    oscbnk_flen_setup(ftp->flen, &mask, &lobits, &pfrac);
+    if (UNLIKELY((ftp == NULL) || ((gt.ft = ftp->ftable) == NULL)))
+      return NOTOK;
+    oscbnk_flen_setup(ftp->flen, &gt.mask, &gt.lobits, &gt.pfrac);
 
     p->grain_frq = grain_frq = *(p->kcps) * csound->onedsr; /* grain freq. */
     p->frq_scl   = frq_scl = *(p->kfmd) * csound->onedsr;
@@ -714,36 +976,67 @@ static int grain2(CSOUND *csound, GRAIN2 *p)
         o[i].grain_frq_int = OSCBNK_PHS2INT(f);
       }
     }
-    aout = p->ar;                       /* audio output         */
-    for (nn = offset; nn<nsmps; nn++) {
-      i = p->nr_osc;
-      do {
-        /* grain waveform */
-        n = o->grain_phs >> lobits; k = ft[n++];
-        if (g_interp)
-          k += (ft[n] - k) * (MYFLT) ((int32) (o->grain_phs & mask)) * pfrac;
-        o->grain_phs += o->grain_frq_int;
-        o->grain_phs &= OSCBNK_PHSMSK;
-        /* window waveform */
-        n = o->window_phs >> w_lobits; a = w_ft[n++];
-        if (w_interp)
-          a += (w_ft[n] - a) * (MYFLT) ((int32) (o->window_phs & w_mask))
-               * w_pfrac;
-        o->window_phs += w_frq;
-        /* mix to output */
-        aout[nn] += a * k;
-        if (o->window_phs >= OSCBNK_PHSMAX) {
-          o->window_phs &= OSCBNK_PHSMSK;       /* new grain    */
-          grain2_init_grain(p, o);
-          /* grain frequency */
-          if (f_nolock) {
-            f = grain_frq + frq_scl * o->grain_frq_flt;
-            o->grain_frq_int = OSCBNK_PHS2INT(f);
+
+    /* in span samples, a window phase below OSCBNK_PHSMAX grows by at  */
+    /* most OSCBNK_PHSMAX, and so wraps at most once                    */
+    span = (w_frq ? OSCBNK_PHSMAX / w_frq : GRAIN2_SPAN);
+    if (span > GRAIN2_SPAN) span = GRAIN2_SPAN;
+    for (nn = offset; nn < nsmps; nn += len) {
+      len = nsmps - nn;
+      if (len > span) len = span;
+      /* find the samples where new grains start, and sort by sample */
+      memset(cnt, 0, (len + 1) * sizeof(int32));
+      nev = 0;
+      for (i = 0; i < p->nr_osc; i++) {
+        p->ev_smp[i] = -1;
+        if (w_frq) {
+          t = (OSCBNK_PHSMAX - o[i].window_phs + w_frq - 1) / w_frq;
+          if (t <= len) {
+            p->ev_smp[i] = (int32) t - 1; cnt[t]++; nev++;
           }
         }
-        o++;            /* next grain */
-      } while (--i);
-      o -= p->nr_osc;
+      }
+      for (t = 1; t < len; t++)
+        cnt[t] += cnt[t - 1];
+      for (i = 0; i < p->nr_osc; i++) {
+        if (p->ev_smp[i] >= 0)
+          p->ev_ord[cnt[p->ev_smp[i]]++] = i;
+      }
+      /* new grains */
+      for (i = 0; i < nev; i++) {
+        g = p->grain + p->ev_ord[i];
+        grain2_init_grain(p, g);
+        /* grain frequency */
+        if (f_nolock) {
+          f = grain_frq + frq_scl * g->grain_frq_flt;
+          g->grain_frq_int = OSCBNK_PHS2INT(f);
+        }
+      }
+      /* render and mix the oscillators */
+      for (i = 0; i < p->nr_osc; i++) {
+        w_phs = o[i].window_phs;
+        if (p->ev_smp[i] < 0) {
+          grain2_mix(aout + nn, &gt, &wt, o[i].grain_phs, o[i].grain_frq_int,
+                     w_phs, w_frq, (int) len);
+          o[i].grain_phs =
+            (o[i].grain_phs + len * o[i].grain_frq_int) & OSCBNK_PHSMSK;
+          o[i].window_phs = w_phs + len * w_frq;
+        }
+        else {
+          t = (uint32) p->ev_smp[i] + 1;      /* samples of old grain */
+          grain2_mix(aout + nn, &gt, &wt, o[i].grain_phs, o[i].grain_frq_int,
+                     w_phs, w_frq, (int) t);
+          w_phs = (w_phs + t * w_frq) & OSCBNK_PHSMSK;     /* new grain */
+          g = p->grain + i;
+          o[i].grain_frq_int = g->grain_frq_int;
+          if (f_nolock) o[i].grain_frq_flt = g->grain_frq_flt;
+          grain2_mix(aout + nn + t, &gt, &wt, g->grain_phs, g->grain_frq_int,
+                     w_phs, w_frq, (int) (len - t));
+          o[i].grain_phs =
+            (g->grain_phs + (len - t) * g->grain_frq_int) & OSCBNK_PHSMSK;
+          o[i].window_phs = w_phs + (len - t) * w_frq;
+        }
+      }
     }
     return OK;
  err1:
@@ -2586,7 +2879,7 @@ static const OENTRY localops[] = {
 //    { "vco2",       sizeof(VCO2),       TR, 5,      "a",    "kkoM",
     { "vco2",       sizeof(VCO2),       TR, 5,      "a",    "kkoOOo",
             (SUBR) vco2set, (SUBR) NULL, (SUBR) vco2                    },
-    { "denorm",     sizeof(DENORMS),   0,  4,      "",     "y",
+    { "denorm",     sizeof(DENORMS),   IW, 4,      "",     "y",
             (SUBR) NULL, (SUBR) NULL, (SUBR) denorms                    },
     { "delayk",     sizeof(DELAYK),    0,  3,      "k",    "kio",
             (SUBR) delaykset, (SUBR) delayk, (SUBR) NULL                },
@@ -52,16 +52,18 @@
 
 /* oscbnk types */
 
+/* oscillator state: an array per field, with an entry per oscillator */
+
 typedef struct {
-        uint32  LFO1phs;                /* LFO 1 phase                  */
-        MYFLT   LFO1frq;                /* LFO 1 frequency (0-1)        */
-        uint32  LFO2phs;                /* LFO 2 phase                  */
-        MYFLT   LFO2frq;                /* LFO 2 frequency (0-1)        */
-        uint32  osc_phs;                /* main oscillator phase        */
-        MYFLT   osc_phm;                /* phase mod.                   */
-        MYFLT   osc_frq, osc_amp;       /* osc. freq. / sr, amplitude   */
-        MYFLT   xnm1, xnm2, ynm1, ynm2; /* EQ tmp data                  */
-        MYFLT   a1, a2, b0, b1, b2;     /* EQ coeffs saved for interp.  */
+        uint32  *LFO1phs;               /* LFO 1 phase                  */
+        MYFLT   *LFO1frq;               /* LFO 1 frequency (0-1)        */
+        uint32  *LFO2phs;               /* LFO 2 phase                  */
+        MYFLT   *LFO2frq;               /* LFO 2 frequency (0-1)        */
+        uint32  *osc_phs;               /* main oscillator phase        */
+        MYFLT   *osc_phm;               /* phase mod.                   */
+        MYFLT   *osc_frq, *osc_amp;     /* osc. freq. / sr, amplitude   */
+        MYFLT   *xnm1, *xnm2, *ynm1, *ynm2; /* EQ tmp data              */
+        MYFLT   *a1, *a2, *b0, *b1, *b2; /* EQ coeffs saved for interp. */
 } OSCBNK_OSC;
 
 typedef struct {
@@ -94,7 +96,7 @@ typedef struct {
         int32    outft_len;              /* (optional)                   */
         int32    tabl_cnt;               /* current param in table       */
         AUXCH   auxdata;
-        OSCBNK_OSC      *osc;           /* oscillator array             */
+        OSCBNK_OSC      osc;            /* oscillator arrays            */
 } OSCBNK;
 
 /* grain2 types */
@@ -123,6 +125,8 @@ typedef struct {
         uint32   wft_lobits, wft_mask;
         AUXCH   auxdata;
         GRAIN2_OSC      *osc;           /* oscillator array             */
+        GRAIN2_OSC      *grain;         /* next grain of each osc.      */
+        int32   *ev_smp, *ev_ord;       /* where it starts, and order   */
 } GRAIN2;
 
 /* -------- grain3 types -------- */
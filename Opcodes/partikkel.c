@@ -19,6 +19,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
 #include "partikkel.h"
+#include "cs_simd.h"
 #include <limits.h>
 #include <math.h>
 
@@ -39,55 +40,116 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
     if (index > (unsigned)(to) || index < (unsigned)(from)) \
         index = (unsigned)(from);
 
-/* here follows routines for maintaining a linked list of grains */
+/* here follows routines for maintaining the grain pool */
 
-/* initialises a linked list of NODEs */
-static void init_pool(GRAINPOOL *s, unsigned max_grains)
+/* number of grains rendered side by side */
+#define GRAIN_LANES 8
+
+/* bytes of pool memory taken by one grain */
+#define GRAIN_BYTES (25*sizeof(double) + 6*sizeof(FUNC *) + \
+                     10*sizeof(MYFLT) + 5*sizeof(unsigned))
+
+/* lays out the grain arrays in mem, which holds GRAIN_BYTES per entry
+ * size is even, so with the widest types first every array is aligned */
+static void init_pool(GRAINPOOL *s, char *mem, unsigned size,
+                      unsigned max_grains)
 {
-    unsigned i;
-    NODE **p = &s->grainlist;
-    NODE *grainpool = (NODE *)s->mempool;
-
-    s->free_nodes = max_grains;
-    /* build list of grains in pool */
-    for (i = 0; i < max_grains; ++i) {
-        NODE *node;
-        *p = grainpool + i;
-        node = *p;
-        node->next = NULL;
-        p = &(node->next);
+    int i;
+
+#define POOL_ARRAY(ptr, type) \
+    (ptr = (type *)mem, mem += size*sizeof(type))
+    POOL_ARRAY(s->envphase, double);
+    POOL_ARRAY(s->envinc, double);
+    POOL_ARRAY(s->envattacklen, double);
+    POOL_ARRAY(s->envdecaystart, double);
+    POOL_ARRAY(s->env2amount, double);
+    for (i = 0; i < 5; ++i) {
+        POOL_ARRAY(s->wav[i].phase, double);
+        POOL_ARRAY(s->wav[i].delta, double);
+        POOL_ARRAY(s->wav[i].sweepoffset, double);
+        POOL_ARRAY(s->wav[i].sweepdecay, double);
     }
+    POOL_ARRAY(s->fmenvtab, FUNC *);
+    for (i = 0; i < 5; ++i)
+        POOL_ARRAY(s->wav[i].table, FUNC *);
+    POOL_ARRAY(s->fmamp, MYFLT);
+    POOL_ARRAY(s->falloff, MYFLT);
+    POOL_ARRAY(s->falloff_pow_N, MYFLT);
+    POOL_ARRAY(s->gain1, MYFLT);
+    POOL_ARRAY(s->gain2, MYFLT);
+    for (i = 0; i < 5; ++i)
+        POOL_ARRAY(s->wav[i].gain, MYFLT);
+    POOL_ARRAY(s->start, unsigned);
+    POOL_ARRAY(s->stop, unsigned);
+    POOL_ARRAY(s->harmonics, unsigned);
+    POOL_ARRAY(s->chan1, unsigned);
+    POOL_ARRAY(s->chan2, unsigned);
+#undef POOL_ARRAY
+    s->first = s->count = 0;
+    s->max_grains = max_grains;
 }
 
-/* returns pointer to new node */
-static NODE *get_grain(GRAINPOOL *s)
+/* return oldest grain to the pool, we use this when we're out of grains */
+static void kill_oldest_grain(GRAINPOOL *s)
 {
-    NODE *ret = s->grainlist;
-
-    if (s->grainlist)
-        s->grainlist = s->grainlist->next;
-    s->free_nodes--;
-    return ret;
+    s->first++;
+    s->count--;
 }
 
-/* returns a NODE to the pool. function returns pointer to next node */
-static NODE *return_grain(GRAINPOOL *s, NODE *c)
+/* copies grain from to entry to, used when squeezing out finished grains */
+static void move_grain(GRAINPOOL *s, unsigned to, unsigned from)
 {
-    NODE *oldnext = c->next;
+    int i;
 
-    c->next = s->grainlist;
-    s->grainlist = c;
-    s->free_nodes++;
-    return oldnext;
+    s->start[to] = s->start[from];
+    s->stop[to] = s->stop[from];
+    s->envphase[to] = s->envphase[from];
+    s->envinc[to] = s->envinc[from];
+    s->envattacklen[to] = s->envattacklen[from];
+    s->envdecaystart[to] = s->envdecaystart[from];
+    s->env2amount[to] = s->env2amount[from];
+    s->fmamp[to] = s->fmamp[from];
+    s->fmenvtab[to] = s->fmenvtab[from];
+    s->harmonics[to] = s->harmonics[from];
+    s->falloff[to] = s->falloff[from];
+    s->falloff_pow_N[to] = s->falloff_pow_N[from];
+    s->gain1[to] = s->gain1[from];
+    s->gain2[to] = s->gain2[from];
+    s->chan1[to] = s->chan1[from];
+    s->chan2[to] = s->chan2[from];
+    for (i = 0; i < 5; ++i) {
+        WAVEDATA *wav = &s->wav[i];
+
+        wav->table[to] = wav->table[from];
+        wav->phase[to] = wav->phase[from];
+        wav->delta[to] = wav->delta[from];
+        wav->sweepoffset[to] = wav->sweepoffset[from];
+        wav->sweepdecay[to] = wav->sweepdecay[from];
+        wav->gain[to] = wav->gain[from];
+    }
 }
 
-/* return oldest grain to the pool, we use this when we're out of grains */
-static void kill_oldest_grain(GRAINPOOL *s, NODE *n)
+/* drops the grains that finished this k-period and moves the rest one
+ * k-period on, keeping them in order at the start of the arrays */
+static void retire_grains(GRAINPOOL *s, unsigned ksmps)
 {
-    while (n->next->next)
-        n = n->next;
-    return_grain(s, n->next);
-    n->next = NULL;
+    unsigned k, w = 0, end = s->first + s->count;
+
+    for (k = s->first; k < end; ++k) {
+        if (s->stop[k] <= ksmps)
+            continue; /* grain is finished, deactivate it */
+        /* extend grain lifetime with one k-period */
+        if (ksmps > s->start[k])
+            s->start[k] = 0; /* grain is active */
+        else
+            s->start[k] -= ksmps; /* grain is not yet active */
+        s->stop[k] -= ksmps;
+        if (w != k)
+            move_grain(s, w, k);
+        w++;
+    }
+    s->first = 0;
+    s->count = w;
 }
 
 static int setup_globals(CSOUND *csound, PARTIKKEL *p)
@@ -190,14 +252,12 @@ static inline double intpow_(MYFLT x, unsigned n)
 }
 
 /* dsf synthesis for trainlets */
-static inline MYFLT dsf(FUNC *tab, GRAIN *grain, double beta, MYFLT zscale,
-                        unsigned cosineshift)
+static inline MYFLT dsf(FUNC *tab, unsigned N, MYFLT a, MYFLT a_pow_N,
+                        double beta, MYFLT zscale, unsigned cosineshift)
 {
     MYFLT numerator, denominator, cos_beta;
     MYFLT lastharmonic, result;
-    unsigned fbeta, N = grain->harmonics;
-    const MYFLT a = grain->falloff;
-    const MYFLT a_pow_N = grain->falloff_pow_N;
+    unsigned fbeta;
     fbeta = (unsigned)(beta*(double)UINT_MAX);
 
     cos_beta = lrplookup(tab, fbeta, zscale, cosineshift);
@@ -218,13 +278,12 @@ static inline MYFLT dsf(FUNC *tab, GRAIN *grain, double beta, MYFLT zscale,
 
 static int partikkel_init(CSOUND *csound, PARTIKKEL *p)
 {
-    uint32_t size;
+    uint32_t size, poolsize;
     int ret;
 
     if ((ret = setup_globals(csound, p)) != OK)
         return ret;
 
-    p->grainroot = NULL;
     /* set grainphase to 1.0 to make grain scheduler create a grain immediately
      * after starting opcode */
     p->grainphase = 1.0;
@@ -302,22 +361,24 @@ static int partikkel_init(CSOUND *csound, PARTIKKEL *p)
     p->synced = 0;
     p->graininc = 0.0;
 
-    /* allocate memory for the grain mix buffer */
-    size = CS_KSMPS*sizeof(MYFLT);
-    if (p->aux.auxp == NULL || p->aux.size < size)
-        csound->AuxAlloc(csound, size, &p->aux);
-    else
-      memset(p->aux.auxp, 0, size);
-
     /* allocate memory for the grain pool and initialize it*/
     if (UNLIKELY(*p->max_grains < FL(1.0)))
         return INITERROR("maximum number of grains needs to be non-zero "
                          "and positive");
-    size = ((unsigned)*p->max_grains)*sizeof(NODE);
+    poolsize = ((unsigned)*p->max_grains + CS_KSMPS + 1) & ~1U;
+    size = poolsize*GRAIN_BYTES;
     if (p->aux2.auxp == NULL || p->aux2.size < size)
         csound->AuxAlloc(csound, size, &p->aux2);
-    p->gpool.mempool = p->aux2.auxp;
-    init_pool(&p->gpool, (unsigned)*p->max_grains);
+    init_pool(&p->gpool, p->aux2.auxp, poolsize, (unsigned)*p->max_grains);
+
+    /* allocate memory for the render buffers: a mix buffer per lane, the fm
+     * input padded with zeros to two k-periods, and the list of grains to
+     * render */
+    size = (GRAIN_LANES + 2)*CS_KSMPS*sizeof(MYFLT) + poolsize*sizeof(unsigned);
+    if (p->aux.auxp == NULL || p->aux.size < size)
+        csound->AuxAlloc(csound, size, &p->aux);
+    else
+      memset(p->aux.auxp, 0, size);
 
     /* find out which of the xrate parameters are arate */
     p->grainfreq_arate = IS_ASIG_ARG(p->grainfreq) ? 1 : 0;
@@ -327,8 +388,10 @@ static int partikkel_init(CSOUND *csound, PARTIKKEL *p)
 }
 
 /* n is sample number for which the grain is to be scheduled
- * offset is time offset for grain in seconds, passed separately for hints */
-static int schedule_grain(CSOUND *csound, PARTIKKEL *p, NODE *node, int32 n,
+ * offset is time offset for grain in seconds, passed separately for hints
+ * the grain is set up in the first free pool entry, and only added to the
+ * pool once it is known not to be cancelled */
+static int schedule_grain(CSOUND *csound, PARTIKKEL *p, int32 n,
                           double offset)
 {
     /* make a new grain */
@@ -337,7 +400,8 @@ static int schedule_grain(CSOUND *csound, PARTIKKEL *p, NODE *node, int32 n,
     int samples;
     double rcp_samples; /* 1/samples */
     double phase_corr;
-    GRAIN *grain = &node->grain;
+    GRAINPOOL *s = &p->gpool;
+    const unsigned k = s->first + s->count;
     unsigned int i;
     unsigned int chan;
     MYFLT graingain;
@@ -374,7 +438,7 @@ static int schedule_grain(CSOUND *csound, PARTIKKEL *p, NODE *node, int32 n,
 
     /* get fm modulation index */
     clip_index(p->fmampindex, fmamps[0], fmamps[1]);
-    grain->fmamp = fmamps[p->fmampindex + 2];
+    s->fmamp[k] = fmamps[p->fmampindex + 2];
     p->fmampindex++;
 
     /* calculate waveform gain table index for later use */
@@ -386,47 +450,42 @@ static int schedule_grain(CSOUND *csound, PARTIKKEL *p, NODE *node, int32 n,
     if ((fabs(graingain) < FL(1e-8)) || (frand() > 1.0 - *p->randommask)) {
         /* grain is either masked out or has a zero amplitude, so we cancel it
          * and proceed with scheduling our next grain */
-        return_grain(&p->gpool, node);
         return OK;
     }
 
-    grain->env2amount = *p->env2_amount;
-    grain->envattacklen = (1.0 - *p->sustain_amount)*(*p->a_d_ratio);
-    grain->envdecaystart = grain->envattacklen + *p->sustain_amount;
-    grain->fmenvtab = p->fmenvtab;
+    s->env2amount[k] = *p->env2_amount;
+    s->envattacklen[k] = (1.0 - *p->sustain_amount)*(*p->a_d_ratio);
+    s->envdecaystart[k] = s->envattacklen[k] + *p->sustain_amount;
+    s->fmenvtab[k] = p->fmenvtab;
 
     /* place a grain in between two channels according to channel mask value */
     chan = (unsigned)maskchannel;
-    if (UNLIKELY(chan >= p->num_outputs)) {
-        return_grain(&p->gpool, node);
+    if (UNLIKELY(chan >= p->num_outputs))
         return PERFERROR("channel mask specifies non-existing output channel");
-    }
     /* use panning law table if specified */
     if (p->pantab != NULL) {
         unsigned tabsize = p->pantab->flen/8;
         unsigned i1 = (unsigned)((FL(1.0) - maskchannel + 2*chan)*tabsize);
         unsigned i2 = (unsigned)(maskchannel*tabsize);
 
-        grain->gain1 = p->pantab->ftable[i1];
-        grain->gain2 = p->pantab->ftable[i2];
+        s->gain1[k] = p->pantab->ftable[i1];
+        s->gain2[k] = p->pantab->ftable[i2];
     } else {
-        grain->gain1 = FL(1.0) - (maskchannel - chan);
-        grain->gain2 = maskchannel - chan;
+        s->gain1[k] = FL(1.0) - (maskchannel - chan);
+        s->gain2[k] = maskchannel - chan;
     }
 
-    grain->chan1 = chan;
-    grain->chan2 = p->num_outputs > chan + 1 ? chan + 1 : 0;
+    s->chan1[k] = chan;
+    s->chan2[k] = p->num_outputs > chan + 1 ? chan + 1 : 0;
 
     /* duration in samples */
     samples = (int)((CS_ESR*(*p->duration)/1000.0) + 0.5);
     /* if grainlength is below one sample, we'll just cancel it */
-    if (samples <= 0) {
-        return_grain(&p->gpool, node);
+    if (samples <= 0)
         return OK;
-    }
     rcp_samples = 1.0/(double)samples;
-    grain->start = n + offset*CS_ESR;
-    grain->stop = grain->start + samples;
+    s->start[k] = n + offset*CS_ESR;
+    s->stop[k] = s->start[k] + samples;
     /* implement sub-sample grain placement for synchronous grains */
     if (offset == 0.0 && p->graininc > 1e-6)
         phase_corr = p->grainphase/p->graininc;
@@ -435,7 +494,9 @@ static int schedule_grain(CSOUND *csound, PARTIKKEL *p, NODE *node, int32 n,
 
     /* set up the four wavetables and dsf to use in the grain */
     for (i = 0; i < 5; ++i) {
-        WAVEDATA *curwav = &grain->wav[i];
+        WAVEDATA *curwav = &s->wav[i];
+        double phase, delta, sweepoffset, sweepdecay;
+        MYFLT gain;
         MYFLT freqmult = i != WAV_TRAINLET
                          ? *(*(&p->wavekey1 + i))*(*p->wavfreq)
                          : *p->trainletfreq;
@@ -444,12 +505,12 @@ static int schedule_grain(CSOUND *csound, PARTIKKEL *p, NODE *node, int32 n,
         MYFLT *samplepos = *(&p->samplepos1 + i);
         MYFLT enddelta;
 
-        curwav->table = i != WAV_TRAINLET ? p->wavetabs[i] : p->costab;
-        curwav->gain = wavgains[wavgainsindex + i + 2]*graingain;
+        curwav->table[k] = i != WAV_TRAINLET ? p->wavetabs[i] : p->costab;
+        gain = wavgains[wavgainsindex + i + 2]*graingain;
 
         /* drop wavetables with close to zero gain */
-        if (fabs(curwav->gain) < FL(1e-8)) {
-            curwav->table = NULL;
+        if (fabs(gain) < FL(1e-8)) {
+            curwav->table[k] = NULL;
             continue;
         }
 
@@ -464,80 +525,84 @@ static int schedule_grain(CSOUND *csound, PARTIKKEL *p, NODE *node, int32 n,
             nh = 0.5*CS_ESR/fabs(maxfreq);
             if (nh > fabs(*p->harmonics))
                 nh = fabs(*p->harmonics);
-            grain->harmonics = (unsigned)nh + 1;
-            if (grain->harmonics < 2)
-                grain->harmonics = 2;
-            grain->falloff = *p->falloff;
-            grain->falloff_pow_N = intpow_(grain->falloff, grain->harmonics);
+            s->harmonics[k] = (unsigned)nh + 1;
+            if (s->harmonics[k] < 2)
+                s->harmonics[k] = 2;
+            s->falloff[k] = *p->falloff;
+            s->falloff_pow_N[k] = intpow_(s->falloff[k], s->harmonics[k]);
             /* normalize trainlets to uniform peak, using geometric sum */
-            if (FABS(grain->falloff) > FL(0.9999) &&
-                FABS(grain->falloff) < FL(1.0001))
+            if (FABS(s->falloff[k]) > FL(0.9999) &&
+                FABS(s->falloff[k]) < FL(1.0001))
                 /* limit case for falloff = 1 */
-                normalize = 1.0/(double)grain->harmonics;
+                normalize = 1.0/(double)s->harmonics[k];
             else
-                normalize = (1.0 - fabs(grain->falloff))
-                            /(1.0 - fabs(grain->falloff_pow_N));
-            curwav->gain *= normalize;
+                normalize = (1.0 - fabs(s->falloff[k]))
+                            /(1.0 - fabs(s->falloff_pow_N[k]));
+            gain *= normalize;
         }
 
-        curwav->delta = startfreq*csound->onedsr;
+        delta = startfreq*csound->onedsr;
         enddelta = endfreq*csound->onedsr;
 
         if (i != WAV_TRAINLET) {
             /* set wavphase to samplepos parameter */
-            curwav->phase = samplepos[n];
+            phase = samplepos[n];
         } else {
             /* set to 0.5 so the dsf pulse doesn't occur at the very start of
              * the grain where it'll probably be enveloped away anyway */
-            curwav->phase = 0.5;
+            phase = 0.5;
         }
         /* place grain between samples. this is especially important to make
          * high frequency synchronous grain streams sounds right */
-        curwav->phase += phase_corr*startfreq*csound->onedsr;
+        phase += phase_corr*startfreq*csound->onedsr;
 
         /* clamp phase in case it's out of bounds */
-        curwav->phase = curwav->phase > 1.0 ? 1.0 : curwav->phase;
-        curwav->phase = curwav->phase < 0.0 ? 0.0 : curwav->phase;
+        phase = phase > 1.0 ? 1.0 : phase;
+        phase = phase < 0.0 ? 0.0 : phase;
         /* phase and delta for wavetable synthesis are scaled by table length */
         if (i != WAV_TRAINLET) {
-            double tablen = (double)curwav->table->flen;
+            double tablen = (double)curwav->table[k]->flen;
 
-            curwav->phase *= tablen;
-            curwav->delta *= tablen;
+            phase *= tablen;
+            delta *= tablen;
             enddelta *= tablen;
         }
 
         /* the sweep curve generator is a first order iir filter */
-        if (curwav->delta == enddelta || *p->freqsweepshape == FL(0.5)) {
+        if (delta == enddelta || *p->freqsweepshape == FL(0.5)) {
             /* special case for linear sweep */
-            curwav->sweepdecay = 1.0;
-            curwav->sweepoffset = (enddelta - curwav->delta)*rcp_samples;
+            sweepdecay = 1.0;
+            sweepoffset = (enddelta - delta)*rcp_samples;
         } else {
             /* handle extreme cases the generic code doesn't handle too well */
             if (*p->freqsweepshape < FL(0.001)) {
-                curwav->sweepdecay = 1.0;
-                curwav->sweepoffset = 0.0;
+                sweepdecay = 1.0;
+                sweepoffset = 0.0;
             } else if (*p->freqsweepshape > FL(0.999)) {
-                curwav->sweepdecay = 0.0;
-                curwav->sweepoffset = enddelta;
+                sweepdecay = 0.0;
+                sweepoffset = enddelta;
             } else {
                 double start_offset, total_decay, t;
 
                 t = fabs((*p->freqsweepshape - 1.0)/(*p->freqsweepshape));
-                curwav->sweepdecay = pow(t, 2.0*rcp_samples);
-                total_decay = t*t; /* pow(curwav->sweepdecay, samples) */
-                start_offset = (enddelta - curwav->delta*total_decay)/
+                sweepdecay = pow(t, 2.0*rcp_samples);
+                total_decay = t*t; /* pow(sweepdecay, samples) */
+                start_offset = (enddelta - delta*total_decay)/
                                (1.0 - total_decay);
-                curwav->sweepoffset = start_offset*(1.0 - curwav->sweepdecay);
+                sweepoffset = start_offset*(1.0 - sweepdecay);
             }
         }
+        curwav->phase[k] = phase;
+        curwav->delta[k] = delta;
+        curwav->sweepoffset[k] = sweepoffset;
+        curwav->sweepdecay[k] = sweepdecay;
+        curwav->gain[k] = gain;
     }
 
-    grain->envinc = rcp_samples;
-    grain->envphase = phase_corr*grain->envinc;
-    /* link new grain into the list */
-    node->next = p->grainroot;
-    p->grainroot = node;
+    s->envinc[k] = rcp_samples;
+    s->envphase[k] = phase_corr*s->envinc[k];
+    /* add the new grain to the pool */
+    s->count++;
     return OK;
 }
 
@@ -547,7 +612,6 @@ static int schedule_grains(CSOUND *csound, PARTIKKEL *p)
     uint32_t koffset = p->h.insdshead->ksmps_offset;
     uint32_t early  = p->h.insdshead->ksmps_no_end;
     uint32_t n, nsmps = CS_KSMPS;
-    NODE *node;
     MYFLT **waveformparams = &p->waveform1;
     MYFLT grainfreq = fabs(*p->grainfreq);
 
@@ -621,19 +685,16 @@ static int schedule_grains(CSOUND *csound, PARTIKKEL *p)
                 offset = (offset - p->grainphase)/grainfreq;
 
             /* check if there are any grains left in the pool */
-            if (!p->gpool.free_nodes) {
+            if (p->gpool.count >= p->gpool.max_grains) {
                 if (!p->out_of_voices_warning) {
                     WARNING("maximum number of grains reached");
                     p->out_of_voices_warning = 1; /* we only warn once */
                 }
-                kill_oldest_grain(&p->gpool, p->grainroot);
+                kill_oldest_grain(&p->gpool);
             }
             /* add a new grain */
-            node = get_grain(&p->gpool);
-            /* check first, in case we'll change the above behaviour of
-             * killing a grain */
-            if (node) {
-                int ret = schedule_grain(csound, p, node, n, offset);
+            {
+                int ret = schedule_grain(csound, p, n, offset);
 
                 if (ret != OK)
                     return ret;
@@ -656,142 +717,559 @@ static int schedule_grains(CSOUND *csound, PARTIKKEL *p)
 }
 
 /* Main synthesis loops */
-/* NOTE: the main synthesis loop is duplicated for both wavetable and
- * trainlet synthesis for speed */
-static inline void render_wave(PARTIKKEL *p, GRAIN *grain, WAVEDATA *wav,
-                               MYFLT *buf, unsigned stop)
+/* Grains are rendered GRAIN_LANES at a time, one grain per lane.  Their
+ * state is copied into the arrays below for the k-period, and each step of
+ * a sample (phase wrap, table lookup, phase and sweep update, envelopes)
+ * is a loop across the lanes.  Lane j renders samples lo[j] onwards, so
+ * a grain starting late in the k-period still begins at step 0.  Lanes
+ * without a grain, and waves a grain does not use, run on harmless dummy
+ * state with zero gain.  The arithmetic is that of one grain at a time,
+ * sample for sample. */
+typedef struct {
+    const MYFLT *tab[4][GRAIN_LANES];
+    double tablen[4][GRAIN_LANES];
+    double phase[5][GRAIN_LANES], delta[5][GRAIN_LANES];
+    double sweepoffset[5][GRAIN_LANES], sweepdecay[5][GRAIN_LANES];
+    MYFLT gain[5][GRAIN_LANES];
+    unsigned harmonics[GRAIN_LANES];
+    MYFLT falloff[GRAIN_LANES], falloff_pow_N[GRAIN_LANES];
+    double envphase[GRAIN_LANES], fmenvphase[GRAIN_LANES];
+    double envinc[GRAIN_LANES];
+    double envattacklen[GRAIN_LANES], envdecaystart[GRAIN_LANES];
+    double env2amount[GRAIN_LANES];
+    MYFLT fmamp[GRAIN_LANES];
+    const MYFLT *fmenvtab[GRAIN_LANES];
+    int fmenvlobits[GRAIN_LANES];
+    size_t fmenvlen[GRAIN_LANES];
+    const MYFLT *fm[GRAIN_LANES];
+    MYFLT *buf[GRAIN_LANES];
+    unsigned pos[GRAIN_LANES], lo[GRAIN_LANES], len[GRAIN_LANES];
+} GRAINLANES;
+
+/* copies grain k of the pool into lane j, returns the waves it uses */
+static unsigned load_lane(PARTIKKEL *p, GRAINLANES *g, int j, unsigned k,
+                          const MYFLT *fm)
 {
-    unsigned n;
-    double fmenvphase = grain->envphase;
-
-    /* wavetable synthesis */
-    for (n = grain->start; n < stop; ++n) {
-        double tablen = (double)wav->table->flen;
-        unsigned x0;
-        MYFLT frac, fmenv;
-
-        /* make sure phase accumulator stays within bounds */
-        while (UNLIKELY(wav->phase >= tablen))
-            wav->phase -= tablen;
-        while (UNLIKELY(wav->phase < 0.0))
-            wav->phase += tablen;
-
-        /* sample table lookup with linear interpolation */
-        x0 = (unsigned)wav->phase;
-        frac = (MYFLT)(wav->phase - x0);
-        buf[n] += lrp(wav->table->ftable[x0], wav->table->ftable[x0 + 1],
-                      frac)*wav->gain;
-
-        fmenv = grain->fmenvtab->ftable[(size_t)(fmenvphase*FMAXLEN)
-                                        >> grain->fmenvtab->lobits];
-        fmenvphase += grain->envinc;
-        wav->phase += wav->delta + wav->delta*p->fm[n]*grain->fmamp*fmenv;
-        /* apply sweep */
-        wav->delta = wav->delta*wav->sweepdecay + wav->sweepoffset;
-     }
+    GRAINPOOL *s = &p->gpool;
+    FUNC *fmenvtab = s->fmenvtab[k];
+    unsigned stop = s->stop[k] > CS_KSMPS ? CS_KSMPS : s->stop[k];
+    unsigned waves = 0;
+    int i;
+
+    for (i = 0; i < 5; ++i) {
+        WAVEDATA *wav = &s->wav[i];
+        FUNC *table = wav->table[k];
+
+        if (table == NULL) {
+            /* silent stand-in for a wave the grain does not use */
+            if (i != WAV_TRAINLET) {
+                g->tab[i][j] = p->globals->zzz_tab->ftable;
+                g->tablen[i][j] = (double)p->globals->zzz_tab->flen;
+            } else {
+                g->harmonics[j] = 2;
+                g->falloff[j] = g->falloff_pow_N[j] = FL(0.0);
+            }
+            g->phase[i][j] = g->delta[i][j] = 0.0;
+            g->sweepoffset[i][j] = 0.0;
+            g->sweepdecay[i][j] = 1.0;
+            g->gain[i][j] = FL(0.0);
+            continue;
+        }
+        if (i != WAV_TRAINLET) {
+            g->tab[i][j] = table->ftable;
+            g->tablen[i][j] = (double)table->flen;
+        } else {
+            g->harmonics[j] = s->harmonics[k];
+            g->falloff[j] = s->falloff[k];
+            g->falloff_pow_N[j] = s->falloff_pow_N[k];
+        }
+        g->phase[i][j] = wav->phase[k];
+        g->delta[i][j] = wav->delta[k];
+        g->sweepoffset[i][j] = wav->sweepoffset[k];
+        g->sweepdecay[i][j] = wav->sweepdecay[k];
+        g->gain[i][j] = wav->gain[k];
+        waves |= 1 << i;
+    }
+    g->envphase[j] = g->fmenvphase[j] = s->envphase[k];
+    g->envinc[j] = s->envinc[k];
+    g->envattacklen[j] = s->envattacklen[k];
+    g->envdecaystart[j] = s->envdecaystart[k];
+    g->env2amount[j] = s->env2amount[k];
+    g->fmamp[j] = s->fmamp[k];
+    g->fmenvtab[j] = fmenvtab->ftable;
+    g->fmenvlobits[j] = fmenvtab->lobits;
+    g->fmenvlen[j] = fmenvtab->flen;
+    g->fm[j] = fm + s->start[k];
+    g->pos[j] = k;
+    g->lo[j] = s->start[k];
+    g->len[j] = stop - s->start[k];
+    return waves;
 }
 
-static inline void render_trainlet(PARTIKKEL *p, GRAIN *grain, WAVEDATA *wav,
-                                   MYFLT *buf, unsigned stop)
+/* fills an unused lane with a silent grain */
+static void clear_lane(PARTIKKEL *p, GRAINLANES *g, int j, const MYFLT *fm)
 {
-    unsigned n;
-    double fmenvphase = grain->envphase;
-
-    /* trainlet synthesis */
-    for (n = grain->start; n < stop; ++n) {
-        MYFLT fmenv;
-
-        while (UNLIKELY(wav->phase >= 1.0))
-            wav->phase -= 1.0;
-        while (UNLIKELY(wav->phase < 0.0))
-            wav->phase += 1.0;
+    FUNC *zzz = p->globals->zzz_tab, *ooo = p->globals->ooo_tab;
+    int i;
 
-        /* dsf/trainlet synthesis */
-        buf[n] += wav->gain*dsf(p->costab, grain, wav->phase, p->zscale,
-                                p->cosineshift);
-
-        fmenv = grain->fmenvtab->ftable[(size_t)(fmenvphase*FMAXLEN)
-                                        >> grain->fmenvtab->lobits];
-        fmenvphase += grain->envinc;
-        wav->phase += wav->delta + wav->delta*p->fm[n]*grain->fmamp*fmenv;
-        wav->delta = wav->delta*wav->sweepdecay + wav->sweepoffset;
+    for (i = 0; i < 5; ++i) {
+        if (i != WAV_TRAINLET) {
+            g->tab[i][j] = zzz->ftable;
+            g->tablen[i][j] = (double)zzz->flen;
+        }
+        g->phase[i][j] = g->delta[i][j] = 0.0;
+        g->sweepoffset[i][j] = 0.0;
+        g->sweepdecay[i][j] = 1.0;
+        g->gain[i][j] = FL(0.0);
     }
+    g->harmonics[j] = 2;
+    g->falloff[j] = g->falloff_pow_N[j] = FL(0.0);
+    g->envphase[j] = g->fmenvphase[j] = g->envinc[j] = 0.0;
+    g->envattacklen[j] = g->envdecaystart[j] = 0.0;
+    g->env2amount[j] = 0.0;
+    g->fmamp[j] = FL(0.0);
+    g->fmenvtab[j] = ooo->ftable;
+    g->fmenvlobits[j] = ooo->lobits;
+    g->fmenvlen[j] = ooo->flen;
+    g->fm[j] = fm;
+    g->lo[j] = g->len[j] = 0;
 }
 
-/* do the actual waveform synthesis */
-static inline void render_grain(CSOUND *csound, PARTIKKEL *p, GRAIN *grain)
+/* copies the state of lane j back to its grain */
+static void store_lane(GRAINPOOL *s, const GRAINLANES *g, int j)
 {
+    unsigned k = g->pos[j];
     int i;
-    unsigned n;
-    MYFLT *out1 = *(&(p->output1) + grain->chan1);
-    MYFLT *out2 = *(&(p->output1) + grain->chan2);
-    unsigned stop = grain->stop > CS_KSMPS
-                    ? CS_KSMPS : grain->stop;
-    MYFLT *buf = (MYFLT *)p->aux.auxp;
-
-    if (grain->start >= CS_KSMPS)
-        return; /* grain starts at a later kperiod */
-    for (i = 0; i < 5; ++i) {
-        WAVEDATA *curwav = &grain->wav[i];
 
-        /* check if ftable is to be rendered */
-        if (curwav->table == NULL)
+    for (i = 0; i < 5; ++i) {
+        if (s->wav[i].table[k] == NULL)
             continue;
+        s->wav[i].phase[k] = g->phase[i][j];
+        s->wav[i].delta[k] = g->delta[i][j];
+    }
+    s->envphase[k] = g->envphase[j];
+}
 
-        if (i != WAV_TRAINLET)
-            render_wave(p, grain, curwav, buf, stop);
-        else
-            render_trainlet(p, grain, curwav, buf, stop);
+/* renders steps t0 to t1 of all lanes into their mix buffers, running only
+ * the waves flagged in waves */
+#if defined(CS_VEC) && defined(USE_DOUBLE)
+
+/* With GCC vector types the lanes are done CS_DLEN at a time.  Table
+ * lookups are still one lane at a time, but the indices are found as
+ * doubles: (size_t)(x*FMAXLEN) >> lobits is floor(x*FMAXLEN*2^-lobits) */
+
+#define GRAIN_VECS      (GRAIN_LANES/CS_DLEN)
+#define ROUND_MAGIC     6755399441055744.0          /* 1.5 * 2^52 */
+#define VSEL(m, a, b)   ((cs_dvec_t) (((cs_dmask_t) (a) & (m)) | \
+                                      ((cs_dmask_t) (b) & ~(m))))
+#define VANY(m)         ((m)[0] | (m)[1] | (m)[2] | (m)[3])
+
+/* r = floor(x) for 0 <= x < 2^51 */
+#define VFLOOR(r, x) \
+    do { \
+        const cs_dvec_t x_ = (x); \
+        r = (x_ + ROUND_MAGIC) - ROUND_MAGIC; \
+        r -= VSEL(r > x_, x_ - x_ + 1.0, x_ - x_); \
+    } while (0)
+
+CS_CLONES
+static void render_lanes(PARTIKKEL *p, GRAINLANES *g, unsigned t0,
+                         unsigned t1, unsigned waves)
+{
+    FUNC *attacktab = p->env_attack_tab, *decaytab = p->env_decay_tab;
+    const MYFLT *env2tab = p->env2_tab->ftable;
+    const double attackscale = ldexp(1.0, -attacktab->lobits);
+    const double decayscale = ldexp(1.0, -decaytab->lobits);
+    const double env2scale = ldexp(1.0, -p->env2_tab->lobits);
+    cs_dvec_t phase[5][GRAIN_VECS], delta[5][GRAIN_VECS];
+    cs_dvec_t sweepoffset[5][GRAIN_VECS], sweepdecay[5][GRAIN_VECS];
+    cs_dvec_t gain[5][GRAIN_VECS], tablen[4][GRAIN_VECS];
+    cs_dvec_t envphase[GRAIN_VECS], fmenvphase[GRAIN_VECS];
+    cs_dvec_t envinc[GRAIN_VECS], envattacklen[GRAIN_VECS];
+    cs_dvec_t envdecaystart[GRAIN_VECS], env2amount[GRAIN_VECS];
+    cs_dvec_t fmamp[GRAIN_VECS], fmenvscale[GRAIN_VECS];
+    cs_dvec_t fmenvlen[GRAIN_VECS];
+    double x[GRAIN_LANES], y[GRAIN_LANES], z[GRAIN_LANES];
+    unsigned t;
+    int i, j, v;
+
+    memcpy(phase, g->phase, sizeof(phase));
+    memcpy(delta, g->delta, sizeof(delta));
+    memcpy(sweepoffset, g->sweepoffset, sizeof(sweepoffset));
+    memcpy(sweepdecay, g->sweepdecay, sizeof(sweepdecay));
+    memcpy(gain, g->gain, sizeof(gain));
+    memcpy(tablen, g->tablen, sizeof(tablen));
+    memcpy(envphase, g->envphase, sizeof(envphase));
+    memcpy(fmenvphase, g->fmenvphase, sizeof(fmenvphase));
+    memcpy(envinc, g->envinc, sizeof(envinc));
+    memcpy(envattacklen, g->envattacklen, sizeof(envattacklen));
+    memcpy(envdecaystart, g->envdecaystart, sizeof(envdecaystart));
+    memcpy(env2amount, g->env2amount, sizeof(env2amount));
+    memcpy(fmamp, g->fmamp, sizeof(fmamp));
+    for (j = 0; j < GRAIN_LANES; ++j) {
+        x[j] = ldexp(1.0, -g->fmenvlobits[j]);
+        y[j] = (double)g->fmenvlen[j];
+    }
+    memcpy(fmenvscale, x, sizeof(fmenvscale));
+    memcpy(fmenvlen, y, sizeof(fmenvlen));
+
+    for (t = t0; t < t1; ++t) {
+        cs_dvec_t acc[GRAIN_VECS], fm[GRAIN_VECS], fmenv[GRAIN_VECS];
+        cs_dvec_t a[GRAIN_VECS], b[GRAIN_VECS], frac[GRAIN_VECS];
+        cs_dmask_t dec[GRAIN_VECS];
+
+        /* fm envelope; lanes past the end of their grain may run beyond
+         * the table */
+        for (v = 0; v < GRAIN_VECS; ++v) {
+            cs_dvec_t ix;
+
+            VFLOOR(ix, fmenvphase[v]*FMAXLEN*fmenvscale[v]);
+            ix = VSEL(ix < fmenvlen[v], ix, fmenvlen[v]);
+            memcpy(x + v*CS_DLEN, &ix, sizeof(ix));
+            fmenvphase[v] += envinc[v];
+            acc[v] = ix - ix;
+        }
+        for (j = 0; j < GRAIN_LANES; ++j) {
+            y[j] = g->fmenvtab[j][(int)x[j]];
+            z[j] = g->fm[j][t];
+        }
+        memcpy(fmenv, y, sizeof(fmenv));
+        memcpy(fm, z, sizeof(fm));
+
+        /* wavetable synthesis */
+        for (i = 0; i < 4; ++i) {
+            cs_dmask_t wrap = { 0 };
+
+            if (!(waves & (1 << i)))
+                continue;
+            /* make sure phase accumulator stays within bounds */
+            for (v = 0; v < GRAIN_VECS; ++v) {
+                cs_dvec_t ph = phase[i][v], tl = tablen[i][v];
+                const cs_dvec_t zero = tl - tl;
+
+                ph -= VSEL(ph >= tl, tl, zero);
+                ph += VSEL(ph < 0.0, tl, zero);
+                wrap |= (ph >= tl) | (ph < 0.0);
+                phase[i][v] = ph;
+            }
+            if (UNLIKELY(VANY(wrap))) {
+                memcpy(x, phase[i], sizeof(x));
+                memcpy(y, tablen[i], sizeof(y));
+                for (j = 0; j < GRAIN_LANES; ++j) {
+                    while (x[j] >= y[j])
+                        x[j] -= y[j];
+                    while (x[j] < 0.0)
+                        x[j] += y[j];
+                }
+                memcpy(phase[i], x, sizeof(x));
+            }
+            /* sample table lookup with linear interpolation */
+            for (v = 0; v < GRAIN_VECS; ++v) {
+                cs_dvec_t ix;
+
+                VFLOOR(ix, phase[i][v]);
+                frac[v] = phase[i][v] - ix;
+                memcpy(x + v*CS_DLEN, &ix, sizeof(ix));
+            }
+            for (j = 0; j < GRAIN_LANES; ++j) {
+                const MYFLT *tab = g->tab[i][j] + (int)x[j];
+
+                y[j] = tab[0];
+                z[j] = tab[1];
+            }
+            memcpy(a, y, sizeof(a));
+            memcpy(b, z, sizeof(b));
+            for (v = 0; v < GRAIN_VECS; ++v) {
+                acc[v] += lrp(a[v], b[v], frac[v])*gain[i][v];
+                phase[i][v] += delta[i][v] +
+                               delta[i][v]*fm[v]*fmamp[v]*fmenv[v];
+                /* apply sweep */
+                delta[i][v] = delta[i][v]*sweepdecay[i][v] +
+                              sweepoffset[i][v];
+            }
+        }
+
+        /* dsf/trainlet synthesis */
+        if (waves & (1 << WAV_TRAINLET)) {
+            cs_dmask_t wrap = { 0 };
+
+            for (v = 0; v < GRAIN_VECS; ++v) {
+                cs_dvec_t ph = phase[WAV_TRAINLET][v];
+                const cs_dvec_t zero = ph - ph;
+
+                ph -= VSEL(ph >= 1.0, zero + 1.0, zero);
+                ph += VSEL(ph < 0.0, zero + 1.0, zero);
+                wrap |= (ph >= 1.0) | (ph < 0.0);
+                phase[WAV_TRAINLET][v] = ph;
+            }
+            memcpy(x, phase[WAV_TRAINLET], sizeof(x));
+            for (j = 0; UNLIKELY(VANY(wrap)) && j < GRAIN_LANES; ++j) {
+                while (x[j] >= 1.0)
+                    x[j] -= 1.0;
+                while (x[j] < 0.0)
+                    x[j] += 1.0;
+            }
+            memcpy(phase[WAV_TRAINLET], x, sizeof(x));
+            for (j = 0; j < GRAIN_LANES; ++j)
+                y[j] = dsf(p->costab, g->harmonics[j], g->falloff[j],
+                           g->falloff_pow_N[j], x[j], p->zscale,
+                           p->cosineshift);
+            memcpy(a, y, sizeof(a));
+            for (v = 0; v < GRAIN_VECS; ++v) {
+                cs_dvec_t *ph = &phase[WAV_TRAINLET][v];
+                cs_dvec_t *dl = &delta[WAV_TRAINLET][v];
+
+                acc[v] += gain[WAV_TRAINLET][v]*a[v];
+                *ph += *dl + *dl*fm[v]*fmamp[v]*fmenv[v];
+                *dl = *dl*sweepdecay[WAV_TRAINLET][v] +
+                      sweepoffset[WAV_TRAINLET][v];
+            }
+        }
+
+        /* apply envelopes: attack, sustain on the last sample of the attack
+         * table, decay, and the clamp of the phase at 1.0 */
+        for (v = 0; v < GRAIN_VECS; ++v) {
+            cs_dvec_t e = envphase[v], ds = envdecaystart[v];
+            const cs_dvec_t zero = e - e;
+            cs_dmask_t m1 = e < envattacklen[v], m2 = e < ds, m3 = e < 1.0;
+            cs_dvec_t ep;
+
+            ep = VSEL(m1, e/envattacklen[v],
+                      VSEL(m2, zero + 1.0,
+                           VSEL(m3, (e - ds)/(1.0 - ds), zero + 1.0)));
+            dec[v] = ~m1 & ~m2 & (m3 | (ds < 1.0));
+            e = VSEL(m3 | m2 | m1, e, zero + 1.0);
+            envphase[v] = e;
+            VFLOOR(ep, ep*FMAXLEN*VSEL(dec[v], zero + decayscale,
+                                       zero + attackscale));
+            VFLOOR(e, e*FMAXLEN*env2scale);
+            memcpy(x + v*CS_DLEN, &ep, sizeof(ep));
+            memcpy(y + v*CS_DLEN, &e, sizeof(e));
+        }
+        for (j = 0; j < GRAIN_LANES; ++j) {
+            FUNC *envtable = dec[j/CS_DLEN][j%CS_DLEN] ? decaytab : attacktab;
+
+            z[j] = envtable->ftable[(int)x[j]];
+            y[j] = env2tab[(int)y[j]];
+        }
+        memcpy(a, z, sizeof(a));
+        memcpy(b, y, sizeof(b));
+        for (v = 0; v < GRAIN_VECS; ++v) {
+            cs_dvec_t env2 = 1.0 - env2amount[v] + env2amount[v]*b[v];
+
+            envphase[v] += envinc[v];
+            /* generate grain output sample */
+            acc[v] = acc[v]*a[v]*env2;
+        }
+        memcpy(x, acc, sizeof(x));
+        for (j = 0; j < GRAIN_LANES; ++j)
+            g->buf[j][t] = x[j];
     }
 
-    /* apply envelopes */
-    for (n = grain->start; n < stop; ++n) {
-        MYFLT env, env2, output;
-        double envphase;
-        FUNC *envtable;
+    memcpy(g->phase, phase, sizeof(phase));
+    memcpy(g->delta, delta, sizeof(delta));
+    memcpy(g->envphase, envphase, sizeof(envphase));
+    memcpy(g->fmenvphase, fmenvphase, sizeof(fmenvphase));
+}
+
+#else
+
+CS_CLONES
+static void render_lanes(PARTIKKEL *p, GRAINLANES *gp, unsigned t0,
+                         unsigned t1, unsigned waves)
+{
+    /* work on a copy, which the compiler knows the output can't alias */
+    GRAINLANES lanes = *gp, *g = &lanes;
+    FUNC *attacktab = p->env_attack_tab, *decaytab = p->env_decay_tab;
+    const MYFLT *env2tab = p->env2_tab->ftable;
+    const int env2lobits = p->env2_tab->lobits;
+    unsigned t;
+    int i, j;
+
+    for (t = t0; t < t1; ++t) {
+        MYFLT acc[GRAIN_LANES], fm[GRAIN_LANES], fmenv[GRAIN_LANES];
+
+        for (j = 0; j < GRAIN_LANES; ++j) {
+            size_t x = (size_t)(g->fmenvphase[j]*FMAXLEN) >> g->fmenvlobits[j];
+
+            /* lanes past the end of their grain may run beyond the table */
+            x = x < g->fmenvlen[j] ? x : g->fmenvlen[j];
+            acc[j] = FL(0.0);
+            fm[j] = g->fm[j][t];
+            fmenv[j] = g->fmenvtab[j][x];
+            g->fmenvphase[j] += g->envinc[j];
+        }
+
+        /* wavetable synthesis */
+        for (i = 0; i < 4; ++i) {
+            double *phase = g->phase[i], *delta = g->delta[i];
+            const double *tablen = g->tablen[i];
+            int wrap = 0;
+
+            if (!(waves & (1 << i)))
+                continue;
+            /* make sure phase accumulator stays within bounds */
+            for (j = 0; j < GRAIN_LANES; ++j) {
+                phase[j] -= tablen[j]*(double)(phase[j] >= tablen[j]);
+                phase[j] += tablen[j]*(double)(phase[j] < 0.0);
+                wrap |= (phase[j] >= tablen[j]) | (phase[j] < 0.0);
+            }
+            for (j = 0; UNLIKELY(wrap) && j < GRAIN_LANES; ++j) {
+                while (phase[j] >= tablen[j])
+                    phase[j] -= tablen[j];
+                while (phase[j] < 0.0)
+                    phase[j] += tablen[j];
+            }
+            /* sample table lookup with linear interpolation */
+            for (j = 0; j < GRAIN_LANES; ++j) {
+                const MYFLT *tab = g->tab[i][j];
+                unsigned x0 = (unsigned)phase[j];
+                MYFLT frac = (MYFLT)(phase[j] - x0);
+
+                acc[j] += lrp(tab[x0], tab[x0 + 1], frac)*g->gain[i][j];
+            }
+            for (j = 0; j < GRAIN_LANES; ++j) {
+                phase[j] += delta[j] + delta[j]*fm[j]*g->fmamp[j]*fmenv[j];
+                /* apply sweep */
+                delta[j] = delta[j]*g->sweepdecay[i][j] + g->sweepoffset[i][j];
+            }
+        }
+
+        /* dsf/trainlet synthesis */
+        if (waves & (1 << WAV_TRAINLET)) {
+            double *phase = g->phase[WAV_TRAINLET];
+            double *delta = g->delta[WAV_TRAINLET];
+            int wrap = 0;
+
+            for (j = 0; j < GRAIN_LANES; ++j) {
+                phase[j] -= (double)(phase[j] >= 1.0);
+                phase[j] += (double)(phase[j] < 0.0);
+                wrap |= (phase[j] >= 1.0) | (phase[j] < 0.0);
+            }
+            for (j = 0; UNLIKELY(wrap) && j < GRAIN_LANES; ++j) {
+                while (phase[j] >= 1.0)
+                    phase[j] -= 1.0;
+                while (phase[j] < 0.0)
+                    phase[j] += 1.0;
+            }
+            for (j = 0; j < GRAIN_LANES; ++j)
+                acc[j] += g->gain[WAV_TRAINLET][j]*
+                          dsf(p->costab, g->harmonics[j], g->falloff[j],
+                              g->falloff_pow_N[j], phase[j], p->zscale,
+                              p->cosineshift);
+            for (j = 0; j < GRAIN_LANES; ++j) {
+                phase[j] += delta[j] + delta[j]*fm[j]*g->fmamp[j]*fmenv[j];
+                delta[j] = delta[j]*g->sweepdecay[WAV_TRAINLET][j] +
+                           g->sweepoffset[WAV_TRAINLET][j];
+            }
+        }
 
         /* apply envelopes */
-        if (grain->envphase < grain->envattacklen) {
-            envtable = p->env_attack_tab;
-            envphase = grain->envphase/grain->envattacklen;
-        } else if (grain->envphase < grain->envdecaystart) {
-            /* for sustain, use last sample in attack table */
-            envtable = p->env_attack_tab;
-            envphase = 1.0;
-        } else if (grain->envphase < 1.0) {
-            envtable = p->env_decay_tab;
-            envphase = (grain->envphase - grain->envdecaystart)/(1.0 -
-                       grain->envdecaystart);
-        } else {
-            /* clamp envelope phase because of round-off errors */
-            envtable = grain->envdecaystart < 1.0 ?
-                       p->env_decay_tab : p->env_attack_tab;
-            envphase = grain->envphase = 1.0;
+        for (j = 0; j < GRAIN_LANES; ++j) {
+            MYFLT env, env2;
+            double envphase;
+            FUNC *envtable;
+
+            if (g->envphase[j] < g->envattacklen[j]) {
+                envtable = attacktab;
+                envphase = g->envphase[j]/g->envattacklen[j];
+            } else if (g->envphase[j] < g->envdecaystart[j]) {
+                /* for sustain, use last sample in attack table */
+                envtable = attacktab;
+                envphase = 1.0;
+            } else if (g->envphase[j] < 1.0) {
+                envtable = decaytab;
+                envphase = (g->envphase[j] - g->envdecaystart[j])/(1.0 -
+                           g->envdecaystart[j]);
+            } else {
+                /* clamp envelope phase because of round-off errors */
+                envtable = g->envdecaystart[j] < 1.0 ? decaytab : attacktab;
+                envphase = g->envphase[j] = 1.0;
+            }
+
+            /* fetch envelope values */
+            env = envtable->ftable[(size_t)(envphase*FMAXLEN)
+                                   >> envtable->lobits];
+            env2 = env2tab[(size_t)(g->envphase[j]*FMAXLEN) >> env2lobits];
+            env2 = FL(1.0) - g->env2amount[j] + g->env2amount[j]*env2;
+            g->envphase[j] += g->envinc[j];
+            /* generate grain output sample */
+            g->buf[j][t] = acc[j]*env*env2;
         }
+    }
+    memcpy(gp->phase, g->phase, sizeof(g->phase));
+    memcpy(gp->delta, g->delta, sizeof(g->delta));
+    memcpy(gp->envphase, g->envphase, sizeof(g->envphase));
+    memcpy(gp->fmenvphase, g->fmenvphase, sizeof(g->fmenvphase));
+}
+
+#endif
 
-        /* fetch envelope values */
-        env = envtable->ftable[(size_t)(envphase*FMAXLEN)
-                                >> envtable->lobits];
-        env2 = p->env2_tab->ftable[(size_t)(grain->envphase*FMAXLEN)
-                                   >> p->env2_tab->lobits];
-        env2 = FL(1.0) - grain->env2amount + grain->env2amount*env2;
-        grain->envphase += grain->envinc;
-        /* generate grain output sample */
-        output = buf[n]*env*env2;
-        /* now distribute this grain to the output channels it's supposed to
-         * end up in, as decided by the channel mask */
-        out1[n] += output*grain->gain1;
-        out2[n] += output*grain->gain2;
+/* renders the grains that sound in this k-period */
+static void render_grains(PARTIKKEL *p)
+{
+    GRAINPOOL *s = &p->gpool;
+    MYFLT *bufs = (MYFLT *)p->aux.auxp;
+    MYFLT *fm = bufs + GRAIN_LANES*CS_KSMPS;
+    unsigned *active = (unsigned *)(fm + 2*CS_KSMPS);
+    unsigned k, nactive = 0, b;
+    GRAINLANES g;
+    int j;
+
+    /* the second k-period of fm stays zero, it feeds lanes that run past
+     * the end of the k-period */
+    memcpy(fm, p->fm, CS_KSMPS*sizeof(MYFLT));
+    for (j = 0; j < GRAIN_LANES; ++j)
+        g.buf[j] = bufs + j*CS_KSMPS;
+    /* newest grain first, the order in which the grains are mixed */
+    for (k = s->first + s->count; k-- > s->first; )
+        if (s->start[k] < CS_KSMPS)
+            active[nactive++] = k;
+
+    for (b = 0; b < nactive; b += GRAIN_LANES) {
+        unsigned nl = nactive - b < GRAIN_LANES ? nactive - b : GRAIN_LANES;
+        unsigned waves = 0, maxlen = 0, t, t1;
+
+        for (j = 0; j < GRAIN_LANES; ++j) {
+            if ((unsigned)j < nl) {
+                waves |= load_lane(p, &g, j, active[b + j], fm);
+                maxlen = g.len[j] > maxlen ? g.len[j] : maxlen;
+            } else
+                clear_lane(p, &g, j, fm);
+        }
+        /* render up to the end of the shortest grain still going on, save
+         * the grains that end there, and carry on with the rest */
+        for (t = 0; t < maxlen; t = t1) {
+            t1 = maxlen;
+            for (j = 0; (unsigned)j < nl; ++j)
+                if (g.len[j] > t && g.len[j] < t1)
+                    t1 = g.len[j];
+            render_lanes(p, &g, t, t1, waves);
+            for (j = 0; (unsigned)j < nl; ++j)
+                if (g.len[j] == t1 && s->stop[g.pos[j]] > CS_KSMPS)
+                    store_lane(s, &g, j);
+        }
+        /* now distribute the grains to the output channels they're
+         * supposed to end up in, as decided by the channel mask */
+        for (j = 0; (unsigned)j < nl; ++j) {
+            unsigned k = g.pos[j];
+            MYFLT *out1 = *(&(p->output1) + s->chan1[k]) + g.lo[j];
+            MYFLT *out2 = *(&(p->output1) + s->chan2[k]) + g.lo[j];
+            const MYFLT *buf = g.buf[j];
+            MYFLT gain1 = s->gain1[k], gain2 = s->gain2[k];
+
+            for (t = 0; t < g.len[j]; ++t) {
+                out1[t] += buf[t]*gain1;
+                out2[t] += buf[t]*gain2;
+            }
+        }
     }
-    /* now clear the area we just worked in */
-    memset(buf + grain->start, 0, (stop - grain->start)*sizeof(MYFLT));
 }
 
 static int partikkel(CSOUND *csound, PARTIKKEL *p)
 {
     int ret;
     unsigned int n;
-    NODE **nodeptr;
     MYFLT **outputs = &p->output1;
 
     if (UNLIKELY(p->aux.auxp == NULL || p->aux2.auxp == NULL))
@@ -804,27 +1282,8 @@ static int partikkel(CSOUND *csound, PARTIKKEL *p)
     for (n = 0; n < p->num_outputs; ++n)
         memset(outputs[n], 0, sizeof(MYFLT)*CS_KSMPS);
 
-    /* prepare to traverse grain list */
-    nodeptr = &p->grainroot;
-    while (*nodeptr) {
-        GRAIN *grain = &((*nodeptr)->grain);
-
-        /* render current grain to outputs */
-        render_grain(csound, p, grain);
-        /* check if grain is finished */
-        if (grain->stop <= CS_KSMPS) {
-            /* grain is finished, deactivate it */
-            *nodeptr = return_grain(&p->gpool, *nodeptr);
-        } else {
-            /* extend grain lifetime with one k-period and find next grain */
-            if (CS_KSMPS > grain->start)
-                grain->start = 0; /* grain is active */
-            else
-                grain->start -= CS_KSMPS; /* grain is not yet active */
-            grain->stop -= CS_KSMPS;
-            nodeptr = &((*nodeptr)->next);
-        }
-    }
+    render_grains(p);
+    retire_grains(&p->gpool, CS_KSMPS);
     return OK;
 }
 
@@ -21,40 +21,38 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "csoundCore.h"
 #include "interlocks.h"
 
+/* per-wave grain state, one array entry per grain (see GRAINPOOL) */
 typedef struct {
-    FUNC *table;
-    double phase, delta;
-    double sweepoffset, sweepdecay;
-    MYFLT gain;
+    FUNC **table;
+    double *phase, *delta;
+    double *sweepoffset, *sweepdecay;
+    MYFLT *gain;
 } WAVEDATA;
 
-typedef struct {
-    unsigned start, stop;
-    double envphase, envinc;
-    double envattacklen, envdecaystart;
-    double env2amount;
-    MYFLT fmamp;
-    FUNC *fmenvtab;
-    unsigned harmonics;
-    MYFLT falloff, falloff_pow_N;
-    MYFLT gain1, gain2;
-    unsigned chan1, chan2;
-    WAVEDATA wav[5];
-} GRAIN;
-
-/* which of the wav[] entries above correspond to the trainlet generator */
+/* which of the wav[] entries below correspond to the trainlet generator */
 #define WAV_TRAINLET 4
 
-/* support structs for the grain pool routines */
-typedef struct NODE {
-    GRAIN grain;
-    struct NODE *next;
-} NODE;
-
+/* The grain pool keeps its grains as a structure of arrays: entry k of
+ * every array belongs to the same grain.  Live grains occupy entries
+ * first .. first + count - 1, oldest first, so a new grain is added at the
+ * end and the oldest one killed at the front in constant time.  Finished
+ * grains are squeezed out once per k-period, which also moves first back
+ * to zero.  Up to one grain can be killed per sample, so the arrays have
+ * room for max_grains + ksmps entries. */
 typedef struct {
-    NODE *grainlist;
-    char *mempool;
-    unsigned free_nodes;
+    unsigned *start, *stop;
+    double *envphase, *envinc;
+    double *envattacklen, *envdecaystart;
+    double *env2amount;
+    MYFLT *fmamp;
+    FUNC **fmenvtab;
+    unsigned *harmonics;
+    MYFLT *falloff, *falloff_pow_N;
+    MYFLT *gain1, *gain2;
+    unsigned *chan1, *chan2;
+    WAVEDATA wav[5];
+    unsigned first, count;
+    unsigned max_grains;
 } GRAINPOOL;
 
 struct PARTIKKEL;
@@ -122,7 +120,6 @@ typedef struct PARTIKKEL {
     PARTIKKEL_GLOBALS *globals;
     PARTIKKEL_GLOBALS_ENTRY *globals_entry;
     GRAINPOOL gpool;
-    NODE *grainroot;
     int out_of_voices_warning;
     unsigned num_outputs;
     int grainfreq_arate;
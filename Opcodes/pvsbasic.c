@@ -28,6 +28,7 @@
 #include "pvs_ops.h"
 #include "pvsbasic.h"
 #include "pvfileio.h"
+#include "spectral.h"
 #include <math.h>
 #define MAXOUTS 16
 
@@ -914,10 +915,15 @@ static int pvsoscprocess(CSOUND *csound, PVSOSC *p)
         cfbin = freq/w;
         cbin = (int)MYFLT2LRND(cfbin);
          if (cbin != 0)     {
-        for (i=cbin-1;i < cbin+3 &&i < framesize/2 ; i++) {
+        double  d[4], s[4];
+        int     j, nb = 0;
+        for (i=cbin-1;i < cbin+3 &&i < framesize/2 ; i++)
+          d[nb++] = i-cfbin;
+        spec_sin(s, d, nb, csound->oparms->spectralApprox);
+        for (i=cbin-1, j=0; j < nb; i++, j++) {
           k = i<<1;
-          if (i-cfbin == 0) a = 1;
-          else a = sin(i-cfbin)/(i-cfbin);
+          if (d[j] == 0) a = 1;
+          else a = s[j]/d[j];
           fout[k] = amp*a*a*a;
           fout[k+1] = freq;
         }
@@ -1120,14 +1126,7 @@ static int pvsmoothprocess(CSOUND *csound, PVSMOOTH *p)
       coef1 = sqrt(costh1 * costh1 - 1.0) - costh1;
       coef2 = sqrt(costh2 * costh2 - 1.0) - costh2;
 
-      for (i = 0; i < framesize; i += 2) {
-        /* amp smoothing */
-        fout[i] = (float) (fin[i] * (1.0 + coef1) - del[i] * coef1);
-        /* freq smoothing */
-        fout[i + 1] = (float) (fin[i + 1] * (1.0 + coef2) - del[i + 1] * coef1);
-        del[i] = fout[i];
-        del[i + 1] = fout[i + 1];
-      }
+      spec_smooth(fout, fin, del, framesize/2, coef1, coef2);
       p->fout->framecount = p->lastframe = p->fin->framecount;
     }
     return OK;
@@ -1170,7 +1169,6 @@ static int pvsmix(CSOUND *csound, PVSMIX *p)
 {
     int     i;
     int32    framesize;
-    int     test;
     float   *fout, *fa, *fb;
 
     if (UNLIKELY(!fsigs_equal(p->fa, p->fb))) goto err1;
@@ -1200,17 +1198,7 @@ static int pvsmix(CSOUND *csound, PVSMIX *p)
     framesize = p->fa->N + 2;
 
     if (p->lastframe < p->fa->framecount) {
-      for (i = 0; i < framesize; i += 2) {
-        test = fa[i] >= fb[i];
-        if (test) {
-          fout[i] = fa[i];
-          fout[i + 1] = fa[i + 1];
-        }
-        else {
-          fout[i] = fb[i];
-          fout[i + 1] = fb[i + 1];
-        }
-      }
+      spec_mix(fout, fa, fb, framesize/2);
       p->fout->framecount =  p->fa->framecount;
       p->lastframe = p->fout->framecount;
     }
@@ -1299,10 +1287,7 @@ static int pvsfilter(CSOUND *csound, PVSFILTER *p)
     if (p->lastframe < p->fin->framecount) {
       kdepth = kdepth >= 0 ? (kdepth <= 1 ? kdepth : 1) : FL(0.0);
       dirgain = (1 - kdepth);
-      for (i = 0; i < N + 2; i += 2) {
-        fout[i] = (float) (fin[i] * (dirgain + fil[i] * kdepth))*g;
-        fout[i + 1] = fin[i + 1];
-      }
+      spec_filter(fout, fin, fil, N/2 + 1, dirgain, kdepth, g);
 
       p->fout->framecount = p->lastframe = p->fin->framecount;
     }
@@ -1978,6 +1963,9 @@ static int pvsblurset(CSOUND *csound, PVSBLUR *p)
           p->delframes.size < (N + 2) * sizeof(float) * CS_KSMPS * delayframes)
           csound->AuxAlloc(csound, (N + 2) * sizeof(float) * delayframes,
                            &p->delframes);
+
+        if (p->sum.auxp == NULL || p->sum.size < (N + 2) * sizeof(double))
+          csound->AuxAlloc(csound, (N + 2) * sizeof(double), &p->sum);
       }
     delay = (float *) p->delframes.auxp;
 
@@ -2056,29 +2044,27 @@ static int pvsblur(CSOUND *csound, PVSBLUR *p)
 
       kdel = kdel >= 0 ? (kdel < mdel ? kdel : mdel - framesize) : 0;
 
-      for (i = 0; i < N + 2; i += 2) {
-
+      for (i = 0; i < N + 2; i++)
         delay[countr + i] = fin[i];
-        delay[countr + i + 1] = fin[i + 1];
 
-        if (kdel) {
+      if (kdel) {
+        /* a frame at a time into the sums, which are added to in the
+           same order as bin by bin */
+        double  *sum = (double *) p->sum.auxp;
 
-          if ((first = countr - kdel) < 0)
-            first += mdel;
+        if ((first = countr - kdel) < 0)
+          first += mdel;
 
-          for (j = first; j != countr; j = (j + framesize) % mdel) {
-            amp += delay[j + i];
-            freq += delay[j + i + 1];
-          }
+        memset(sum, 0, sizeof(double) * framesize);
+        for (j = first; j != countr; j = (j + framesize) % mdel)
+          spec_accum(sum, delay + j, framesize/2);
 
-          fout[i] = (float) (amp / delayframes);
-          fout[i + 1] = (float) (freq / delayframes);
-          amp = freq = 0.;
-        }
-        else {
+        for (i = 0; i < N + 2; i++)
+          fout[i] = (float) (sum[i] / delayframes);
+      }
+      else {
+        for (i = 0; i < N + 2; i++)
           fout[i] = fin[i];
-          fout[i + 1] = fin[i + 1];
-        }
       }
 
       p->fout->framecount = p->lastframe = p->fin->framecount;
@@ -2489,11 +2475,11 @@ static OENTRY localops[] = {
                                (SUBR) pvsenvwset, (SUBR) pvsenvw},
   {"pvsgain", sizeof(PVSGAIN), 0,3, "f", "fk",
                                (SUBR) pvsgainset, (SUBR) pvsgain, NULL},
-  {"pvs2tab", sizeof(PVS2TAB_T), 0,3, "k", "k[]f",
+  {"pvs2tab", sizeof(PVS2TAB_T), IW,3, "k", "k[]f",
                                (SUBR) pvs2tab_init, (SUBR) pvs2tab, NULL},
   {"tab2pvs", sizeof(TAB2PVS_T), 0, 3, "f", "k[]oop", (SUBR) tab2pvs_init,
                                                      (SUBR) tab2pvs, NULL},
-  {"pvs2array", sizeof(PVS2TAB_T), 0,3, "k", "k[]f",
+  {"pvs2array", sizeof(PVS2TAB_T), IW,3, "k", "k[]f",
                                (SUBR) pvs2tab_init, (SUBR) pvs2tab, NULL},
   {"pvsfromarray", sizeof(TAB2PVS_T), 0, 3, "f", "k[]oop",
                                (SUBR) tab2pvs_init, (SUBR) tab2pvs, NULL}
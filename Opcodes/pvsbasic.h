@@ -199,6 +199,7 @@ typedef struct _pvsblur {
     MYFLT   *kdel;
     MYFLT   *maxdel;
     AUXCH   delframes;
+    AUXCH   sum;
     MYFLT   frpsec;
     int32   count;
     uint32  lastframe;
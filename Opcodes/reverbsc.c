@@ -33,6 +33,7 @@
 */
 
 #include "stdopcod.h"
+#include "cs_simd.h"
 #include <math.h>
 
 #define DEFAULT_SRATE   44100.0
@@ -202,16 +203,134 @@ static int sc_reverb_init(CSOUND *csound, SC_REVERB *p)
     return OK;
 }
 
+/* The eight delay lines are run side by side, one lane per line: their
+   state is copied into arrays for the k-cycle, and each step (position
+   update, reads, interpolation and filter) is a loop across the lines,
+   so that all but the reads, the writes and the rare random segment
+   updates is done on whole vectors.  The arithmetic is that of the
+   one-line-at-a-time loop, sample for sample. */
+
+CS_CLONES
+static void sc_reverb_lines(SC_REVERB *p, uint32_t offset, uint32_t nsmps,
+                            double dampFact)
+{
+    MYFLT     *base = (MYFLT*) p->auxData.auxp;
+    double    feedBack = (double) *(p->kFeedBack);
+    double    filterState[8], v[8];
+    MYFLT     xm1[8], x0[8], x1[8], x2[8];
+    int       start[8], bufferSize[8], writePos[8], readPos[8];
+    int       readPosFrac[8], readPosFrac_inc[8], randLine_cnt[8];
+    uint32_t  i;
+    int       n, due;
+
+    for (n = 0; n < 8; n++) {
+      delayLine *lp = p->delayLines[n];
+      start[n] = (int) (lp->buf - base);
+      bufferSize[n] = lp->bufferSize;
+      writePos[n] = lp->writePos;
+      readPos[n] = lp->readPos;
+      readPosFrac[n] = lp->readPosFrac;
+      readPosFrac_inc[n] = lp->readPosFrac_inc;
+      randLine_cnt[n] = lp->randLine_cnt;
+      filterState[n] = lp->filterState;
+    }
+    for (i = offset; i < nsmps; i++) {
+      double  ainL, ainR, aoutL, aoutR;
+      /* calculate "resultant junction pressure" and mix to input signals */
+      ainL = 0.0;
+      for (n = 0; n < 8; n++)
+        ainL += filterState[n];
+      ainL *= jpScale;
+      ainR = ainL + (double) p->ainR[i];
+      ainL = ainL + (double) p->ainL[i];
+      /* send input signal and feedback to delay lines */
+      for (n = 0; n < 8; n++)
+        base[start[n] + writePos[n]] =
+          (MYFLT) ((n & 1 ? ainR : ainL) - filterState[n]);
+      /* advance the write and read positions */
+      for (n = 0; n < 8; n++) {
+        int     carry;
+        if (++writePos[n] >= bufferSize[n])
+          writePos[n] -= bufferSize[n];
+        carry = readPosFrac[n] >= DELAYPOS_SCALE;
+        readPos[n] += carry ? (readPosFrac[n] >> DELAYPOS_SHIFT) : 0;
+        readPosFrac[n] = carry ? (readPosFrac[n] & DELAYPOS_MASK)
+                               : readPosFrac[n];
+        if (readPos[n] >= bufferSize[n])
+          readPos[n] -= bufferSize[n];
+      }
+      /* read four samples for interpolation, checking the index at
+         buffer wrap-around */
+      for (n = 0; n < 8; n++) {
+        const MYFLT *buf = base + start[n];
+        int     rp = readPos[n], bs = bufferSize[n];
+        if (LIKELY(rp > 0 && rp < bs - 2)) {
+          xm1[n] = buf[rp - 1]; x0[n] = buf[rp];
+          x1[n] = buf[rp + 1]; x2[n] = buf[rp + 2];
+        }
+        else {
+          xm1[n] = buf[rp == 0 ? bs - 1 : rp - 1];
+          x0[n] = buf[rp];
+          x1[n] = buf[rp + 1 >= bs ? rp + 1 - bs : rp + 1];
+          x2[n] = buf[rp + 2 >= bs ? rp + 2 - bs : rp + 2];
+        }
+      }
+      for (n = 0; n < 8; n++) {
+        double  vm1, v0, v1, v2, am1, a0, a1, a2, frac;
+        /* cubic interpolation */
+        frac = (double) readPosFrac[n] * (1.0 / (double) DELAYPOS_SCALE);
+        a2 = frac * frac; a2 -= 1.0; a2 *= (1.0 / 6.0);
+        a1 = frac; a1 += 1.0; a1 *= 0.5; am1 = a1 - 1.0;
+        a0 = 3.0 * a2; a1 -= a0; am1 -= a2; a0 -= frac;
+        vm1 = (double) xm1[n]; v0 = (double) x0[n];
+        v1 = (double) x1[n]; v2 = (double) x2[n];
+        v0 = (am1 * vm1 + a0 * v0 + a1 * v1 + a2 * v2) * frac + v0;
+        /* update buffer read position */
+        readPosFrac[n] += readPosFrac_inc[n];
+        /* apply feedback gain and lowpass filter */
+        v0 *= feedBack;
+        v0 = (filterState[n] - v0) * dampFact + v0;
+        filterState[n] = v[n] = v0;
+      }
+      /* mix to output */
+      aoutL = aoutR = 0.0;
+      for (n = 0; n < 8; n += 2) {
+        aoutL += v[n];
+        aoutR += v[n + 1];
+      }
+      p->aoutL[i] = (MYFLT) (aoutL * outputGain);
+      p->aoutR[i] = (MYFLT) (aoutR * outputGain);
+      /* start next random line segment if current one has reached endpoint */
+      for (n = 0, due = 0; n < 8; n++)
+        due |= (--randLine_cnt[n] <= 0);
+      for (n = 0; UNLIKELY(due) && n < 8; n++) {
+        if (randLine_cnt[n] <= 0) {
+          delayLine *lp = p->delayLines[n];
+          lp->writePos = writePos[n];
+          lp->readPos = readPos[n];
+          lp->readPosFrac = readPosFrac[n];
+          next_random_lineseg(p, lp, n);
+          readPosFrac_inc[n] = lp->readPosFrac_inc;
+          randLine_cnt[n] = lp->randLine_cnt;
+        }
+      }
+    }
+    for (n = 0; n < 8; n++) {
+      delayLine *lp = p->delayLines[n];
+      lp->writePos = writePos[n];
+      lp->readPos = readPos[n];
+      lp->readPosFrac = readPosFrac[n];
+      lp->readPosFrac_inc = readPosFrac_inc[n];
+      lp->randLine_cnt = randLine_cnt[n];
+      lp->filterState = filterState[n];
+    }
+}
+
 static int sc_reverb_perf(CSOUND *csound, SC_REVERB *p)
 {
-    double    ainL, ainR, aoutL, aoutR;
-    double    vm1, v0, v1, v2, am1, a0, a1, a2, frac;
-    delayLine *lp;
-    int       readPos;
     uint32_t offset = p->h.insdshead->ksmps_offset;
     uint32_t early  = p->h.insdshead->ksmps_no_end;
-    uint32_t i, n, nsmps = CS_KSMPS;
-    int       bufferSize; /* Local copy */
+    uint32_t nsmps = CS_KSMPS;
     double    dampFact = p->dampFact;
 
     if (p->initDone <= 0) goto err1;
@@ -231,73 +350,7 @@ static int sc_reverb_perf(CSOUND *csound, SC_REVERB *p)
       memset(&p->aoutR[nsmps], '\0', early*sizeof(MYFLT));
     }
     /* update delay lines */
-    for (i = offset; i < nsmps; i++) {
-      /* calculate "resultant junction pressure" and mix to input signals */
-      ainL = aoutL = aoutR = 0.0;
-      for (n = 0; n < 8; n++)
-        ainL += p->delayLines[n]->filterState;
-      ainL *= jpScale;
-      ainR = ainL + (double) p->ainR[i];
-      ainL = ainL + (double) p->ainL[i];
-      /* loop through all delay lines */
-      for (n = 0; n < 8; n++) {
-        lp = p->delayLines[n];
-        bufferSize = lp->bufferSize;
-        /* send input signal and feedback to delay line */
-        lp->buf[lp->writePos] = (MYFLT) ((n & 1 ? ainR : ainL)
-                                         - lp->filterState);
-        if (UNLIKELY(++lp->writePos >= bufferSize))
-          lp->writePos -= bufferSize;
-        /* read from delay line with cubic interpolation */
-        if (lp->readPosFrac >= DELAYPOS_SCALE) {
-          lp->readPos += (lp->readPosFrac >> DELAYPOS_SHIFT);
-          lp->readPosFrac &= DELAYPOS_MASK;
-        }
-        if (UNLIKELY(lp->readPos >= bufferSize))
-          lp->readPos -= bufferSize;
-        readPos = lp->readPos;
-        frac = (double) lp->readPosFrac * (1.0 / (double) DELAYPOS_SCALE);
-        /* calculate interpolation coefficients */
-        a2 = frac * frac; a2 -= 1.0; a2 *= (1.0 / 6.0);
-        a1 = frac; a1 += 1.0; a1 *= 0.5; am1 = a1 - 1.0;
-        a0 = 3.0 * a2; a1 -= a0; am1 -= a2; a0 -= frac;
-        /* read four samples for interpolation */
-        if (readPos > 0 && readPos < (bufferSize - 2)) {
-          vm1 = (double) (lp->buf[readPos - 1]);
-          v0  = (double) (lp->buf[readPos]);
-          v1  = (double) (lp->buf[readPos + 1]);
-          v2  = (double) (lp->buf[readPos + 2]);
-        }
-        else {
-          /* at buffer wrap-around, need to check index */
-          if (--readPos < 0) readPos += bufferSize;
-          vm1 = (double) lp->buf[readPos];
-          if (++readPos >= bufferSize) readPos -= bufferSize;
-          v0 = (double) lp->buf[readPos];
-          if (++readPos >= bufferSize) readPos -= bufferSize;
-          v1 = (double) lp->buf[readPos];
-          if (++readPos >= bufferSize) readPos -= bufferSize;
-          v2 = (double) lp->buf[readPos];
-        }
-        v0 = (am1 * vm1 + a0 * v0 + a1 * v1 + a2 * v2) * frac + v0;
-        /* update buffer read position */
-        lp->readPosFrac += lp->readPosFrac_inc;
-        /* apply feedback gain and lowpass filter */
-        v0 *= (double) *(p->kFeedBack);
-        v0 = (lp->filterState - v0) * dampFact + v0;
-        lp->filterState = v0;
-        /* mix to output */
-        if (n & 1)
-          aoutR += v0;
-        else
-          aoutL += v0;
-        /* start next random line segment if current one has reached endpoint */
-        if (--(lp->randLine_cnt) <= 0)
-          next_random_lineseg(p, lp, n);
-      }
-      p->aoutL[i] = (MYFLT) (aoutL * outputGain);
-      p->aoutR[i] = (MYFLT) (aoutR * outputGain);
-    }
+    sc_reverb_lines(p, offset, nsmps, dampFact);
 
     return OK;
  err1:
@@ -100,9 +100,9 @@ static int vasigset(CSOUND *csound, VASIG_SET *p)
 
 static OENTRY vaops_localops[] = {
   { "vaget", S(VA_GET),    0, 2,      "k", "ka",  NULL, (SUBR)vaget },
-  { "vaset", S(VA_SET),    0, 2,      "",  "kka", NULL, (SUBR)vaset },
+  { "vaset", S(VA_SET),    IW, 2,      "",  "kka", NULL, (SUBR)vaset },
   { "##array_get", S(VASIG_GET),    0, 2,      "k", "ak",  NULL, (SUBR)vasigget },
-  { "##array_set", S(VASIG_SET),    0, 2,      "",  "akk", NULL, (SUBR)vasigset }
+  { "##array_set", S(VASIG_SET),    IW, 2,      "",  "akk", NULL, (SUBR)vasigset }
 };
 
 
@@ -24,6 +24,7 @@
 #include "soundio.h"
 #include "new_opts.h"
 #include "csmodule.h"
+#include "csprofile.h"
 #include <ctype.h>
 
 static void list_audio_devices(CSOUND *csound, int output);
@@ -196,6 +197,22 @@ static const char *longUsageList[] = {
   Str_noop("--postscriptdisplay\tSuppress graphics, use Postscript displays"),
   " ",
   Str_noop("--defer-gen1\t\tDefer GEN01 soundfile loads until performance time"),
+  Str_noop("--mmap-gen1\t\tMap GEN01 tables from a cache of decoded samples"),
+  Str_noop("\t\t\tin GEN01CACHE, reading pages from disk as used"),
+  Str_noop("--ftgen-threads=N\tGenerate tables from GENs 9-14, 19 and 20 on"),
+  Str_noop("\t\t\tN threads, alongside the rest of the score"),
+  Str_noop("--ftgen-cache\t\tKeep tables from those GENs in FTGENCACHE and"),
+  Str_noop("\t\t\treuse them in later runs"),
+  Str_noop("--diskin-threads=N\tRead ahead real-time diskin2 streams on N"),
+  Str_noop("\t\t\tthreads (default 1, 0 reads them synchronously)"),
+  Str_noop("--pvs-batch[=thread]\tTransform the frames of pvsanal instances"),
+  Str_noop("\t\t\twith the same parameters together (on a worker"),
+  Str_noop("\t\t\tthread), one hop later"),
+  Str_noop("--spectral-approx=N\tApproximate atan2, sin and cos in the pvs and"),
+  Str_noop("\t\t\tspectral array opcodes: 0 libm (default), 1 to"),
+  Str_noop("\t\t\tabout 1e-7, 2 to about 1e-5"),
+  Str_noop("--array-threads=N\tShare arithmetic, reductions and tabmap on"),
+  Str_noop("\t\t\tlarge k-rate arrays between N threads"),
   Str_noop("--iobufsamps=N\t\tSample frames (or -kprds) per software "
            "sound I/O buffer"),
   Str_noop("--hardwarebufsamps=N\tSamples per hardware sound I/O buffer"),
@@ -274,6 +291,27 @@ static const char *longUsageList[] = {
   Str_noop("--no-default-paths\tTurn off relative paths from CSD/ORC/SCO"),
   Str_noop("--sample-accurate\t\tUse sample-accurate timing of score events"),
   Str_noop("--realtime\t\trealtime priority mode"),
+  Str_noop("--par-scheduler=NAME\t task dispatch for -j: scan (default) "
+           "or steal"),
+  Str_noop("--instance-pool[=N]\t build instrument instances ahead of time "
+           "in a"),
+  Str_noop("\t\t\t background thread, keeping N spare (default 2)"),
+  Str_noop("--fft-backend=NAME\t power-of-two FFTs: plan (vectorised, "
+           "default) or scalar"),
+  Str_noop("--udo-args=NAME\t\t UDO arguments: ref (pass by reference where "
+           "safe,"),
+  Str_noop("\t\t\t default) or copy (copy every k-cycle)"),
+  Str_noop("--inline-udos[=N]\t inline calls to UDOs of up to N statements "
+           "(default 32)"),
+  Str_noop("--opt-level=N\t\t orchestra optimisation: 0 off (default), 1 fold"),
+  Str_noop("\t\t\t constants, remove dead code and fuse a-rate"),
+  Str_noop("\t\t\t arithmetic, 2 also merge common subexpressions"),
+  Str_noop("\t\t\t and inline UDOs"),
+  Str_noop("--profile[=N]\t\t print a performance profile at the end, "
+           "timing"),
+  Str_noop("\t\t\t opcodes on one k-cycle in N (default 16)"),
+  Str_noop("--profile-trace=FNAME\t write a Chrome trace of k-cycles and "
+           "instruments"),
   Str_noop("--nchnls=N\t\t override number of audio channels"),
   Str_noop("--nchnls_i=N\t\t override number of input audio channels"),
   Str_noop("--0dbfs=N\t\t override 0dbfs (max positive signal amplitude)"),
@@ -517,6 +555,44 @@ static int decode_long(CSOUND *csound, char *s, int argc, char **argv)
       O->gen01defer = 1;                /* defer GEN01 sample loads */
       return 1;                         /*   until performance time */
     }
+    else if (!(strcmp (s, "mmap-gen1"))) {
+      O->gen01mmap = 1;                 /* map GEN01 tables from a */
+      return 1;                         /*   cache file */
+    }
+    else if (!(strncmp (s, "ftgen-threads=", 14))) {
+      s += 14;
+      O->ftgenThreads = atoi(s);        /* generate tables on threads */
+      return 1;
+    }
+    else if (!(strcmp (s, "ftgen-cache"))) {
+      O->ftgenCache = 1;                /* cache generated tables */
+      return 1;
+    }
+    else if (!(strncmp (s, "diskin-threads=", 15))) {
+      s += 15;
+      O->diskinThreads = atoi(s);       /* diskin2 streaming threads */
+      return 1;
+    }
+    else if (!(strcmp (s, "pvs-batch"))) {
+      O->pvsBatch = 1;                  /* batch pvsanal transforms */
+      return 1;
+    }
+    else if (!(strcmp (s, "pvs-batch=thread"))) {
+      O->pvsBatch = 2;                  /*   on a worker thread */
+      return 1;
+    }
+    else if (!(strncmp (s, "spectral-approx=", 16))) {
+      s += 16;
+      O->spectralApprox = atoi(s);      /* polynomial atan2, sin, cos */
+      if (O->spectralApprox < 0) O->spectralApprox = 0;
+      if (O->spectralApprox > 2) O->spectralApprox = 2;
+      return 1;
+    }
+    else if (!(strncmp (s, "array-threads=", 14))) {
+      s += 14;
+      O->arrayThreads = atoi(s);        /* split large array operations */
+      return 1;
+    }
     else if (!(strncmp (s, "midifile=", 9))) {
       s += 9;
       if (UNLIKELY(*s == '\0')) dieu(csound, Str("no midifile name"));
@@ -945,6 +1021,87 @@ static int decode_long(CSOUND *csound, char *s, int argc, char **argv)
       O->numThreads = atoi(s);
       return 1;
     }
+    else if (!(strncmp (s, "par-scheduler=", 14))) {
+      s += 14;
+      if (!strcmp(s, "steal"))
+        O->parScheduler = PAR_SCHED_STEAL;
+      else if (!strcmp(s, "scan"))
+        O->parScheduler = PAR_SCHED_SCAN;
+      else {
+        csound->Warning(csound, Str("unknown scheduler '%s', using 'scan'"), s);
+        O->parScheduler = PAR_SCHED_SCAN;
+      }
+      return 1;
+    }
+    else if (!(strncmp(s, "fft-backend=", 12))) {
+      s += 12;
+      if (!strcmp(s, "plan"))
+        O->fftBackend = FFT_BACKEND_PLAN;
+      else if (!strcmp(s, "scalar"))
+        O->fftBackend = FFT_BACKEND_SCALAR;
+      else {
+        csound->Warning(csound, Str("unknown FFT backend '%s', using 'plan'"),
+                        s);
+        O->fftBackend = FFT_BACKEND_PLAN;
+      }
+      return 1;
+    }
+    else if (!(strncmp(s, "udo-args=", 9))) {
+      s += 9;
+      if (!strcmp(s, "ref"))
+        O->udoArgs = UDO_ARGS_REF;
+      else if (!strcmp(s, "copy"))
+        O->udoArgs = UDO_ARGS_COPY;
+      else {
+        csound->Warning(csound, Str("unknown UDO argument passing '%s', "
+                                    "using 'ref'"), s);
+        O->udoArgs = UDO_ARGS_REF;
+      }
+      return 1;
+    }
+    else if (!(strcmp(s, "inline-udos"))) {
+      O->inlineUDOs = 32;
+      return 1;
+    }
+    else if (!(strncmp(s, "inline-udos=", 12))) {
+      s += 12;
+      O->inlineUDOs = atoi(s);
+      return 1;
+    }
+    else if (!(strncmp(s, "opt-level=", 10))) {
+      s += 10;
+      O->optLevel = atoi(s);
+      if (O->optLevel < 0 || O->optLevel > 2) {
+        csound->Warning(csound, Str("unknown optimisation level %d, "
+                                    "using 0"), O->optLevel);
+        O->optLevel = 0;
+      }
+      return 1;
+    }
+    else if (!(strcmp(s, "instance-pool"))) {
+      O->instancePool = 2;
+      return 1;
+    }
+    else if (!(strncmp(s, "instance-pool=", 14))) {
+      s += 14;
+      O->instancePool = atoi(s);
+      return 1;
+    }
+    else if (!(strcmp(s, "profile"))) {
+      csprofile_option(csound, CSPROFILE_PERIOD, NULL);
+      return 1;
+    }
+    else if (!(strncmp(s, "profile=", 8))) {
+      s += 8;
+      csprofile_option(csound, atoi(s), NULL);
+      return 1;
+    }
+    else if (!(strncmp(s, "profile-trace=", 14))) {
+      s += 14;
+      if (UNLIKELY(*s == '\0')) dieu(csound, Str("no trace file name"));
+      csprofile_option(csound, 0, s);
+      return 1;
+    }
     else if (!(strcmp (s, "syntax-check-only"))) {
       O->syntaxCheckOnly = 1;
       return 1;
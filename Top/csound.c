@@ -71,6 +71,7 @@
 #include "csound_standard_types.h"
 
 #include "csdebug.h"
+#include "csprofile.h"
 
 static void SetInternalYieldCallback(CSOUND *, int (*yieldCallback)(CSOUND *));
 int  playopen_dummy(CSOUND *, const csRtAudioParams *parm);
@@ -624,6 +625,7 @@ static const CSOUND cenviron_ = {
     { 0, NULL, NULL, '\0', 0, FL(0.0),
       FL(0.0), { FL(0.0) }, {NULL}},   /*  evt */
     NULL,           /*  memalloc_db         */
+    NULL,           /*  mempool             */
     (MGLOBAL*) NULL, /* midiGlobals         */
     NULL,           /*  envVarDB            */
     (MEMFIL*) NULL, /*  memfiles            */
@@ -818,7 +820,20 @@ static const CSOUND cenviron_ = {
       0,            /*    realtime  */
       0.0,          /*    0dbfs override */
       0,            /*    no exit on compile error */
-      0.4           /*    vbr quality  */
+      0.4,          /*    vbr quality  */
+      PAR_SCHED_SCAN, /*  parScheduler */
+      0,            /*    instancePool */
+      FFT_BACKEND_PLAN, /* fftBackend */
+      UDO_ARGS_REF, /*    udoArgs */
+      -1,           /*    inlineUDOs */
+      0,            /*    optLevel */
+      0,            /*    gen01mmap */
+      0,            /*    ftgenThreads */
+      0,            /*    ftgenCache */
+      1,            /*    diskinThreads */
+      0,            /*    pvsBatch */
+      0,            /*    spectralApprox */
+      0             /*    arrayThreads */
     },
 
     {0, 0, {0}}, /* REMOT_BUF */
@@ -848,6 +863,11 @@ static const CSOUND cenviron_ = {
     NULL,           /* dag_wlmm */
     NULL,           /* dag_task_dep */
     100,            /* dag_task_max_size */
+    NULL,           /* dag_ws */
+    NULL,           /* dag_first_dep */
+    NULL,           /* dag_dep_cache */
+    NULL,           /* dag_ins_first */
+    0,              /* dag_dep_cache_size */
     0,              /* tempStatus */
     0,              /* orcLineOffset */
     0,              /* scoLineOffset */
@@ -871,7 +891,17 @@ static const CSOUND cenviron_ = {
     -1,             /* audio system sr */
     0,              /* csdebug_data */
     kperf_nodebug,  /* current kperf function - nodebug by default */
-    0               /* which score parser */
+    0,              /* which score parser */
+    NULL,           /* csprofile_data */
+    NULL, NULL, NULL, 0, /* instance pool thread */
+    NULL,           /* init_pass_queue */
+    NULL,           /* chn_updates */
+    NULL,           /* rt_event_queue */
+    NULL,           /* FFT_plans */
+    NULL,           /* gen01_maps */
+    NULL,           /* ftgen_pool */
+    0,              /* ftgen_pending */
+    NULL            /* array_pool */
     /*, NULL */           /* self-reference */
 };
 
@@ -1323,94 +1353,117 @@ int dag_get_task(CSOUND *csound);
 int dag_end_task(CSOUND *csound, int task);
 void dag_build(CSOUND *csound, INSDS *chain);
 void dag_reinit(CSOUND *csound);
+void dag_ws_reinit(CSOUND *csound, int changed);
+int dag_ws_get_task(CSOUND *csound, int index);
+void dag_ws_end_task(CSOUND *csound, int index, int task);
 
-inline static int nodePerf(CSOUND *csound, int index)
-{
-    INSDS *insds = NULL;
-    OPDS  *opstart = NULL;
-    int played_count = 0;
-    int which_task;
-    INSDS **task_map = (INSDS**)csound->dag_task_map;
-    double time_end;
 #define INVALID (-1)
 #define WAIT    (-2)
-    IGN(index);
 
-    while(1) {
-      int done;
-      which_task = dag_get_task(csound);
-      //printf("******** Select task %d\n", which_task);
-      if (which_task==WAIT) continue;
-      if (which_task==INVALID) return played_count;
-         /* VL: the validity of icurTime needs to be checked */
-        time_end = (csound->ksmps+csound->icurTime)/csound->esr;
-        insds = task_map[which_task];
-        if (insds->offtim > 0 && time_end > insds->offtim){
-            /* this is the last cycle of performance */
-            insds->ksmps_no_end = insds->no_end;
-          }
+/* Run one k-cycle of a single instance; returns 1 if it was performed */
+inline static int dagPerfTask(CSOUND *csound, INSDS *insds)
+{
+    OPDS  *opstart = (OPDS*) insds;
+    /* VL: the validity of icurTime needs to be checked */
+    double time_end = (csound->ksmps+csound->icurTime)/csound->esr;
+    int done;
+
+    if (insds->offtim > 0 && time_end > insds->offtim) {
+      /* this is the last cycle of performance */
+      insds->ksmps_no_end = insds->no_end;
+    }
 #ifdef HAVE_ATOMIC_BUILTIN
-        done = __sync_fetch_and_add((int *) &insds->init_done, 0);
+    done = __sync_fetch_and_add((int *) &insds->init_done, 0);
 #else
-        done = insds->init_done;
+    done = insds->init_done;
 #endif
-        if(done) {
-        opstart = (OPDS*)task_map[which_task];
-        if(insds->ksmps == csound->ksmps) {
-        insds->spin = csound->spin;
-        insds->spout = csound->spout;
-        insds->kcounter =  csound->kcounter;
+    if (!done) return 0;
+    if (insds->ksmps == csound->ksmps) {
+      insds->spin = csound->spin;
+      insds->spout = csound->spout;
+      insds->kcounter =  csound->kcounter;
+      while ((opstart = opstart->nxtp) != NULL) {
+        /* In case of jumping need this repeat of opstart */
+        opstart->insdshead->pds = opstart;
+        (*opstart->opadr)(csound, opstart); /* run each opcode */
+        opstart = opstart->insdshead->pds;
+      }
+    }
+    else {
+      int i, n = csound->nspout, start = 0;
+      int lksmps = insds->ksmps;
+      int incr = csound->nchnls*lksmps;
+      int offset =  insds->ksmps_offset;
+      int early = insds->ksmps_no_end;
+      insds->spin = csound->spin;
+      insds->spout = csound->spout;
+      insds->kcounter =  csound->kcounter*csound->ksmps;
+
+      /* we have to deal with sample-accurate code
+         whole CS_KSMPS blocks are offset here, the
+         remainder is left to each opcode to deal with.
+      */
+      while (offset >= lksmps) {
+        offset -= lksmps;
+        start += csound->nchnls;
+      }
+      insds->ksmps_offset = offset;
+      if (early) {
+        n -= (early*csound->nchnls);
+        insds->ksmps_no_end = early % lksmps;
+      }
+
+      for (i=start; i < n; i+=incr, insds->spin+=incr, insds->spout+=incr) {
+        opstart = (OPDS*) insds;
         while ((opstart = opstart->nxtp) != NULL) {
-          /* In case of jumping need this repeat of opstart */
           opstart->insdshead->pds = opstart;
           (*opstart->opadr)(csound, opstart); /* run each opcode */
           opstart = opstart->insdshead->pds;
         }
-        } else {
-          int i, n = csound->nspout, start = 0;
-          int lksmps = insds->ksmps;
-          int incr = csound->nchnls*lksmps;
-          int offset =  insds->ksmps_offset;
-          int early = insds->ksmps_no_end;
-          OPDS  *opstart;
-          insds->spin = csound->spin;
-          insds->spout = csound->spout;
-          insds->kcounter =  csound->kcounter*csound->ksmps;
-
-          /* we have to deal with sample-accurate code
-             whole CS_KSMPS blocks are offset here, the
-             remainder is left to each opcode to deal with.
-          */
-          while(offset >= lksmps) {
-            offset -= lksmps;
-            start += csound->nchnls;
-          }
-          insds->ksmps_offset = offset;
-          if(early){
-            n -= (early*csound->nchnls);
-            insds->ksmps_no_end = early % lksmps;
-          }
+        insds->kcounter++;
+      }
+    }
+    insds->ksmps_offset = 0; /* reset sample-accuracy offset */
+    insds->ksmps_no_end = 0;  /* reset end of loop samples */
+    return 1;
+}
 
-          for (i=start; i < n; i+=incr, insds->spin+=incr, insds->spout+=incr) {
-            opstart = (OPDS*) insds;
-            while ((opstart = opstart->nxtp) != NULL) {
-              opstart->insdshead->pds = opstart;
-              (*opstart->opadr)(csound, opstart); /* run each opcode */
-              opstart = opstart->insdshead->pds;
-            }
-            insds->kcounter++;
-          }
-        }
-        insds->ksmps_offset = 0; /* reset sample-accuracy offset */
-        insds->ksmps_no_end = 0;  /* reset end of loop samples */
-        played_count++;
-        }
-        //printf("******** finished task %d\n", which_task);
-        dag_end_task(csound, which_task);
+inline static int nodePerf(CSOUND *csound, int index)
+{
+    int played_count = 0;
+    int which_task;
+    INSDS **task_map = (INSDS**)csound->dag_task_map;
+
+    if (csound->oparms->parScheduler == PAR_SCHED_STEAL) {
+      while ((which_task = dag_ws_get_task(csound, index)) != INVALID) {
+        played_count += dagPerfTask(csound, task_map[which_task]);
+        dag_ws_end_task(csound, index, which_task);
+      }
+      return played_count;
+    }
+    while(1) {
+      which_task = dag_get_task(csound);
+      //printf("******** Select task %d\n", which_task);
+      if (which_task==WAIT) continue;
+      if (which_task==INVALID) return played_count;
+      played_count += dagPerfTask(csound, task_map[which_task]);
+      //printf("******** finished task %d\n", which_task);
+      dag_end_task(csound, which_task);
     }
     return played_count;
 }
 
+/* Bring the DAG up to date with the active chain and reset it for a cycle */
+inline static void dagPrepare(CSOUND *csound, INSDS *ip)
+{
+    int changed = csound->dag_changed;
+    if (changed) dag_build(csound, ip);
+    else if (csound->oparms->parScheduler != PAR_SCHED_STEAL)
+      dag_reinit(csound);     /* set to initial state */
+    if (csound->oparms->parScheduler == PAR_SCHED_STEAL)
+      dag_ws_reinit(csound, changed);
+}
+
 unsigned long kperfThread(void * cs)
 {
     //INSDS *start;
@@ -1456,9 +1509,36 @@ unsigned long kperfThread(void * cs)
     }
 }
 
-int kperf_nodebug(CSOUND *csound)
+/* Run one pass of an instrument's opcode chain, timing each opcode */
+static inline void opcode_perf_profile(CSOUND *csound, csprofile_data_t *data,
+                                       INSDS *ip, int chkact)
+{
+    OPDS  *opstart = (OPDS*) ip;
+    while ((opstart = opstart->nxtp) != NULL && (!chkact || ip->actflg)) {
+      OENTRY *ep = opstart->optext->t.oentry;
+      int64_t t = csprofile_ticks();
+      opstart->insdshead->pds = opstart;
+      (*opstart->opadr)(csound, opstart); /* run each opcode */
+      opstart = opstart->insdshead->pds;
+      csprofile_op(csound, data, ep, csprofile_ticks() - t);
+    }
+}
+
+#if defined(__GNUC__)
+#  define KPERF_INLINE static inline __attribute__((always_inline))
+#else
+#  define KPERF_INLINE static inline
+#endif
+
+/* One k-cycle of performance, shared by kperf_nodebug and kperf_profile.
+   profile is a constant in each of them, so the timing hooks compile
+   away in kperf_nodebug */
+KPERF_INLINE int kperf_cycle(CSOUND *csound, int profile)
 {
     INSDS *ip;
+    csprofile_data_t *data = NULL;
+    int64_t cycle_start = 0;
+    int sampled = 0;
     /* update orchestra time */
     csound->kcounter = ++(csound->global_kcounter);
     csound->icurTime += csound->ksmps;
@@ -1487,13 +1567,21 @@ int kperf_nodebug(CSOUND *csound)
     /* clear spout */
     memset(csound->spout, 0, csound->nspout*sizeof(MYFLT));
     ip = csound->actanchor.nxtact;
+    if (profile) {
+      data = (csprofile_data_t *) csound->csprofile_data;
+      /* opcodes are timed on one k-cycle in 'period' only */
+      sampled = (--data->countdown <= 0);
+      if (sampled) data->countdown = data->period;
+      /* audio I/O is not part of the cycle time */
+      cycle_start = csprofile_ticks();
+    }
 
     if (ip != NULL) {
       /* There are 2 partitions of work: 1st by inso,
-         2nd by inso count / thread count. */
+         2nd by inso count / thread count.  When profiling, only the
+         cycle is timed, as the instances run on several threads. */
       if (csound->multiThreadedThreadInfo != NULL) {
-        if (csound->dag_changed) dag_build(csound, ip);
-        else dag_reinit(csound);     /* set to initial state */
+        dagPrepare(csound, ip);
 
         /* process this partition */
         csound->WaitBarrier(csound->barrier1);
@@ -1527,15 +1615,19 @@ int kperf_nodebug(CSOUND *csound)
 
           if (done == 1) {/* if init-pass has been done */
             OPDS  *opstart = (OPDS*) ip;
+            int64_t t = profile ? csprofile_ticks() : 0;
             ip->spin = csound->spin;
             ip->spout = csound->spout;
             ip->kcounter =  csound->kcounter;
             if(ip->ksmps == csound->ksmps) {
-              while ((opstart = opstart->nxtp) != NULL) {
-                opstart->insdshead->pds = opstart;
-                (*opstart->opadr)(csound, opstart); /* run each opcode */
-                opstart = opstart->insdshead->pds;
-              }
+              if (sampled)
+                opcode_perf_profile(csound, data, ip, 0);
+              else
+                while ((opstart = opstart->nxtp) != NULL) {
+                  opstart->insdshead->pds = opstart;
+                  (*opstart->opadr)(csound, opstart); /* run each opcode */
+                  opstart = opstart->insdshead->pds;
+                }
             } else {
               int i, n = csound->nspout, start = 0;
                 int lksmps = ip->ksmps;
@@ -1562,15 +1654,22 @@ int kperf_nodebug(CSOUND *csound)
                   }
 
                for (i=start; i < n; i+=incr, ip->spin+=incr, ip->spout+=incr) {
-                  opstart = (OPDS*) ip;
-                  while ((opstart = opstart->nxtp) != NULL && ip->actflg) {
-                    opstart->insdshead->pds = opstart;
-                    (*opstart->opadr)(csound, opstart); /* run each opcode */
-                    opstart = opstart->insdshead->pds;
+                  if (sampled)
+                    opcode_perf_profile(csound, data, ip, 1);
+                  else {
+                    opstart = (OPDS*) ip;
+                    while ((opstart = opstart->nxtp) != NULL && ip->actflg) {
+                      opstart->insdshead->pds = opstart;
+                      (*opstart->opadr)(csound, opstart); /* run each opcode */
+                      opstart = opstart->insdshead->pds;
+                    }
                   }
                   ip->kcounter++;
                 }
             }
+            if (profile)
+              csprofile_instr(csound, data, ip, t,
+                              csprofile_ticks() - t, sampled);
           }
           /*else csound->Message(csound, "time %f \n",
                                  csound->kcounter/csound->ekr);*/
@@ -1580,6 +1679,9 @@ int kperf_nodebug(CSOUND *csound)
         }
       }
     }
+    if (profile)
+      csprofile_cycle(csound, data, cycle_start,
+                      csprofile_ticks() - cycle_start);
 
     if (!csound->spoutactive) { /* results now in spout? */
       memset(csound->spout, 0, csound->nspout * sizeof(MYFLT));
@@ -1588,6 +1690,17 @@ int kperf_nodebug(CSOUND *csound)
     return 0;
 }
 
+int kperf_nodebug(CSOUND *csound)
+{
+    return kperf_cycle(csound, 0);
+}
+
+/* kperf_nodebug with timing hooks, installed by csoundSetProfiling() */
+int kperf_profile(CSOUND *csound)
+{
+    return kperf_cycle(csound, 1);
+}
+
 static inline void opcode_perf_debug(CSOUND *csound,
                                      csdebug_data_t *data, INSDS *ip)
 {
@@ -1733,8 +1846,7 @@ int kperf_debug(CSOUND *csound)
       /* There are 2 partitions of work: 1st by inso,
          2nd by inso count / thread count. */
       if (csound->multiThreadedThreadInfo != NULL) {
-        if (csound->dag_changed) dag_build(csound, ip);
-        else dag_reinit(csound);     /* set to initial state */
+        dagPrepare(csound, ip);
 
         /* process this partition */
         csound->WaitBarrier(csound->barrier1);
@@ -3004,6 +3116,7 @@ static void reset(CSOUND *csound)
     csound->enableHostImplementedMIDIIO = saved_env->enableHostImplementedMIDIIO;
     memcpy(&(csound->exitjmp), &(saved_env->exitjmp), sizeof(jmp_buf));
     csound->memalloc_db = saved_env->memalloc_db;
+    csound->mempool = saved_env->mempool;
     //csound->self = self;
     free(saved_env);
 
@@ -3312,12 +3425,16 @@ PUBLIC int csoundTableLength(CSOUND *csound, int table)
 
 PUBLIC MYFLT csoundTableGet(CSOUND *csound, int table, int index)
 {
+    if (UNLIKELY(csound->ftgen_pending))
+      ftgen_sync(csound);
     return csound->flist[table]->ftable[index];
 }
 
 static void csoundTableSetInternal(CSOUND *csound,
                                    int table, int index, MYFLT value)
 {
+    if (UNLIKELY(csound->ftgen_pending))
+      ftgen_sync(csound);
     csound->flist[table]->ftable[index] = value;
 }
 
@@ -3326,6 +3443,8 @@ PUBLIC void csoundTableSet(CSOUND *csound, int table, int index, MYFLT value)
     /* in realtime mode init pass is executed in a separate thread, so
      we need to protect it */
     csoundUnlockMutex(csound->API_lock);
+    if (UNLIKELY(csound->ftgen_pending))
+      ftgen_sync(csound);
    if(csound->oparms->realtime) csoundLockMutex(csound->init_pass_threadlock);
     csound->flist[table]->ftable[index] = value;
    if(csound->oparms->realtime) csoundUnlockMutex(csound->init_pass_threadlock);
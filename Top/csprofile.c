@@ -0,0 +1,417 @@
+/*
+    csprofile.c:
+
+    Copyright (C) 2026 Csound developers
+
+    This file is part of Csound.
+
+    The Csound Library is free software; you can redistribute it
+    and/or modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    Csound is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with Csound; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+    02111-1307 USA
+*/
+
+#include "csoundCore.h"
+#include "csprofile.h"
+
+#define NS2SEC(x) ((double) (x) * 1.0e-9)
+
+PUBLIC int csoundSetProfiling(CSOUND *csound, int period)
+{
+    csprofile_data_t *data = (csprofile_data_t *) csound->csprofile_data;
+
+    if (period <= 0) {
+      if (csound->kperf == kperf_profile)
+        csound->kperf = kperf_nodebug;
+      if (data != NULL) data->period = 0;
+      return CSOUND_SUCCESS;
+    }
+    if (UNLIKELY(csound->csdebug_data != NULL)) {
+      csound->Warning(csound,
+                      Str("csoundSetProfiling: cannot profile while the "
+                          "debugger is in use"));
+      return CSOUND_ERROR;
+    }
+    if (data == NULL) {
+      data = (csprofile_data_t *) csound->Calloc(csound,
+                                                 sizeof(csprofile_data_t));
+      data->trace = (csprofile_event_t *)
+        csound->Calloc(csound, sizeof(csprofile_event_t)*CSPROFILE_TRACE);
+      csound->csprofile_data = data;
+    }
+    else {                      /* start afresh, keeping the buffers */
+      csprofile_op_t *ops = data->ops;
+      csprofile_instr_t *instr = data->instr;
+      csprofile_event_t *trace = data->trace;
+      char *trace_file = data->trace_file;
+      int report = data->report;
+      int opsize = data->opsize, ninstr = data->ninstr;
+      if (ops) memset(ops, 0, sizeof(csprofile_op_t)*opsize);
+      if (instr) memset(instr, 0, sizeof(csprofile_instr_t)*ninstr);
+      memset(data, 0, sizeof(csprofile_data_t));
+      data->ops = ops; data->opsize = opsize;
+      data->instr = instr; data->ninstr = ninstr;
+      data->trace = trace;
+      data->trace_file = trace_file;
+      data->report = report;
+    }
+    data->period = data->countdown = period;
+    data->t0 = csprofile_ticks();
+    csound->kperf = kperf_profile;
+    return CSOUND_SUCCESS;
+}
+
+/* Called from kperf_profile for each opcode on sampled k-cycles */
+void csprofile_op(CSOUND *csound, csprofile_data_t *data,
+                  OENTRY *ep, int64_t ticks)
+{
+    csprofile_op_t *op;
+    unsigned int h, mask;
+
+    if (UNLIKELY(2*(data->nops+1) > data->opsize)) {
+      /* grow the hash table; opcodes are new only in the first cycles */
+      csprofile_op_t *old = data->ops;
+      int i, oldsize = data->opsize;
+      data->opsize = oldsize ? 2*oldsize : 256;
+      data->ops = (csprofile_op_t *)
+        csound->Calloc(csound, sizeof(csprofile_op_t)*data->opsize);
+      mask = data->opsize-1;
+      for (i = 0; i < oldsize; i++) {
+        if (old[i].oentry == NULL) continue;
+        h = (unsigned int) (((uintptr_t) old[i].oentry) >> 4) & mask;
+        while (data->ops[h].oentry != NULL) h = (h+1) & mask;
+        data->ops[h] = old[i];
+      }
+      if (old) csound->Free(csound, old);
+    }
+    mask = data->opsize-1;
+    h = (unsigned int) (((uintptr_t) ep) >> 4) & mask;
+    while ((op = &data->ops[h])->oentry != ep) {
+      if (op->oentry == NULL) {
+        op->oentry = ep;
+        data->nops++;
+        break;
+      }
+      h = (h+1) & mask;
+    }
+    op->calls++;
+    op->ticks += ticks;
+    if (ticks > op->max) op->max = ticks;
+}
+
+static void csprofile_trace(csprofile_data_t *data, int64_t kcount,
+                            int64_t start, int64_t ticks, int insno)
+{
+    csprofile_event_t *ev = &data->trace[data->trace_pos];
+    ev->kcount = kcount;
+    ev->start = start - data->t0;
+    ev->ticks = ticks;
+    ev->insno = insno;
+    if (++data->trace_pos == CSPROFILE_TRACE) {
+      data->trace_pos = 0;
+      data->trace_full = 1;
+    }
+}
+
+/* Called from kperf_profile for each instrument instance */
+void csprofile_instr(CSOUND *csound, csprofile_data_t *data, INSDS *ip,
+                     int64_t start, int64_t ticks, int traced)
+{
+    csprofile_instr_t *in;
+    int insno = ip->insno;
+    if (UNLIKELY(insno >= data->ninstr)) {
+      int n = csound->engineState.maxinsno+1;
+      if (n <= insno) n = insno+1;
+      data->instr = (csprofile_instr_t *)
+        csound->ReAlloc(csound, data->instr, sizeof(csprofile_instr_t)*n);
+      memset(data->instr+data->ninstr, 0,
+             sizeof(csprofile_instr_t)*(n-data->ninstr));
+      data->ninstr = n;
+    }
+    in = &data->instr[insno];
+    in->calls++;
+    in->ticks += ticks;
+    if (ticks > in->max) in->max = ticks;
+    if (traced)
+      csprofile_trace(data, csound->kcounter, start, ticks, insno);
+}
+
+/* Called from kperf_profile at the end of each k-cycle */
+void csprofile_cycle(CSOUND *csound, csprofile_data_t *data,
+                     int64_t start, int64_t ticks)
+{
+    int bin, i;
+    if (UNLIKELY(data->kperiod == 0))
+      data->kperiod = (int64_t) (1.0e9 * csound->ksmps / csound->esr);
+    data->cycles++;
+    data->cycle_ticks += ticks;
+    bin = (int) (ticks * 10 / data->kperiod);
+    data->hist[bin < CS_PROFILE_BINS-1 ? bin : CS_PROFILE_BINS-1]++;
+    if (data->nworst < CSPROFILE_WORST ||
+        NS2SEC(ticks) > data->worst[data->nworst-1].seconds) {
+      /* insertion into the short sorted list of slowest cycles */
+      i = data->nworst < CSPROFILE_WORST ? data->nworst++ : data->nworst-1;
+      while (i > 0 && data->worst[i-1].seconds < NS2SEC(ticks)) {
+        data->worst[i] = data->worst[i-1];
+        i--;
+      }
+      data->worst[i].kcount = csound->kcounter;
+      data->worst[i].seconds = NS2SEC(ticks);
+    }
+    csprofile_trace(data, csound->kcounter, start, ticks, 0);
+}
+
+static int cmp_profile(const void *a, const void *b)
+{
+    double d = ((CS_PROFILE_ENTRY *) b)->seconds -
+               ((CS_PROFILE_ENTRY *) a)->seconds;
+    return d > 0.0 ? 1 : (d < 0.0 ? -1 : 0);
+}
+
+PUBLIC int csoundGetOpcodeProfile(CSOUND *csound, CS_PROFILE_ENTRY **lst)
+{
+    csprofile_data_t *data = (csprofile_data_t *) csound->csprofile_data;
+    int i, n = 0;
+
+    *lst = NULL;
+    if (data == NULL || data->nops == 0)
+      return 0;
+    *lst = (CS_PROFILE_ENTRY *) malloc(data->nops*sizeof(CS_PROFILE_ENTRY));
+    if (UNLIKELY(*lst == NULL))
+      return CSOUND_MEMORY;
+    for (i = 0; i < data->opsize && n < data->nops; i++) {
+      csprofile_op_t *op = &data->ops[i];
+      if (op->oentry == NULL) continue;
+      (*lst)[n].name = op->oentry->opname;
+      (*lst)[n].insno = 0;
+      (*lst)[n].calls = op->calls;
+      (*lst)[n].seconds = NS2SEC(op->ticks);
+      (*lst)[n].max = NS2SEC(op->max);
+      n++;
+    }
+    qsort((void *) *lst, n, sizeof(CS_PROFILE_ENTRY), cmp_profile);
+    return n;
+}
+
+PUBLIC int csoundGetInstrProfile(CSOUND *csound, CS_PROFILE_ENTRY **lst)
+{
+    csprofile_data_t *data = (csprofile_data_t *) csound->csprofile_data;
+    int i, n = 0;
+
+    *lst = NULL;
+    if (data == NULL)
+      return 0;
+    for (i = 0; i < data->ninstr; i++)
+      if (data->instr[i].calls) n++;
+    if (n == 0)
+      return 0;
+    *lst = (CS_PROFILE_ENTRY *) malloc(n*sizeof(CS_PROFILE_ENTRY));
+    if (UNLIKELY(*lst == NULL))
+      return CSOUND_MEMORY;
+    for (i = 0, n = 0; i < data->ninstr; i++) {
+      csprofile_instr_t *in = &data->instr[i];
+      INSTRTXT *tp;
+      if (in->calls == 0) continue;
+      tp = i <= csound->engineState.maxinsno ?
+        csound->engineState.instrtxtp[i] : NULL;
+      (*lst)[n].name = tp != NULL ? tp->insname : NULL;
+      (*lst)[n].insno = i;
+      (*lst)[n].calls = in->calls;
+      (*lst)[n].seconds = NS2SEC(in->ticks);
+      (*lst)[n].max = NS2SEC(in->max);
+      n++;
+    }
+    qsort((void *) *lst, n, sizeof(CS_PROFILE_ENTRY), cmp_profile);
+    return n;
+}
+
+PUBLIC void csoundDeleteProfile(CSOUND *csound, CS_PROFILE_ENTRY *lst)
+{
+    (void) csound;
+    if (lst != NULL)
+      free(lst);
+}
+
+PUBLIC int csoundGetProfileWorstCycles(CSOUND *csound,
+                                       CS_PROFILE_CYCLE *cycles, int n)
+{
+    csprofile_data_t *data = (csprofile_data_t *) csound->csprofile_data;
+    if (data == NULL || n <= 0)
+      return 0;
+    if (n > data->nworst) n = data->nworst;
+    memcpy(cycles, data->worst, n*sizeof(CS_PROFILE_CYCLE));
+    return n;
+}
+
+PUBLIC int64_t csoundGetProfileHistogram(CSOUND *csound, int64_t *bins)
+{
+    csprofile_data_t *data = (csprofile_data_t *) csound->csprofile_data;
+    if (data == NULL) {
+      memset(bins, 0, CS_PROFILE_BINS*sizeof(int64_t));
+      return 0;
+    }
+    memcpy(bins, data->hist, CS_PROFILE_BINS*sizeof(int64_t));
+    return data->cycles;
+}
+
+static void profile_print(CSOUND *csound, FILE *f, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    if (f != NULL)
+      vfprintf(f, fmt, args);
+    else
+      csound->MessageV(csound, 0, fmt, args);
+    va_end(args);
+}
+
+PUBLIC int csoundWriteProfile(CSOUND *csound, const char *filename)
+{
+    csprofile_data_t *data = (csprofile_data_t *) csound->csprofile_data;
+    CS_PROFILE_ENTRY *lst;
+    FILE *f = NULL;
+    double total;
+    int i, n;
+
+    if (UNLIKELY(data == NULL)) {
+      csound->Warning(csound, Str("no profile data: profiling was not enabled"));
+      return CSOUND_ERROR;
+    }
+    if (filename != NULL && (f = fopen(filename, "w")) == NULL) {
+      csound->Warning(csound, Str("cannot open profile file %s"), filename);
+      return CSOUND_ERROR;
+    }
+    profile_print(csound, f, Str("\nprofile: %lld k-cycles, %.3f s, "
+                                 "mean %.1f us, k-period %.1f us\n"),
+                  (long long) data->cycles, NS2SEC(data->cycle_ticks),
+                  data->cycles ?
+                  1.0e-3 * data->cycle_ticks / data->cycles : 0.0,
+                  1.0e-3 * data->kperiod);
+    profile_print(csound, f, Str("k-cycle load histogram:\n"));
+    for (i = 0; i < CS_PROFILE_BINS; i++)
+      if (i < CS_PROFILE_BINS-1)
+        profile_print(csound, f, "  %3d-%3d%%  %lld\n", i*10, i*10+10,
+                      (long long) data->hist[i]);
+      else
+        profile_print(csound, f, "  >= 100%%  %lld\n",
+                      (long long) data->hist[i]);
+    profile_print(csound, f, Str("slowest k-cycles:\n"));
+    for (i = 0; i < data->nworst; i++)
+      profile_print(csound, f, "  %10lld  %9.1f us\n",
+                    (long long) data->worst[i].kcount,
+                    1.0e6 * data->worst[i].seconds);
+
+    total = NS2SEC(data->cycle_ticks);
+    if ((n = csoundGetInstrProfile(csound, &lst)) > 0) {
+      profile_print(csound, f, Str("instruments:\n   %%time   seconds"
+                                   "      calls   max (us)  instr\n"));
+      for (i = 0; i < n; i++) {
+        profile_print(csound, f, "  %6.2f  %8.3f  %9lld  %9.1f  ",
+                      total > 0.0 ? 100.0 * lst[i].seconds / total : 0.0,
+                      lst[i].seconds, (long long) lst[i].calls,
+                      1.0e6 * lst[i].max);
+        if (lst[i].name != NULL)
+          profile_print(csound, f, "%s\n", lst[i].name);
+        else
+          profile_print(csound, f, "%d\n", lst[i].insno);
+      }
+      csoundDeleteProfile(csound, lst);
+    }
+    if ((n = csoundGetOpcodeProfile(csound, &lst)) > 0) {
+      double optotal = 0.0;
+      for (i = 0; i < n; i++) optotal += lst[i].seconds;
+      profile_print(csound, f, Str("opcodes (sampled every %d k-cycles):\n"
+                                   "   %%time   seconds      calls"
+                                   "   max (us)  opcode\n"), data->period);
+      for (i = 0; i < n; i++)
+        profile_print(csound, f, "  %6.2f  %8.3f  %9lld  %9.1f  %s\n",
+                      optotal > 0.0 ? 100.0 * lst[i].seconds / optotal : 0.0,
+                      lst[i].seconds, (long long) lst[i].calls,
+                      1.0e6 * lst[i].max, lst[i].name);
+      csoundDeleteProfile(csound, lst);
+    }
+    if (f != NULL) fclose(f);
+    return CSOUND_SUCCESS;
+}
+
+PUBLIC int csoundWriteProfileTrace(CSOUND *csound, const char *filename)
+{
+    csprofile_data_t *data = (csprofile_data_t *) csound->csprofile_data;
+    FILE *f;
+    int i, n, first = 1;
+
+    if (UNLIKELY(data == NULL)) {
+      csound->Warning(csound, Str("no profile data: profiling was not enabled"));
+      return CSOUND_ERROR;
+    }
+    if ((f = fopen(filename, "w")) == NULL) {
+      csound->Warning(csound, Str("cannot open profile trace %s"), filename);
+      return CSOUND_ERROR;
+    }
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    n = data->trace_full ? CSPROFILE_TRACE : data->trace_pos;
+    for (i = 0; i < n; i++) {
+      /* oldest first */
+      csprofile_event_t *ev = &data->trace[data->trace_full ?
+                                           (data->trace_pos+i) % CSPROFILE_TRACE
+                                           : i];
+      if (!first) fprintf(f, ",\n");
+      first = 0;
+      if (ev->insno == 0)
+        fprintf(f, "{\"name\":\"%s\",\"cat\":\"kperf\",\"ph\":\"X\","
+                "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1,"
+                "\"args\":{\"kcount\":%lld}}",
+                ev->ticks > data->kperiod ? "k-cycle (late)" : "k-cycle",
+                1.0e-3 * ev->start, 1.0e-3 * ev->ticks,
+                (long long) ev->kcount);
+      else
+        fprintf(f, "{\"name\":\"instr %d\",\"cat\":\"instr\",\"ph\":\"X\","
+                "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1,"
+                "\"args\":{\"kcount\":%lld}}",
+                ev->insno, 1.0e-3 * ev->start, 1.0e-3 * ev->ticks,
+                (long long) ev->kcount);
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    return CSOUND_SUCCESS;
+}
+
+/* Enable profiling from the --profile[=N] and --profile-trace=FILE options */
+int csprofile_option(CSOUND *csound, int period, const char *trace_file)
+{
+    csprofile_data_t *data;
+    if (period <= 0) period = CSPROFILE_PERIOD;
+    data = (csprofile_data_t *) csound->csprofile_data;
+    if (data == NULL || data->period == 0) {
+      if (csoundSetProfiling(csound, period) != CSOUND_SUCCESS)
+        return 0;
+      data = (csprofile_data_t *) csound->csprofile_data;
+    }
+    if (trace_file != NULL) {
+      data->trace_file = (char *) csound->Malloc(csound, strlen(trace_file)+1);
+      strcpy(data->trace_file, trace_file);
+    }
+    else data->period = period;
+    data->report = 1;
+    return 1;
+}
+
+/* Report at the end of performance when enabled from the command line */
+void csprofile_cleanup(CSOUND *csound)
+{
+    csprofile_data_t *data = (csprofile_data_t *) csound->csprofile_data;
+    if (data == NULL || !data->report) return;
+    csoundWriteProfile(csound, NULL);
+    if (data->trace_file != NULL)
+      csoundWriteProfileTrace(csound, data->trace_file);
+}
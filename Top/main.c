@@ -47,6 +47,7 @@ extern  void    openMIDIout(CSOUND *);
 extern  int     read_unified_file(CSOUND *, char **, char **);
 extern  int     read_unified_file2(CSOUND *csound, char *csd);
 extern  uintptr_t  kperfThread(void * cs);
+extern  void    array_pool_start(CSOUND *);
 extern void cs_init_math_constants_macros(CSOUND *csound, PRE_PARM *yyscanner);
 extern void cs_init_omacros(CSOUND *csound, PRE_PARM*, NAMES *nn);
 extern void csoundInputMessageInternal(CSOUND *csound, const char *message);
@@ -474,6 +475,8 @@ PUBLIC int csoundStart(CSOUND *csound) // DEBUG
 
       csound->WaitBarrier(csound->barrier2);
     }
+    if (O->arrayThreads > 1)
+      array_pool_start(csound);   /* before any thread can use it */
     csound->engineStatus |= CS_STATE_COMP;
     if(csound->oparms->daemon > 1)
         UDPServerStart(csound,csound->oparms->daemon);
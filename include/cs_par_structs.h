@@ -46,4 +46,10 @@ typedef struct _watchList {
   struct _watchList *next;
 } watchList;
 
+/* Strategies for handing out DAG tasks to the performance threads */
+#define PAR_SCHED_SCAN  0           /* scan the shared task status array */
+#define PAR_SCHED_STEAL 1           /* per-thread deques with work stealing */
+
+struct dag_ws_t;
+
 #endif
@@ -554,6 +554,98 @@ extern "C" {
             void *channelValuePtr,
             const void *channelType);
 
+/**
+ * Number of bins of the k-cycle duration histogram returned by
+ * csoundGetProfileHistogram(): bin i counts the k-cycles that took
+ * between i and i+1 tenths of a k-period, the last bin those that
+ * took a whole k-period or more (possible xruns).
+ */
+#define CS_PROFILE_BINS (11)
+
+    /**
+     * Accumulated profile of an opcode or instrument
+     */
+    typedef struct {
+        /** opcode name, or instrument name (NULL if unnamed) */
+        const char  *name;
+        /** instrument number, or 0 for an opcode */
+        int     insno;
+        /** number of timed calls */
+        int64_t calls;
+        /** total time in seconds */
+        double  seconds;
+        /** longest single call in seconds */
+        double  max;
+    } CS_PROFILE_ENTRY;
+
+    /**
+     * Duration of a single k-cycle
+     */
+    typedef struct {
+        /** k-cycle number */
+        int64_t kcount;
+        /** processing time in seconds, excluding audio I/O */
+        double  seconds;
+    } CS_PROFILE_CYCLE;
+
+    /**
+     * Counters of the engine's memory allocator (see csoundGetMemoryStats())
+     */
+    typedef struct {
+        /** blocks taken from / returned to the size class pools */
+        int64_t pool_allocs, pool_frees;
+        /** pool allocations that had to fetch a new chunk */
+        int64_t pool_misses;
+        /** bytes held by the pools */
+        int64_t pool_bytes;
+        /** large blocks allocated from / returned to the system heap */
+        int64_t heap_allocs, heap_frees;
+    } CS_MEMORY_STATS;
+
+    /**
+     * Instance pool counters of an instrument
+     * (see csoundGetInstancePoolStats())
+     */
+    typedef struct {
+        /** instances the pool tries to keep allocated */
+        int     target;
+        /** instances allocated so far */
+        int     allocated;
+        /** activations that found a free instance */
+        int64_t hits;
+        /** activations that had to build one */
+        int64_t misses;
+    } CS_INSTANCE_POOL_STATS;
+
+    /**
+     * State of an asynchronous diskin2 stream (see csoundGetStreamStats())
+     */
+    typedef struct {
+        /** instrument playing the stream */
+        int     insno;
+        /** sample frames read ahead and not yet played */
+        int     buffered;
+        /** k-cycles that found fewer frames than they needed */
+        int64_t underruns;
+    } CS_STREAM_STATS;
+
+#define CS_SCORE_EVENT_PFIELDS 16
+
+    /**
+     * A score event for csoundSubmitScoreEvents()
+     */
+    typedef struct {
+        /** start time in sample frames from the start of performance;
+            times already past start on the next k-cycle */
+        int64_t frame;
+        /** event type: 'i', 'q', 'f', 'a' or 'e' */
+        char    type;
+        /** number of p-fields in p */
+        int     pcnt;
+        /** p-fields, p[0] is p1; p2 is ignored in favour of frame */
+        MYFLT   p[CS_SCORE_EVENT_PFIELDS];
+    } CS_SCORE_EVENT;
+
 #ifndef CSOUND_CSDL_H
 
     /** @defgroup INSTANTIATION Instantiation
@@ -761,6 +853,91 @@ extern "C" {
      */
     PUBLIC void csoundReset(CSOUND *);
 
+    /** @}*/
+    /** @defgroup PROFILING Performance profiling
+     *
+     *  @{ */
+
+    /**
+     * Enables (period > 0) or disables (period == 0) profiling of the
+     * performance loop. While enabled, the processing time of every
+     * k-cycle and every instrument instance is recorded, and the opcodes
+     * are timed individually on one k-cycle in 'period', which keeps the
+     * overhead of timing them low. Enabling clears the data collected so
+     * far. Profiling is not available while the debugger is in use.
+     * The same can be requested with the --profile[=period] option.
+     * Returns CSOUND_SUCCESS, or CSOUND_ERROR if it cannot be enabled.
+     */
+    PUBLIC int csoundSetProfiling(CSOUND *, int period);
+
+    /**
+     * Returns in *lst the profile of each opcode timed so far, in
+     * decreasing order of total time. The return value is the number of
+     * entries, which may be zero, or CSOUND_MEMORY. The list must be
+     * freed with csoundDeleteProfile(). Values read while performing in
+     * another thread may be slightly out of date.
+     */
+    PUBLIC int csoundGetOpcodeProfile(CSOUND *, CS_PROFILE_ENTRY **lst);
+
+    /**
+     * As csoundGetOpcodeProfile(), for each instrument.
+     */
+    PUBLIC int csoundGetInstrProfile(CSOUND *, CS_PROFILE_ENTRY **lst);
+
+    /**
+     * Releases a list returned by csoundGetOpcodeProfile() or
+     * csoundGetInstrProfile().
+     */
+    PUBLIC void csoundDeleteProfile(CSOUND *, CS_PROFILE_ENTRY *lst);
+
+    /**
+     * Copies to 'cycles' the (at most 'n') slowest k-cycles seen so far,
+     * slowest first, and returns how many were copied.
+     */
+    PUBLIC int csoundGetProfileWorstCycles(CSOUND *,
+                                           CS_PROFILE_CYCLE *cycles, int n);
+
+    /**
+     * Copies the CS_PROFILE_BINS counts of the k-cycle duration histogram
+     * to 'bins'. Returns the total number of k-cycles profiled.
+     */
+    PUBLIC int64_t csoundGetProfileHistogram(CSOUND *, int64_t *bins);
+
+    /**
+     * Writes a flat text profile (k-cycle statistics, instruments and
+     * opcodes) to the named file, or to the message stream if 'filename'
+     * is NULL. Returns CSOUND_SUCCESS or CSOUND_ERROR.
+     */
+    PUBLIC int csoundWriteProfile(CSOUND *, const char *filename);
+
+    /**
+     * Writes the most recent k-cycles, with the instrument instances
+     * timed on sampled cycles, as a Chrome trace (JSON) file that can be
+     * loaded in chrome://tracing or similar viewers. K-cycles that
+     * exceeded the k-period are named "k-cycle (late)".
+     * Returns CSOUND_SUCCESS or CSOUND_ERROR.
+     */
+    PUBLIC int csoundWriteProfileTrace(CSOUND *, const char *filename);
+
+    /**
+     * Fill 'stats' with the instance pool counters of instrument 'insno',
+     * or the sum over all instruments if 'insno' is 0. Activations are
+     * counted whether or not the pool thread is enabled
+     * (--instance-pool), so the counters also show how often note
+     * activations allocate in a normal performance.
+     * Returns CSOUND_ERROR if the instrument does not exist.
+     */
+    PUBLIC int csoundGetInstancePoolStats(CSOUND *, int insno,
+                                          CS_INSTANCE_POOL_STATS *stats);
+
+    /**
+     * Copies to 'stats' the state of (at most 'n') diskin2 streams read
+     * ahead by the I/O threads (real-time performance, see
+     * --diskin-threads), and returns the number of such streams.
+     * A stream that ends with underruns also reports them as a warning.
+     */
+    PUBLIC int csoundGetStreamStats(CSOUND *, CS_STREAM_STATS *stats, int n);
+
     /** @}*/
     /** @defgroup ATTRIBUTES Attributes
      *
@@ -1474,6 +1651,50 @@ extern "C" {
     PUBLIC void csoundSetControlChannel(CSOUND *csound,
                                         const char *name, MYFLT val);
 
+    /**
+     * Returns a handle to the channel 'name' of the given type, creating
+     * the channel if it does not exist (see csoundGetChannelPtr()), or
+     * NULL if it exists with a different type. The handle avoids the
+     * name lookup of the functions above and stays valid until the
+     * instance is reset or destroyed.
+     */
+    PUBLIC void *csoundGetChannelHandle(CSOUND *csound, const char *name,
+                                        int type);
+
+    /**
+     * retrieves the value of the control channel with the given handle
+     */
+    PUBLIC MYFLT csoundGetControlChannelHandle(CSOUND *csound, void *handle);
+
+    /**
+     * sets the value of the control channel with the given handle
+     */
+    PUBLIC void csoundSetControlChannelHandle(CSOUND *csound, void *handle,
+                                              MYFLT val);
+
+    /**
+     * copies ksmps MYFLTs from the audio channel with the given handle
+     */
+    PUBLIC void csoundGetAudioChannelHandle(CSOUND *csound, void *handle,
+                                            MYFLT *samples);
+
+    /**
+     * copies ksmps MYFLTs into the audio channel with the given handle
+     */
+    PUBLIC void csoundSetAudioChannelHandle(CSOUND *csound, void *handle,
+                                            const MYFLT *samples);
+
+    /**
+     * Queues n control channel updates, values[i] for the channel
+     * handles[i], to be applied together at the start of the next
+     * k-cycle. The performance thread does not lock to apply them.
+     * Returns n, 0 if the queue has no room for the whole batch (nothing
+     * is queued; try again later), or CSOUND_ERROR if a handle is not a
+     * control channel or n is larger than the queue (4095 updates).
+     */
+    PUBLIC int csoundSetControlChannels(CSOUND *csound, void **handles,
+                                        const MYFLT *values, int n);
+
     /**
      * copies the audio channel identified by *name into array
      * *samples which should contain enough memory for ksmps MYFLTs
@@ -1559,6 +1780,22 @@ extern "C" {
     PUBLIC int csoundScoreEventAbsolute(CSOUND *,
             char type, const MYFLT *pfields, long numFields, double time_ofs);
 
+    /**
+     * Queues n score events for the performance thread, which schedules
+     * them at the start of its next k-cycle. Events are copied into a
+     * preallocated queue without parsing, allocating or locking, and
+     * several threads may submit at once. Events with more than
+     * CS_SCORE_EVENT_PFIELDS p-fields or string p-fields need
+     * csoundScoreEvent(). Only available between csoundStart() and
+     * csoundCleanup().
+     * Returns the number of events queued, which is less than n if the
+     * queue is full (the rest can be submitted again later), or
+     * CSOUND_ERROR if Csound is not performing or an event is invalid,
+     * in which case nothing is queued.
+     */
+    PUBLIC int csoundSubmitScoreEvents(CSOUND *,
+                                       const CS_SCORE_EVENT *events, int n);
+
     /**
      * Input a NULL-terminated string (as if from a console),
      * used for line events.
@@ -2072,6 +2309,23 @@ extern "C" {
      */
     PUBLIC uint32_t csoundGetRandomSeedFromTime(void);
 
+    /**
+     * Fill 'stats' with the counters of the memory allocator behind
+     * csound->Malloc() and friends. Small blocks are served from per
+     * instance size class pools, large ones from the system heap.
+     */
+    PUBLIC void csoundGetMemoryStats(CSOUND *, CS_MEMORY_STATS *stats);
+
+    /**
+     * Add at least 'count' free blocks able to take 'size' bytes to
+     * the pools, so that later allocations of that size (for
+     * instance when instruments are instantiated during a real-time
+     * performance) do not reach the system allocator.
+     * Returns zero on success, or CSOUND_MEMORY if the pool is full.
+     * Sizes too large for the pools are ignored.
+     */
+    PUBLIC int csoundReserveMemory(CSOUND *, size_t size, int count);
+
     /**
      * Set language to 'lang_code' (lang_code can be for example
      * CSLANGUAGE_ENGLISH_UK or CSLANGUAGE_FRENCH or many others,
@@ -2251,6 +2505,56 @@ extern "C" {
    */
   PUBLIC void csoundFlushCircularBuffer(CSOUND *csound, void *p);
 
+ /**
+  * Create a circular buffer like csoundCreateCircularBuffer(), that
+  * several threads may write to at the same time (there must still be a
+  * single reader). Writers reserve their space with an atomic
+  * operation and their items are made visible to the reader in the
+  * order of reservation.
+  */
+  PUBLIC void *csoundCreateMPSCCircularBuffer(CSOUND *csound, int numelem,
+                                              int elemsize);
+
+ /**
+  * Give the reader direct access to up to 'items' elements of a circular
+  * buffer, without copying. The elements are in one or two contiguous
+  * segments: 'n1' at 'seg1' followed by 'n2' at 'seg2' ('seg2' is NULL
+  * when the data do not wrap around). Call
+  * csoundReadCircularBufferCommit() once they have been consumed.
+  * @returns the number of elements available (n1 + n2)
+  */
+  PUBLIC int csoundReadCircularBufferReserve(CSOUND *csound, void *p,
+                                             int items,
+                                             void **seg1, int *n1,
+                                             void **seg2, int *n2);
+
+ /**
+  * Release 'items' elements obtained with
+  * csoundReadCircularBufferReserve() back to the writer.
+  */
+  PUBLIC void csoundReadCircularBufferCommit(CSOUND *csound, void *p,
+                                             int items);
+
+ /**
+  * Give the writer direct access to up to 'items' free elements of a
+  * circular buffer, to be filled in place, in one or two segments as for
+  * csoundReadCircularBufferReserve(). Call
+  * csoundWriteCircularBufferCommit() to make them visible to the reader.
+  * Not available on MPSC buffers, where it returns 0.
+  * @returns the number of elements reserved (n1 + n2)
+  */
+  PUBLIC int csoundWriteCircularBufferReserve(CSOUND *csound, void *p,
+                                              int items,
+                                              void **seg1, int *n1,
+                                              void **seg2, int *n2);
+
+ /**
+  * Publish 'items' elements filled after
+  * csoundWriteCircularBufferReserve().
+  */
+  PUBLIC void csoundWriteCircularBufferCommit(CSOUND *csound, void *p,
+                                              int items);
+
  /**
   * Free circular buffer
   */
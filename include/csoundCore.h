@@ -162,6 +162,12 @@ typedef struct {
 
 #define DFLT_DBFS (FL(32768.0))
 
+#define FFT_BACKEND_PLAN    0   /* planned vector FFTs, fftplan.c */
+#define FFT_BACKEND_SCALAR  1   /* fftlib.c only */
+
+#define UDO_ARGS_REF        0   /* bind UDO arguments to the caller's vars */
+#define UDO_ARGS_COPY       1   /* always copy UDO arguments */
+
 #define MAXOCTS         8
 #define MAXCHAN         16      /* 16 MIDI channels; only one port for now */
 
@@ -232,6 +238,20 @@ typedef struct {
     MYFLT   e0dbfs_override;
     int     daemon;
     double  quality;        /* for ogg encoding */
+    int     parScheduler;   /* PAR_SCHED_SCAN or PAR_SCHED_STEAL */
+    int     instancePool;   /* spare instances kept per instr, 0 = off */
+    int     fftBackend;     /* FFT_BACKEND_PLAN or FFT_BACKEND_SCALAR */
+    int     udoArgs;        /* UDO_ARGS_REF or UDO_ARGS_COPY */
+    int     inlineUDOs;     /* largest UDO body inlined, 0 = off,
+                               -1 = as set by optLevel */
+    int     optLevel;       /* orchestra optimisation, 0 = off */
+    int     gen01mmap;      /* map GEN01 tables from a cache file */
+    int     ftgenThreads;   /* threads generating tables, 0 = off */
+    int     ftgenCache;     /* keep generated tables in a cache */
+    int     diskinThreads;  /* diskin2 streaming threads, 0 = no streaming */
+    int     pvsBatch;       /* pvsanal batches: 0 off, 1 on, 2 on a thread */
+    int     spectralApprox; /* spectral kernel trigonometry, 0 = libm */
+    int     arrayThreads;   /* threads sharing large array operations */
   } OPARMS;
 
   typedef struct arglst {
@@ -326,6 +346,11 @@ typedef struct {
     int     instcnt;                /* Count number of instances ever */
     int     isNew;                  /* is this a new definition */
     int     nocheckpcnt;            /* Control checks on pcnt */
+    struct insds * volatile pool_ready; /* built by the instance pool
+                                       thread, not linked in yet */
+    int     pool_target;            /* instances the pool should keep */
+    volatile int pool_allocated;    /* instances built so far */
+    int64_t pool_hits, pool_misses; /* activations with/without instance() */
   } INSTRTXT;
 
   typedef struct namedInstr {
@@ -838,6 +863,7 @@ typedef struct {
  * and nodebug kperf functions */
   int kperf_nodebug(CSOUND *csound);
   int kperf_debug(CSOUND *csound);
+  int kperf_profile(CSOUND *csound);
 
 #endif  /* __BUILDING_LIBCSOUND */
 
@@ -889,6 +915,8 @@ typedef struct NAME__ {
     CS_VAR_POOL* in_arg_pool;
     INSTRTXT *ip;
     struct opcodinfo *prv;
+    char    *refargs;   /* per argument, outputs first: may be passed by
+                           reference; NULL until the first call */
   } OPCODINFO;
 
   /**
@@ -1464,6 +1492,7 @@ typedef struct NAME__ {
     int64_t       cyclesRemaining;
     EVTBLK        evt;
     void          *memalloc_db;
+    void          *mempool;         /* size class pools, memalloc.c */
     MGLOBAL       *midiGlobals;
     CS_HASH_TABLE *envVarDB;
     MEMFIL        *memfiles;
@@ -1671,6 +1700,11 @@ typedef struct NAME__ {
     watchList     *dag_wlmm;
     char          **dag_task_dep;
     int           dag_task_max_size;
+    struct dag_ws_t *dag_ws;     /* work-stealing dispatcher state */
+    int           *dag_first_dep;   /* first task each task waits for */
+    char          **dag_dep_cache;  /* dependency of instr pairs */
+    int           *dag_ins_first;   /* first task and dependency, by instr */
+    int           dag_dep_cache_size;
     uint32_t      tempStatus;    /* keeps track of which files are temps */
     int           orcLineOffset; /* 1 less than 1st orch line in the CSD */
     int           scoLineOffset; /* 1 less than 1st score line in the CSD */
@@ -1697,6 +1731,19 @@ typedef struct NAME__ {
     int (*kperf)(CSOUND *); /* kperf function pointer, to switch between debug
                                and nodebug function */
     int           score_parser;
+    void          *csprofile_data; /* profiler data */
+    void          *instance_pool_thread;
+    void          *instance_pool_wakeup;
+    void          *instance_pool_lock;
+    volatile int  instance_pool_loop;
+    void          *init_pass_queue; /* instances waiting for init, insert.c */
+    void          *chn_updates;   /* batched control channel updates, bus.c */
+    void          *rt_event_queue; /* csoundSubmitScoreEvents(), linevent.c */
+    void          *FFT_plans;     /* fftplan.c */
+    void          *gen01_maps;    /* memory-mapped GEN01 tables, fgens.c */
+    void          *ftgen_pool;    /* table generation threads, fgens.c */
+    volatile int  ftgen_pending;  /* tables queued for ftgen_pool */
+    void          *array_pool;    /* array operation threads, arrays.c */
     /*struct CSOUND_ **self;*/
     /**@}*/
 #endif  /* __BUILDING_LIBCSOUND */
@@ -45,6 +45,9 @@
 //Printing
 #define WR (0x0100)
 
+//Writes to its input arguments (vincr, ##array_set, OSClisten...)
+#define IW (0x0200)
+
 //Deprecated
 #define _QQ (0x8000)
 
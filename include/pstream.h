@@ -142,6 +142,10 @@ typedef struct {
         AUXCH   oldInPhase;
         AUXCH           trig;
         double          *cosine, *sine;
+        MYFLT           *analwin;       /* window centre, may be shared */
+        void            *group;         /* PVSANAL_GROUP with --pvs-batch */
+        AUXCH           batchbuf;       /* frame handed over to the batch */
+        int             batchstate;
 } PVSANAL;
 
 typedef struct {
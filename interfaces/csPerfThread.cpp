@@ -641,6 +641,12 @@ void CsoundPerformanceThread::ScoreEvent(int absp2mode, char opcod,
                                                 absp2mode, opcod, pcnt, p));
 }
 
+int CsoundPerformanceThread::SubmitScoreEvents(const CS_SCORE_EVENT *events,
+                                               int n)
+{
+    return csoundSubmitScoreEvents(csound, events, n);
+}
+
 void CsoundPerformanceThread::InputMessage(const char *s)
 {
     QueueMessage(new CsPerfThreadMsg_InputMessage(this, s));
@@ -205,6 +205,12 @@ class PUBLIC CsoundPerformanceThread {
      * performance, instead of the default of relative to the current time.
      */
     void ScoreEvent(int absp2mode, char opcod, int pcnt, const MYFLT *p);
+    /**
+     * Queues 'n' binary score events with csoundSubmitScoreEvents(),
+     * bypassing the message queue of this class. Returns the number of
+     * events queued, or CSOUND_ERROR.
+     */
+    int SubmitScoreEvents(const CS_SCORE_EVENT *events, int n);
     /**
      * Sends a score event as a string, similarly to line events (-L).
      */
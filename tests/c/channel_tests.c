@@ -356,6 +356,49 @@ void test_string_channel(void)
     csoundDestroy(csound);
 }
 
+void test_channel_handles(void)
+{
+    csoundSetGlobalEnv("OPCODE6DIR64", "../../");
+    CSOUND *csound = csoundCreate(0);
+    csoundCreateMessageBuffer(csound, 0);
+    csoundSetOption(csound, "--logfile=NULL");
+    csoundCompileOrc(csound, orc2);
+    int err = csoundStart(csound);
+    CU_ASSERT(err == CSOUND_SUCCESS);
+
+    void *h[3];
+    MYFLT vals[3] = { 1.0, 2.0, 3.0 };
+    h[0] = csoundGetChannelHandle(csound, "testing",
+                                  CSOUND_CONTROL_CHANNEL | CSOUND_INPUT_CHANNEL);
+    h[1] = csoundGetChannelHandle(csound, "h1",
+                                  CSOUND_CONTROL_CHANNEL | CSOUND_INPUT_CHANNEL);
+    h[2] = csoundGetChannelHandle(csound, "h2",
+                                  CSOUND_CONTROL_CHANNEL | CSOUND_INPUT_CHANNEL);
+    CU_ASSERT_PTR_NOT_NULL(h[0]);
+    CU_ASSERT_PTR_NULL(csoundGetChannelHandle(csound, "testing2",
+                                              CSOUND_CONTROL_CHANNEL));
+
+    csoundSetControlChannelHandle(csound, h[0], 5.0);
+    CU_ASSERT_EQUAL(5.0, csoundGetControlChannelHandle(csound, h[0]));
+    CU_ASSERT_EQUAL(5.0, csoundGetControlChannel(csound, "testing", NULL));
+
+    /* batched updates only land at the next k-cycle */
+    CU_ASSERT_EQUAL(3, csoundSetControlChannels(csound, h, vals, 3));
+    CU_ASSERT_EQUAL(5.0, csoundGetControlChannelHandle(csound, h[0]));
+    csoundPerformKsmps(csound);
+    CU_ASSERT_EQUAL(1.0, csoundGetControlChannelHandle(csound, h[0]));
+    CU_ASSERT_EQUAL(2.0, csoundGetControlChannel(csound, "h1", NULL));
+    CU_ASSERT_EQUAL(3.0, csoundGetControlChannel(csound, "h2", NULL));
+
+    void *ah = csoundGetChannelHandle(csound, "testing2",
+                                      CSOUND_AUDIO_CHANNEL);
+    CU_ASSERT_EQUAL(CSOUND_ERROR, csoundSetControlChannels(csound, &ah,
+                                                           vals, 1));
+
+    csoundCleanup(csound);
+    csoundDestroyMessageBuffer(csound);
+    csoundDestroy(csound);
+}
 
 int main()
 {
@@ -382,6 +425,7 @@ int main()
            || (NULL == CU_add_test(pSuite, "Invalid channels", test_invalid_channel))
            || (NULL == CU_add_test(pSuite, "Channel hints", test_chn_hints))
            || (NULL == CU_add_test(pSuite, "String channel", test_string_channel))
+           || (NULL == CU_add_test(pSuite, "Channel handles", test_channel_handles))
        )
    {
       CU_cleanup_registry();
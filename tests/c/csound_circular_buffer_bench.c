@@ -0,0 +1,104 @@
+/*
+ * File:   csound_circular_buffer_bench.c
+ *
+ * Throughput of the circular buffer API between two threads: one item
+ * per call, blocks of items, zero-copy reserve/commit, and several
+ * writers on an MPSC buffer.  Not run as a test; run it by hand when
+ * changing InOut/circularbuffer.c.
+ */
+
+#include "csound.h"
+#include "pthread.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BUFSIZE   4096
+#define ITEMS     (1 << 24)
+#define WRITERS   4
+
+typedef struct {
+    CSOUND  *csound;
+    void    *rb;
+    int     block;
+    int     reserve;
+    long    items;
+} BENCH;
+
+static void *writer(void *arg)
+{
+    BENCH *b = (BENCH *) arg;
+    float vals[256];
+    long i = 0;
+    int k;
+    for (k = 0; k < 256; k++) vals[k] = k;
+    while (i < b->items) {
+      int n = b->block;
+      if (n > b->items - i) n = (int) (b->items - i);
+      if (b->reserve) {
+        void *seg1, *seg2;
+        int n1, n2;
+        n = csoundWriteCircularBufferReserve(b->csound, b->rb, n,
+                                             &seg1, &n1, &seg2, &n2);
+        for (k = 0; k < n1; k++) ((float *) seg1)[k] = k;
+        for (k = 0; k < n2; k++) ((float *) seg2)[k] = k;
+        csoundWriteCircularBufferCommit(b->csound, b->rb, n);
+      }
+      else
+        n = csoundWriteCircularBuffer(b->csound, b->rb, vals, n);
+      i += n;
+    }
+    return NULL;
+}
+
+static void run(const char *name, int block, int reserve, int nwriters)
+{
+    CSOUND *csound = csoundCreate(NULL);
+    BENCH b;
+    pthread_t th[WRITERS];
+    RTCLOCK clk;
+    float vals[256];
+    long total, got = 0;
+    double secs;
+    int i;
+
+    b.csound = csound;
+    b.rb = nwriters > 1 ?
+      csoundCreateMPSCCircularBuffer(csound, BUFSIZE, sizeof(float)) :
+      csoundCreateCircularBuffer(csound, BUFSIZE, sizeof(float));
+    b.block = block;
+    b.reserve = reserve;
+    b.items = ITEMS / nwriters;
+    total = b.items * nwriters;
+    csoundInitTimerStruct(&clk);
+    for (i = 0; i < nwriters; i++)
+      pthread_create(&th[i], NULL, writer, &b);
+    while (got < total) {
+      if (reserve) {
+        void *seg1, *seg2;
+        int n1, n2;
+        int n = csoundReadCircularBufferReserve(csound, b.rb, block,
+                                                &seg1, &n1, &seg2, &n2);
+        csoundReadCircularBufferCommit(csound, b.rb, n);
+        got += n;
+      }
+      else
+        got += csoundReadCircularBuffer(csound, b.rb, vals, block);
+    }
+    for (i = 0; i < nwriters; i++)
+      pthread_join(th[i], NULL);
+    secs = csoundGetRealTime(&clk);
+    printf("%-28s %8.2f Mitems/s\n", name, 1.0e-6 * total / secs);
+    csoundDestroyCircularBuffer(csound, b.rb);
+    csoundDestroy(csound);
+}
+
+int main(void)
+{
+    csoundInitialize(CSOUNDINIT_NO_SIGNAL_HANDLER | CSOUNDINIT_NO_ATEXIT);
+    run("SPSC, 1 item per call", 1, 0, 1);
+    run("SPSC, 64 items per call", 64, 0, 1);
+    run("SPSC, 256 items per call", 256, 0, 1);
+    run("SPSC, reserve/commit 256", 256, 1, 1);
+    run("MPSC, 4 writers, 64 items", 64, 0, WRITERS);
+    return 0;
+}
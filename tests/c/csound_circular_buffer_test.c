@@ -7,6 +7,7 @@
 
 #include "csound.h"
 #include "pthread.h"
+#include <sched.h>
 #include "CUnit/Basic.h"
 
 
@@ -132,6 +133,155 @@ void test_wrap(void) {
     csoundDestroy(csound);
 }
 
+void test_reserve_commit(void) {
+    int i, j, n1, n2;
+    void *seg1, *seg2;
+    CSOUND* csound = csoundCreate(NULL);
+    void *rb = csoundCreateCircularBuffer(csound, 32, sizeof(float));
+    CU_ASSERT_PTR_NOT_NULL(rb);
+    int writeindex = 0, readindex = 0;
+    for (i = 1 ; i < 40; i++) {
+        int n = csoundWriteCircularBufferReserve(csound, rb, (i % 13) + 1,
+                                                 &seg1, &n1, &seg2, &n2);
+        CU_ASSERT_EQUAL(n, n1 + n2);
+        for (j = 0; j < n1; j++)
+            ((float *) seg1)[j] = writeindex++;
+        for (j = 0; j < n2; j++)
+            ((float *) seg2)[j] = writeindex++;
+        csoundWriteCircularBufferCommit(csound, rb, n);
+        n = csoundReadCircularBufferReserve(csound, rb, (i % 11) + 1,
+                                            &seg1, &n1, &seg2, &n2);
+        CU_ASSERT_EQUAL(n, n1 + n2);
+        for (j = 0; j < n1; j++)
+            CU_ASSERT_EQUAL(((float *) seg1)[j], readindex++);
+        for (j = 0; j < n2; j++)
+            CU_ASSERT_EQUAL(((float *) seg2)[j], readindex++);
+        csoundReadCircularBufferCommit(csound, rb, n);
+    }
+    csoundDestroyCircularBuffer(csound, rb);
+    csoundDestroy(csound);
+}
+
+#define MPSC_WRITERS 4
+#define MPSC_ITEMS 100000
+
+static CSOUND *mpsc_csound;
+static void *mpsc_rb;
+
+static void *mpsc_writer(void *arg) {
+    int id = (int) (intptr_t) arg, i = 0, n, k;
+    int vals[8];
+    while (i < MPSC_ITEMS) {
+        n = (i % 8) + 1;
+        if (n > MPSC_ITEMS - i) n = MPSC_ITEMS - i;
+        for (k = 0; k < n; k++)
+            vals[k] = (id << 24) | (i + k);
+        n = csoundWriteCircularBuffer(mpsc_csound, mpsc_rb, vals, n);
+        if (n == 0) sched_yield();      /* full: let the reader run */
+        i += n;
+    }
+    return NULL;
+}
+
+void test_mpsc(void) {
+    int i, k, n, next[MPSC_WRITERS], vals[64];
+    long got = 0;
+    pthread_t writers[MPSC_WRITERS];
+    mpsc_csound = csoundCreate(NULL);
+    mpsc_rb = csoundCreateMPSCCircularBuffer(mpsc_csound, 100, sizeof(int));
+    CU_ASSERT_PTR_NOT_NULL(mpsc_rb);
+    for (i = 0; i < MPSC_WRITERS; i++) {
+        next[i] = 0;
+        pthread_create(&writers[i], NULL, mpsc_writer, (void *) (intptr_t) i);
+    }
+    /* each writer's items must come out complete and in order */
+    while (got < (long) MPSC_WRITERS * MPSC_ITEMS) {
+        n = csoundReadCircularBuffer(mpsc_csound, mpsc_rb, vals, 64);
+        for (k = 0; k < n; k++) {
+            int id = vals[k] >> 24;
+            CU_ASSERT_EQUAL(vals[k] & 0xFFFFFF, next[id]);
+            next[id]++;
+        }
+        if (n == 0) sched_yield();
+        got += n;
+    }
+    for (i = 0; i < MPSC_WRITERS; i++)
+        pthread_join(writers[i], NULL);
+    CU_ASSERT_EQUAL(csoundReadCircularBuffer(mpsc_csound, mpsc_rb, vals, 1), 0);
+    csoundDestroyCircularBuffer(mpsc_csound, mpsc_rb);
+    csoundDestroy(mpsc_csound);
+}
+
+#define SPSC_ITEMS 1000000
+
+static void *spsc_rb;
+
+/* writes a running count, alternating copies and in-place reservations
+   of odd sizes so that both cross the end of the buffer */
+static void *spsc_writer(void *arg) {
+    int i = 0, k, n, n1, n2, vals[37];
+    void *seg1, *seg2;
+    (void) arg;
+    while (i < SPSC_ITEMS) {
+        n = (i % 37) + 1;
+        if (n > SPSC_ITEMS - i) n = SPSC_ITEMS - i;
+        if (i & 1) {
+            n = csoundWriteCircularBufferReserve(mpsc_csound, spsc_rb, n,
+                                                 &seg1, &n1, &seg2, &n2);
+            for (k = 0; k < n1; k++)
+                ((int *) seg1)[k] = i + k;
+            for (k = 0; k < n2; k++)
+                ((int *) seg2)[k] = i + n1 + k;
+            csoundWriteCircularBufferCommit(mpsc_csound, spsc_rb, n);
+        }
+        else {
+            for (k = 0; k < n; k++)
+                vals[k] = i + k;
+            n = csoundWriteCircularBuffer(mpsc_csound, spsc_rb, vals, n);
+        }
+        if (n == 0) sched_yield();
+        i += n;
+    }
+    return NULL;
+}
+
+void test_spsc_threads(void) {
+    int k, n, n1, n2, vals[64];
+    int next = 0;
+    void *seg1, *seg2;
+    pthread_t writer;
+    mpsc_csound = csoundCreate(NULL);
+    spsc_rb = csoundCreateCircularBuffer(mpsc_csound, 251, sizeof(int));
+    CU_ASSERT_PTR_NOT_NULL(spsc_rb);
+    pthread_create(&writer, NULL, spsc_writer, NULL);
+    /* the reader must see the count without gaps, repeats or stale data */
+    while (next < SPSC_ITEMS) {
+        if (next & 1) {
+            n = csoundReadCircularBufferReserve(mpsc_csound, spsc_rb, 53,
+                                                &seg1, &n1, &seg2, &n2);
+            for (k = 0; k < n1; k++)
+                CU_ASSERT_EQUAL(((int *) seg1)[k], next + k);
+            for (k = 0; k < n2; k++)
+                CU_ASSERT_EQUAL(((int *) seg2)[k], next + n1 + k);
+            csoundReadCircularBufferCommit(mpsc_csound, spsc_rb, n);
+        }
+        else {
+            n = csoundPeekCircularBuffer(mpsc_csound, spsc_rb, vals, 64);
+            if (n > 0)
+                CU_ASSERT_EQUAL(vals[0], next);
+            n = csoundReadCircularBuffer(mpsc_csound, spsc_rb, vals, 64);
+            for (k = 0; k < n; k++)
+                CU_ASSERT_EQUAL(vals[k], next + k);
+        }
+        if (n == 0) sched_yield();
+        next += n;
+    }
+    pthread_join(writer, NULL);
+    CU_ASSERT_EQUAL(csoundReadCircularBuffer(mpsc_csound, spsc_rb, vals, 1), 0);
+    csoundDestroyCircularBuffer(mpsc_csound, spsc_rb);
+    csoundDestroy(mpsc_csound);
+}
+
 
 int main()
 {
@@ -153,6 +303,9 @@ int main()
             || (NULL == CU_add_test(pSuite, "Test read and write diff sizes", test_read_write_diff_size))
             || (NULL == CU_add_test(pSuite, "Test peek", test_peek))
             || (NULL == CU_add_test(pSuite, "Test wrap", test_wrap))
+            || (NULL == CU_add_test(pSuite, "Test reserve and commit", test_reserve_commit))
+            || (NULL == CU_add_test(pSuite, "Test multiple writers", test_mpsc))
+            || (NULL == CU_add_test(pSuite, "Test writer and reader threads", test_spsc_threads))
         )
     {
         CU_cleanup_registry();
@@ -0,0 +1,200 @@
+/*
+ * File:   diskin_test.c
+ *
+ * Tests of diskin2 streaming (OOps/diskin2.c): in real-time mode a
+ * stream read ahead by the I/O threads must play the same samples as a
+ * diskin2 with iforceSync, and csoundGetStreamStats() must list it while
+ * the note plays.  With --diskin-threads=0 nothing is streamed.
+ */
+
+#define __BUILDING_LIBCSOUND
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "csoundCore.h"
+#include "CUnit/Basic.h"
+
+#define KSMPS     32
+#define KCYCLES   1000          /* the note lasts about 690 */
+#define FRAMES    44100
+#define SNDFILE_NAME "diskin_test.wav"
+
+static const char *orc =
+    "sr = 44100\n"
+    "ksmps = 32\n"
+    "nchnls = 2\n"
+    "0dbfs = 1\n"
+    "chn_a \"l\", 2\n"
+    "chn_a \"r\", 2\n"
+    "chn_a \"lsync\", 2\n"
+    "chn_a \"rsync\", 2\n"
+    "instr 1\n"
+    "a1, a2 diskin2 \"" SNDFILE_NAME "\", 1\n"
+    "a3, a4 diskin2 \"" SNDFILE_NAME "\", 1, 0, 0, 0, 4, 0, 0, 1\n"
+    "chnset a1, \"l\"\n"
+    "chnset a2, \"r\"\n"
+    "chnset a3, \"lsync\"\n"
+    "chnset a4, \"rsync\"\n"
+    "endin\n";
+
+static void put16(FILE *f, int v)
+{
+    putc(v & 0xff, f);
+    putc((v >> 8) & 0xff, f);
+}
+
+static void put32(FILE *f, long v)
+{
+    put16(f, (int) (v & 0xffff));
+    put16(f, (int) ((v >> 16) & 0xffff));
+}
+
+/* a stereo 16 bit WAV file: a sine and a ramp */
+int init_suite1(void) {
+    FILE    *f = fopen(SNDFILE_NAME, "wb");
+    int     i;
+
+    if (f == NULL)
+      return -1;
+    fwrite("RIFF", 1, 4, f);
+    put32(f, 36 + FRAMES * 4);
+    fwrite("WAVEfmt ", 1, 8, f);
+    put32(f, 16);
+    put16(f, 1);                        /* PCM */
+    put16(f, 2);
+    put32(f, 44100);
+    put32(f, 44100 * 4);
+    put16(f, 4);
+    put16(f, 16);
+    fwrite("data", 1, 4, f);
+    put32(f, FRAMES * 4);
+    for (i = 0; i < FRAMES; i++) {
+      put16(f, (int) (20000.0 * sin(i * 0.0627)));
+      put16(f, (i % 2000) * 16 - 16000);
+    }
+    return fclose(f);
+}
+
+int clean_suite1(void) {
+    remove(SNDFILE_NAME);
+    return 0;
+}
+
+/* plays a note and counts the samples that differ between the streamed
+   and the synchronous diskin2; *streamed is the most streams listed at
+   once, and *sounding the samples of the note that are not quiet */
+static int run(const char *threads, int *streamed, int64_t *underruns,
+               int *sounding)
+{
+    CSOUND  *csound = csoundCreate(NULL);
+    CS_STREAM_STATS stats[4];
+    MYFLT   l[KSMPS], r[KSMPS], lsync[KSMPS], rsync[KSMPS];
+    int     k, n, i, w, bad = 0;
+
+    csoundSetOption(csound, "-odac");
+    csoundSetOption(csound, "-+rtaudio=null");
+    csoundSetOption(csound, "--realtime");
+    csoundSetOption(csound, "-d");
+    csoundSetOption(csound, (char*) threads);
+    csoundSetMessageLevel(csound, 0);
+    CU_ASSERT_EQUAL(csoundCompileOrc(csound, orc), 0);
+    csoundReadScore(csound, "i1 0 0.5\n");
+    CU_ASSERT_EQUAL(csoundStart(csound), 0);
+    *streamed = 0;
+    *underruns = 0;
+    *sounding = 0;
+    for (k = 0; k < KCYCLES; k++) {
+      /* give the I/O threads time to read ahead, so that a slow machine
+         does not make the streamed note late */
+      for (w = 0; w < 1000; w++) {
+        n = csoundGetStreamStats(csound, stats, 4);
+        for (i = 0; i < n && i < 4; i++)
+          if (stats[i].buffered < KSMPS)
+            break;
+        if (i == n || i == 4)
+          break;
+        csoundSleep(1);
+      }
+      if (n > *streamed)
+        *streamed = n;
+      for (i = 0; i < n && i < 4; i++) {
+        CU_ASSERT_EQUAL(stats[i].insno, 1);
+        if (stats[i].underruns > *underruns)
+          *underruns = stats[i].underruns;
+      }
+      csoundPerformKsmps(csound);
+      csoundGetAudioChannel(csound, "l", l);
+      csoundGetAudioChannel(csound, "r", r);
+      csoundGetAudioChannel(csound, "lsync", lsync);
+      csoundGetAudioChannel(csound, "rsync", rsync);
+      for (i = 0; i < KSMPS; i++) {
+        if (l[i] != lsync[i] || r[i] != rsync[i])
+          bad++;
+        if (fabs(lsync[i]) > 0.1)
+          (*sounding)++;
+      }
+    }
+    /* the note has ended, and its stream with it */
+    CU_ASSERT_EQUAL(csoundGetStreamStats(csound, stats, 4), 0);
+    csoundDestroy(csound);
+    return bad;
+}
+
+void test_streamed(void)
+{
+    int     streamed, sounding;
+    int64_t underruns;
+
+    CU_ASSERT_EQUAL(run("--diskin-threads=2", &streamed, &underruns,
+                        &sounding), 0);
+    CU_ASSERT_EQUAL(streamed, 1);
+    CU_ASSERT_EQUAL(underruns, 0);
+    CU_ASSERT(sounding > 10000);
+}
+
+void test_no_threads(void)
+{
+    int     streamed, sounding;
+    int64_t underruns;
+
+    CU_ASSERT_EQUAL(run("--diskin-threads=0", &streamed, &underruns,
+                        &sounding), 0);
+    CU_ASSERT_EQUAL(streamed, 0);
+    CU_ASSERT(sounding > 10000);
+}
+
+int main()
+{
+    CU_pSuite pSuite = NULL;
+
+    csoundInitialize(CSOUNDINIT_NO_SIGNAL_HANDLER | CSOUNDINIT_NO_ATEXIT);
+
+    /* initialize the CUnit test registry */
+    if (CUE_SUCCESS != CU_initialize_registry())
+        return CU_get_error();
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("diskin2 streaming tests", init_suite1,
+                          clean_suite1);
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* add the tests to the suite */
+    if ((NULL == CU_add_test(pSuite, "streamed diskin2", test_streamed))
+        || (NULL == CU_add_test(pSuite, "diskin2 without I/O threads",
+                                test_no_threads))
+        )
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* Run all tests using the CUnit Basic interface */
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+    return CU_get_error();
+}
@@ -1,8 +1,11 @@
 #include "csound.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <CUnit/Basic.h>
 
 #include "time.h"
+#include <unistd.h>
 
 int init_suite1(void)
 {
@@ -30,6 +33,179 @@ void test_udp_server(void)
     csoundDestroy(csound);
 }
 
+void test_submit_score_events(void)
+{
+    CSOUND  *csound;
+    CS_SCORE_EVENT ev[2], *burst;
+    int     i;
+
+    csound = csoundCreate(NULL);
+    csoundCreateMessageBuffer(csound, 0);
+    csoundSetOption(csound, "-n");
+    csoundSetOption(csound, "--ksmps=16");
+    csoundCompileOrc(csound, "instr 1\n chnset p4, \"ev\"\n endin\n"
+                             "instr 2\n chnset chnget:i(\"n\")+1, \"n\"\n"
+                             " turnoff\n endin\n");
+    /* no queue before the performance has started */
+    CU_ASSERT_EQUAL(CSOUND_ERROR, csoundSubmitScoreEvents(csound, ev, 0));
+    CU_ASSERT_EQUAL(CSOUND_SUCCESS, csoundStart(csound));
+
+    memset(ev, 0, sizeof(ev));
+    ev[0].type = 'i';
+    ev[0].pcnt = 4;
+    ev[0].p[0] = 1; ev[0].p[2] = 0.1; ev[0].p[3] = 1;
+    ev[1] = ev[0];
+    ev[1].frame = 160;      /* ten k-cycles in */
+    ev[1].p[3] = 2;
+    CU_ASSERT_EQUAL(2, csoundSubmitScoreEvents(csound, ev, 2));
+    csoundPerformKsmps(csound);
+    CU_ASSERT_EQUAL(1.0, csoundGetControlChannel(csound, "ev", NULL));
+    for (i = 0; i < 10; i++)
+      csoundPerformKsmps(csound);
+    CU_ASSERT_EQUAL(2.0, csoundGetControlChannel(csound, "ev", NULL));
+
+    ev[0].type = 'x';
+    CU_ASSERT_EQUAL(CSOUND_ERROR, csoundSubmitScoreEvents(csound, ev, 1));
+
+    /* a burst of a thousand notes all start on the next k-cycle */
+    burst = (CS_SCORE_EVENT *) calloc(1000, sizeof(CS_SCORE_EVENT));
+    for (i = 0; i < 1000; i++) {
+      burst[i].type = 'i';
+      burst[i].pcnt = 3;
+      burst[i].p[0] = 2; burst[i].p[2] = 1;
+    }
+    CU_ASSERT_EQUAL(1000, csoundSubmitScoreEvents(csound, burst, 1000));
+    csoundPerformKsmps(csound);
+    CU_ASSERT_EQUAL(1000.0, csoundGetControlChannel(csound, "n", NULL));
+    free(burst);
+
+    csoundCleanup(csound);
+    /* the queue goes with the performance */
+    ev[0].type = 'i';
+    CU_ASSERT_EQUAL(CSOUND_ERROR, csoundSubmitScoreEvents(csound, ev, 1));
+    csoundDestroyMessageBuffer(csound);
+    csoundDestroy(csound);
+}
+
+void test_profiling(void)
+{
+    CSOUND  *csound;
+    CS_PROFILE_ENTRY *lst;
+    CS_PROFILE_CYCLE worst[8];
+    int64_t bins[CS_PROFILE_BINS], total;
+    int     i, n, found = 0;
+
+    csound = csoundCreate(NULL);
+    csoundCreateMessageBuffer(csound, 0);
+    csoundSetOption(csound, "-n");
+    csoundSetOption(csound, "--ksmps=32");
+    csoundCompileOrc(csound, "instr 1\n a1 oscili 0.1, 440\n out a1\n endin\n"
+                             "instr 2\n k1 = 1\n endin\n");
+    csoundReadScore(csound, "i1 0 10\ni2 0 10\n");
+    CU_ASSERT_EQUAL(CSOUND_SUCCESS, csoundStart(csound));
+    /* opcodes are timed on one cycle in four */
+    CU_ASSERT_EQUAL(CSOUND_SUCCESS, csoundSetProfiling(csound, 4));
+    for (i = 0; i < 100; i++)
+      csoundPerformKsmps(csound);
+
+    total = csoundGetProfileHistogram(csound, bins);
+    CU_ASSERT_EQUAL(100, total);
+    for (i = 0; i < CS_PROFILE_BINS; i++)
+      total -= bins[i];
+    CU_ASSERT_EQUAL(0, total);
+
+    n = csoundGetInstrProfile(csound, &lst);
+    CU_ASSERT_EQUAL(2, n);
+    for (i = 0; i < n; i++) {
+      CU_ASSERT(lst[i].insno == 1 || lst[i].insno == 2);
+      CU_ASSERT_EQUAL(100, lst[i].calls);
+      CU_ASSERT(lst[i].max <= lst[i].seconds);
+      if (i > 0) CU_ASSERT(lst[i].seconds <= lst[i-1].seconds);
+    }
+    csoundDeleteProfile(csound, lst);
+
+    n = csoundGetOpcodeProfile(csound, &lst);
+    CU_ASSERT(n > 0);
+    for (i = 0; i < n; i++) {
+      CU_ASSERT_EQUAL(0, lst[i].insno);
+      if (!strncmp(lst[i].name, "oscili", 6)) {
+        CU_ASSERT_EQUAL(25, lst[i].calls);
+        found = 1;
+      }
+    }
+    CU_ASSERT(found);
+    csoundDeleteProfile(csound, lst);
+
+    n = csoundGetProfileWorstCycles(csound, worst, 8);
+    CU_ASSERT(n > 0 && n <= 8);
+    for (i = 1; i < n; i++)
+      CU_ASSERT(worst[i].seconds <= worst[i-1].seconds);
+
+    /* nothing more is recorded once profiling is off */
+    CU_ASSERT_EQUAL(CSOUND_SUCCESS, csoundSetProfiling(csound, 0));
+    for (i = 0; i < 10; i++)
+      csoundPerformKsmps(csound);
+    CU_ASSERT_EQUAL(100, csoundGetProfileHistogram(csound, bins));
+
+    csoundCleanup(csound);
+    csoundDestroyMessageBuffer(csound);
+    csoundDestroy(csound);
+}
+
+/* eight overlapping notes, then pool_notes more once those have ended */
+static void run_instance_pool(CSOUND *csound, int pool_notes,
+                              CS_INSTANCE_POOL_STATS *stats)
+{
+    char    sco[1024];
+    int     i, n = 0;
+
+    csoundCreateMessageBuffer(csound, 0);
+    csoundSetOption(csound, "-n");
+    csoundSetOption(csound, "--ksmps=32");
+    csoundCompileOrc(csound, "instr 1\n a1 oscili p4, 440\n out a1\n endin\n");
+    for (i = 0; i < 8; i++)
+      n += sprintf(sco + n, "i1 0 0.1 0.01\n");
+    for (i = 0; i < pool_notes; i++)
+      n += sprintf(sco + n, "i1 0.5 0.1 0.01\n");
+    csoundReadScore(csound, sco);
+    CU_ASSERT_EQUAL(CSOUND_SUCCESS, csoundStart(csound));
+    for (i = 0; i < 400; i++)           /* about 0.3 seconds */
+      csoundPerformKsmps(csound);
+    usleep(200000);                     /* time for the pool thread */
+    while (csoundPerformKsmps(csound) == 0)
+      ;
+    CU_ASSERT_EQUAL(CSOUND_SUCCESS,
+                    csoundGetInstancePoolStats(csound, 1, stats));
+    CU_ASSERT_EQUAL(CSOUND_ERROR,
+                    csoundGetInstancePoolStats(csound, 2, stats + 1));
+    csoundCleanup(csound);
+    csoundDestroyMessageBuffer(csound);
+    csoundDestroy(csound);
+}
+
+void test_instance_pool(void)
+{
+    CS_INSTANCE_POOL_STATS stats[2];
+
+    /* without the pool thread, the second group reuses the first eight */
+    run_instance_pool(csoundCreate(NULL), 8, stats);
+    CU_ASSERT_EQUAL(8, stats[0].misses);
+    CU_ASSERT_EQUAL(8, stats[0].hits);
+    CU_ASSERT_EQUAL(8, stats[0].allocated);
+
+    /* with it, the pool keeps 8 + 8/4 + 2 instances, so twelve notes
+       start without building any */
+    {
+      CSOUND *csound = csoundCreate(NULL);
+      csoundSetOption(csound, "--instance-pool=2");
+      run_instance_pool(csound, 12, stats);
+    }
+    CU_ASSERT_EQUAL(8, stats[0].misses);
+    CU_ASSERT_EQUAL(12, stats[0].hits);
+    CU_ASSERT(stats[0].target >= 12);
+    CU_ASSERT(stats[0].allocated >= 12);
+}
+
 int main()
 {
     CU_pSuite pSuite = NULL;
@@ -47,6 +223,10 @@ int main()
 
     /* add the tests to the suite */
     if ((NULL == CU_add_test(pSuite, "Test UDP Server", test_udp_server))
+        || (NULL == CU_add_test(pSuite, "Binary score events",
+                                test_submit_score_events))
+        || (NULL == CU_add_test(pSuite, "Profiling", test_profiling))
+        || (NULL == CU_add_test(pSuite, "Instance pool", test_instance_pool))
         )
     {
         CU_cleanup_registry();
@@ -0,0 +1,80 @@
+/*
+ * File:   fft_bench.c
+ *
+ * Speed of the planned FFTs (OOps/fftplan.c) against the scalar ones in
+ * OOps/fftlib.c, and the largest difference between their results.
+ * Not run as a test; run it by hand when changing either file.
+ */
+
+#define __BUILDING_LIBCSOUND
+#include "csoundCore.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define WORK (1 << 23)          /* points transformed per measurement */
+
+static double run(CSOUND *csound, MYFLT *buf, int N, int real)
+{
+    RTCLOCK clk;
+    int     i, reps = WORK / N;
+    csoundInitTimerStruct(&clk);
+    for (i = 0; i < reps; i++) {
+      if (real) {
+        csound->RealFFT(csound, buf, N);
+        csound->InverseRealFFT(csound, buf, N);
+      }
+      else {
+        csound->ComplexFFT(csound, buf, N);
+        csound->InverseComplexFFT(csound, buf, N);
+      }
+    }
+    return 1.0e9 * csoundGetRealTime(&clk) / reps;
+}
+
+static void compare(CSOUND *plan, CSOUND *scalar, int N, int real)
+{
+    int     i, len = real ? N : 2*N;
+    MYFLT   *a = (MYFLT *) malloc(len * sizeof(MYFLT));
+    MYFLT   *b = (MYFLT *) malloc(len * sizeof(MYFLT));
+    double  err = 0.0, tp, ts;
+
+    for (i = 0; i < len; i++)
+      a[i] = b[i] = (MYFLT) (rand() / (double) RAND_MAX - 0.5);
+    if (real) {
+      plan->RealFFT(plan, a, N);
+      scalar->RealFFT(scalar, b, N);
+    }
+    else {
+      plan->ComplexFFT(plan, a, N);
+      scalar->ComplexFFT(scalar, b, N);
+    }
+    for (i = 0; i < len; i++)
+      if (fabs(a[i] - b[i]) > err) err = fabs(a[i] - b[i]);
+    tp = run(plan, a, N, real);
+    ts = run(scalar, b, N, real);
+    printf("%-7s %6d  scalar %10.1f ns  plan %10.1f ns  x%.2f  err %.2g\n",
+           real ? "real" : "complex", N, ts, tp, ts / tp, err);
+    free(a);
+    free(b);
+}
+
+int main(void)
+{
+    CSOUND  *plan, *scalar;
+    int     N;
+
+    csoundInitialize(CSOUNDINIT_NO_SIGNAL_HANDLER | CSOUNDINIT_NO_ATEXIT);
+    plan = csoundCreate(NULL);
+    scalar = csoundCreate(NULL);
+    csoundSetOption(plan, "--fft-backend=plan");
+    csoundSetOption(scalar, "--fft-backend=scalar");
+    printf("forward + inverse transform, per call\n");
+    for (N = 64; N <= 16384; N *= 2)
+      compare(plan, scalar, N, 1);
+    for (N = 64; N <= 16384; N *= 2)
+      compare(plan, scalar, N, 0);
+    csoundDestroy(plan);
+    csoundDestroy(scalar);
+    return 0;
+}
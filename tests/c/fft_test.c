@@ -0,0 +1,194 @@
+/*
+ * File:   fft_test.c
+ *
+ * Tests of the power-of-two FFTs: the planned transforms (OOps/fftplan.c)
+ * and the scalar ones (OOps/fftlib.c, --fft-backend=scalar) against a
+ * direct DFT, against each other, and for the round trip through the
+ * inverse transforms.
+ */
+
+#define __BUILDING_LIBCSOUND
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "csoundCore.h"
+#include "CUnit/Basic.h"
+
+#ifdef USE_DOUBLE
+#define FFT_TOL 1.0e-9
+#else
+#define FFT_TOL 1.0e-3
+#endif
+
+static CSOUND *plan, *scalar;
+
+int init_suite1(void) {
+    plan = csoundCreate(NULL);
+    scalar = csoundCreate(NULL);
+    csoundSetOption(plan, "--fft-backend=plan");
+    csoundSetOption(scalar, "--fft-backend=scalar");
+    return 0;
+}
+
+int clean_suite1(void) {
+    csoundDestroy(plan);
+    csoundDestroy(scalar);
+    return 0;
+}
+
+static void fill(MYFLT *buf, int len, unsigned int seed) {
+    int i;
+    srand(seed);
+    for (i = 0; i < len; i++)
+      buf[i] = (MYFLT) (rand() / (double) RAND_MAX - 0.5);
+}
+
+/* largest difference, relative to the largest magnitude in b */
+static double diff(const MYFLT *a, const MYFLT *b, int len) {
+    double err = 0.0, mag = 1.0;
+    int i;
+    for (i = 0; i < len; i++) {
+      if (fabs(a[i] - b[i]) > err) err = fabs(a[i] - b[i]);
+      if (fabs(b[i]) > mag) mag = fabs(b[i]);
+    }
+    return err / mag;
+}
+
+/* X[k] = sum x[n] exp(-2 pi i k n / N), in the layouts of fftlib.c:
+   complex data interleaved re, im; real data as DC, Nyquist, then
+   re, im of bins 1 .. N/2-1 */
+static void dft(const MYFLT *in, MYFLT *out, int N, int real) {
+    int k, n;
+    for (k = 0; k < (real ? N/2 + 1 : N); k++) {
+      double re = 0.0, im = 0.0;
+      for (n = 0; n < N; n++) {
+        double w = -2.0 * PI * (double) k * n / N;
+        double xr = real ? in[n] : in[2*n], xi = real ? 0.0 : in[2*n+1];
+        re += xr * cos(w) - xi * sin(w);
+        im += xr * sin(w) + xi * cos(w);
+      }
+      if (!real) {
+        out[2*k] = (MYFLT) re; out[2*k+1] = (MYFLT) im;
+      }
+      else if (k == 0)
+        out[0] = (MYFLT) re;
+      else if (k == N/2)
+        out[1] = (MYFLT) re;
+      else {
+        out[2*k] = (MYFLT) re; out[2*k+1] = (MYFLT) im;
+      }
+    }
+}
+
+static void forward(CSOUND *csound, MYFLT *buf, int N, int real) {
+    if (real) csound->RealFFT(csound, buf, N);
+    else csound->ComplexFFT(csound, buf, N);
+}
+
+static void check_dft(int real) {
+    int N, len;
+    MYFLT in[2*256], ref[2*256], a[2*256], b[2*256];
+    for (N = 16; N <= 256; N *= 2) {
+      len = real ? N : 2*N;
+      fill(in, len, N);
+      dft(in, ref, N, real);
+      memcpy(a, in, len * sizeof(MYFLT));
+      memcpy(b, in, len * sizeof(MYFLT));
+      forward(plan, a, N, real);
+      forward(scalar, b, N, real);
+      CU_ASSERT(diff(a, ref, len) < FFT_TOL);
+      CU_ASSERT(diff(b, ref, len) < FFT_TOL);
+    }
+}
+
+void test_complex_dft(void) {
+    check_dft(0);
+}
+
+void test_real_dft(void) {
+    check_dft(1);
+}
+
+/* the two backends agree, and the inverse undoes the forward transform */
+static void check_backends(int real) {
+    int N, i, len;
+    for (N = 16; N <= 16384; N *= 2) {
+      MYFLT *in, *a, *b, scale;
+      len = real ? N : 2*N;
+      in = (MYFLT *) malloc(len * sizeof(MYFLT));
+      a = (MYFLT *) malloc(len * sizeof(MYFLT));
+      b = (MYFLT *) malloc(len * sizeof(MYFLT));
+      fill(in, len, N + real);
+      memcpy(a, in, len * sizeof(MYFLT));
+      memcpy(b, in, len * sizeof(MYFLT));
+      forward(plan, a, N, real);
+      forward(scalar, b, N, real);
+      CU_ASSERT(diff(a, b, len) < FFT_TOL);
+      if (real) {
+        plan->InverseRealFFT(plan, a, N);
+        scalar->InverseRealFFT(scalar, b, N);
+        scale = plan->GetInverseRealFFTScale(plan, N);
+      }
+      else {
+        plan->InverseComplexFFT(plan, a, N);
+        scalar->InverseComplexFFT(scalar, b, N);
+        scale = plan->GetInverseComplexFFTScale(plan, N);
+      }
+      for (i = 0; i < len; i++) {
+        a[i] *= scale;
+        b[i] *= scale;
+      }
+      CU_ASSERT(diff(a, in, len) < FFT_TOL);
+      CU_ASSERT(diff(b, in, len) < FFT_TOL);
+      free(in);
+      free(a);
+      free(b);
+    }
+}
+
+void test_complex_backends(void) {
+    check_backends(0);
+}
+
+void test_real_backends(void) {
+    check_backends(1);
+}
+
+int main()
+{
+    CU_pSuite pSuite = NULL;
+
+    /* initialize the CUnit test registry */
+    if (CUE_SUCCESS != CU_initialize_registry())
+        return CU_get_error();
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("FFT tests", init_suite1, clean_suite1);
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* add the tests to the suite */
+    if ((NULL == CU_add_test(pSuite, "Complex FFT against DFT",
+                             test_complex_dft))
+        || (NULL == CU_add_test(pSuite, "Real FFT against DFT",
+                                test_real_dft))
+        || (NULL == CU_add_test(pSuite, "Complex FFT backends",
+                                test_complex_backends))
+        || (NULL == CU_add_test(pSuite, "Real FFT backends",
+                                test_real_backends))
+        )
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* Run all tests using the CUnit Basic interface */
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+    return CU_get_error();
+}
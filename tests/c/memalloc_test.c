@@ -0,0 +1,170 @@
+/*
+ * File:   memalloc_test.c
+ *
+ * Tests of the size class pools behind csound->Malloc() and friends
+ * (Engine/memalloc.c).
+ */
+
+#define __BUILDING_LIBCSOUND
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pthread.h"
+#include "csoundCore.h"
+#include "CUnit/Basic.h"
+
+int init_suite1(void) {
+    return 0;
+}
+
+int clean_suite1(void) {
+    return 0;
+}
+
+void test_pool_stats(void) {
+    CSOUND *csound = csoundCreate(NULL);
+    CS_MEMORY_STATS before, after;
+    void *p, *q;
+
+    csoundGetMemoryStats(csound, &before);
+    p = csound->Malloc(csound, 100);
+    q = csound->Calloc(csound, 1000);
+    CU_ASSERT_PTR_NOT_NULL(p);
+    CU_ASSERT_PTR_NOT_NULL(q);
+    CU_ASSERT_EQUAL(((char *) q)[999], 0);
+    csoundGetMemoryStats(csound, &after);
+    CU_ASSERT_EQUAL(after.pool_allocs - before.pool_allocs, 2);
+
+    /* a block that still fits its class is kept by ReAlloc */
+    memset(p, 0x55, 100);
+    CU_ASSERT_PTR_EQUAL(csound->ReAlloc(csound, p, 110), p);
+    /* a larger one moves, keeping the contents */
+    p = csound->ReAlloc(csound, p, 5000);
+    CU_ASSERT_EQUAL(((unsigned char *) p)[99], 0x55);
+    csound->Free(csound, p);
+    csound->Free(csound, q);
+    csoundGetMemoryStats(csound, &after);
+    CU_ASSERT_EQUAL(after.pool_allocs - after.pool_frees,
+                    before.pool_allocs - before.pool_frees);
+
+    /* large blocks come from the heap */
+    p = csound->Malloc(csound, 100000);
+    csound->Free(csound, p);
+    csoundGetMemoryStats(csound, &before);
+    CU_ASSERT_EQUAL(before.heap_allocs - after.heap_allocs, 1);
+    CU_ASSERT_EQUAL(before.heap_frees - after.heap_frees, 1);
+    csoundDestroy(csound);
+}
+
+void test_reserve(void) {
+    CSOUND *csound = csoundCreate(NULL);
+    CS_MEMORY_STATS before, after;
+    void *p[1000];
+    int i;
+
+    csoundGetMemoryStats(csound, &before);
+    CU_ASSERT_EQUAL(csoundReserveMemory(csound, 200, 1000), 0);
+    csoundGetMemoryStats(csound, &after);
+    CU_ASSERT(after.pool_bytes - before.pool_bytes >= 1000 * 200);
+    /* reserved blocks are used without fetching new chunks */
+    for (i = 0; i < 1000; i++)
+      p[i] = csound->Malloc(csound, 200);
+    csoundGetMemoryStats(csound, &before);
+    CU_ASSERT_EQUAL(before.pool_misses, after.pool_misses);
+    for (i = 0; i < 1000; i++)
+      csound->Free(csound, p[i]);
+    /* too large for the pools: ignored */
+    CU_ASSERT_EQUAL(csoundReserveMemory(csound, 1 << 20, 1), 0);
+    csoundGetMemoryStats(csound, &after);
+    CU_ASSERT_EQUAL(after.pool_bytes, before.pool_bytes);
+    csoundDestroy(csound);
+}
+
+#define POOL_THREADS 4
+#define POOL_ROUNDS 20000
+#define POOL_LIVE 64
+
+static CSOUND *pool_csound;
+
+/* every thread keeps a set of live blocks of various sizes, each filled
+   with its own pattern, and checks them when they are freed */
+static void *pool_thread(void *arg) {
+    int id = (int) (intptr_t) arg, i, k, bad = 0;
+    unsigned char *live[POOL_LIVE];
+    size_t size[POOL_LIVE];
+    unsigned int seed = id + 1;
+
+    memset(live, 0, sizeof(live));
+    for (i = 0; i < POOL_ROUNDS; i++) {
+      k = rand_r(&seed) % POOL_LIVE;
+      if (live[k] != NULL) {
+        size_t j;
+        for (j = 0; j < size[k]; j++)
+          if (live[k][j] != (unsigned char) (id * POOL_LIVE + k))
+            bad++;
+        pool_csound->Free(pool_csound, live[k]);
+      }
+      size[k] = 1 + rand_r(&seed) % 3000;
+      live[k] = pool_csound->Malloc(pool_csound, size[k]);
+      memset(live[k], id * POOL_LIVE + k, size[k]);
+    }
+    for (k = 0; k < POOL_LIVE; k++)
+      pool_csound->Free(pool_csound, live[k]);
+    return (void *) (intptr_t) bad;
+}
+
+void test_threads(void) {
+    CS_MEMORY_STATS before, after;
+    pthread_t threads[POOL_THREADS];
+    void *bad;
+    int i;
+
+    pool_csound = csoundCreate(NULL);
+    csoundGetMemoryStats(pool_csound, &before);
+    for (i = 0; i < POOL_THREADS; i++)
+      pthread_create(&threads[i], NULL, pool_thread, (void *) (intptr_t) i);
+    for (i = 0; i < POOL_THREADS; i++) {
+      pthread_join(threads[i], &bad);
+      CU_ASSERT_EQUAL((intptr_t) bad, 0);
+    }
+    /* every block taken was given back */
+    csoundGetMemoryStats(pool_csound, &after);
+    CU_ASSERT_EQUAL(after.pool_allocs - after.pool_frees,
+                    before.pool_allocs - before.pool_frees);
+    CU_ASSERT(after.pool_allocs - before.pool_allocs >=
+              POOL_THREADS * POOL_ROUNDS);
+    csoundDestroy(pool_csound);
+}
+
+int main()
+{
+    CU_pSuite pSuite = NULL;
+
+    /* initialize the CUnit test registry */
+    if (CUE_SUCCESS != CU_initialize_registry())
+        return CU_get_error();
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("Memory allocator tests", init_suite1, clean_suite1);
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* add the tests to the suite */
+    if ((NULL == CU_add_test(pSuite, "Pool counters", test_pool_stats))
+        || (NULL == CU_add_test(pSuite, "Reserved blocks", test_reserve))
+        || (NULL == CU_add_test(pSuite, "Concurrent allocation", test_threads))
+        )
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* Run all tests using the CUnit Basic interface */
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+    return CU_get_error();
+}
@@ -0,0 +1,91 @@
+/*
+ * File:   osc_bench.c
+ *
+ * Cost per sample of the a-rate oscillators (OOps/ugens2.c) and table
+ * readers (OOps/ugtabs.c), with k- and a-rate arguments, and a checksum
+ * of their output to compare before and after a change.  Not run as a
+ * test; run it by hand when changing either file.
+ */
+
+#include "csound.h"
+#include <math.h>
+#include <stdio.h>
+
+#define KCYCLES   20000
+#define KSMPS     64
+#define VOICES    32
+
+static const char *orc =
+    "sr = 44100\n"
+    "ksmps = %d\n"
+    "nchnls = 1\n"
+    "0dbfs = 1\n"
+    "gisin ftgen 1, 0, 8192, 10, 1, 0.5, 0.3\n"
+    "gisnp ftgen 2, 0, -5000, 10, 1, 0.5, 0.3\n"
+    "instr 1\n"
+    "kf = 100 + p4 * 7\n"
+    "af = kf * (1 + 0.01 * poscil:a(1, 3))\n"
+    "aph phasor kf\n"
+    "a1 %s\n"
+    "out a1 * 0.01\n"
+    "endin\n";
+
+static const char *ops[] = {
+    "oscil 0.5, kf, 1",
+    "oscil 0.5, af, 1",
+    "oscil a(0.5), af, 1",
+    "oscili 0.5, kf, 1",
+    "oscili 0.5, af, 1",
+    "oscil3 0.5, kf, 1",
+    "oscil3 0.5, af, 1",
+    "table aph, 1, 1",
+    "table aph * 1.5 - 0.25, 1, 1, 0, 1",
+    "tablei aph, 1, 1",
+    "tablei aph, 2, 1, 0, 1",
+    "table3 aph, 1, 1",
+};
+
+static double run(const char *op, double *sum)
+{
+    CSOUND  *csound = csoundCreate(NULL);
+    char    text[2048], sco[64];
+    RTCLOCK clk;
+    double  t;
+    int     i, j;
+
+    csoundSetOption(csound, "-n");
+    csoundSetOption(csound, "-d");
+    csoundSetMessageLevel(csound, 0);
+    snprintf(text, sizeof(text), orc, KSMPS, op);
+    csoundCompileOrc(csound, text);
+    for (i = 0; i < VOICES; i++) {
+      snprintf(sco, sizeof(sco), "i1 0 3600 %d\n", i);
+      csoundReadScore(csound, sco);
+    }
+    csoundStart(csound);
+    *sum = 0.0;
+    csoundInitTimerStruct(&clk);
+    for (i = 0; i < KCYCLES; i++) {
+      MYFLT *spout = csoundGetSpout(csound);
+      csoundPerformKsmps(csound);
+      for (j = 0; j < KSMPS; j++)
+        *sum += fabs(spout[j]);
+    }
+    t = 1.0e9 * csoundGetRealTime(&clk) / ((double) KCYCLES*KSMPS*VOICES);
+    csoundDestroy(csound);
+    return t;
+}
+
+int main(void)
+{
+    int     i;
+
+    csoundInitialize(CSOUNDINIT_NO_SIGNAL_HANDLER | CSOUNDINIT_NO_ATEXIT);
+    printf("%d voices, ksmps %d, time per sample per voice "
+           "(including the rest of the instrument)\n", VOICES, KSMPS);
+    for (i = 0; i < (int) (sizeof(ops)/sizeof(ops[0])); i++) {
+      double  sum, t = run(ops[i], &sum);
+      printf("%-36s %7.2f ns  sum %.17g\n", ops[i], t, sum);
+    }
+    return 0;
+}
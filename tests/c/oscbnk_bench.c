@@ -0,0 +1,86 @@
+/*
+ * File:   oscbnk_bench.c
+ *
+ * Cost of oscbnk (with and without its parametric EQ) and grain2
+ * (Opcodes/oscbnk.c) with many oscillators, and a checksum of the output
+ * to compare before and after a change.  Not run as a test; run it by
+ * hand when changing the oscillator bank.
+ */
+
+#include "csound.h"
+#include <math.h>
+#include <stdio.h>
+
+#define KCYCLES   2000
+#define KSMPS     64
+
+static const char *orc =
+    "sr = 44100\n"
+    "ksmps = %d\n"
+    "nchnls = 1\n"
+    "0dbfs = 1\n"
+    "giSine ftgen 0, 0, 4096, 10, 1\n"
+    "giWin ftgen 0, 0, 16384, 20, 2, 1\n"
+    "instr 1\n"
+    "a1 %s\n"
+    "out a1 * 0.01\n"
+    "endin\n";
+
+static const char *opcodes[] = {
+    /* 100 oscillators, both LFOs on every parameter, no EQ */
+    "oscbnk 220, 0.5, 0.1, 0.2, 100, 12, 0.2, 3, 0.5, 5, 255,"
+    " 0, 0, 0, 0, 0, 0, -1, giSine, giSine, giSine",
+    /* the same with a peak filter per oscillator, coefficients interpolated */
+    "oscbnk 220, 0.5, 0.1, 0.2, 100, 12, 0.2, 3, 0.5, 5, 255,"
+    " 200, 4000, 0.5, 2, 1, 4, 4, giSine, giSine, giSine",
+    /* 100 overlapping grains, 20 ms long */
+    "grain2 440, 0.05, 0.02, 100, giSine, giWin, 0, 12, 0",
+    /* the same with a random frequency per grain and short grains */
+    "grain2 440, 0.05, 0.005, 100, giSine, giWin, 0, 12, 4"
+};
+
+static const char *names[] = {
+    "oscbnk", "oscbnk eq", "grain2", "grain2 short"
+};
+
+static double run(const char *opcode, double *sum)
+{
+    CSOUND  *csound = csoundCreate(NULL);
+    char    text[4096];
+    RTCLOCK clk;
+    double  t;
+    int     i, j;
+
+    csoundSetOption(csound, "-n");
+    csoundSetOption(csound, "-d");
+    csoundSetMessageLevel(csound, 0);
+    snprintf(text, sizeof(text), orc, KSMPS, opcode);
+    csoundCompileOrc(csound, text);
+    csoundReadScore(csound, "i1 0 3600\n");
+    csoundStart(csound);
+    *sum = 0.0;
+    csoundInitTimerStruct(&clk);
+    for (i = 0; i < KCYCLES; i++) {
+      MYFLT *spout = csoundGetSpout(csound);
+      csoundPerformKsmps(csound);
+      for (j = 0; j < KSMPS; j++)
+        *sum += fabs(spout[j]);
+    }
+    t = 1.0e9 * csoundGetRealTime(&clk) / ((double) KCYCLES*KSMPS);
+    csoundDestroy(csound);
+    return t;
+}
+
+int main(void)
+{
+    int     i;
+
+    csoundInitialize(CSOUNDINIT_NO_SIGNAL_HANDLER | CSOUNDINIT_NO_ATEXIT);
+    printf("ksmps %d, time per sample (including the rest of the "
+           "instrument)\n", KSMPS);
+    for (i = 0; i < 4; i++) {
+      double  sum, t = run(opcodes[i], &sum);
+      printf("%-13s %9.2f ns  sum %.17g\n", names[i], t, sum);
+    }
+    return 0;
+}
@@ -0,0 +1,216 @@
+/*
+ * File:   oscbnk_test.c
+ *
+ * Tests of oscbnk (Opcodes/oscbnk.c).  Without LFOs and EQ, a bank of
+ * oscillators with phases from a parameter table must be the sum of the
+ * table reads worked out here, sample for sample.  With every LFO route
+ * and each EQ mode, a bank must be the sum of banks of one oscillator
+ * each, as the oscillators of a group of lanes must not mix.
+ */
+
+#include "test_util.h"
+#include <stdarg.h>
+
+#define OSC_TOL   TEST_TOL(1.0e-12, 1.0e-5)
+
+#define NSAMPS    19200         /* 300 k-periods of 64, 192 of 100 */
+#define NOSC      20            /* two groups of lanes and part of one */
+#define NLFO      13
+
+static const char *orc_head =
+    "sr = 44100\n"
+    "ksmps = %d\n"
+    "nchnls = 2\n"
+    "0dbfs = 1\n"
+    "giSine ftgen 1, 0, 4096, 10, 1\n"
+    "giLfo1 ftgen 2, 0, 1024, 10, 1\n"
+    "giLfo2 ftgen 3, 0, 1024, 10, 1, 0.5\n"
+    "giEq ftgen 4, 0, 257, -7, 0, 256, 1\n";
+
+static MYFLT out[NSAMPS * 2];
+static char orc[32768];
+
+/* appends to orc */
+static void add(const char *fmt, ...)
+{
+    size_t  len = strlen(orc);
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintf(orc + len, sizeof(orc) - len, fmt, args);
+    va_end(args);
+}
+
+/* runs orc for NSAMPS samples into out, and copies table 1 to tab */
+static void run(MYFLT *tab)
+{
+    CSOUND  *csound = test_start(orc, "i1 0 3600\n", NULL);
+    MYFLT   *ft;
+
+    if (tab != NULL) {
+      CU_ASSERT_EQUAL(csoundGetTable(csound, &ft, 1), 4096);
+      memcpy(tab, ft, 4097 * sizeof(MYFLT));
+    }
+    test_capture(csound, out, NSAMPS);
+    csoundDestroy(csound);
+}
+
+/* oscillator i starts at phase i / 32, which the table holds exactly;
+   the other four parameters are for the LFOs */
+static void bank_orc(int ksmps)
+{
+    int     i;
+
+    orc[0] = '\0';
+    add(orc_head, ksmps);
+    add("giPar ftgen 10, 0, -%d, -2", NOSC * 5);
+    for (i = 0; i < NOSC; i++)
+      add(", %.10g, 0, 0, 0, 0", i / 32.0);
+    add("\ninstr 1\n"
+        "a1 oscbnk 441, 0, 0, 0, %d, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,"
+        " -1, 1, 0, 0, 0, 0, 0, 10\n"
+        "outs a1, a1\n"
+        "endin\n", NOSC);
+}
+
+/* the oscillators of bank_orc, read from tab with linear interpolation
+   at the fixed point phases of oscbnk, and mixed in order */
+static void bank_reference(const MYFLT *tab, MYFLT *ref)
+{
+    MYFLT   f = FL(441.0) * (FL(1.0) / FL(44100.0));
+    uint32  ph[NOSC], f_i, lobits = 19, mask = (1UL << 19) - 1UL;
+    MYFLT   pfrac = FL(1.0) / (MYFLT) (1UL << 19);
+    int     i, n;
+
+    f_i = (uint32) MYFLT2LRND(f * (MYFLT) 0x80000000UL) & 0x7FFFFFFFUL;
+    for (i = 0; i < NOSC; i++)
+      ph[i] = (uint32) MYFLT2LRND((MYFLT) (i / 32.0)
+                                  * (MYFLT) 0x80000000UL) & 0x7FFFFFFFUL;
+    for (n = 0; n < NSAMPS; n++) {
+      MYFLT y = FL(0.0);
+      for (i = 0; i < NOSC; i++) {
+        uint32  x = ph[i] >> lobits;
+        MYFLT   k = tab[x];
+        k += (tab[x + 1] - k) * (MYFLT) ((int32) (ph[i] & mask)) * pfrac;
+        y += k;
+        ph[i] = (ph[i] + f_i) & 0x7FFFFFFFUL;
+      }
+      ref[n] = y;
+    }
+}
+
+void test_bank(void)
+{
+    static MYFLT tab[4097], ref[NSAMPS];
+    static const int ksmps[] = { 64, 100, 1 };
+    int     i, j, bad, sounding;
+
+    for (j = 0; j < 3; j++) {
+      bank_orc(ksmps[j]);
+      run(tab);
+      bank_reference(tab, ref);
+      bad = sounding = 0;
+      for (i = 0; i < NSAMPS; i++) {
+        if (fabs(out[2 * i] - ref[i]) > OSC_TOL)
+          bad++;
+        if (fabs(ref[i]) > 1.0)
+          sounding++;
+      }
+      CU_ASSERT_EQUAL(bad, 0);
+      CU_ASSERT(sounding > NSAMPS / 2);
+    }
+}
+
+/* a bank of NLFO oscillators on the left, and on the right the sum of
+   NLFO banks of one oscillator each, with the same parameters */
+static void lanes_orc(int eqmode)
+{
+    static const char *args =
+        "300, 0.5, 20, 0.3, %d, 1, 0.5, 3, 1, 7, 255,"
+        " 200, 2000, 0.5, 2, 0.5, 2, %d, 1, 2, 3, 4, 4, 4, %d\n";
+    MYFLT   par[NLFO * 5];
+    int     i, j;
+
+    for (i = 0; i < NLFO * 5; i++)
+      par[i] = (MYFLT) fmod(i * 0.6180339887, 1.0);
+    orc[0] = '\0';
+    add(orc_head, 64);
+    add("giPar ftgen 10, 0, -%d, -2", NLFO * 5);
+    for (i = 0; i < NLFO * 5; i++)
+      add(", %.6f", par[i]);
+    add("\n");
+    for (i = 0; i < NLFO; i++) {
+      add("giPar%d ftgen %d, 0, -5, -2", i, 20 + i);
+      for (j = 0; j < 5; j++)
+        add(", %.6f", par[i * 5 + j]);
+      add("\n");
+    }
+    add("instr 1\n");
+    add("a1 oscbnk ");
+    add(args, NLFO, eqmode, 10);
+    for (i = 0; i < NLFO; i++) {
+      add("a1_%d oscbnk ", i);
+      add(args, 1, eqmode, 20 + i);
+    }
+    add("a2 = a1_0\n");
+    for (i = 1; i < NLFO; i++)
+      add("a2 = a2 + a1_%d\n", i);
+    add("outs a1, a2\n"
+        "endin\n");
+}
+
+void test_lanes(void)
+{
+    static const int eqmode[] = { -1, 2, 3, 4 };
+    double  peak;
+    int     i, j, bad;
+
+    for (j = 0; j < 4; j++) {
+      lanes_orc(eqmode[j]);
+      run(NULL);
+      bad = 0;
+      peak = 0.0;
+      for (i = 0; i < NSAMPS; i++) {
+        if (fabs(out[2 * i] - out[2 * i + 1]) > OSC_TOL)
+          bad++;
+        peak = fabs(out[2 * i]) > peak ? fabs(out[2 * i]) : peak;
+      }
+      CU_ASSERT_EQUAL(bad, 0);
+      CU_ASSERT(peak > 1.0);
+    }
+}
+
+int main()
+{
+    CU_pSuite pSuite = NULL;
+
+    csoundInitialize(CSOUNDINIT_NO_SIGNAL_HANDLER | CSOUNDINIT_NO_ATEXIT);
+
+    /* initialize the CUnit test registry */
+    if (CUE_SUCCESS != CU_initialize_registry())
+        return CU_get_error();
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("oscbnk tests", init_suite1, clean_suite1);
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* add the tests to the suite */
+    if ((NULL == CU_add_test(pSuite, "a bank against a reference",
+                             test_bank))
+        || (NULL == CU_add_test(pSuite, "a bank against single oscillators",
+                                test_lanes))
+        )
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* Run all tests using the CUnit Basic interface */
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+    return CU_get_error();
+}
@@ -0,0 +1,282 @@
+/*
+ * File:   oscil_test.c
+ *
+ * Tests of the a-rate oscillators (oscil, oscili, oscil3 in OOps/ugens2.c)
+ * and table readers (table, tablei, table3 in OOps/ugtabs.c) against the
+ * per-sample loops they replaced, fed with the same inputs through
+ * channels.  The block kernels keep the operations of those loops, so the
+ * results must be identical where the compiler does not contract a
+ * multiply and an add into one instruction.  The oscillators are also
+ * run with the output as the amplitude input.
+ */
+
+#include "test_util.h"
+
+#define OSC_TOL   TEST_TOL(1.0e-12, 1.0e-5)
+
+#define KSMPS     32
+#define KCYCLES   400
+
+static const char *orc =
+    "sr = 44100\n"
+    "ksmps = 32\n"
+    "nchnls = 1\n"
+    "0dbfs = 1\n"
+    "gi1 ftgen 1, 0, 1024, 10, 1, 0.5, 0.3\n"
+    "gi2 ftgen 2, 0, -1000, 10, 1, 0.5, 0.3\n"
+    "chn_k \"kamp\", 1\n"
+    "chn_k \"kcps\", 1\n"
+    "chn_a \"aamp\", 1\n"
+    "chn_a \"acps\", 1\n"
+    "chn_a \"ndx\", 1\n"
+    "chn_a \"out\", 2\n"
+    "instr 1\n"
+    "kamp chnget \"kamp\"\n"
+    "kcps chnget \"kcps\"\n"
+    "aamp chnget \"aamp\"\n"
+    "acps chnget \"acps\"\n"
+    "andx chnget \"ndx\"\n"
+    "a1 = aamp\n"
+    "a1 %s\n"
+    "chnset a1, \"out\"\n"
+    "endin\n";
+
+typedef struct {
+    const char  *op;
+    int         interp;         /* 0, 1 (linear) or 3 (cubic) */
+    int         acps, aamp;     /* oscillators: a-rate arguments */
+    int         table, wrap;    /* table readers */
+} VARIANT;
+
+static const VARIANT variants[] = {
+    { "oscil kamp, kcps, 1",    0, 0, 0, 0, 0 },
+    { "oscil kamp, acps, 1",    0, 1, 0, 0, 0 },
+    { "oscil aamp, kcps, 1",    0, 0, 1, 0, 0 },
+    { "oscil aamp, acps, 1",    0, 1, 1, 0, 0 },
+    { "oscili kamp, kcps, 1",   1, 0, 0, 0, 0 },
+    { "oscili kamp, acps, 1",   1, 1, 0, 0, 0 },
+    { "oscili aamp, kcps, 1",   1, 0, 1, 0, 0 },
+    { "oscili aamp, acps, 1",   1, 1, 1, 0, 0 },
+    { "oscil3 kamp, kcps, 1",   3, 0, 0, 0, 0 },
+    { "oscil3 kamp, acps, 1",   3, 1, 0, 0, 0 },
+    { "oscil3 aamp, kcps, 1",   3, 0, 1, 0, 0 },
+    { "oscil3 aamp, acps, 1",   3, 1, 1, 0, 0 },
+    { "table andx, 1, 1",       0, 0, 0, 1, 0 },
+    { "table andx, 1, 1, 0, 1", 0, 0, 0, 1, 1 },
+    { "table andx, 2, 1, 0, 1", 0, 0, 0, 2, 1 },
+    { "tablei andx, 1, 1",      1, 0, 0, 1, 0 },
+    { "tablei andx, 1, 1, 0, 1", 1, 0, 0, 1, 1 },
+    { "tablei andx, 2, 1, 0, 1", 1, 0, 0, 2, 1 },
+    { "table3 andx, 1, 1",      3, 0, 0, 1, 0 },
+    { "table3 andx, 1, 1, 0, 1", 3, 0, 0, 1, 1 },
+    { "table3 andx, 2, 1",      3, 0, 0, 2, 0 },
+};
+
+/* a1 holds aamp before the oscillator overwrites it */
+static const VARIANT aliased[] = {
+    { "oscil a1, kcps, 1",      0, 0, 1, 0, 0 },
+    { "oscil a1, acps, 1",      0, 1, 1, 0, 0 },
+    { "oscili a1, kcps, 1",     1, 0, 1, 0, 0 },
+    { "oscili a1, acps, 1",     1, 1, 1, 0, 0 },
+    { "oscil3 a1, kcps, 1",     3, 0, 1, 0, 0 },
+    { "oscil3 a1, acps, 1",     3, 1, 1, 0, 0 },
+};
+
+/* the inputs of k-cycle k */
+static void inputs(int k, MYFLT *kamp, MYFLT *kcps,
+                   MYFLT *aamp, MYFLT *acps, MYFLT *ndx)
+{
+    int i;
+    *kamp = (MYFLT) (0.7 + 0.2 * sin(k * 0.1));
+    *kcps = (MYFLT) (-500.0 + 12.5 * k);
+    for (i = 0; i < KSMPS; i++) {
+      int t = k * KSMPS + i;
+      aamp[i] = (MYFLT) (0.5 * cos(0.003 * t));
+      acps[i] = *kcps + (MYFLT) (300.0 * sin(0.01 * t));
+      ndx[i] = (MYFLT) (-0.37 + 1.9 * (t % 1000) / 1000.0);
+    }
+}
+
+/* oscil, oscili and oscil3 as they were, one sample at a time */
+static void ref_oscil(CSOUND *csound, const VARIANT *v, FUNC *ftp,
+                      int32 *phase, MYFLT kamp, MYFLT kcps,
+                      const MYFLT *aamp, const MYFLT *acps, MYFLT *out)
+{
+    MYFLT   *ft = ftp->ftable;
+    int32   phs = *phase, lobits = ftp->lobits;
+    int32   inc = MYFLT2LONG(kcps * csound->sicvt);
+    int     n;
+
+    for (n = 0; n < KSMPS; n++) {
+      MYFLT amp = v->aamp ? aamp[n] : kamp;
+      if (v->acps)
+        inc = MYFLT2LONG(acps[n] * csound->sicvt);
+      if (v->interp == 0)
+        out[n] = ft[phs >> lobits] * amp;
+      else if (v->interp == 1) {
+        MYFLT fract = PFRAC(phs), *ftab = ft + (phs >> lobits);
+        MYFLT v1 = ftab[0];
+        out[n] = (v1 + (ftab[1] - v1) * fract) * amp;
+      }
+      else {
+        MYFLT fract = PFRAC(phs), y0, y1, ym1, y2;
+        int32 x0 = (phs >> lobits);
+        x0--;
+        if (x0 < 0) {
+          ym1 = ft[ftp->flen-1]; x0 = 0;
+        }
+        else ym1 = ft[x0++];
+        y0 = ft[x0++];
+        y1 = ft[x0++];
+        if (x0 > (int32) ftp->flen) y2 = ft[1]; else y2 = ft[x0];
+        {
+          MYFLT frsq = fract*fract;
+          MYFLT frcu = frsq*ym1;
+          MYFLT t1 = y2 + y0+y0+y0;
+          out[n] = amp * (y0 + FL(0.5)*frcu +
+                          fract*(y1 - frcu/FL(6.0) - t1/FL(6.0) - ym1/FL(3.0)) +
+                          frsq*fract*(t1/FL(6.0) - FL(0.5)*y1) +
+                          frsq*(FL(0.5)* y1 - y0));
+        }
+      }
+      phs = (phs+inc) & PHMASK;
+    }
+    *phase = phs;
+}
+
+/* table, tablei and table3 with a normalised index, as they were */
+static void ref_table(const VARIANT *v, FUNC *ftp, const MYFLT *ndx_f,
+                      MYFLT *out)
+{
+    MYFLT   *func = ftp->ftable, mul = (MYFLT) ftp->flen;
+    int     len = ftp->flen, mask = ftp->lenmask, np2 = mask ? 0 : 1;
+    int     n, ndx;
+
+    for (n = 0; n < KSMPS; n++) {
+      MYFLT tmp = ndx_f[n] * mul, frac;
+      ndx = (int) FLOOR(tmp);
+      frac = tmp - ndx;
+      if (v->wrap) {
+        if (np2) {
+          while (ndx >= len) ndx -= len;
+          while (ndx < 0)  ndx += len;
+        }
+        else ndx &= mask;
+      } else {
+        if (ndx >= len) ndx = len - 1;
+        else if (ndx < 0) ndx = 0;
+      }
+      if (v->interp == 0)
+        out[n] = func[ndx];
+      else if (v->interp == 1 || ndx < 1 || ndx == len-1 || len < 4) {
+        MYFLT x1 = func[ndx], x2 = func[ndx+1];
+        out[n] = x1 + (x2 - x1)*frac;
+      }
+      else {
+        MYFLT x0 = func[ndx-1], x1 = func[ndx], x2 = func[ndx+1];
+        MYFLT x3 = func[ndx+2], fracsq, fracub, temp1;
+        fracsq = frac*frac;
+        fracub = fracsq*x0;
+        temp1 = x3+x1+x1+x1;
+        out[n] =  x1 + FL(0.5)*fracub +
+          frac*(x2 - fracub/FL(6.0) - temp1/FL(6.0) - x0/FL(3.0)) +
+          fracsq*frac*(temp1/FL(6.0) - FL(0.5)*x2) + fracsq*(FL(0.5)*x2 - x1);
+      }
+    }
+}
+
+/* number of samples that differ from the reference */
+static int run_variant(const VARIANT *v)
+{
+    CSOUND  *csound;
+    char    text[2048];
+    MYFLT   kamp, kcps, aamp[KSMPS], acps[KSMPS], ndx[KSMPS];
+    MYFLT   out[KSMPS], ref[KSMPS], fno;
+    FUNC    *ftp;
+    int32   phase = 0;
+    int     k, n, bad = 0;
+
+    snprintf(text, sizeof(text), orc, v->op);
+    csound = test_start(text, "i1 0 3600\n", NULL);
+    fno = (MYFLT) (v->table ? v->table : 1);
+    ftp = csound->FTnp2Find(csound, &fno);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(ftp);
+    for (k = 0; k < KCYCLES; k++) {
+      inputs(k, &kamp, &kcps, aamp, acps, ndx);
+      csoundSetControlChannel(csound, "kamp", kamp);
+      csoundSetControlChannel(csound, "kcps", kcps);
+      csoundSetAudioChannel(csound, "aamp", aamp);
+      csoundSetAudioChannel(csound, "acps", acps);
+      csoundSetAudioChannel(csound, "ndx", ndx);
+      csoundPerformKsmps(csound);
+      csoundGetAudioChannel(csound, "out", out);
+      if (v->table)
+        ref_table(v, ftp, ndx, ref);
+      else
+        ref_oscil(csound, v, ftp, &phase, kamp, kcps, aamp, acps, ref);
+      for (n = 0; n < KSMPS; n++)
+        if (fabs(out[n] - ref[n]) > OSC_TOL)
+          bad++;
+    }
+    if (bad)
+      printf("%s: %d samples differ\n", v->op, bad);
+    csoundDestroy(csound);
+    return bad;
+}
+
+void test_oscil(void)
+{
+    int i;
+    for (i = 0; i < 12; i++)
+      CU_ASSERT_EQUAL(run_variant(&variants[i]), 0);
+}
+
+void test_table(void)
+{
+    int i;
+    for (i = 12; i < (int) (sizeof(variants)/sizeof(variants[0])); i++)
+      CU_ASSERT_EQUAL(run_variant(&variants[i]), 0);
+}
+
+void test_alias(void)
+{
+    int i;
+    for (i = 0; i < (int) (sizeof(aliased)/sizeof(aliased[0])); i++)
+      CU_ASSERT_EQUAL(run_variant(&aliased[i]), 0);
+}
+
+int main()
+{
+    CU_pSuite pSuite = NULL;
+
+    csoundInitialize(CSOUNDINIT_NO_SIGNAL_HANDLER | CSOUNDINIT_NO_ATEXIT);
+
+    /* initialize the CUnit test registry */
+    if (CUE_SUCCESS != CU_initialize_registry())
+        return CU_get_error();
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("Oscillator tests", init_suite1, clean_suite1);
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* add the tests to the suite */
+    if ((NULL == CU_add_test(pSuite, "oscil, oscili and oscil3", test_oscil))
+        || (NULL == CU_add_test(pSuite, "table, tablei and table3",
+                                test_table))
+        || (NULL == CU_add_test(pSuite, "oscillators writing their amplitude",
+                                test_alias))
+        )
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* Run all tests using the CUnit Basic interface */
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+    return CU_get_error();
+}
@@ -0,0 +1,81 @@
+/*
+ * File:   partikkel_bench.c
+ *
+ * Cost of partikkel (Opcodes/partikkel.c) with many overlapping grains,
+ * with and without trainlets, and a checksum of the output to compare
+ * before and after a change.  Not run as a test; run it by hand when
+ * changing the grain engine.
+ */
+
+#include "csound.h"
+#include <math.h>
+#include <stdio.h>
+
+#define KCYCLES   2000
+#define KSMPS     64
+
+/* 30000 grains a second, 40 ms long: about 1200 grains at a time */
+static const char *orc =
+    "sr = 44100\n"
+    "ksmps = %d\n"
+    "nchnls = 2\n"
+    "0dbfs = 1\n"
+    "giSine ftgen 0, 0, 4096, 10, 1\n"
+    "giCos ftgen 0, 0, 8192, 11, 1\n"
+    "giSaw ftgen 0, 0, 4096, 7, -1, 4096, 1\n"
+    "giWin ftgen 0, 0, 4096, 20, 2, 1\n"
+    "giDist ftgen 0, 0, 32768, 21, 1, 1\n"
+    "giAmps ftgen 0, 0, 8, -2, 0, 0, 0.5, 0.3, 0.2, 0, %s\n"
+    "instr 1\n"
+    "async = 0\n"
+    "afm oscili 0.3, 3\n"
+    "asamp = 0\n"
+    "a1, a2 partikkel 30000, 0.3, giDist, async, 0.5, giWin, giWin, giWin,"
+    " 0.3, 0.4, 40, 0.05, -1, 220, 0.3, -1, -1, afm, -1, -1, giCos,"
+    " 300, 20, 0.7, -1, 0, giSine, giSaw, giSine, giSine, giAmps,"
+    " asamp, asamp, asamp, asamp, 1, 1.5, 0.75, 2, 2000\n"
+    "outs a1, a2\n"
+    "endin\n";
+
+static double run(const char *trainlet, double *sum)
+{
+    CSOUND  *csound = csoundCreate(NULL);
+    char    text[4096];
+    RTCLOCK clk;
+    double  t;
+    int     i, j;
+
+    csoundSetOption(csound, "-n");
+    csoundSetOption(csound, "-d");
+    csoundSetMessageLevel(csound, 0);
+    snprintf(text, sizeof(text), orc, KSMPS, trainlet);
+    csoundCompileOrc(csound, text);
+    csoundReadScore(csound, "i1 0 3600\n");
+    csoundStart(csound);
+    *sum = 0.0;
+    csoundInitTimerStruct(&clk);
+    for (i = 0; i < KCYCLES; i++) {
+      MYFLT *spout = csoundGetSpout(csound);
+      csoundPerformKsmps(csound);
+      for (j = 0; j < 2*KSMPS; j++)
+        *sum += fabs(spout[j]);
+    }
+    t = 1.0e9 * csoundGetRealTime(&clk) / ((double) KCYCLES*KSMPS);
+    csoundDestroy(csound);
+    return t;
+}
+
+int main(void)
+{
+    static const char *trainlets[] = { "0", "0.25" };
+    int     i;
+
+    csoundInitialize(CSOUNDINIT_NO_SIGNAL_HANDLER | CSOUNDINIT_NO_ATEXIT);
+    printf("ksmps %d, time per sample (including the rest of the "
+           "instrument)\n", KSMPS);
+    for (i = 0; i < 2; i++) {
+      double  sum, t = run(trainlets[i], &sum);
+      printf("trainlet gain %-5s %9.2f ns  sum %.17g\n", trainlets[i], t, sum);
+    }
+    return 0;
+}
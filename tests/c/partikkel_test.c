@@ -0,0 +1,229 @@
+/*
+ * File:   partikkel_test.c
+ *
+ * Tests of partikkel (Opcodes/partikkel.c).  A stream of plain sine
+ * grains must be the sum of grains worked out here, sample for sample.
+ * A dense stream using every feature (overlapping grains in several
+ * batches of lanes, sweeps, FM, trainlets, envelopes, masks) must not
+ * depend on ksmps, as grains are carried from one k-period to the next.
+ * With max_grains 1 only the newest grain sounds.
+ */
+
+#include "test_util.h"
+
+#define PART_TOL  TEST_TOL(1.0e-12, 1.0e-5)
+
+#define NSAMPS    22016         /* 344 k-periods of 64, 512 of 43 */
+
+/* 100 grains a second, each 4 ms of a 441 Hz sine at a gain of 0.5 with
+   a flat envelope, starting 5 ms after the grain clock ticks */
+static const char *orc_stream =
+    "sr = 44100\n"
+    "ksmps = %d\n"
+    "nchnls = 1\n"
+    "0dbfs = 1\n"
+    "giSine ftgen 1, 0, 4096, 10, 1\n"
+    "giCos ftgen 2, 0, 8192, 11, 1\n"
+    "giDist ftgen 3, 0, 2, -2, 0.5, 0.5\n"
+    "giAmps ftgen 4, 0, 8, -2, 0, 0, 1, 0, 0, 0, 0, 0\n"
+    "instr 1\n"
+    "a0 = 0\n"
+    "a1 partikkel 100, -1, giDist, a0, 0, -1, -1, -1, 1, 0.5, %s, 0.5,"
+    " -1, 441, 0, -1, -1, a0, -1, -1, giCos, 0, 0, 0, -1, 0, giSine, -1,"
+    " -1, -1, giAmps, a0, a0, a0, a0, 1, 1, 1, 1, %d\n"
+    "out a1\n"
+    "endin\n";
+
+/* 3000 grains a second, 40 ms long: about 120 grains at a time */
+static const char *orc_dense =
+    "sr = 44100\n"
+    "ksmps = %d\n"
+    "nchnls = 2\n"
+    "0dbfs = 1\n"
+    "giSine ftgen 0, 0, 4096, 10, 1\n"
+    "giCos ftgen 0, 0, 8192, 11, 1\n"
+    "giSaw ftgen 0, 0, 4096, 7, -1, 4096, 1\n"
+    "giWin ftgen 0, 0, 4096, 20, 2, 1\n"
+    "giUp ftgen 0, 0, 256, 7, 0, 256, 1\n"
+    "giDist ftgen 0, 0, 4, -2, 0.5, 0.9, 0.2, 0.7\n"
+    "giAmps ftgen 0, 0, 8, -2, 0, 0, 0.5, 0.3, 0.2, 0, 0.25, 0\n"
+    "giChan ftgen 0, 0, 4, -2, 0, 1, 0.3, 0.8\n"
+    "giGain ftgen 0, 0, 8, -2, 0, 2, 1, 0.5, 0.8, 0\n"
+    "instr 1\n"
+    "a0 = 0\n"
+    "afm oscili 0.3, 70\n"
+    "asp oscili 0.1, 0.35\n"
+    "asp1 = asp + 0.1\n"
+    "asp2 = asp + 0.35\n"
+    "asp3 = asp + 0.6\n"
+    "asp4 = asp + 0.85\n"
+    "a1, a2 partikkel 3000, -1, giDist, a0, 0.5, giWin, giWin, giUp, 0.3,"
+    " 0.4, 40, 0.7, giGain, 220, 0.3, -1, -1, afm, -1, giWin, giCos, 300,"
+    " 20, 0.7, giChan, 0, giSine, giSaw, giSine, giSine, giAmps, asp1,"
+    " asp2, asp3, asp4, 1, 1.5, 0.75, 2, 1000\n"
+    "outs a1, a2\n"
+    "endin\n";
+
+static MYFLT out[NSAMPS * 2], dense[NSAMPS * 2];
+
+/* runs an orchestra for NSAMPS samples into buf */
+static void run(const char *orc, const char *duration, int ksmps,
+                int maxgrains, MYFLT *buf)
+{
+    CSOUND  *csound;
+    char    text[4096];
+
+    if (duration != NULL)
+      snprintf(text, sizeof(text), orc, ksmps, duration, maxgrains);
+    else
+      snprintf(text, sizeof(text), orc, ksmps);
+    csound = test_start(text, "i1 0 3600\n", NULL);
+    test_capture(csound, buf, NSAMPS);
+    csoundDestroy(csound);
+}
+
+/* the grains of orc_stream, as partikkel schedules and renders them: the
+   grain clock ticks every 441 samples, a grain starts half a tick later,
+   truncated to a sample within its k-period, and reads the table with
+   linear interpolation */
+static void stream_reference(const MYFLT *tab, int ksmps, MYFLT *ref)
+{
+    double  grainphase = 1.0, onedsr = 1.0 / 44100;
+    int     samples = (int) ((44100 * 4.0) / 1000.0 + 0.5);
+    int     n, t;
+
+    memset(ref, 0, NSAMPS * sizeof(MYFLT));
+    for (n = 0; n < NSAMPS; n++) {
+      if (grainphase >= 1.0) {
+        int      base = n - n % ksmps;
+        double   offset, phase = 0.0, delta;
+        unsigned start;
+
+        do
+          grainphase -= 1.0;
+        while (grainphase >= 1.0);
+        offset = (0.5 - grainphase) / 100;
+        start = base + (unsigned) (n % ksmps + offset * 44100);
+        delta = 441 * onedsr;
+        delta *= 4096;
+        for (t = 0; t < samples && start + t < NSAMPS; t++) {
+          unsigned x0;
+          MYFLT    frac;
+          if (phase >= 4096)
+            phase -= 4096;
+          x0 = (unsigned) phase;
+          frac = (MYFLT) (phase - x0);
+          ref[start + t] += (tab[x0] + (tab[x0 + 1] - tab[x0]) * frac)
+                            * FL(0.5);
+          phase += delta;
+        }
+      }
+      grainphase += 100 * onedsr;
+    }
+}
+
+void test_stream(void)
+{
+    static MYFLT ref[NSAMPS];
+    static const int ksmps[] = { 64, 43, 1 };
+    CSOUND  *csound = csoundCreate(NULL);
+    MYFLT   *tab;
+    int     i, j, bad, sounding;
+
+    /* GEN10 as partikkel gets it */
+    csoundSetOption(csound, "-n");
+    csoundSetMessageLevel(csound, 0);
+    CU_ASSERT_EQUAL(csoundCompileOrc(csound,
+                    "giSine ftgen 1, 0, 4096, 10, 1\n"), 0);
+    CU_ASSERT_EQUAL(csoundStart(csound), 0);
+    CU_ASSERT_EQUAL(csoundGetTable(csound, &tab, 1), 4096);
+    for (j = 0; j < 3; j++) {
+      run(orc_stream, "4", ksmps[j], 1000, out);
+      stream_reference(tab, ksmps[j], ref);
+      bad = sounding = 0;
+      for (i = 0; i < NSAMPS; i++) {
+        if (fabs(out[i] - ref[i]) > PART_TOL)
+          bad++;
+        if (ref[i] != FL(0.0))
+          sounding++;
+      }
+      CU_ASSERT_EQUAL(bad, 0);
+      /* 50 grains of 176 samples, less the zeros of the sine */
+      CU_ASSERT(sounding > 49 * 170);
+    }
+    csoundDestroy(csound);
+}
+
+void test_ksmps(void)
+{
+    static const int ksmps[] = { 43, 16, 1 };
+    double  peak = 0.0;
+    int     i, j, bad;
+
+    run(orc_dense, NULL, 64, 0, dense);
+    for (i = 0; i < 2 * NSAMPS; i++)
+      peak = fabs(dense[i]) > peak ? fabs(dense[i]) : peak;
+    CU_ASSERT(peak > 0.1);
+    for (j = 0; j < 3; j++) {
+      run(orc_dense, NULL, ksmps[j], 0, out);
+      bad = 0;
+      for (i = 0; i < 2 * NSAMPS; i++)
+        if (fabs(out[i] - dense[i]) > PART_TOL)
+          bad++;
+      CU_ASSERT_EQUAL(bad, 0);
+    }
+}
+
+/* 40 ms grains overlap four at a time, but with a pool of one grain each
+   new grain kills the one before */
+void test_max_grains(void)
+{
+    int     i, sounding = 0, loud = 0;
+
+    run(orc_stream, "40", 64, 1, out);
+    for (i = 0; i < NSAMPS; i++) {
+      if (out[i] != FL(0.0))
+        sounding++;
+      if (fabs(out[i]) > 0.5)
+        loud++;
+    }
+    CU_ASSERT(sounding > NSAMPS / 3);
+    CU_ASSERT_EQUAL(loud, 0);
+}
+
+int main()
+{
+    CU_pSuite pSuite = NULL;
+
+    csoundInitialize(CSOUNDINIT_NO_SIGNAL_HANDLER | CSOUNDINIT_NO_ATEXIT);
+
+    /* initialize the CUnit test registry */
+    if (CUE_SUCCESS != CU_initialize_registry())
+        return CU_get_error();
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("partikkel tests", init_suite1, clean_suite1);
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* add the tests to the suite */
+    if ((NULL == CU_add_test(pSuite, "sine grains against a reference",
+                             test_stream))
+        || (NULL == CU_add_test(pSuite, "dense grains at several ksmps",
+                                test_ksmps))
+        || (NULL == CU_add_test(pSuite, "a pool of one grain",
+                                test_max_grains))
+        )
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* Run all tests using the CUnit Basic interface */
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+    return CU_get_error();
+}
@@ -0,0 +1,136 @@
+/*
+ * File:   pvs_batch_test.c
+ *
+ * Tests of batched pvsanal (OOps/pvsanal.c): with --pvs-batch, and with
+ * --pvs-batch=thread, an instance outputs at each hop the spectrum that
+ * it outputs one hop earlier without batching.  The transforms are the
+ * same code, so the frames must be identical where the compiler does
+ * not contract a multiply and an add into one instruction.
+ */
+
+#include "test_util.h"
+
+#define PVS_TOL   TEST_TOL(1.0e-9, 1.0e-3)
+
+#define KSMPS     64
+#define KCYCLES   2000
+#define NFRAMES   (KCYCLES * KSMPS / 256 + 2)
+#define NVALS     1026
+
+/* instr 2 adds members to the group of instr 1, so that the batches hold
+   several frames */
+static const char *orc =
+    "sr = 44100\n"
+    "ksmps = 64\n"
+    "nchnls = 1\n"
+    "0dbfs = 1\n"
+    "gi1 ftgen 1, 0, -1026, -2, 0\n"
+    "chn_a \"in\", 1\n"
+    "chn_k \"frame\", 2\n"
+    "instr 1\n"
+    "ain chnget \"in\"\n"
+    "f1 pvsanal ain, 1024, 256, 1024, 1\n"
+    "kA[] init 1026\n"
+    "kframe pvs2tab kA, f1\n"
+    "copya2ftab kA, 1\n"
+    "chnset kframe, \"frame\"\n"
+    "endin\n"
+    "instr 2\n"
+    "ain chnget \"in\"\n"
+    "f1 pvsanal ain * p4, 1024, 256, 1024, 1\n"
+    "endin\n";
+
+static MYFLT plain[NFRAMES][NVALS];
+
+/* the input of k-cycle k: partials and a little noise */
+static void input(int k, MYFLT *in)
+{
+    static uint32_t seed = 1;
+    int i;
+    if (k == 0)
+      seed = 1;
+    for (i = 0; i < KSMPS; i++) {
+      int t = k * KSMPS + i;
+      seed = seed * 1664525 + 1013904223;
+      in[i] = (MYFLT) (0.3 * sin(t * 0.0731) + 0.2 * sin(t * 0.311 + 1.0)
+                       + 0.05 * ((double) (seed >> 8) / 8388608.0 - 1.0));
+    }
+}
+
+/* runs pvsanal with the given option (or none); without batching it
+   keeps the frames, with batching it counts the values that differ from
+   the frame one hop earlier.  *compared counts the frames compared. */
+static int run(const char *option, int *compared)
+{
+    CSOUND  *csound;
+    MYFLT   in[KSMPS], *tab;
+    int     k, i, err, last = 0, bad = 0;
+
+    csound = test_start(orc, "i1 0 3600\ni2 0 3600 0.5\ni2 0 3600 0.25\n",
+                        option);
+    *compared = 0;
+    for (k = 0; k < KCYCLES; k++) {
+      int frame;
+      input(k, in);
+      csoundSetAudioChannel(csound, "in", in);
+      csoundPerformKsmps(csound);
+      frame = (int) csoundGetControlChannel(csound, "frame", &err);
+      if (frame == last || frame <= 1 || frame >= NFRAMES)
+        continue;
+      last = frame;
+      CU_ASSERT_EQUAL(csoundGetTable(csound, &tab, 1), NVALS);
+      if (option == NULL)
+        memcpy(plain[frame], tab, NVALS * sizeof(MYFLT));
+      else if (frame > 2) {             /* the first frame is empty */
+        for (i = 0; i < NVALS; i++)
+          if (fabs(tab[i] - plain[frame - 1][i]) > PVS_TOL)
+            bad++;
+        (*compared)++;
+      }
+    }
+    csoundDestroy(csound);
+    return bad;
+}
+
+void test_pvs_batch(void)
+{
+    int compared;
+
+    CU_ASSERT_EQUAL(run(NULL, &compared), 0);
+    CU_ASSERT_EQUAL(run("--pvs-batch", &compared), 0);
+    CU_ASSERT(compared > 400);
+    CU_ASSERT_EQUAL(run("--pvs-batch=thread", &compared), 0);
+    CU_ASSERT(compared > 400);
+}
+
+int main()
+{
+    CU_pSuite pSuite = NULL;
+
+    csoundInitialize(CSOUNDINIT_NO_SIGNAL_HANDLER | CSOUNDINIT_NO_ATEXIT);
+
+    /* initialize the CUnit test registry */
+    if (CUE_SUCCESS != CU_initialize_registry())
+        return CU_get_error();
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("pvsanal batch tests", init_suite1, clean_suite1);
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* add the tests to the suite */
+    if (NULL == CU_add_test(pSuite, "batched against plain pvsanal",
+                            test_pvs_batch))
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* Run all tests using the CUnit Basic interface */
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+    return CU_get_error();
+}
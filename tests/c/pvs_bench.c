@@ -0,0 +1,89 @@
+/*
+ * File:   pvs_bench.c
+ *
+ * Cost of a chain of pvs opcodes per voice, from pvsanal to pvsynth,
+ * and of the rect/polar array conversions, with --spectral-approx at
+ * each level, and a checksum of the output to compare before and after
+ * a change.  Level 0 must give the output it gave before.  Not run as a
+ * test; run it by hand when changing OOps/spectral.c or its callers.
+ */
+
+#include "csound.h"
+#include <math.h>
+#include <stdio.h>
+
+#define KCYCLES   5000
+#define KSMPS     64
+#define VOICES    16
+
+static const char *orc =
+    "sr = 44100\n"
+    "ksmps = %d\n"
+    "nchnls = 1\n"
+    "0dbfs = 1\n"
+    "instr 1\n"
+    "a1 = vco2:a(0.1, 110 + p4 * 17) + noise:a(0.02, 0)\n"
+    "f1 pvsanal a1, 1024, 256, 1024, 1\n"
+    "f2 pvsanal poscil:a(0.1, 330 + p4), 1024, 256, 1024, 1\n"
+    "f3 pvsmix f1, f2\n"
+    "f4 pvsfilter f3, f2, 0.5\n"
+    "f5 pvsmooth f4, 0.2, 0.1\n"
+    "f6 pvsblur f5, 0.05, 0.2\n"
+    "f7 pvscale f6, 1.25\n"
+    "f8 pvsosc 0.1, 220, 1, 1024, 256, 1024, 1\n"
+    "f9 pvsmix f7, f8\n"
+    "a2 pvsynth f9\n"
+    "kfr[] init 1026\n"
+    "kfl pvs2tab kfr, f9\n"
+    "kpol[] rect2pol kfr\n"
+    "kre[] pol2rect kpol\n"
+    "kmag[] mags kre\n"
+    "out a2 + kmag[3] * 1e-6\n"
+    "endin\n";
+
+static double run(int approx, double *sum)
+{
+    CSOUND  *csound = csoundCreate(NULL);
+    char    text[4096], opt[32], sco[64];
+    RTCLOCK clk;
+    double  t;
+    int     i, j;
+
+    snprintf(opt, sizeof(opt), "--spectral-approx=%d", approx);
+    csoundSetOption(csound, "-n");
+    csoundSetOption(csound, "-d");
+    csoundSetOption(csound, opt);
+    csoundSetMessageLevel(csound, 0);
+    snprintf(text, sizeof(text), orc, KSMPS);
+    csoundCompileOrc(csound, text);
+    for (i = 0; i < VOICES; i++) {
+      snprintf(sco, sizeof(sco), "i1 0 3600 %d\n", i);
+      csoundReadScore(csound, sco);
+    }
+    csoundStart(csound);
+    *sum = 0.0;
+    csoundInitTimerStruct(&clk);
+    for (i = 0; i < KCYCLES; i++) {
+      MYFLT *spout = csoundGetSpout(csound);
+      csoundPerformKsmps(csound);
+      for (j = 0; j < KSMPS; j++)
+        *sum += fabs(spout[j]);
+    }
+    t = 1.0e9 * csoundGetRealTime(&clk) / ((double) KCYCLES*KSMPS*VOICES);
+    csoundDestroy(csound);
+    return t;
+}
+
+int main(void)
+{
+    int     i;
+
+    csoundInitialize(CSOUNDINIT_NO_SIGNAL_HANDLER | CSOUNDINIT_NO_ATEXIT);
+    printf("%d voices, ksmps %d, time per sample per voice "
+           "(including the rest of the instrument)\n", VOICES, KSMPS);
+    for (i = 0; i <= 2; i++) {
+      double  sum, t = run(i, &sum);
+      printf("--spectral-approx=%d  %7.2f ns  sum %.17g\n", i, t, sum);
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * File:   reverb_bench.c
+ *
+ * Cost of reverbsc (Opcodes/reverbsc.c) and freeverb (Opcodes/freeverb.c)
+ * with one reverb per bus on a number of buses, and a checksum of the
+ * output to compare before and after a change.  Not run as a test; run
+ * it by hand when changing either file.
+ */
+
+#include "csound.h"
+#include <math.h>
+#include <stdio.h>
+
+#define KCYCLES   5000
+#define KSMPS     64
+#define BUSES     32
+
+static const char *orc =
+    "sr = 44100\n"
+    "ksmps = %d\n"
+    "nchnls = 2\n"
+    "0dbfs = 1\n"
+    "instr 1\n"
+    "a1 = vco2:a(0.1, 110 + p4) + noise:a(0.05, 0)\n"
+    "a1 *= linseg:a(1, 0.5, 0, 1, 0, 0.1, 1)\n"
+    "aL, aR %s\n"
+    "outs aL, aR\n"
+    "endin\n";
+
+static double run(const char *op, double *sum)
+{
+    CSOUND  *csound = csoundCreate(NULL);
+    char    text[2048], sco[64];
+    RTCLOCK clk;
+    double  t;
+    int     i, j;
+
+    csoundSetOption(csound, "-n");
+    csoundSetOption(csound, "-d");
+    csoundSetMessageLevel(csound, 0);
+    snprintf(text, sizeof(text), orc, KSMPS, op);
+    csoundCompileOrc(csound, text);
+    for (i = 0; i < BUSES; i++) {
+      snprintf(sco, sizeof(sco), "i1 0 3600 %d\n", i);
+      csoundReadScore(csound, sco);
+    }
+    csoundStart(csound);
+    *sum = 0.0;
+    csoundInitTimerStruct(&clk);
+    for (i = 0; i < KCYCLES; i++) {
+      MYFLT *spout = csoundGetSpout(csound);
+      csoundPerformKsmps(csound);
+      for (j = 0; j < 2*KSMPS; j++)
+        *sum += fabs(spout[j]);
+    }
+    t = 1.0e9 * csoundGetRealTime(&clk) / ((double) KCYCLES*KSMPS*BUSES);
+    csoundDestroy(csound);
+    return t;
+}
+
+int main(void)
+{
+    static const char *ops[] = {
+      "reverbsc a1, a1 * 0.5, 0.85, 10000",
+      "freeverb a1, a1 * 0.5, 0.85, 0.4"
+    };
+    int     i;
+
+    csoundInitialize(CSOUNDINIT_NO_SIGNAL_HANDLER | CSOUNDINIT_NO_ATEXIT);
+    printf("%d buses, ksmps %d, time per sample per bus "
+           "(including the rest of the instrument)\n", BUSES, KSMPS);
+    for (i = 0; i < 2; i++) {
+      double  sum, t = run(ops[i], &sum);
+      printf("%-36s %7.2f ns  sum %.17g\n", ops[i], t, sum);
+    }
+    return 0;
+}
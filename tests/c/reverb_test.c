@@ -0,0 +1,388 @@
+/*
+ * File:   reverb_test.c
+ *
+ * Tests of reverbsc (Opcodes/reverbsc.c) and freeverb (Opcodes/freeverb.c)
+ * against the one-line-at-a-time loops their lane kernels replaced, fed
+ * with the same inputs through channels.  The kernels keep the operations
+ * of those loops, so the results must be identical where the compiler
+ * does not contract a multiply and an add into one instruction.
+ */
+
+#include "test_util.h"
+
+#define REVERB_TOL TEST_TOL(1.0e-9, 1.0e-4)
+
+#define KSMPS     32
+#define KCYCLES   3000
+#define SR        44100.0
+
+static const char *orc =
+    "sr = 44100\n"
+    "ksmps = 32\n"
+    "nchnls = 2\n"
+    "0dbfs = 1\n"
+    "chn_a \"inL\", 1\n"
+    "chn_a \"inR\", 1\n"
+    "chn_k \"k1\", 1\n"
+    "chn_k \"k2\", 1\n"
+    "chn_a \"outL\", 2\n"
+    "chn_a \"outR\", 2\n"
+    "instr 1\n"
+    "aL chnget \"inL\"\n"
+    "aR chnget \"inR\"\n"
+    "k1 chnget \"k1\"\n"
+    "k2 chnget \"k2\"\n"
+    "a1, a2 %s aL, aR, k1, k2\n"
+    "chnset a1, \"outL\"\n"
+    "chnset a2, \"outR\"\n"
+    "endin\n";
+
+/* the inputs of k-cycle k: noise bursts with silent gaps, and slowly
+   changing feedback and damping */
+static void inputs(int k, MYFLT *inL, MYFLT *inR, MYFLT *k1, MYFLT *k2,
+                   unsigned int *seed)
+{
+    int i;
+    for (i = 0; i < KSMPS; i++) {
+      int on = (k % 700) < 200;
+      inL[i] = on ? (MYFLT) (rand_r(seed) / (double) RAND_MAX - 0.5) : FL(0.0);
+      inR[i] = on ? (MYFLT) (0.3 * sin(0.01 * (k * KSMPS + i))) : FL(0.0);
+    }
+    *k1 = (MYFLT) (0.6 + 0.3 * sin(k * 0.002));
+    *k2 = (k / 500) % 2 ? FL(0.2) : FL(0.7);
+}
+
+/* freeverb as it was, with its default sample rate */
+
+static const double fv_comb[8] = {
+    1116.0, 1188.0, 1277.0, 1356.0, 1422.0, 1491.0, 1557.0, 1617.0
+};
+static const double fv_allpass[4] = { 556.0, 441.0, 341.0, 225.0 };
+
+typedef struct {
+    int     nSamples, bufPos;
+    double  filterState;
+    MYFLT   *buf;
+} FV_LINE;
+
+typedef struct {
+    FV_LINE comb[8][2], allpass[4][2];
+    MYFLT   prvDampFactor;
+    double  dampValue;
+} FV_REF;
+
+static void fv_line(FV_LINE *l, double delay)
+{
+    l->nSamples = (int) (delay / SR * SR + 0.5);
+    l->bufPos = 0;
+    l->filterState = 0.0;
+    l->buf = (MYFLT *) calloc(l->nSamples, sizeof(MYFLT));
+}
+
+static void fv_init(FV_REF *p)
+{
+    int i, j;
+    for (i = 0; i < 8; i++)
+      for (j = 0; j < 2; j++)
+        fv_line(&p->comb[i][j], fv_comb[i] + 23.0 * j);
+    for (i = 0; i < 4; i++)
+      for (j = 0; j < 2; j++)
+        fv_line(&p->allpass[i][j], fv_allpass[i] + 23.0 * j);
+    p->prvDampFactor = -FL(1.0);
+}
+
+static void fv_free(FV_REF *p)
+{
+    int i, j;
+    for (i = 0; i < 8; i++)
+      for (j = 0; j < 2; j++)
+        free(p->comb[i][j].buf);
+    for (i = 0; i < 4; i++)
+      for (j = 0; j < 2; j++)
+        free(p->allpass[i][j].buf);
+}
+
+static void fv_perf(FV_REF *p, const MYFLT *in[2], MYFLT kRoom, MYFLT kDamp,
+                    MYFLT *out[2])
+{
+    double  feedback, damp1, damp2, x;
+    MYFLT   tmp[KSMPS];
+    int     c, i, n;
+
+    feedback = (double) kRoom * 0.28 + 0.7;
+    if (kDamp != p->prvDampFactor) {
+      p->prvDampFactor = kDamp;
+      p->dampValue = (double) kDamp * 0.4;
+    }
+    damp1 = p->dampValue;
+    damp2 = 1.0 - damp1;
+    for (c = 0; c < 2; c++) {
+      memset(tmp, 0, sizeof(tmp));
+      for (i = 0; i < 8; i++) {
+        FV_LINE *l = &p->comb[i][c];
+        for (n = 0; n < KSMPS; n++) {
+          tmp[n] += l->buf[l->bufPos];
+          x = (double) l->buf[l->bufPos];
+          l->filterState = (l->filterState * damp1) + (x * damp2);
+          x = l->filterState * feedback + (double) in[c][n];
+          l->buf[l->bufPos] = (MYFLT) x;
+          if (++(l->bufPos) >= l->nSamples)
+            l->bufPos = 0;
+        }
+      }
+      for (i = 0; i < 4; i++) {
+        FV_LINE *l = &p->allpass[i][c];
+        for (n = 0; n < KSMPS; n++) {
+          x = (double) l->buf[l->bufPos] - (double) tmp[n];
+          l->buf[l->bufPos] *= (MYFLT) 0.5;
+          l->buf[l->bufPos] += tmp[n];
+          if (++(l->bufPos) >= l->nSamples)
+            l->bufPos = 0;
+          tmp[n] = (MYFLT) x;
+        }
+      }
+      for (n = 0; n < KSMPS; n++)
+        out[c][n] = tmp[n] * (MYFLT) 0.015;
+    }
+}
+
+/* reverbsc as it was, with its default sample rate and pitch modulation */
+
+static const double sc_params[8][4] = {
+    { (2473.0 / SR), 0.0010, 3.100,  1966.0 },
+    { (2767.0 / SR), 0.0011, 3.500, 29491.0 },
+    { (3217.0 / SR), 0.0017, 1.110, 22937.0 },
+    { (3557.0 / SR), 0.0006, 3.973,  9830.0 },
+    { (3907.0 / SR), 0.0010, 2.341, 20643.0 },
+    { (4127.0 / SR), 0.0011, 1.897, 22937.0 },
+    { (2143.0 / SR), 0.0017, 0.891, 29491.0 },
+    { (1933.0 / SR), 0.0006, 3.221, 14417.0 }
+};
+
+#define DELAYPOS_SHIFT  28
+#define DELAYPOS_SCALE  0x10000000
+#define DELAYPOS_MASK   0x0FFFFFFF
+
+typedef struct {
+    int     writePos, bufferSize, readPos, readPosFrac, readPosFrac_inc;
+    int     seedVal, randLine_cnt;
+    double  filterState;
+    MYFLT   *buf;
+} SC_LINE;
+
+typedef struct {
+    SC_LINE line[8];
+    double  dampFact;
+    MYFLT   prv_LPFreq;
+} SC_REF;
+
+static void sc_lineseg(SC_LINE *lp, int n)
+{
+    double  prvDel, nxtDel, phs_incVal;
+
+    if (lp->seedVal < 0)
+      lp->seedVal += 0x10000;
+    lp->seedVal = (lp->seedVal * 15625 + 1) & 0xFFFF;
+    if (lp->seedVal >= 0x8000)
+      lp->seedVal -= 0x10000;
+    lp->randLine_cnt = (int) ((SR / sc_params[n][2]) + 0.5);
+    prvDel = (double) lp->writePos;
+    prvDel -= ((double) lp->readPos
+               + ((double) lp->readPosFrac / (double) DELAYPOS_SCALE));
+    while (prvDel < 0.0)
+      prvDel += (double) lp->bufferSize;
+    prvDel = prvDel / SR;
+    nxtDel = (double) lp->seedVal * sc_params[n][1] / 32768.0;
+    nxtDel = sc_params[n][0] + (nxtDel * 1.0);
+    phs_incVal = (prvDel - nxtDel) / (double) lp->randLine_cnt;
+    phs_incVal = phs_incVal * SR + 1.0;
+    lp->readPosFrac_inc = (int) (phs_incVal * DELAYPOS_SCALE + 0.5);
+}
+
+static void sc_init(SC_REF *p)
+{
+    int n;
+    for (n = 0; n < 8; n++) {
+      SC_LINE *lp = &p->line[n];
+      double  readPos;
+      lp->bufferSize = (int) ((sc_params[n][0] + sc_params[n][1] * 1.125)
+                              * SR + 16.5);
+      lp->writePos = 0;
+      lp->seedVal = (int) (sc_params[n][3] + 0.5);
+      readPos = (double) lp->seedVal * sc_params[n][1] / 32768;
+      readPos = sc_params[n][0] + (readPos * 1.0);
+      readPos = (double) lp->bufferSize - (readPos * SR);
+      lp->readPos = (int) readPos;
+      readPos = (readPos - (double) lp->readPos) * (double) DELAYPOS_SCALE;
+      lp->readPosFrac = (int) (readPos + 0.5);
+      sc_lineseg(lp, n);
+      lp->filterState = 0.0;
+      lp->buf = (MYFLT *) calloc(lp->bufferSize, sizeof(MYFLT));
+    }
+    p->dampFact = 1.0;
+    p->prv_LPFreq = FL(0.0);
+}
+
+static void sc_free(SC_REF *p)
+{
+    int n;
+    for (n = 0; n < 8; n++)
+      free(p->line[n].buf);
+}
+
+static void sc_perf(SC_REF *p, const MYFLT *in[2], MYFLT kFeedBack,
+                    MYFLT kLPFreq, MYFLT *out[2])
+{
+    double  ainL, ainR, aoutL, aoutR;
+    double  vm1, v0, v1, v2, am1, a0, a1, a2, frac, dampFact = p->dampFact;
+    int     i, n, readPos, bufferSize;
+
+    if (kLPFreq != p->prv_LPFreq) {
+      p->prv_LPFreq = kLPFreq;
+      dampFact = 2.0 - cos(p->prv_LPFreq * TWOPI / SR);
+      dampFact = p->dampFact = dampFact - sqrt(dampFact * dampFact - 1.0);
+    }
+    for (i = 0; i < KSMPS; i++) {
+      ainL = aoutL = aoutR = 0.0;
+      for (n = 0; n < 8; n++)
+        ainL += p->line[n].filterState;
+      ainL *= 0.25;
+      ainR = ainL + (double) in[1][i];
+      ainL = ainL + (double) in[0][i];
+      for (n = 0; n < 8; n++) {
+        SC_LINE *lp = &p->line[n];
+        bufferSize = lp->bufferSize;
+        lp->buf[lp->writePos] = (MYFLT) ((n & 1 ? ainR : ainL)
+                                         - lp->filterState);
+        if (++lp->writePos >= bufferSize)
+          lp->writePos -= bufferSize;
+        if (lp->readPosFrac >= DELAYPOS_SCALE) {
+          lp->readPos += (lp->readPosFrac >> DELAYPOS_SHIFT);
+          lp->readPosFrac &= DELAYPOS_MASK;
+        }
+        if (lp->readPos >= bufferSize)
+          lp->readPos -= bufferSize;
+        readPos = lp->readPos;
+        frac = (double) lp->readPosFrac * (1.0 / (double) DELAYPOS_SCALE);
+        a2 = frac * frac; a2 -= 1.0; a2 *= (1.0 / 6.0);
+        a1 = frac; a1 += 1.0; a1 *= 0.5; am1 = a1 - 1.0;
+        a0 = 3.0 * a2; a1 -= a0; am1 -= a2; a0 -= frac;
+        if (readPos > 0 && readPos < (bufferSize - 2)) {
+          vm1 = (double) (lp->buf[readPos - 1]);
+          v0  = (double) (lp->buf[readPos]);
+          v1  = (double) (lp->buf[readPos + 1]);
+          v2  = (double) (lp->buf[readPos + 2]);
+        }
+        else {
+          if (--readPos < 0) readPos += bufferSize;
+          vm1 = (double) lp->buf[readPos];
+          if (++readPos >= bufferSize) readPos -= bufferSize;
+          v0 = (double) lp->buf[readPos];
+          if (++readPos >= bufferSize) readPos -= bufferSize;
+          v1 = (double) lp->buf[readPos];
+          if (++readPos >= bufferSize) readPos -= bufferSize;
+          v2 = (double) lp->buf[readPos];
+        }
+        v0 = (am1 * vm1 + a0 * v0 + a1 * v1 + a2 * v2) * frac + v0;
+        lp->readPosFrac += lp->readPosFrac_inc;
+        v0 *= (double) kFeedBack;
+        v0 = (lp->filterState - v0) * dampFact + v0;
+        lp->filterState = v0;
+        if (n & 1)
+          aoutR += v0;
+        else
+          aoutL += v0;
+        if (--(lp->randLine_cnt) <= 0)
+          sc_lineseg(lp, n);
+      }
+      out[0][i] = (MYFLT) (aoutL * 0.35);
+      out[1][i] = (MYFLT) (aoutR * 0.35);
+    }
+}
+
+/* number of output samples that differ from the reference */
+static int run_reverb(int sc)
+{
+    CSOUND  *csound;
+    char    text[2048];
+    MYFLT   inL[KSMPS], inR[KSMPS], k1, k2;
+    MYFLT   outL[KSMPS], outR[KSMPS], refL[KSMPS], refR[KSMPS];
+    const MYFLT *in[2] = { inL, inR };
+    MYFLT   *ref[2] = { refL, refR };
+    FV_REF  fv;
+    SC_REF  scr;
+    unsigned int seed = 1;
+    int     k, n, bad = 0;
+
+    snprintf(text, sizeof(text), orc, sc ? "reverbsc" : "freeverb");
+    csound = test_start(text, "i1 0 3600\n", NULL);
+    if (sc) sc_init(&scr);
+    else fv_init(&fv);
+    for (k = 0; k < KCYCLES; k++) {
+      inputs(k, inL, inR, &k1, &k2, &seed);
+      /* reverbsc takes a cutoff frequency rather than a damping factor */
+      if (sc) k2 = FL(4000.0) + k2 * FL(10000.0);
+      csoundSetAudioChannel(csound, "inL", inL);
+      csoundSetAudioChannel(csound, "inR", inR);
+      csoundSetControlChannel(csound, "k1", k1);
+      csoundSetControlChannel(csound, "k2", k2);
+      csoundPerformKsmps(csound);
+      csoundGetAudioChannel(csound, "outL", outL);
+      csoundGetAudioChannel(csound, "outR", outR);
+      if (sc) sc_perf(&scr, in, k1, k2, ref);
+      else fv_perf(&fv, in, k1, k2, ref);
+      for (n = 0; n < KSMPS; n++) {
+        if (fabs(outL[n] - refL[n]) > REVERB_TOL) bad++;
+        if (fabs(outR[n] - refR[n]) > REVERB_TOL) bad++;
+      }
+    }
+    if (bad)
+      printf("%s: %d samples differ\n", sc ? "reverbsc" : "freeverb", bad);
+    if (sc) sc_free(&scr);
+    else fv_free(&fv);
+    csoundDestroy(csound);
+    return bad;
+}
+
+void test_freeverb(void)
+{
+    CU_ASSERT_EQUAL(run_reverb(0), 0);
+}
+
+void test_reverbsc(void)
+{
+    CU_ASSERT_EQUAL(run_reverb(1), 0);
+}
+
+int main()
+{
+    CU_pSuite pSuite = NULL;
+
+    csoundInitialize(CSOUNDINIT_NO_SIGNAL_HANDLER | CSOUNDINIT_NO_ATEXIT);
+
+    /* initialize the CUnit test registry */
+    if (CUE_SUCCESS != CU_initialize_registry())
+        return CU_get_error();
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("Reverb tests", init_suite1, clean_suite1);
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* add the tests to the suite */
+    if ((NULL == CU_add_test(pSuite, "freeverb", test_freeverb))
+        || (NULL == CU_add_test(pSuite, "reverbsc", test_reverbsc))
+        )
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* Run all tests using the CUnit Basic interface */
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+    return CU_get_error();
+}
@@ -0,0 +1,375 @@
+/*
+ * File:   spectral_test.c
+ *
+ * Tests of the spectral kernels (OOps/spectral.c).  pvsmix, pvsfilter,
+ * pvsmooth and pvsblur must give the output of the scalar loops they
+ * replaced, which are copied below, at every --spectral-approx level.
+ * rect2pol, pol2rect, mags and phs must match libm exactly by default,
+ * and to within the stated errors of the polynomials at levels 1 and 2.
+ */
+
+#include "test_util.h"
+
+#define PVS_TOL   TEST_TOL(1.0e-6, 1.0e-3)
+#define ARR_TOL   TEST_TOL(1.0e-12, 1.0e-6)
+
+#define KCYCLES   400
+#define N         1024
+#define NVALS     (N + 2)
+#define NBINS     (N / 2 + 1)
+#define SR        44100
+#define OLAP      256
+
+/* tables 1 and 2 are the input frames of the pvs opcodes, 3 to 6 their
+   outputs; table 7 is the input of the array opcodes, 8 to 12 theirs */
+static const char *orc =
+    "sr = 44100\n"
+    "ksmps = 64\n"
+    "nchnls = 1\n"
+    "0dbfs = 1\n"
+    "gi1 ftgen 1, 0, -1026, -2, 0\n"
+    "gi2 ftgen 2, 0, -1026, -2, 0\n"
+    "gi3 ftgen 3, 0, -1026, -2, 0\n"
+    "gi4 ftgen 4, 0, -1026, -2, 0\n"
+    "gi5 ftgen 5, 0, -1026, -2, 0\n"
+    "gi6 ftgen 6, 0, -1026, -2, 0\n"
+    "gi7 ftgen 7, 0, -1026, -2, 0\n"
+    "gi8 ftgen 8, 0, -1026, -2, 0\n"
+    "gi9 ftgen 9, 0, -1026, -2, 0\n"
+    "gi10 ftgen 10, 0, -514, -2, 0\n"
+    "gi11 ftgen 11, 0, -514, -2, 0\n"
+    "gi12 ftgen 12, 0, -1026, -2, 0\n"
+    "chn_k \"frame\", 2\n"
+    "instr 1\n"
+    "kA[] init 1026\n"
+    "kB[] init 1026\n"
+    "copyf2array kA, 1\n"
+    "copyf2array kB, 2\n"
+    "fa tab2pvs kA, 256, 1024, 1\n"
+    "fb tab2pvs kB, 256, 1024, 1\n"
+    "fm pvsmix fa, fb\n"
+    "ff pvsfilter fa, fb, 0.7, 0.5\n"
+    "fs pvsmooth fa, 0.2, 0.1\n"
+    "fl pvsblur fa, 0.05, 0.2\n"
+    "kM[] init 1026\n"
+    "kF[] init 1026\n"
+    "kS[] init 1026\n"
+    "kL[] init 1026\n"
+    "kframe pvs2tab kM, fm\n"
+    "kf2 pvs2tab kF, ff\n"
+    "kf3 pvs2tab kS, fs\n"
+    "kf4 pvs2tab kL, fl\n"
+    "copya2ftab kM, 3\n"
+    "copya2ftab kF, 4\n"
+    "copya2ftab kS, 5\n"
+    "copya2ftab kL, 6\n"
+    "chnset kframe, \"frame\"\n"
+    "kR[] init 1026\n"
+    "copyf2array kR, 7\n"
+    "kP[] rect2pol kR\n"
+    "kQ[] pol2rect kR\n"
+    "kmag[] mags kR\n"
+    "kph[] phs kR\n"
+    "kT[] pol2rect kmag, kph\n"
+    "copya2ftab kP, 8\n"
+    "copya2ftab kQ, 9\n"
+    "copya2ftab kmag, 10\n"
+    "copya2ftab kph, 11\n"
+    "copya2ftab kT, 12\n"
+    "endin\n";
+
+/* the scalar loops of pvsmix, pvsfilter, pvsmooth and pvsblur before
+   they called the kernels */
+
+static void old_pvsmix(float *fout, const float *fa, const float *fb)
+{
+    int     i, test;
+    for (i = 0; i < NVALS; i += 2) {
+      test = fa[i] >= fb[i];
+      if (test) {
+        fout[i] = fa[i];
+        fout[i + 1] = fa[i + 1];
+      }
+      else {
+        fout[i] = fb[i];
+        fout[i + 1] = fb[i + 1];
+      }
+    }
+}
+
+static void old_pvsfilter(float *fout, const float *fin, const float *fil,
+                          MYFLT kdepth, float g)
+{
+    int     i;
+    MYFLT   dirgain;
+    kdepth = kdepth >= 0 ? (kdepth <= 1 ? kdepth : 1) : FL(0.0);
+    dirgain = (1 - kdepth);
+    for (i = 0; i < NVALS; i += 2) {
+      fout[i] = (float) (fin[i] * (dirgain + fil[i] * kdepth))*g;
+      fout[i + 1] = fin[i + 1];
+    }
+}
+
+static void old_pvsmooth(float *fout, const float *fin, float *del,
+                         MYFLT kfra, MYFLT kfrf)
+{
+    int     i;
+    double  ffa = (double) kfra, ffr = (double) kfrf;
+    double  costh1, costh2, coef1, coef2;
+    ffa = ffa < FL(0.0) ? FL(0.0) : (ffa > FL(1.0) ? FL(1.0) : ffa);
+    ffr = ffr < FL(0.0) ? FL(0.0) : (ffr > FL(1.0) ? FL(1.0) : ffr);
+    costh1 = 2.0 - cos(PI * ffa);
+    costh2 = 2.0 - cos(PI * ffr);
+    coef1 = sqrt(costh1 * costh1 - 1.0) - costh1;
+    coef2 = sqrt(costh2 * costh2 - 1.0) - costh2;
+    for (i = 0; i < NVALS; i += 2) {
+      fout[i] = (float) (fin[i] * (1.0 + coef1) - del[i] * coef1);
+      fout[i + 1] = (float) (fin[i + 1] * (1.0 + coef2) - del[i + 1] * coef1);
+      del[i] = fout[i];
+      del[i + 1] = fout[i + 1];
+    }
+}
+
+typedef struct {
+    float   *delay;
+    MYFLT   frpsec;
+    int32   count;
+} BLUR;
+
+static void old_pvsblurset(BLUR *p, MYFLT maxdel)
+{
+    int     i, j, delayframes, framesize = NVALS;
+    p->frpsec = (MYFLT) SR / OLAP;
+    delayframes = (int) (maxdel * p->frpsec);
+    p->delay = (float *) calloc(framesize * delayframes, sizeof(float));
+    for (j = 0; j < framesize * delayframes; j += framesize)
+      for (i = 0; i < N + 2; i += 2) {
+        p->delay[i + j] = 0.0f;
+        p->delay[i + j + 1] = i * (MYFLT) SR / N;
+      }
+    p->count = 0;
+}
+
+static void old_pvsblur(BLUR *p, float *fout, const float *fin,
+                        MYFLT kdelay, MYFLT maxdel)
+{
+    int32    j, i, first, framesize = N + 2;
+    int32    countr = p->count;
+    double  amp = 0.0, freq = 0.0;
+    int     delayframes = (int) (kdelay * p->frpsec);
+    int     kdel = delayframes * framesize;
+    int     mdel = (int) (maxdel * p->frpsec) * framesize;
+    float   *delay = p->delay;
+
+    kdel = kdel >= 0 ? (kdel < mdel ? kdel : mdel - framesize) : 0;
+    for (i = 0; i < N + 2; i += 2) {
+      delay[countr + i] = fin[i];
+      delay[countr + i + 1] = fin[i + 1];
+      if (kdel) {
+        if ((first = countr - kdel) < 0)
+          first += mdel;
+        for (j = first; j != countr; j = (j + framesize) % mdel) {
+          amp += delay[j + i];
+          freq += delay[j + i + 1];
+        }
+        fout[i] = (float) (amp / delayframes);
+        fout[i + 1] = (float) (freq / delayframes);
+        amp = freq = 0.;
+      }
+      else {
+        fout[i] = fin[i];
+        fout[i + 1] = fin[i + 1];
+      }
+    }
+    countr += (N + 2);
+    p->count = countr < mdel ? countr : 0;
+}
+
+static uint32_t seed;
+
+/* a value in [0, 1) that a float holds exactly */
+static MYFLT rnd(void)
+{
+    seed = seed * 1664525 + 1013904223;
+    return (MYFLT) (float) ((seed >> 8) / 16777216.0);
+}
+
+/* amplitudes and frequencies near the bin centres; bin 100 is silent */
+static void pvs_frame(MYFLT *tab, float *frame)
+{
+    int     i;
+    for (i = 0; i < NVALS; i += 2) {
+      tab[i] = i == 200 ? FL(0.0) : rnd();
+      tab[i + 1] = (MYFLT) (float) ((i / 2 + rnd() - 0.5) * SR / N);
+      frame[i] = (float) tab[i];
+      frame[i + 1] = (float) tab[i + 1];
+    }
+}
+
+/* real parts in [-1, 1), imaginary parts (or phases) in [-10, 10), with
+   a zero bin and bins on the axes */
+static void rect_frame(MYFLT *tab)
+{
+    int     i;
+    for (i = 0; i < NVALS; i += 2) {
+      tab[i] = 2 * rnd() - 1;
+      tab[i + 1] = 20 * rnd() - 10;
+    }
+    tab[200] = tab[201] = FL(0.0);
+    tab[202] = FL(0.0);
+    tab[205] = FL(0.0);
+}
+
+/* the difference of two phases, wrapped round the circle */
+static double phase_diff(double a, double b)
+{
+    double  d = fabs(a - b);
+    return d > PI ? fabs(d - 2 * PI) : d;
+}
+
+/* counts the values of the array opcodes further than tol (relative to
+   the magnitude for rectangular values) from libm */
+static int check_arrays(CSOUND *csound, const MYFLT *in, double tol)
+{
+    MYFLT   *pol, *rect, *mag, *ph, *rect2;
+    int     i, j, bad = 0;
+
+    CU_ASSERT_EQUAL(csoundGetTable(csound, &pol, 8), NVALS);
+    CU_ASSERT_EQUAL(csoundGetTable(csound, &rect, 9), NVALS);
+    CU_ASSERT_EQUAL(csoundGetTable(csound, &mag, 10), NBINS + 1);
+    CU_ASSERT_EQUAL(csoundGetTable(csound, &ph, 11), NBINS + 1);
+    CU_ASSERT_EQUAL(csoundGetTable(csound, &rect2, 12), NVALS);
+    for (i = 2; i < NVALS; i += 2) {
+      double  m = sqrt(in[i]*in[i] + in[i+1]*in[i+1]);
+      double  p = atan2(in[i+1], in[i]);
+      if (fabs(pol[i] - m) > tol * (1 + m) ||
+          phase_diff(pol[i+1], p) > tol)
+        bad++;
+      if (fabs(rect[i] - in[i] * cos(in[i+1])) > tol * (1 + fabs(in[i])) ||
+          fabs(rect[i+1] - in[i] * sin(in[i+1])) > tol * (1 + fabs(in[i])))
+        bad++;
+    }
+    CU_ASSERT_EQUAL(mag[0], in[0]);
+    CU_ASSERT_EQUAL(mag[NBINS], in[1]);
+    for (j = 1; j < NBINS; j++)
+      if (fabs(mag[j] - sqrt(in[2*j]*in[2*j] + in[2*j+1]*in[2*j+1]))
+          > ARR_TOL)
+        bad++;
+    /* the last value of phs is read from past the end of the array */
+    for (j = 0; j < NBINS; j++)
+      if (phase_diff(ph[j], atan2(in[2*j+1], in[2*j])) > tol)
+        bad++;
+    for (j = 1; j < NBINS; j++) {
+      double  m = mag[j], p = ph[j];
+      if (fabs(rect2[2*j] - m * cos(p)) > tol * (1 + m) ||
+          fabs(rect2[2*j+1] - m * sin(p)) > tol * (1 + m))
+        bad++;
+    }
+    return bad;
+}
+
+/* runs the opcodes at an approximation level, and counts the pvs values
+   that differ from the old loops and the array values that differ from
+   libm.  *frames counts the pvs frames compared. */
+static int run(const char *option, double tol, int *frames)
+{
+    CSOUND  *csound = test_start(orc, "i1 0 3600\n", option);
+    MYFLT   *tab, *out;
+    float   fa[NVALS], fb[NVALS], ref[4][NVALS], del[NVALS];
+    BLUR    blur;
+    int     k, i, t, err, frame, last = 0, bad = 0;
+
+    memset(del, 0, sizeof(del));
+    old_pvsblurset(&blur, FL(0.2));
+    seed = 1;
+    *frames = 0;
+    for (k = 0; k < KCYCLES; k++) {
+      CU_ASSERT_EQUAL(csoundGetTable(csound, &tab, 1), NVALS);
+      pvs_frame(tab, fa);
+      CU_ASSERT_EQUAL(csoundGetTable(csound, &tab, 2), NVALS);
+      pvs_frame(tab, fb);
+      CU_ASSERT_EQUAL(csoundGetTable(csound, &tab, 7), NVALS);
+      rect_frame(tab);
+      csoundPerformKsmps(csound);
+      bad += check_arrays(csound, tab, tol);
+      /* tab2pvs takes a new frame every fourth k-cycle */
+      frame = (int) csoundGetControlChannel(csound, "frame", &err);
+      if (frame == last)
+        continue;
+      last = frame;
+      old_pvsmix(ref[0], fa, fb);
+      old_pvsfilter(ref[1], fa, fb, FL(0.7), 0.5f);
+      old_pvsmooth(ref[2], fa, del, FL(0.2), FL(0.1));
+      old_pvsblur(&blur, ref[3], fa, FL(0.05), FL(0.2));
+      for (t = 0; t < 4; t++) {
+        CU_ASSERT_EQUAL(csoundGetTable(csound, &out, 3 + t), NVALS);
+        for (i = 0; i < NVALS; i++)
+          if (fabs(out[i] - ref[t][i]) > PVS_TOL * (1 + fabs(ref[t][i])))
+            bad++;
+      }
+      (*frames)++;
+    }
+    free(blur.delay);
+    csoundDestroy(csound);
+    return bad;
+}
+
+void test_libm(void)
+{
+    int     frames;
+    CU_ASSERT_EQUAL(run("--spectral-approx=0", ARR_TOL, &frames), 0);
+    CU_ASSERT(frames >= KCYCLES / 4 - 1);
+}
+
+/* the polynomials of level 1 have errors of about 4e-8, those of level
+   2 of 1.2e-5 */
+void test_approx1(void)
+{
+    int     frames;
+    CU_ASSERT_EQUAL(run("--spectral-approx=1",
+                        ARR_TOL > 1.0e-7 ? ARR_TOL : 1.0e-7, &frames), 0);
+    CU_ASSERT(frames >= KCYCLES / 4 - 1);
+}
+
+void test_approx2(void)
+{
+    int     frames;
+    CU_ASSERT_EQUAL(run("--spectral-approx=2", 2.0e-5, &frames), 0);
+    CU_ASSERT(frames >= KCYCLES / 4 - 1);
+}
+
+int main()
+{
+    CU_pSuite pSuite = NULL;
+
+    csoundInitialize(CSOUNDINIT_NO_SIGNAL_HANDLER | CSOUNDINIT_NO_ATEXIT);
+
+    /* initialize the CUnit test registry */
+    if (CUE_SUCCESS != CU_initialize_registry())
+        return CU_get_error();
+
+    /* add a suite to the registry */
+    pSuite = CU_add_suite("spectral kernel tests", init_suite1, clean_suite1);
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* add the tests to the suite */
+    if ((NULL == CU_add_test(pSuite, "spectral kernels with libm", test_libm))
+        || (NULL == CU_add_test(pSuite, "spectral kernels at approx 1",
+                                test_approx1))
+        || (NULL == CU_add_test(pSuite, "spectral kernels at approx 2",
+                                test_approx2))
+        )
+    {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* Run all tests using the CUnit Basic interface */
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+    CU_cleanup_registry();
+    return CU_get_error();
+}
@@ -0,0 +1,44 @@
+/*
+ * File:   test_util.c
+ *
+ * See test_util.h.
+ */
+
+#include "test_util.h"
+
+int init_suite1(void) {
+    return 0;
+}
+
+int clean_suite1(void) {
+    return 0;
+}
+
+CSOUND *test_start(const char *orc, const char *sco, const char *option)
+{
+    CSOUND  *csound = csoundCreate(NULL);
+
+    csoundSetOption(csound, "-n");
+    csoundSetOption(csound, "-d");
+    if (option != NULL)
+      csoundSetOption(csound, (char*) option);
+    csoundSetMessageLevel(csound, 0);
+    CU_ASSERT_EQUAL(csoundCompileOrc(csound, orc), 0);
+    csoundReadScore(csound, sco);
+    CU_ASSERT_EQUAL(csoundStart(csound), 0);
+    return csound;
+}
+
+void test_capture(CSOUND *csound, MYFLT *buf, int nframes)
+{
+    int     ksmps = (int) csoundGetKsmps(csound);
+    int     nchnls = (int) csoundGetNchnls(csound);
+    int     k, i;
+
+    for (k = 0; k < nframes / ksmps; k++) {
+      MYFLT *spout = csoundGetSpout(csound);
+      csoundPerformKsmps(csound);
+      for (i = 0; i < ksmps * nchnls; i++)
+        buf[k * ksmps * nchnls + i] = spout[i];
+    }
+}
@@ -0,0 +1,52 @@
+/*
+ * File:   test_util.h
+ *
+ * Shared by the tests that run opcodes against the loops they replaced
+ * or against results worked out in the test: the includes, the
+ * tolerance of those comparisons, the suite set-up and an instance that
+ * runs an orchestra.  Built into each of them with test_util.c.
+ */
+
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#define __BUILDING_LIBCSOUND
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "csoundCore.h"
+#include "CUnit/Basic.h"
+
+/* The kernels keep the operations of the reference loops, so the
+   results are identical when each operation is rounded to its type as
+   it is done.  They may differ by a few ulps when intermediate values
+   are kept wider (x87), when a multiply and an add can be contracted
+   into one instruction (FMA targets, where GCC contracts by default),
+   or with -ffast-math.  TEST_TOL(dbl, flt) is then the difference
+   allowed for a double or a float build, and 0 otherwise. */
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0 && \
+    !defined(__FAST_MATH__) && !defined(__FMA__) && \
+    !defined(__FP_FAST_FMA) && !defined(__ARM_FEATURE_FMA)
+#  define TEST_TOL(dbl, flt)    0.0
+#elif defined(USE_DOUBLE)
+#  define TEST_TOL(dbl, flt)    (dbl)
+#else
+#  define TEST_TOL(dbl, flt)    (flt)
+#endif
+
+int init_suite1(void);
+int clean_suite1(void);
+
+/* a new instance with -n -d and option (if not NULL), running orc with
+   the score sco */
+CSOUND *test_start(const char *orc, const char *sco, const char *option);
+
+/* performs enough k-periods for nframes frames of spout, which are
+   copied interleaved to buf */
+void test_capture(CSOUND *csound, MYFLT *buf, int nframes);
+
+#endif  /* TEST_UTIL_H */
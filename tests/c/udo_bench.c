@@ -0,0 +1,94 @@
+/*
+ * File:   udo_bench.c
+ *
+ * Cost of UDO calls in nested chains, with arguments passed by reference
+ * (--udo-args=ref) and copied on every k-cycle (--udo-args=copy).  Both
+ * runs must produce the same output.  Not run as a test; run it by hand
+ * when changing the UDO code in Engine/insert.c.
+ */
+
+#include "csound.h"
+#include <math.h>
+#include <stdio.h>
+
+#define KCYCLES   20000
+
+static const char *orc =
+    "sr = 44100\n"
+    "ksmps = %d\n"
+    "nchnls = 1\n"
+    "0dbfs = 1\n"
+    "opcode leaf, ak, ak\n"
+    "ain, kg xin\n"
+    "aout = ain * kg\n"
+    "kout = kg * 0.5\n"
+    "xout aout, kout\n"
+    "endop\n"
+    "opcode mid, ak, ak\n"
+    "ain, kg xin\n"
+    "a1, k1 leaf ain, kg\n"
+    "a2, k2 leaf a1, k1\n"
+    "xout a2, k2\n"
+    "endop\n"
+    "opcode top, ak, ak\n"
+    "ain, kg xin\n"
+    "a1, k1 mid ain, kg\n"
+    "a2, k2 mid a1, k1\n"
+    "a3, k3 mid a2, k2\n"
+    "a4, k4 mid a3, k3\n"
+    "xout a4, k4\n"
+    "endop\n"
+    "instr 1\n"
+    "asig oscili 0.5, 440\n"
+    "a1, k1 top asig, 1.001\n"
+    "a2, k2 top a1, k1 + 1\n"
+    "out a2\n"
+    "endin\n";
+
+static double run(const char *mode, int ksmps, double *sum)
+{
+    CSOUND  *csound = csoundCreate(NULL);
+    char    text[2048], opt[32];
+    RTCLOCK clk;
+    double  t;
+    int     i, j;
+
+    snprintf(opt, sizeof(opt), "--udo-args=%s", mode);
+    csoundSetOption(csound, "-n");
+    csoundSetOption(csound, "-d");
+    csoundSetOption(csound, opt);
+    csoundSetMessageLevel(csound, 0);
+    snprintf(text, sizeof(text), orc, ksmps);
+    csoundCompileOrc(csound, text);
+    csoundReadScore(csound, "i1 0 3600\n");
+    csoundStart(csound);
+    *sum = 0.0;
+    csoundInitTimerStruct(&clk);
+    for (i = 0; i < KCYCLES; i++) {
+      MYFLT *spout = csoundGetSpout(csound);
+      csoundPerformKsmps(csound);
+      for (j = 0; j < ksmps; j++)
+        *sum += fabs(spout[j]);
+    }
+    t = 1.0e9 * csoundGetRealTime(&clk) / KCYCLES;
+    csoundDestroy(csound);
+    return t;
+}
+
+int main(void)
+{
+    static const int ksmps[] = { 1, 16, 64 };
+    int     i;
+
+    csoundInitialize(CSOUNDINIT_NO_SIGNAL_HANDLER | CSOUNDINIT_NO_ATEXIT);
+    printf("26 nested UDO calls, time per k-cycle\n");
+    for (i = 0; i < 3; i++) {
+      double  sref, scopy;
+      double  tref = run("ref", ksmps[i], &sref);
+      double  tcopy = run("copy", ksmps[i], &scopy);
+      printf("ksmps %3d  copy %9.1f ns  ref %9.1f ns  x%.2f  %s\n",
+             ksmps[i], tcopy, tref, tcopy / tref,
+             sref == scopy ? "same output" : "OUTPUT DIFFERS");
+    }
+    return 0;
+}
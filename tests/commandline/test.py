@@ -4,6 +4,7 @@
 # By Steven Yi <stevenyi at gmail dot com>
 
 import os
+import re
 import sys
 
 from testUI import TestApplication
@@ -134,6 +135,32 @@ def runTest():
 	["test_udo_2d_array.csd", "test udo with 2d-array"],
         ["test_udo_string_array_join.csd", "test udo with S[] arg returning S"],
         ["test_array_function_call.csd", "test synthesizing an array arg from a function-call"],
+        ["test_udo_args_ref.csd", "test udo arguments passed by reference and copied"],
+        ["test_udo_inline.csd", "test inlining of udo calls"],
+        ["test_opt_level.csd", "test orchestra optimisation level 0", 0, "--opt-level=0",
+         "!optimiser removed"],
+        ["test_opt_level.csd", "test orchestra optimisation level 1", 0, "--opt-level=1",
+         r"optimiser removed \d+ opcodes? \([1-9]\d* folded, 0 merged, [1-9]\d* dead"],
+        ["test_opt_level.csd", "test orchestra optimisation level 2", 0, "--opt-level=2",
+         r"optimiser removed \d+ opcodes? \([1-9]\d* folded, [1-9]\d* merged, [1-9]\d* dead"],
+        ["test_fused_arith.csd", "test unfused a-rate arithmetic", 0, "--opt-level=0",
+         "!optimiser removed"],
+        ["test_fused_arith.csd", "test fused a-rate arithmetic", 0, "--opt-level=1",
+         r"optimiser removed .* [1-9]\d* fused\)"],
+        ["test_ftconv_nonuniform.csd", "test non-uniform partitioned ftconv"],
+        ["test_gen01_mmap.csd", "test GEN01 tables in memory"],
+        ["test_gen01_mmap.csd", "test memory-mapped GEN01 tables", 0, "--mmap-gen1"],
+        ["test_ftgen_threads.csd", "test threaded ftgen", 0, "--ftgen-threads=2"],
+        ["test_ftgen_threads.csd", "test cached ftgen", 0, "--ftgen-cache"],
+        ["test_ftgen_threads.csd", "test threaded and cached ftgen", 0, "--ftgen-threads=2 --ftgen-cache"],
+        ["test_pvs_batch.csd", "test grouped pvsanal"],
+        ["test_pvs_batch.csd", "test batched pvsanal", 0, "--pvs-batch"],
+        ["test_pvs_batch.csd", "test batched pvsanal on a thread", 0, "--pvs-batch=thread"],
+        ["test_spectral_approx.csd", "test spectral kernels with libm", 0, "--spectral-approx=0"],
+        ["test_spectral_approx.csd", "test approximate spectral kernels", 0, "--spectral-approx=1"],
+        ["test_spectral_approx.csd", "test cheaper approximate spectral kernels", 0, "--spectral-approx=2"],
+        ["test_array_threads.csd", "test array opcodes"],
+        ["test_array_threads.csd", "test arrays shared between threads", 0, "--array-threads=4"],
     ]
 
     arrayTests = [["arrays/arrays_i_local.csd", "local i[]"],
@@ -160,21 +187,52 @@ def runTest():
     for t in tests:
         filename = t[0]
         desc = t[1]
-        expectedResult = (len(t) == 3) and 1 or 0
+        # an optional third entry is the expected result, 1 for failure,
+        # a fourth one holds extra options for that test, and a fifth one
+        # a regular expression the output must match (not match after '!')
+        expectedResult = (len(t) >= 3) and t[2] or 0
+        testArgs = (len(t) >= 4) and "%s %s"%(runArgs, t[3]) or runArgs
+        expectedOutput = (len(t) >= 5) and t[4] or None
 
         if(os.sep == '\\'):
             executable = (csoundExecutable == "") and "..\csound.exe" or csoundExecutable
-            command = "%s %s %s %s 2> %s"%(executable, parserType, runArgs, filename, tempfile)
+            command = "%s %s %s %s 2> %s"%(executable, parserType, testArgs, filename, tempfile)
             print command
             retVal = os.system(command)
         else:
             executable = (csoundExecutable == "") and "../../csound" or csoundExecutable
-            command = "%s %s %s %s &> %s"%(executable, parserType, runArgs, filename, tempfile)
+            command = "%s %s %s %s &> %s"%(executable, parserType, testArgs, filename, tempfile)
             #print command
             retVal = os.system(command)
   
+        f = open(tempfile, "r")
+
+        csOutput = ""
+
+        for line in f:
+            csOutput += line
+
+        f.close()
+
+        # orchestras that check their own results with check.inc print
+        # TEST PASSED or TEST FAILED, as a failed check does not change
+        # the return code
+        f = open(filename, "r")
+        selfChecking = '#include "check.inc"' in f.read()
+        f.close()
+        checkFailed = "TEST FAILED" in csOutput or \
+            (selfChecking and "TEST PASSED" not in csOutput)
+
+        outputFailed = False
+        if expectedOutput is not None:
+            if expectedOutput.startswith("!"):
+                outputFailed = re.search(expectedOutput[1:], csOutput) is not None
+            else:
+                outputFailed = re.search(expectedOutput, csOutput) is None
+
         out = ""
-        if (retVal == 0) == (expectedResult == 0):
+        if (retVal == 0) == (expectedResult == 0) and not checkFailed \
+                and not outputFailed:
             testPass += 1
             out = "[pass] - "
         else:
@@ -183,21 +241,17 @@ def runTest():
 
         out += "Test %i: %s (%s)\n\tReturn Code: %i\tExpected: %d\n"%(counter, desc, filename, retVal, expectedResult
 )
+        if checkFailed:
+            out += "\tThe orchestra's own checks failed\n"
+        if outputFailed:
+            out += "\tThe output does not match %s\n"%expectedOutput
         print out
         output += "%s\n"%("=" * 80)
         output += "Test %i: %s (%s)\nReturn Code: %i\n"%(counter, desc, filename, retVal)
         output += "%s\n\n"%("=" * 80)
-        f = open(tempfile, "r")
-
-        csOutput = ""
-
-        for line in f:
-            csOutput += line
 
         output += csOutput
 
-        f.close()
-
         retVals.append(t + [retVal, csOutput])
 
         output += "\n\n"
@@ -35,7 +35,7 @@ class TestApplication(Frame):
     def list_has_changed(self, selection):
         if len(selection) > 0:
             self.textBox.delete(1.0, END)
-            self.textBox.insert(END, self.results[int(selection[0])][3])
+            self.textBox.insert(END, self.results[int(selection[0])][-1])
 
     def setResults(self, results):
         self.results = results